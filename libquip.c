@@ -0,0 +1,7392 @@
+
+/*
+ *	libquip.c - the cryptoquip solving engine behind quip, based on the
+ *				idea that any quip might have several valid legends, or
+ *				valid substitution sets.
+ *
+ *				All the state of solving one cyphertext is in a solve
+ *				context, and the words are in a dictionary that's only
+ *				read while solving - so this can be used by a server, or
+ *				by several threads solving at once. See quip.h.
+ *
+ *	Copyright 2000 Robert E. Beaty, Ph.D. All Rights Reserved
+ */
+
+/*
+ *	Standard system-level includes
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <strings.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <math.h>
+
+/*
+ *	The dictionary pattern matcher can use the SSE2 vector unit to
+ *	check a whole block of words against a cypherword at once. If
+ *	it's not there - or QUIP_NO_SIMD is defined - the scalar version
+ *	of the same matcher is used instead.
+ */
+#if defined(__SSE2__) && !defined(QUIP_NO_SIMD)
+#include <emmintrin.h>
+#define QUIP_SIMD
+#endif
+
+/*
+ *	The public interface to the library
+ */
+#include "quip.h"
+
+
+/************************************************************************
+ *
+ *	Arena functions
+ *
+ *	These functions hand out the memory for solving one cyphertext
+ *	from a few big chunks, so that it all goes away at once when the
+ *	arena is reset - no matter how many pieces there were. Each solve
+ *	context has its own, so the threads solving at the same time are
+ *	never waiting on one another in malloc().
+ *
+ ************************************************************************/
+/*
+ *	This routine creates a new, empty, arena that will get its memory
+ *	in chunks of 'chunkSize' bytes - or more, for the pieces that are
+ *	bigger than that. Nothing is allocated until it's needed.
+ */
+quipArena *CreateArena(size_t chunkSize) {
+	quipArena		*retval = NULL;
+
+	retval = (quipArena *) calloc(1, sizeof(quipArena));
+	if (retval == NULL) {
+		fprintf(stderr, "*** Error in CreateArena() ***\n"
+						"    A new arena could not be allocated. This is a\n"
+						"    serious allocation error.\n");
+	} else {
+		retval->chunkSize = (chunkSize > 0 ? chunkSize : ARENA_CHUNK_SIZE);
+	}
+
+	return retval;
+}
+
+
+/*
+ *	This routine releases all the chunks of the arena, and the arena
+ *	itself. Anything that was handed out is gone with it.
+ */
+quipArena *DestroyArena(quipArena *arena) {
+	if (arena != NULL) {
+		arenaChunk	*chunk = arena->head;
+		arenaChunk	*next = NULL;
+
+		while (chunk != NULL) {
+			next = chunk->next;
+			free(chunk);
+			chunk = next;
+		}
+		free(arena);
+	}
+
+	return NULL;
+}
+
+
+/*
+ *	This routine gives back everything that was handed out by the
+ *	arena in one go - it just starts over at the first chunk. The
+ *	chunks are kept for what comes next, unless a really big solve
+ *	left the arena holding on to more than ARENA_RETAIN_SIZE bytes,
+ *	and then all but the first chunk are let go.
+ */
+void ResetArena(quipArena *arena) {
+	if ((arena == NULL) || (arena->head == NULL)) {
+		return;
+	}
+
+	if (arena->retained > ARENA_RETAIN_SIZE) {
+		arenaChunk	*chunk = arena->head->next;
+		arenaChunk	*next = NULL;
+
+		while (chunk != NULL) {
+			next = chunk->next;
+			free(chunk);
+			chunk = next;
+		}
+		arena->head->next = NULL;
+		arena->retained = arena->head->size;
+	}
+	arena->head->used = 0;
+	arena->current = arena->head;
+	arena->last = NULL;
+	arena->allocations = 0;
+	arena->allocatedBytes = 0;
+	arena->chunkAllocations = 0;
+}
+
+
+/*
+ *	This routine hands out 'size' bytes from the arena - aligned for
+ *	anything - or from the heap if the arena is NULL. When the current
+ *	chunk is full, it moves on to the next one that was kept from
+ *	before, or makes a new one if that one isn't big enough.
+ */
+void *ArenaAlloc(quipArena *arena, size_t size) {
+	void		*retval = NULL;
+	arenaChunk	*chunk = NULL;
+
+	if (arena == NULL) {
+		return malloc(size);
+	}
+
+	// everything is handed out in multiples of the alignment
+	size = (size + (ARENA_ALIGNMENT - 1)) & ~((size_t) (ARENA_ALIGNMENT - 1));
+	if (size == 0) {
+		size = ARENA_ALIGNMENT;
+	}
+	arena->allocations++;
+	arena->allocatedBytes += size;
+
+	// see if it fits in the current chunk, or the one after it
+	chunk = arena->current;
+	if ((chunk != NULL) && ((chunk->size - chunk->used) < size)) {
+		if ((chunk->next != NULL) && (chunk->next->size >= size)) {
+			chunk = chunk->next;
+			chunk->used = 0;
+			arena->current = chunk;
+		} else {
+			chunk = NULL;
+		}
+	}
+
+	// ...and if not, we need a new chunk right after the current one
+	if (chunk == NULL) {
+		size_t	chunkSize = (size > arena->chunkSize ? size : arena->chunkSize);
+
+		chunk = (arenaChunk *) malloc(ARENA_CHUNK_HEADER + chunkSize);
+		if (chunk == NULL) {
+			fprintf(stderr, "*** Error in ArenaAlloc() ***\n"
+							"    A new chunk of %lu bytes could not be added to the\n"
+							"    arena. This is a serious allocation error.\n",
+							(unsigned long) (ARENA_CHUNK_HEADER + chunkSize));
+			return NULL;
+		}
+		chunk->size = chunkSize;
+		chunk->used = 0;
+		if (arena->current == NULL) {
+			chunk->next = NULL;
+			arena->head = chunk;
+		} else {
+			chunk->next = arena->current->next;
+			arena->current->next = chunk;
+		}
+		arena->current = chunk;
+		arena->retained += chunkSize;
+		arena->chunkAllocations++;
+	}
+
+	// now just take it off the front of what's left in the chunk
+	retval = ((char *) chunk) + ARENA_CHUNK_HEADER + chunk->used;
+	chunk->used += size;
+	arena->last = retval;
+
+	return retval;
+}
+
+
+/*
+ *	This routine grows the piece 'ptr' of 'oldSize' bytes to be
+ *	'newSize' bytes - on the heap if the arena is NULL. In an arena,
+ *	the last piece handed out can grow right where it is if there's
+ *	room in the chunk, otherwise it's copied to a new piece, and the
+ *	old one is just left until the arena is reset.
+ */
+void *ArenaRealloc(quipArena *arena, void *ptr, size_t oldSize, size_t newSize) {
+	void		*retval = NULL;
+
+	if (arena == NULL) {
+		return realloc(ptr, newSize);
+	}
+	if (ptr == NULL) {
+		return ArenaAlloc(arena, newSize);
+	}
+
+	// see if we can just grow it in place
+	if ((ptr == arena->last) && (arena->current != NULL)) {
+		arenaChunk	*chunk = arena->current;
+		size_t		start = (char *) ptr - ((char *) chunk + ARENA_CHUNK_HEADER);
+		size_t		size = (newSize + (ARENA_ALIGNMENT - 1)) & ~((size_t) (ARENA_ALIGNMENT - 1));
+
+		if ((start + size) <= chunk->size) {
+			chunk->used = start + size;
+			return ptr;
+		}
+	}
+
+	// ...otherwise it has to be moved
+	retval = ArenaAlloc(arena, newSize);
+	if (retval != NULL) {
+		memcpy(retval, ptr, (oldSize < newSize ? oldSize : newSize));
+	}
+
+	return retval;
+}
+
+
+/*
+ *	This routine gives back the piece 'ptr' - to the heap if the arena
+ *	is NULL. An arena only takes back the last piece it handed out,
+ *	as that's just backing up in the chunk. Everything else stays
+ *	until the arena is reset.
+ */
+void ArenaFree(quipArena *arena, void *ptr) {
+	if (arena == NULL) {
+		free(ptr);
+	} else if ((ptr != NULL) && (ptr == arena->last) && (arena->current != NULL)) {
+		arena->current->used = (char *) ptr - ((char *) arena->current + ARENA_CHUNK_HEADER);
+		arena->last = NULL;
+	}
+}
+
+
+/*
+ *	This routine makes a copy of the string 'str' in the arena - or
+ *	on the heap if the arena is NULL.
+ */
+char *ArenaStrdup(quipArena *arena, char *str) {
+	char		*retval = NULL;
+	size_t		len = 0;
+
+	if (str != NULL) {
+		len = strlen(str) + 1;
+		retval = (char *) ArenaAlloc(arena, len);
+		if (retval != NULL) {
+			memcpy(retval, str, len);
+		}
+	}
+
+	return retval;
+}
+
+
+/************************************************************************
+ *
+ *	Cypherword functions
+ *
+ *	These functions are used to allow the main code to manipulate
+ *	the cypherwords at a very high level and not have to do a loe
+ *	of low-level textual manipulation. In a more OO design, these
+ *	would be the methods on the cyphertext object.
+ *
+ ************************************************************************/
+/*
+ *	This is an interesting little routine - it looks at a
+ *	plaintext and cyphertext and sees if the pattern of
+ *	characters exhibited in both match. If they do, then
+ *	this routine returns TRUE, if not, then it returns
+ *	FALSE.
+ */
+BOOL DoPatternsMatch(char *cyphertext, char *plaintext) {
+	BOOL		error = NO;
+	BOOL		matched = YES;
+	BOOL		finished = NO;
+
+	// first, see if we have an easy match or not...
+	if (!error && !finished) {
+		if ((cyphertext == NULL) && (plaintext == NULL)) {
+			// they are both NULL, so they match - sort-of...
+			matched = YES;
+			finished = YES;
+		} else if ((cyphertext == NULL) || (plaintext == NULL)) {
+			// one is NULL and the other isn't - no match
+			matched = NO;
+			finished = YES;
+		}
+	}
+
+	// OK... check the length of the strings
+	if (!error && !finished) {
+		if (strlen(cyphertext) != strlen(plaintext)) {
+			// wrong length
+			matched = NO;
+			finished = YES;
+		}
+	}
+
+	// now check the pattern of characters
+	if (!error && !finished) {
+		int		i, j;
+		int		len = strlen(cyphertext);
+		char	cypherchar, plainchar;
+
+		for (i = 0; (i < len) && (!finished); i++) {
+			// get the cyphertext and plaintext characters
+			cypherchar = cyphertext[i];
+			plainchar = plaintext[i];
+
+			// check all the remaining chars for the same match
+			for (j = (i+1); (j < len) && (!finished); j++) {
+				/*
+				 *	Check for a repeating in one text and not
+				 *	in the other. If they both don't match,
+				 *	then stop checking.
+				 */
+				if (((cyphertext[j] == cypherchar) &&
+				     (plaintext[j] != plainchar)) ||
+				    ((plaintext[j] == plainchar) &&
+					 (cyphertext[j] != cypherchar))) {
+					matched = NO;
+					finished = YES;
+					break;
+				}
+			}
+		}
+	}
+
+	return error ? error : matched;
+}
+
+
+/*
+ *	This is an interesting little routine... It takes three things:
+ *	a cyphertext, a legned and a plaintext - along with a
+ *	'mustBeComplete' boolean flag, and sees if the legend can be
+ *	used to generate the plaintext from the cyphertext. If the
+ *	'mustBeComplete' is YES, then the legend must completly decode
+ *	the cyphertext into the plaintext. Otherwise, 'holes' in the
+ *	conversion are assumed to be in the favor of the match.
+ *
+ *	This can be used to see if a legend and a cyphertext are on
+ *	the right track to the plsintext - or, if they are 100% there.
+ *	The boolean return value simply says 'Yes' they match.
+ */
+BOOL CanCypherAndLegendMakePlain(char *cyphertext, legend *map, char *plaintext, BOOL mustBeComplete, BOOL noSelfMapping) {
+	BOOL		error = NO;
+	BOOL		finished = NO;
+	BOOL		mismatch = NO;
+
+	// first, let's make sure we have something to do
+	if (!error && !finished) {
+		if (cyphertext == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in CanCypherAndLegendMakePlain() ***\n"
+							"    The cyphertext is NULL, and that means we have\n"
+							"    nothing to do. Please make sure it isn't NULL.\n");
+		}
+	}
+	if (!error && !finished) {
+		if (map == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in CanCypherAndLegendMakePlain() ***\n"
+							"    The legend is NULL, and that means that we have\n"
+							"    nothing to do. Please make sure it isn't NULL.\n");
+		}
+	}
+	if (!error && !finished) {
+		if (plaintext == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in CanCypherAndLegendMakePlain() ***\n"
+							"    The plaintext is NULL, and that means we have\n"
+							"    nothing to do. Please make sure it isn't NULL.\n");
+		}
+	}
+
+	// well... see if they are the right length
+	if (!error && !finished) {
+		if (strlen(cyphertext) != strlen(plaintext)) {
+			mismatch = YES;
+			finished = YES;
+		}
+	}
+
+	// now we need to check each character in the mapping
+	if (!error && !finished) {
+		int			i;
+		char		ppc;
+
+		for (i = 0; i < strlen(cyphertext); i++) {
+			// get the possible plaintext char from the mapping
+			ppc = CypherToPlainChar(map, tolower(cyphertext[i]));
+
+			// check for completness based on the user's desires
+			if ((ppc == 0) && mustBeComplete) {
+				mismatch = YES;
+				finished = YES;
+				break;
+			}
+
+			// now see if they match
+			if (ppc != 0) {
+				if (tolower(ppc) != tolower(plaintext[i])) {
+					mismatch = YES;
+					finished = YES;
+				}
+			} else if (noSelfMapping && isalpha(cyphertext[i]) &&
+					   (tolower(cyphertext[i]) == tolower(plaintext[i]))) {
+				// no letter in the quip can stand for itself
+				mismatch = YES;
+				finished = YES;
+			}
+		}
+	}
+
+	return error ? NO : !mismatch;
+}
+
+
+/*
+ *	This routine returns the set of letters used in the string as
+ *	a 26-bit mask - bit 0 is 'a' and bit 25 is 'z' - regardless of
+ *	case. Anything that's not a letter is simply ignored.
+ */
+unsigned int GetLetterMaskOfString(char *str) {
+	unsigned int	retval = 0;
+	int				i;
+
+	if (str != NULL) {
+		for (i = 0; str[i] != '\0'; i++) {
+			if (isalpha(str[i])) {
+				retval |= (1 << (tolower(str[i]) - 'a'));
+			}
+		}
+	}
+
+	return retval;
+}
+
+
+/*
+ *	This is the first-stage filter on a possible plaintext for a
+ *	cypherword and legend, and it's done with nothing but the letter
+ *	sets. 'assigned' is the set of plaintext letters the legend has
+ *	for the cypherchars in this cypherword, and 'used' is the set of
+ *	all the plaintext letters in the legend. The possible has to have
+ *	every one of the 'assigned' letters in it, and it can't have any
+ *	other letter from 'used' - that letter would have to come from a
+ *	cypherchar not yet in the legend, and the legend already has it
+ *	going to another cypherchar.
+ *
+ *	If this returns NO, the legend can't possibly make the plaintext.
+ *	If it returns YES, the character-by-character check is still
+ *	needed to be sure.
+ */
+BOOL CanLetterMasksMakePlain(unsigned int possible, unsigned int assigned, unsigned int used) {
+	return (((possible & assigned) == assigned) && ((possible & used & ~assigned) == 0));
+}
+
+
+/*
+ *	This is an interesting little routine... It takes a cypherword
+ *	and a legend and sees which, if any, of the possible plaintexts
+ *	this cypherword has matches the legend and the cyphertext. If
+ *	'mustBeComplete' is TRUE, then there can be no 'missing' letters
+ *	in the mapping. If it's FALSE, then missing letters are OK.
+ *
+ *	The return value will be a pointer to a copy of the cypherword's
+ *	possible plaintext, or NULL, if none is found. The caller is
+ *	expected to free this copy when they are done with it.
+ */
+char *GetPossibleOfCypherwordForLegend(cypherword *word, legend *map, BOOL mustBeComplete) {
+	BOOL		error = NO;
+	BOOL		finished = NO;
+	char		*retval = NULL;
+
+	// first, let's make sure we have something to do
+	if (!error && !finished) {
+		if (word == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in GetPossibleOfCypherwordForLegend() ***\n"
+							"    The cypherword is NULL, and that means we have\n"
+							"    nothing to do. Please make sure it isn't NULL.\n");
+		}
+	}
+	if (!error && !finished) {
+		if (map == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in GetPossibleOfCypherwordForLegend() ***\n"
+							"    The legend is NULL, and that means that we have\n"
+							"    nothing to do. Please make sure it isn't NULL.\n");
+		}
+	}
+
+	// next, we need to look at each one of the possibles and check it
+	if (!error && !finished) {
+		int				i;
+		unsigned int	used = GetPlainLetterMaskOfLegend(map, ALL_LETTERS_MASK);
+		unsigned int	assigned = GetPlainLetterMaskOfLegend(map, word->cypherLetterMask);
+
+		for (i = 0; (i < word->numberOfPossibles) && !finished; i++) {
+			// the letter sets are a quick way to skip most of them
+			if (!CanLetterMasksMakePlain(word->possibleLetterMask[i], assigned, used)) {
+				continue;
+			}
+			if (CanCypherAndLegendMakePlain(word->cyphertext, map, word->possiblePlaintext[i], mustBeComplete, NO)) {
+				// we have a match!
+				finished = YES;
+				// ...now copy it for return to the caller
+				retval = strdup(word->possiblePlaintext[i]);
+				if (retval == NULL) {
+					error = YES;
+					fprintf(stderr, "*** Error in GetPossibleOfCypherwordForLegend() ***\n"
+									"    A copy of the plaintext word that matches this cypherword\n"
+									"    and legend could not be obtained due to memory allocation\n"
+									"    problems. This is too bad because we had a solution.\n");
+				}
+			}
+		}
+	}
+
+	return error ? NULL : retval;
+}
+
+
+/*
+ *	This is an interesting routine... it returns TRUE if the legend
+ *	TOTALLY decodes the cypherword into one of it's possible
+ *	plaintext words. This routine calls the more general routine
+ *	GetPossibleOfCypherwordForLegend() with the 'mustBeComplete'
+ *	argument set to TRUE.
+ *
+ *	This routine is very helpful in testing a legend to see if it
+ *	decodes all the cypherwords - one at a time.
+ */
+BOOL IsCypherwordDecryptedByLegend(cypherword *word, legend *map) {
+	BOOL		error = NO;
+	BOOL		retval = NO;
+	char		*plaintext = NULL;
+
+	// first, let's make sure we have something to do
+	if (!error) {
+		if (word == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in IsCypherwordDecryptedByLegend() ***\n"
+							"    The cypherword is NULL, and that means we have\n"
+							"    nothing to do. Please make sure it isn't NULL.\n");
+		}
+	}
+	if (!error) {
+		if (map == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in IsCypherwordDecryptedByLegend() ***\n"
+							"    The legend is NULL, and that means that we have\n"
+							"    nothing to do. Please make sure it isn't NULL.\n");
+		}
+	}
+
+	// next, let's see what the word might be...
+	if (!error) {
+		plaintext = GetPossibleOfCypherwordForLegend(word, map, TRUE);
+		if (plaintext == NULL) {
+			retval = NO;
+		} else {
+			retval = YES;
+			// don't forget to free the plaintext we received
+			free(plaintext);
+		}
+	}
+
+	return error ? error : retval;
+}
+
+
+/*
+ *	This routine creates a new cypherword based on the passed-in
+ *	character string as the basis of the cyphertext. The cypherword
+ *	structure that's returned is completly initialized for use in
+ *	this system.
+ */
+cypherword *CreateCypherword(char *str) {
+	return CreateCypherwordInArena(NULL, str);
+}
+
+
+/*
+ *	This routine creates a new cypherword just like CreateCypherword()
+ *	but it, and everything it ever needs, comes from the arena - if
+ *	it's not NULL.
+ */
+cypherword *CreateCypherwordInArena(quipArena *arena, char *str) {
+	BOOL		error = NO;
+	cypherword	*retval = NULL;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if (str == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in CreateCypherword() ***\n"
+							"    The passed-in cyphertext was NULL and so no\n"
+							"    cypherword will be created. Try to call this\n"
+							"    routine with a valid cyphertext string.\n");
+		}
+	}
+
+	// next, we need to allocate a new cypherword structure
+	if (!error) {
+		retval = (cypherword *) ArenaAlloc(arena, sizeof(cypherword));
+		if (retval == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in CreateCypherword() ***\n"
+							"    A new, blank, cypherword could not be allocated.\n"
+							"    This is a significant problem and we can't do anymore.\n");
+		}
+	}
+
+	// now we can set up the cypherword's internal variables
+	if (!error) {
+		// first, set the length of the cyphertext
+		retval->arena = arena;
+		retval->possiblePlaintext = NULL;
+		retval->length = strlen(str);
+		retval->cypherLetterMask = GetLetterMaskOfString(str);
+		retval->occurrences = 1;
+		retval->possiblesShareCount = NULL;
+		retval->possibleLetterMask = NULL;
+
+		// next, copy the cyphertext
+		retval->cyphertext = ArenaStrdup(arena, str);
+		if (retval->cyphertext == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in CreateCypherword() ***\n"
+							"    While trying to initialize the new cypherword, the\n"
+							"    cyphertext could not be copied into the cypherword's\n"
+							"    internal structures. This is a serious problem.\n");
+		}
+
+		// next, allocate the starting possible array
+		if (!error) {
+			retval->possiblePlaintext = (char **) ArenaAlloc(arena, STARTING_POSSIBLES_SIZE * sizeof(char*));
+			retval->possibleLetterMask = (unsigned int *) ArenaAlloc(arena, STARTING_POSSIBLES_SIZE * sizeof(unsigned int));
+			if ((retval->possiblePlaintext == NULL) || (retval->possibleLetterMask == NULL)) {
+				error = YES;
+				fprintf(stderr, "*** Error in CreateCypherword() ***\n"
+								"    The initial array for holding possible plaintext matches\n"
+								"    to this cypherword could not be allocated. This is a\n"
+								"    serious problem and is cause for great concern.\n");
+			} else {
+				// all went OK, so save the size and number used
+				retval->possiblePlaintextSize = STARTING_POSSIBLES_SIZE;
+				retval->numberOfPossibles = 0;
+			}
+		}
+	}
+
+	// if I've run into troubles, I need to free what I might have allocated
+	if (error) {
+		if (retval != NULL) {
+			retval = DestroyCypherword(retval);
+		}
+	}
+
+	return error ? NULL : retval;
+}
+
+
+/*
+ *	When a cypherword structure is no longer needed, this routine
+ *	can be called to carefully remove all the resources used in
+ *	the structure so that when it's gone, there's a 'zero sum'
+ *	resource game.
+ */
+cypherword *DestroyCypherword(cypherword *word) {
+	BOOL		error = NO;
+	BOOL		finished = NO;
+
+	// first, make sure we have something to do
+	if (!error && !finished) {
+		if (word == NULL) {
+			// while we could flag this as an error, we can
+			// leave it be as a NULL is already 'destroyed'
+			finished = YES;
+		}
+	}
+
+	// now we need to release the cyphertext in this cypherword
+	if (!error && !finished) {
+		if (word->cyphertext != NULL) {
+			ArenaFree(word->arena, word->cyphertext);
+		}
+	}
+
+	/*
+	 *	Now we need to release the arrays of possibles - but only if
+	 *	they are ours. The plaintexts themselves are in the dictionary.
+	 */
+	if (!error && !finished && (word->possiblesShareCount != NULL)) {
+		if (--(*word->possiblesShareCount) > 0) {
+			word->possiblePlaintext = NULL;
+			word->possibleLetterMask = NULL;
+		} else {
+			ArenaFree(word->arena, word->possiblesShareCount);
+		}
+		word->possiblesShareCount = NULL;
+	}
+	if (!error && !finished) {
+		if (word->possiblePlaintext != NULL) {
+			ArenaFree(word->arena, word->possiblePlaintext);
+		}
+		if (word->possibleLetterMask != NULL) {
+			ArenaFree(word->arena, word->possibleLetterMask);
+		}
+	}
+
+	// finally, we need to release the cypherword itself
+	if (!error && !finished) {
+		ArenaFree(word->arena, word);
+	}
+
+	return NULL;
+}
+
+
+/*
+ *	This routine takes a cypherword and a character string and
+ *	checks to see if the string has the right structural pattern
+ *	to match the cypherword. If so, the cypherword adds this
+ *	character string to it's list of possible plaintext words.
+ *	The string is not copied, so it has to be around as long as
+ *	the cypherword is.
+ */
+BOOL CheckCypherwordForPossiblePlaintext(cypherword *word, char *str) {
+	BOOL		error = NO;
+	BOOL		finished = NO;
+
+	// first, check and see if we have something to do
+	if (!error && !finished) {
+		if (word == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in CheckCypherwordForPossiblePlaintext() ***\n"
+							"    The passed-in cypherword was NULL, and therefore nothing\n"
+							"    can be used to check against the plaintext. This is most\n"
+							"    likely a bad argument call.\n");
+		}
+	}
+	if (!error && !finished) {
+		if (str == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in CheckCypherwordForPossiblePlaintext() ***\n"
+							"    The passed in plaintext is NULL, and therefore nothing\n"
+							"    can really be done. Please check arguments before calling.\n");
+		}
+	}
+
+	// now we need to see if the pattern matches
+	if (!error && !finished) {
+		if (!DoPatternsMatch(word->cyphertext, str)) {
+			// they don't match, so stop checking
+			finished = YES;
+		}
+	}
+
+	// if we're here, then add it to the array of possibles
+	if (!error && !finished) {
+		if (!AddPossiblePlaintextToCypherword(word, str)) {
+			error = YES;
+		}
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine adds the character string to the cypherword's list
+ *	of possible plaintext words without checking the pattern - it's
+ *	assumed that the caller has already done that. The string is not
+ *	copied - it's almost always a word in the dictionary - so it has
+ *	to be around as long as the cypherword is.
+ */
+BOOL AddPossiblePlaintextToCypherword(cypherword *word, char *str) {
+	BOOL		error = NO;
+	BOOL		finished = NO;
+
+	// first, check and see if we have something to do
+	if (!error && !finished) {
+		if ((word == NULL) || (str == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in AddPossiblePlaintextToCypherword() ***\n"
+							"    The passed-in cypherword or plaintext was NULL, and\n"
+							"    therefore nothing can be added. This is most likely\n"
+							"    a bad argument call.\n");
+		}
+	}
+
+	/*
+	 *	Add it to the array of possibles.
+	 *	First, see if we have room in the already allocated array,
+	 *	and if not, we need to up that by the appropriate amount.
+	 *	When we have room in the array, we then need to copy the
+	 *	plaintext over to the next available slot.
+	 *
+	 *	First, check to see if we have room in this array...
+	 */
+	if (!error && !finished) {
+		if (word->numberOfPossibles == word->possiblePlaintextSize) {
+			/*
+			 *	OK... we need to expand the array the right amount -
+			 *	doubling it, as a cypherword can have thousands of
+			 *	possibles, and in an arena every old array is just
+			 *	left behind.
+			 */
+			int		size = (word->possiblePlaintextSize == 0 ? STARTING_POSSIBLES_SIZE : (2 * word->possiblePlaintextSize));
+
+			word->possiblePlaintext = (char **) ArenaRealloc(word->arena, word->possiblePlaintext,
+									word->possiblePlaintextSize * sizeof(char *), size * sizeof(char *));
+			word->possibleLetterMask = (unsigned int *) ArenaRealloc(word->arena, word->possibleLetterMask,
+									word->possiblePlaintextSize * sizeof(unsigned int), size * sizeof(unsigned int));
+			if ((word->possiblePlaintext == NULL) || (word->possibleLetterMask == NULL)) {
+				error = YES;
+				fprintf(stderr, "*** Error in AddPossiblePlaintextToCypherword() ***\n"
+								"    While trying to add the plaintext word '%s' to the\n"
+								"    array of possible plaintext words for this cypherword,\n"
+								"	the array needed to be expanded to hold %d words, but\n"
+								"    couldn't. This is a real big problem!\n", str, size);
+
+				// if it's gone, we need to update the sizes
+				word->possiblePlaintextSize = 0;
+				word->numberOfPossibles = 0;
+			} else {
+				/*
+				 *	OK! it worked, so let's reflect the size change
+				 */
+				word->possiblePlaintextSize = size;
+			}
+		}
+	}
+
+	// now, we can place the string, and the letters it uses, in the next slot
+	if (!error && !finished) {
+		word->possiblePlaintext[word->numberOfPossibles] = str;
+		word->possibleLetterMask[word->numberOfPossibles] = GetLetterMaskOfString(str);
+		word->numberOfPossibles++;
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine makes the cypherword share the possibles of the
+ *	'owner' cypherword - which must have the same pattern. Whatever
+ *	possibles the cypherword had of its own are released first. The
+ *	arrays are counted, so whichever of the two is destroyed last
+ *	releases them.
+ */
+BOOL ShareCypherwordPossibles(cypherword *word, cypherword *owner) {
+	BOOL		error = NO;
+
+	if ((word != NULL) && (owner != NULL) && (word != owner) &&
+		(word->possiblePlaintext != owner->possiblePlaintext)) {
+		if (owner->possiblesShareCount == NULL) {
+			owner->possiblesShareCount = (int *) ArenaAlloc(owner->arena, sizeof(int));
+			if (owner->possiblesShareCount == NULL) {
+				error = YES;
+				fprintf(stderr, "*** Error in ShareCypherwordPossibles() ***\n"
+								"    The share count for the possibles of '%s' could not\n"
+								"    be created. This is a serious problem.\n",
+								owner->cyphertext);
+			} else {
+				*owner->possiblesShareCount = 1;
+			}
+		}
+		if (!error) {
+			if (!MakeCypherwordPossiblesPrivate(word)) {
+				error = YES;
+			}
+		}
+		if (!error) {
+			if (word->possiblePlaintext != NULL) {
+				ArenaFree(word->arena, word->possiblePlaintext);
+			}
+			if (word->possibleLetterMask != NULL) {
+				ArenaFree(word->arena, word->possibleLetterMask);
+			}
+			word->possiblePlaintext = owner->possiblePlaintext;
+			word->possibleLetterMask = owner->possibleLetterMask;
+			word->numberOfPossibles = owner->numberOfPossibles;
+			word->possiblePlaintextSize = owner->possiblePlaintextSize;
+			word->possiblesShareCount = owner->possiblesShareCount;
+			(*word->possiblesShareCount)++;
+		}
+	}
+
+	return !error;
+}
+
+
+/*
+ *	The shared arrays of possibles are read-only. Before anything
+ *	re-orders or removes possibles from a cypherword, it has to call
+ *	this routine to get its own copy of the arrays if it's sharing
+ *	them with another cypherword.
+ */
+BOOL MakeCypherwordPossiblesPrivate(cypherword *word) {
+	BOOL			error = NO;
+	char			**plain = NULL;
+	unsigned int	*masks = NULL;
+	int				size;
+
+	if ((word != NULL) && (word->possiblesShareCount != NULL) &&
+		(*word->possiblesShareCount == 1)) {
+		// we're the last one using them, so they're already ours
+		ArenaFree(word->arena, word->possiblesShareCount);
+		word->possiblesShareCount = NULL;
+	}
+	if ((word != NULL) && (word->possiblesShareCount != NULL)) {
+		size = (word->numberOfPossibles > 0 ? word->numberOfPossibles : 1);
+		plain = (char **) ArenaAlloc(word->arena, size * sizeof(char *));
+		masks = (unsigned int *) ArenaAlloc(word->arena, size * sizeof(unsigned int));
+		if ((plain == NULL) || (masks == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in MakeCypherwordPossiblesPrivate() ***\n"
+							"    The cypherword '%s' could not get its own copy of\n"
+							"    the %d possibles it shares. This is a serious problem.\n",
+							word->cyphertext, word->numberOfPossibles);
+			if (masks != NULL) {
+				ArenaFree(word->arena, masks);
+			}
+			if (plain != NULL) {
+				ArenaFree(word->arena, plain);
+			}
+		} else {
+			memcpy(plain, word->possiblePlaintext, word->numberOfPossibles * sizeof(char *));
+			memcpy(masks, word->possibleLetterMask, word->numberOfPossibles * sizeof(unsigned int));
+			word->possiblePlaintext = plain;
+			word->possibleLetterMask = masks;
+			word->possiblePlaintextSize = size;
+			(*word->possiblesShareCount)--;
+			word->possiblesShareCount = NULL;
+		}
+	}
+
+	return !error;
+}
+
+
+/************************************************************************
+ *
+ *	Dictionary functions
+ *
+ *	These functions are used to hold the words file in memory in a
+ *	form that makes it quick to find all the words that match the
+ *	pattern of a cypherword. In a more OO design, these would be the
+ *	methods on the dictionary object.
+ *
+ ************************************************************************/
+/*
+ *	This routine creates a new, empty, dictionary that's ready to
+ *	have words added to it.
+ */
+dictionary *CreateDictionary() {
+	BOOL		error = NO;
+	dictionary	*retval = NULL;
+
+	// first, let's get the space, if we can
+	if (!error) {
+		retval = (dictionary *) malloc(sizeof(dictionary));
+		if (retval == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in CreateDictionary() ***\n"
+							"    The creation of the dictionary structure failed in\n"
+							"    trying to get the necessary memory from the\n"
+							"    pool. This is a serious memory problem.\n");
+		}
+	}
+
+	// now we can set it up as empty
+	if (!error) {
+		retval->wordCount = 0;
+		retval->maxLength = 0;
+		retval->buckets = NULL;
+		retval->image = NULL;
+		retval->imageSize = 0;
+	}
+
+	return error ? NULL : retval;
+}
+
+
+/*
+ *	When a dictionary is no longer needed, this routine can be
+ *	called to release all the words and indexes it contains, and
+ *	then the dictionary itself. If they're in a mapped image, it's
+ *	just unmapped.
+ */
+dictionary *DestroyDictionary(dictionary *dict) {
+	int		i;
+
+	if (dict != NULL) {
+		if (dict->image != NULL) {
+			munmap(dict->image, dict->imageSize);
+			if (dict->buckets != NULL) {
+				free(dict->buckets);
+			}
+		} else if (dict->buckets != NULL) {
+			for (i = 0; i <= dict->maxLength; i++) {
+				if (dict->buckets[i].text != NULL) {
+					free(dict->buckets[i].text);
+				}
+				if (dict->buckets[i].columns != NULL) {
+					free(dict->buckets[i].columns);
+				}
+			}
+			free(dict->buckets);
+		}
+		free(dict);
+	}
+
+	return NULL;
+}
+
+
+/*
+ *	This routine adds a copy of the word to the end of the bucket
+ *	in the dictionary for words of its length. The bucket (and the
+ *	array of buckets) are grown as needed. Empty words are simply
+ *	ignored as they can't match any cypherword. Note that this does
+ *	NOT update the transposed blocks of the bucket - that's done
+ *	all at once with IndexDictionary() after all the words are in.
+ */
+BOOL AddWordToDictionary(dictionary *dict, char *str) {
+	BOOL		error = NO;
+	BOOL		finished = NO;
+	int			len = 0;
+
+	// first, check and see if we have something to do
+	if (!error && !finished) {
+		if ((dict == NULL) || (str == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in AddWordToDictionary() ***\n"
+							"    The passed-in dictionary or word was NULL, and\n"
+							"    therefore nothing can be added. This is most likely\n"
+							"    a bad argument call.\n");
+		} else {
+			len = strlen(str);
+			if (len == 0) {
+				finished = YES;
+			}
+		}
+	}
+
+	// see if we need more buckets to hold words this long
+	if (!error && !finished) {
+		if (len > dict->maxLength) {
+			dictionaryBucket	*more = NULL;
+			int					i;
+
+			more = (dictionaryBucket *) realloc(dict->buckets, (len + 1) * sizeof(dictionaryBucket));
+			if (more == NULL) {
+				error = YES;
+				fprintf(stderr, "*** Error in AddWordToDictionary() ***\n"
+								"    The array of dictionary buckets could not be expanded\n"
+								"    to hold words of length %d. This is a serious problem.\n", len);
+			} else {
+				// initialize all the new buckets as empty
+				for (i = (dict->buckets == NULL ? 0 : (dict->maxLength + 1)); i <= len; i++) {
+					more[i].length = i;
+					more[i].count = 0;
+					more[i].size = 0;
+					more[i].text = NULL;
+					more[i].columns = NULL;
+				}
+				dict->buckets = more;
+				dict->maxLength = len;
+			}
+		}
+	}
+
+	// now make sure the bucket has room for one more word
+	if (!error && !finished) {
+		dictionaryBucket	*bucket = &(dict->buckets[len]);
+
+		if (bucket->count == bucket->size) {
+			int		size = (bucket->size == 0 ? STARTING_DICTIONARY_SIZE : (2 * bucket->size));
+			char	*more = (char *) realloc(bucket->text, size * (len + 1) * sizeof(char));
+
+			if (more == NULL) {
+				error = YES;
+				fprintf(stderr, "*** Error in AddWordToDictionary() ***\n"
+								"    While trying to add the word '%s' to the dictionary,\n"
+								"    the bucket needed to be expanded to hold %d words, but\n"
+								"    couldn't. This is a real big problem!\n", str, size);
+			} else {
+				bucket->text = more;
+				bucket->size = size;
+			}
+		}
+
+		// ...and copy the word into the next slot
+		if (!error) {
+			memcpy(&(bucket->text[bucket->count * (len + 1)]), str, (len + 1));
+			bucket->count++;
+			dict->wordCount++;
+		}
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine adds all the words in the source dictionary to the
+ *	end of the matching buckets in the destination dictionary - in
+ *	the order they are in the source. It's how the dictionaries that
+ *	were loaded from each chunk of the file are put back together.
+ *	The destination needs to be re-indexed after this.
+ */
+BOOL AppendDictionary(dictionary *dest, dictionary *src) {
+	BOOL		error = NO;
+	int			len;
+
+	// first, check and see if we have something to do
+	if (!error) {
+		if ((dest == NULL) || (src == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in AppendDictionary() ***\n"
+							"    The passed-in source or destination dictionary was\n"
+							"    NULL, and therefore nothing can be appended. This is\n"
+							"    most likely a bad argument call.\n");
+		}
+	}
+
+	// make sure the destination has all the buckets it needs
+	if (!error && (src->maxLength > dest->maxLength)) {
+		dictionaryBucket	*more = NULL;
+
+		more = (dictionaryBucket *) realloc(dest->buckets, (src->maxLength + 1) * sizeof(dictionaryBucket));
+		if (more == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in AppendDictionary() ***\n"
+							"    The array of dictionary buckets could not be expanded\n"
+							"    to hold words of length %d. This is a serious problem.\n",
+							src->maxLength);
+		} else {
+			for (len = (dest->buckets == NULL ? 0 : (dest->maxLength + 1)); len <= src->maxLength; len++) {
+				more[len].length = len;
+				more[len].count = 0;
+				more[len].size = 0;
+				more[len].text = NULL;
+				more[len].columns = NULL;
+			}
+			dest->buckets = more;
+			dest->maxLength = src->maxLength;
+		}
+	}
+
+	// now tack each of the source buckets onto the destination's
+	for (len = 1; !error && (len <= src->maxLength); len++) {
+		dictionaryBucket	*from = &(src->buckets[len]);
+		dictionaryBucket	*to = &(dest->buckets[len]);
+
+		if (from->count == 0) {
+			continue;
+		}
+
+		if ((to->count + from->count) > to->size) {
+			int		size = to->count + from->count;
+			char	*more = (char *) realloc(to->text, size * (len + 1) * sizeof(char));
+
+			if (more == NULL) {
+				error = YES;
+				fprintf(stderr, "*** Error in AppendDictionary() ***\n"
+								"    The bucket for words of length %d needed to be\n"
+								"    expanded to hold %d words, but couldn't. This is a\n"
+								"    real big problem!\n", len, size);
+			} else {
+				to->text = more;
+				to->size = size;
+			}
+		}
+
+		if (!error) {
+			memcpy(&(to->text[to->count * (len + 1)]), from->text, from->count * (len + 1));
+			to->count += from->count;
+			dest->wordCount += from->count;
+		}
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This is the comparison for sorting the words of a bucket so the
+ *	duplicates end up next to one another - ignoring case, and then
+ *	by where they are in the bucket, so that the first of a run of
+ *	duplicates is the one that came first in the words file.
+ */
+int CompareDictionaryWords(const void *a, const void *b) {
+	char	*wordA = *((char **) a);
+	char	*wordB = *((char **) b);
+	int		retval = strcasecmp(wordA, wordB);
+
+	if (retval == 0) {
+		retval = (wordA < wordB ? -1 : (wordA > wordB ? 1 : 0));
+	}
+
+	return retval;
+}
+
+
+/*
+ *	This routine removes the words that are in the dictionary more
+ *	than once - ignoring case - keeping the first of each, and the
+ *	order of the rest. The words file has a few of these, and others
+ *	come from taking just the first run of letters on each line, as
+ *	with 'a&m' and 'a&p' both being 'a'. Each duplicate is another
+ *	possible that gives the very same decodings, so they only make
+ *	the attacks do the same work over again. This is part of loading
+ *	the words - the solutions are weeded out on their own, as they're
+ *	reported - and the dictionary needs to be re-indexed after it.
+ */
+BOOL RemoveDuplicateWordsFromDictionary(dictionary *dict) {
+	BOOL		error = NO;
+	int			len;
+
+	// first, check and see if we have something to do
+	if (!error) {
+		if (dict == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in RemoveDuplicateWordsFromDictionary() ***\n"
+							"    The passed-in dictionary was NULL, and therefore\n"
+							"    nothing can be removed. This is most likely a bad\n"
+							"    argument call.\n");
+		}
+	}
+
+	// now weed out each bucket on its own
+	for (len = 1; !error && (len <= dict->maxLength); len++) {
+		dictionaryBucket	*bucket = &(dict->buckets[len]);
+		char				**sorted = NULL;
+		char				*keep = NULL;
+		int					kept = 0;
+		int					w;
+
+		if (bucket->count < 2) {
+			continue;
+		}
+
+		sorted = (char **) malloc(bucket->count * sizeof(char *));
+		keep = (char *) malloc(bucket->count * sizeof(char));
+		if ((sorted == NULL) || (keep == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in RemoveDuplicateWordsFromDictionary() ***\n"
+							"    The list to sort the %d words of length %d could not\n"
+							"    be allocated. This is a serious problem.\n",
+							bucket->count, len);
+		} else {
+			// sort them to find the duplicates...
+			for (w = 0; w < bucket->count; w++) {
+				sorted[w] = &(bucket->text[w * (len + 1)]);
+				keep[w] = YES;
+			}
+			qsort(sorted, bucket->count, sizeof(char *), CompareDictionaryWords);
+			for (w = 1; w < bucket->count; w++) {
+				if (strcasecmp(sorted[w - 1], sorted[w]) == 0) {
+					keep[(sorted[w] - bucket->text) / (len + 1)] = NO;
+				}
+			}
+
+			// ...and slide the ones we're keeping down, in order
+			for (w = 0; w < bucket->count; w++) {
+				if (keep[w]) {
+					if (kept != w) {
+						memcpy(&(bucket->text[kept * (len + 1)]), &(bucket->text[w * (len + 1)]), (len + 1));
+					}
+					kept++;
+				}
+			}
+			dict->wordCount -= (bucket->count - kept);
+			bucket->count = kept;
+		}
+
+		if (sorted != NULL) {
+			free(sorted);
+		}
+		if (keep != NULL) {
+			free(keep);
+		}
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine builds the transposed blocks for each bucket in the
+ *	dictionary. For a bucket of words of length 'n', each block is
+ *	'n' rows of DICTIONARY_LANES characters - row 'i' holding the
+ *	i-th character of each of the words in the block. The unused
+ *	lanes of the last block are zero-filled.
+ */
+BOOL IndexDictionary(dictionary *dict) {
+	BOOL		error = NO;
+	int			len;
+
+	// first, check and see if we have something to do
+	if (!error) {
+		if (dict == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in IndexDictionary() ***\n"
+							"    The passed-in dictionary was NULL, and therefore\n"
+							"    nothing can be indexed. This is most likely a bad\n"
+							"    argument call.\n");
+		}
+	}
+
+	// now build the blocks for each bucket that has words
+	for (len = 1; !error && (len <= dict->maxLength); len++) {
+		dictionaryBucket	*bucket = &(dict->buckets[len]);
+		int					blocks = (bucket->count + DICTIONARY_LANES - 1) / DICTIONARY_LANES;
+		int					w, i;
+
+		if (bucket->columns != NULL) {
+			free(bucket->columns);
+			bucket->columns = NULL;
+		}
+		if (bucket->count == 0) {
+			continue;
+		}
+
+		bucket->columns = (unsigned char *) calloc(blocks * len * DICTIONARY_LANES, sizeof(unsigned char));
+		if (bucket->columns == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in IndexDictionary() ***\n"
+							"    The transposed blocks for the %d words of length %d\n"
+							"    could not be allocated. This is a serious problem.\n",
+							bucket->count, len);
+		} else {
+			for (w = 0; w < bucket->count; w++) {
+				unsigned char	*block = &(bucket->columns[(w / DICTIONARY_LANES) * len * DICTIONARY_LANES]);
+				char			*word = &(bucket->text[w * (len + 1)]);
+
+				for (i = 0; i < len; i++) {
+					block[(i * DICTIONARY_LANES) + (w % DICTIONARY_LANES)] = word[i];
+				}
+			}
+		}
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This is the thread routine that loads one chunk of the mapped
+ *	words file into the task's own dictionary. Each line is treated
+ *	just as if it were read with fgets() - the first run of letters,
+ *	apostrophes and dashes on the line is the word.
+ */
+void *LoadDictionaryChunk(void *arg) {
+	ingestTask	*task = (ingestTask *) arg;
+	char		linebuf[2048];
+	long		pos = task->start;
+	int			n, lpos, i;
+
+	while (!task->error && (pos < task->end)) {
+		// copy out the next line - as much as fgets() would
+		n = 0;
+		while ((pos < task->end) && (n < 2047)) {
+			linebuf[n++] = task->data[pos++];
+			if (linebuf[n-1] == '\n') {
+				break;
+			}
+		}
+		linebuf[n] = '\0';
+
+		// skip past anything not a character in the buffer
+		lpos = 0;
+		while ((linebuf[lpos] != '\0') && !isalpha(linebuf[lpos])) {
+			lpos++;
+		}
+
+		// ...go through the word that is on this line...
+		i = lpos;
+		while (isalpha(linebuf[i]) || (linebuf[i] == '\'') || (linebuf[i] == '-')) {
+			i++;
+		}
+
+		// ...and NULL terminate it when it's done
+		linebuf[i] = '\0';
+
+		if (!AddWordToDictionary(task->dict, &(linebuf[lpos]))) {
+			task->error = YES;
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+ *	This function takes the name of a text file that has one word
+ *	per line and reads each word into a new dictionary that's then
+ *	indexed and returned to the caller. The file is mapped into
+ *	memory and split into line-aligned chunks, each loaded on its
+ *	own thread - up to 'threads' of them. The chunks are put back
+ *	together in file order, and only then are the duplicate words
+ *	dropped - so whatever the number of threads, the words, and
+ *	their order, are just what one thread would have loaded. The
+ *	caller is responsible for destroying the dictionary when they
+ *	are done with it.
+ */
+dictionary *LoadDictionary(char *filename, int threads) {
+	BOOL		error = NO;
+	int			fd = -1;
+	char		*data = NULL;
+	long		size = 0;
+	dictionary	*retval = NULL;
+	ingestTask	tasks[MAX_THREADS];
+	pthread_t	tids[MAX_THREADS];
+	BOOL		started[MAX_THREADS];
+	int			chunks = 1;
+	int			t;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if (filename == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in LoadDictionary() ***\n"
+							"    The name of the file is NULL, and this means no\n"
+							"    processing can be done because no file. Try giving\n"
+							"    this routine a valid filename.\n");
+		}
+	}
+
+	// next, try to open the file and map it in for reading
+	if (!error) {
+		struct stat		info;
+
+		fd = open(filename, O_RDONLY);
+		if ((fd < 0) || (fstat(fd, &info) != 0)) {
+			error = YES;
+			fprintf(stderr, "*** Error in LoadDictionary() ***\n"
+							"    The file '%s' could not be opened for reading.\n"
+							"    This is a serious problem as the file is the basis\n"
+							"    for the decryption of the cyphertext.\n", filename);
+		} else {
+			size = (long) info.st_size;
+		}
+	}
+	if (!error && (size > 0)) {
+		data = (char *) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED) {
+			data = NULL;
+			error = YES;
+			fprintf(stderr, "*** Error in LoadDictionary() ***\n"
+							"    The file '%s' could not be mapped into memory.\n"
+							"    This is a serious problem as the file is the basis\n"
+							"    for the decryption of the cyphertext.\n", filename);
+		}
+	}
+
+	// ...and get an empty dictionary to fill
+	if (!error) {
+		retval = CreateDictionary();
+		if (retval == NULL) {
+			error = YES;
+		}
+	}
+
+	/*
+	 *	Now split up the file into chunks - one per thread - and
+	 *	move the end of each chunk up to the start of the next line.
+	 */
+	if (!error) {
+		chunks = threads;
+		if (chunks > (size / MIN_INGEST_CHUNK_SIZE)) {
+			chunks = (int) (size / MIN_INGEST_CHUNK_SIZE);
+		}
+		if (chunks > MAX_THREADS) {
+			chunks = MAX_THREADS;
+		}
+		if (chunks < 1) {
+			chunks = 1;
+		}
+
+		for (t = 0; t < chunks; t++) {
+			tasks[t].data = data;
+			tasks[t].start = (t == 0 ? 0 : tasks[t-1].end);
+			tasks[t].end = (t == (chunks - 1) ? size : ((size / chunks) * (t + 1)));
+			if (tasks[t].end < tasks[t].start) {
+				tasks[t].end = tasks[t].start;
+			}
+			while ((tasks[t].end < size) && (tasks[t].end > tasks[t].start) && (data[tasks[t].end - 1] != '\n')) {
+				tasks[t].end++;
+			}
+			tasks[t].dict = (t == 0 ? retval : CreateDictionary());
+			tasks[t].error = (tasks[t].dict == NULL);
+			started[t] = NO;
+		}
+	}
+
+	// load up each chunk - on its own thread, if we can
+	if (!error) {
+		for (t = 1; t < chunks; t++) {
+			if (!tasks[t].error) {
+				started[t] = (pthread_create(&tids[t], NULL, LoadDictionaryChunk, &tasks[t]) == 0);
+			}
+		}
+		LoadDictionaryChunk(&tasks[0]);
+		for (t = 1; t < chunks; t++) {
+			if (started[t]) {
+				pthread_join(tids[t], NULL);
+			} else if (!tasks[t].error) {
+				LoadDictionaryChunk(&tasks[t]);
+			}
+		}
+
+		// ...and put them back together in file order
+		for (t = 0; t < chunks; t++) {
+			if (tasks[t].error) {
+				error = YES;
+			} else if ((t > 0) && !error) {
+				if (!AppendDictionary(retval, tasks[t].dict)) {
+					error = YES;
+				}
+			}
+			if (t > 0) {
+				tasks[t].dict = DestroyDictionary(tasks[t].dict);
+			}
+		}
+	}
+
+	// with all the words in, drop the duplicates and build the blocks
+	if (!error) {
+		if (!RemoveDuplicateWordsFromDictionary(retval) || !IndexDictionary(retval)) {
+			error = YES;
+		}
+	}
+
+	// now we can unmap and close the file because we're done
+	if (data != NULL) {
+		munmap(data, size);
+	}
+	if (fd >= 0) {
+		close(fd);
+	}
+
+	// if we had any trouble, release what we've created
+	if (error) {
+		retval = DestroyDictionary(retval);
+	}
+
+	return error ? NULL : retval;
+}
+
+
+/*
+ *	This routine saves the dictionary as an image in the file
+ *	'filename', for the words file 'wordsFilename' it was loaded
+ *	from. The image is written next to the file and then renamed
+ *	over it, so a process mapping it in never sees half of one.
+ */
+BOOL SaveDictionaryImage(dictionary *dict, char *filename, char *wordsFilename) {
+	BOOL					error = NO;
+	dictionaryImageHeader	header;
+	dictionaryImageBucket	*table = NULL;
+	char					*tempName = NULL;
+	FILE					*fp = NULL;
+	BOOL					writeFailed = NO;
+	size_t					offset = 0;
+	int						len;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if ((dict == NULL) || (filename == NULL) || (wordsFilename == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in SaveDictionaryImage() ***\n"
+							"    The dictionary, or the name of the image or words\n"
+							"    file is NULL. This is most likely a bad call.\n");
+		}
+	}
+
+	// the image has to know what words file it's for
+	if (!error) {
+		struct stat		info;
+
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, DICTIONARY_IMAGE_MAGIC, sizeof(header.magic));
+		header.version = DICTIONARY_IMAGE_VERSION;
+		header.lanes = DICTIONARY_LANES;
+		header.wordCount = dict->wordCount;
+		header.maxLength = dict->maxLength;
+		if (stat(wordsFilename, &info) != 0) {
+			error = YES;
+			fprintf(stderr, "*** Error in SaveDictionaryImage() ***\n"
+							"    The words file '%s' could not be looked at: %s\n",
+							wordsFilename, strerror(errno));
+		} else {
+			header.sourceSize = (long) info.st_size;
+			header.sourceTime = (long) info.st_mtime;
+		}
+	}
+
+	// lay out where each bucket's words and blocks go
+	if (!error) {
+		table = (dictionaryImageBucket *) calloc(dict->maxLength + 1, sizeof(dictionaryImageBucket));
+		if (table == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in SaveDictionaryImage() ***\n"
+							"    The table of the %d buckets could not be created.\n"
+							"    This is a serious allocation error.\n", dict->maxLength + 1);
+		} else {
+			offset = sizeof(header) + (dict->maxLength + 1) * sizeof(dictionaryImageBucket);
+			for (len = 1; (dict->buckets != NULL) && (len <= dict->maxLength); len++) {
+				dictionaryBucket	*bucket = &(dict->buckets[len]);
+				int					blocks = (bucket->count + DICTIONARY_LANES - 1) / DICTIONARY_LANES;
+
+				table[len].count = bucket->count;
+				if (bucket->count > 0) {
+					offset = (offset + DICTIONARY_IMAGE_ALIGNMENT - 1) & ~((size_t) DICTIONARY_IMAGE_ALIGNMENT - 1);
+					table[len].textOffset = offset;
+					offset += bucket->count * (len + 1);
+					offset = (offset + DICTIONARY_IMAGE_ALIGNMENT - 1) & ~((size_t) DICTIONARY_IMAGE_ALIGNMENT - 1);
+					table[len].columnsOffset = offset;
+					offset += blocks * len * DICTIONARY_LANES;
+				}
+			}
+			header.imageSize = offset;
+		}
+	}
+
+	// now write it all out to the new file
+	if (!error) {
+		tempName = (char *) malloc(strlen(filename) + 32);
+		if (tempName == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in SaveDictionaryImage() ***\n"
+							"    The name of the new image file could not be made.\n"
+							"    This is a serious allocation error.\n");
+		} else {
+			sprintf(tempName, "%s.%ld.tmp", filename, (long) getpid());
+			fp = fopen(tempName, "w");
+			if (fp == NULL) {
+				error = YES;
+				fprintf(stderr, "*** Error in SaveDictionaryImage() ***\n"
+								"    The new image file '%s' could not be created: %s\n",
+								tempName, strerror(errno));
+			}
+		}
+	}
+	if (!error) {
+		fwrite(&header, sizeof(header), 1, fp);
+		fwrite(table, sizeof(dictionaryImageBucket), dict->maxLength + 1, fp);
+		for (len = 1; (dict->buckets != NULL) && (len <= dict->maxLength); len++) {
+			dictionaryBucket	*bucket = &(dict->buckets[len]);
+			int					blocks = (bucket->count + DICTIONARY_LANES - 1) / DICTIONARY_LANES;
+
+			if (bucket->count > 0) {
+				fseek(fp, table[len].textOffset, SEEK_SET);
+				fwrite(bucket->text, len + 1, bucket->count, fp);
+				fseek(fp, table[len].columnsOffset, SEEK_SET);
+				fwrite(bucket->columns, len * DICTIONARY_LANES, blocks, fp);
+			}
+		}
+		writeFailed = ferror(fp);
+		if ((fclose(fp) != 0) || writeFailed || (rename(tempName, filename) != 0)) {
+			error = YES;
+			fprintf(stderr, "*** Error in SaveDictionaryImage() ***\n"
+							"    The image file '%s' could not be written: %s\n",
+							filename, strerror(errno));
+			unlink(tempName);
+		}
+	}
+
+	// in the end, release what we've used in this routine
+	if (table != NULL) {
+		free(table);
+	}
+	if (tempName != NULL) {
+		free(tempName);
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine maps in the dictionary image in the file 'filename'
+ *	- read-only and shared, so every process using it has the same
+ *	copy - and returns a dictionary whose buckets point into it. If
+ *	'wordsFilename' isn't NULL, the image has to have been made from
+ *	it as it is now. If the image isn't there, is out of date, or
+ *	isn't one this library can use, NULL is returned, and nothing is
+ *	said about it - it just has to be made again.
+ */
+dictionary *MapDictionaryImage(char *filename, char *wordsFilename) {
+	BOOL					error = NO;
+	dictionary				*retval = NULL;
+	char					*image = NULL;
+	size_t					size = 0;
+	dictionaryImageHeader	*header = NULL;
+	dictionaryImageBucket	*table = NULL;
+	int						fd = -1;
+	int						len;
+
+	// first, map in the whole file
+	if (!error) {
+		struct stat		info;
+
+		fd = (filename == NULL ? -1 : open(filename, O_RDONLY));
+		if ((fd < 0) || (fstat(fd, &info) != 0) || (info.st_size < (off_t) sizeof(dictionaryImageHeader))) {
+			error = YES;
+		} else {
+			size = (size_t) info.st_size;
+			image = (char *) mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+			if (image == MAP_FAILED) {
+				image = NULL;
+				error = YES;
+			}
+		}
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+
+	// make sure it's an image we can use, and for these words
+	if (!error) {
+		header = (dictionaryImageHeader *) image;
+		table = (dictionaryImageBucket *) (image + sizeof(dictionaryImageHeader));
+		if ((memcmp(header->magic, DICTIONARY_IMAGE_MAGIC, sizeof(header->magic)) != 0) ||
+			(header->version != DICTIONARY_IMAGE_VERSION) ||
+			(header->lanes != DICTIONARY_LANES) || (header->imageSize != size) ||
+			(header->maxLength < 0) ||
+			(sizeof(dictionaryImageHeader) + (header->maxLength + 1) * sizeof(dictionaryImageBucket) > size)) {
+			error = YES;
+		}
+	}
+	if (!error && (wordsFilename != NULL)) {
+		struct stat		info;
+
+		if ((stat(wordsFilename, &info) != 0) || ((long) info.st_size != header->sourceSize) ||
+			((long) info.st_mtime != header->sourceTime)) {
+			error = YES;
+		}
+	}
+	for (len = 1; !error && (len <= header->maxLength); len++) {
+		size_t	blocks = (table[len].count + DICTIONARY_LANES - 1) / DICTIONARY_LANES;
+
+		if ((table[len].count < 0) ||
+			((table[len].count > 0) &&
+			 ((table[len].textOffset + (size_t) table[len].count * (len + 1) > size) ||
+			  (table[len].columnsOffset + blocks * len * DICTIONARY_LANES > size)))) {
+			error = YES;
+		}
+	}
+
+	// now point the buckets of a new dictionary into it
+	if (!error) {
+		retval = CreateDictionary();
+		if (retval == NULL) {
+			error = YES;
+		} else {
+			retval->buckets = (dictionaryBucket *) calloc(header->maxLength + 1, sizeof(dictionaryBucket));
+			if (retval->buckets == NULL) {
+				error = YES;
+				fprintf(stderr, "*** Error in MapDictionaryImage() ***\n"
+								"    The %d buckets for the image '%s' could not be\n"
+								"    created. This is a serious allocation error.\n",
+								header->maxLength + 1, filename);
+			}
+		}
+	}
+	if (!error) {
+		retval->wordCount = header->wordCount;
+		retval->maxLength = header->maxLength;
+		retval->image = image;
+		retval->imageSize = size;
+		for (len = 0; len <= header->maxLength; len++) {
+			dictionaryBucket	*bucket = &(retval->buckets[len]);
+
+			bucket->length = len;
+			bucket->count = table[len].count;
+			bucket->size = table[len].count;
+			if (table[len].count > 0) {
+				bucket->text = image + table[len].textOffset;
+				bucket->columns = (unsigned char *) (image + table[len].columnsOffset);
+			}
+		}
+	}
+
+	// if we had any trouble, release what we've created
+	if (error) {
+		if (retval != NULL) {
+			retval = DestroyDictionary(retval);
+		}
+		if (image != NULL) {
+			munmap(image, size);
+		}
+	}
+
+	return error ? NULL : retval;
+}
+
+
+/*
+ *	This routine maps in the dictionary image in the file 'filename'
+ *	for the words file 'wordsFilename' - and if it's not there, or
+ *	is out of date, loads the words file with 'threads' threads and
+ *	makes the image first. If the image can't be made, the loaded
+ *	words are used all the same.
+ */
+dictionary *AttachDictionaryImage(char *filename, char *wordsFilename, int threads) {
+	dictionary		*retval = NULL;
+
+	retval = MapDictionaryImage(filename, wordsFilename);
+	if (retval == NULL) {
+		retval = LoadDictionary(wordsFilename, threads);
+		if ((retval != NULL) && SaveDictionaryImage(retval, filename, wordsFilename)) {
+			dictionary	*mapped = MapDictionaryImage(filename, wordsFilename);
+
+			// ...use the one everyone else will be using
+			if (mapped != NULL) {
+				DestroyDictionary(retval);
+				retval = mapped;
+			}
+		}
+	}
+
+	return retval;
+}
+
+
+/*
+ *	This routine takes a cyphertext and fills in the array of checks
+ *	that any plaintext has to pass to have the same pattern as the
+ *	cyphertext. This is the same test as DoPatternsMatch(), but it's
+ *	done once per cypherword instead of once per word compared. The
+ *	array needs to be able to hold n(n+1)/2 checks for a cyphertext
+ *	of length 'n', and the number of checks is returned.
+ */
+int CreatePatternChecks(char *cyphertext, patternCheck *checks) {
+	int		count = 0;
+	int		len = strlen(cyphertext);
+	int		i, j, k;
+
+	// first, tie each position to the first occurrence of its character
+	for (i = 0; i < len; i++) {
+		for (j = 0; (j < i) && (cyphertext[j] != cyphertext[i]); j++) {
+			// just looking for the first occurrence
+		}
+		if (j < i) {
+			checks[count].a = j;
+			checks[count].b = i;
+			checks[count].mustBeEqual = YES;
+			count++;
+		}
+	}
+
+	// ...then make sure all the first occurrences are different
+	for (i = 0; i < len; i++) {
+		if (strchr(cyphertext, cyphertext[i]) != &(cyphertext[i])) {
+			continue;
+		}
+		for (j = (i+1); j < len; j++) {
+			for (k = 0; (k < j) && (cyphertext[k] != cyphertext[j]); k++) {
+				// just looking for the first occurrence
+			}
+			if (k == j) {
+				checks[count].a = i;
+				checks[count].b = j;
+				checks[count].mustBeEqual = NO;
+				count++;
+			}
+		}
+	}
+
+	return count;
+}
+
+
+/*
+ *	This routine runs the pattern checks against a single transposed
+ *	block of 'count' words, one word at a time. The return value has
+ *	bit 'k' set if the word in lane 'k' of the block passed all the
+ *	checks. This is the scalar fallback of the vector matcher.
+ */
+unsigned int MatchPatternBlockScalar(unsigned char *block, int count, patternCheck *checks, int checkCount) {
+	unsigned int	retval = 0;
+	int				k, i;
+	BOOL			eq;
+
+	for (k = 0; k < count; k++) {
+		for (i = 0; i < checkCount; i++) {
+			eq = (block[(checks[i].a * DICTIONARY_LANES) + k] == block[(checks[i].b * DICTIONARY_LANES) + k]);
+			if (eq != checks[i].mustBeEqual) {
+				break;
+			}
+		}
+		if (i == checkCount) {
+			retval |= (1 << k);
+		}
+	}
+
+	return retval;
+}
+
+
+/*
+ *	This routine runs the pattern checks against a single transposed
+ *	block of 'count' words, all the words at once. Each check compares
+ *	two rows of the block and gives a mask of the lanes where the
+ *	characters are equal, and that's compared to what the cypherword
+ *	requires. The return value is the same as the scalar version.
+ */
+unsigned int MatchPatternBlockVector(unsigned char *block, int count, patternCheck *checks, int checkCount) {
+#ifdef QUIP_SIMD
+	unsigned int	lanes = (1 << count) - 1;
+	__m128i			miss = _mm_setzero_si128();
+	__m128i			ones = _mm_set1_epi8((char) 0xff);
+	__m128i			eq;
+	int				i;
+
+	for (i = 0; i < checkCount; i++) {
+		eq = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i *) &(block[checks[i].a * DICTIONARY_LANES])),
+							_mm_loadu_si128((__m128i *) &(block[checks[i].b * DICTIONARY_LANES])));
+		miss = _mm_or_si128(miss, (checks[i].mustBeEqual ? _mm_xor_si128(eq, ones) : eq));
+		// once every word in the block has missed, we're done
+		if ((_mm_movemask_epi8(miss) & lanes) == lanes) {
+			return 0;
+		}
+	}
+
+	return ~((unsigned int) _mm_movemask_epi8(miss)) & lanes;
+#else
+	return MatchPatternBlockScalar(block, count, checks, checkCount);
+#endif
+}
+
+
+/*
+ *	This routine finds all the words in the dictionary that have
+ *	the same pattern as the cypherword and adds them to the list of
+ *	possible plaintexts for the cypherword. They are added in the
+ *	same order that they were added to the dictionary.
+ */
+BOOL MatchCypherwordToDictionary(cypherword *word, dictionary *dict) {
+	return MatchCypherwordToDictionarySlice(word, dict, 0, 1);
+}
+
+
+/*
+ *	This routine is the same as MatchCypherwordToDictionary() but it
+ *	only looks at one of 'slices' equal runs of blocks in the bucket
+ *	for the cypherword. Matching every slice, in order, finds all the
+ *	same possibles, in the same order, as matching the whole bucket.
+ */
+BOOL MatchCypherwordToDictionarySlice(cypherword *word, dictionary *dict, int slice, int slices) {
+	BOOL				error = NO;
+	BOOL				finished = NO;
+	dictionaryBucket	*bucket = NULL;
+	patternCheck		*checks = NULL;
+	int					checkCount = 0;
+	int					firstBlock = 0;
+	int					lastBlock = 0;
+
+	// first, check and see if we have something to do
+	if (!error && !finished) {
+		if ((word == NULL) || (dict == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in MatchCypherwordToDictionarySlice() ***\n"
+							"    The passed-in cypherword or dictionary was NULL, and\n"
+							"    therefore nothing can be matched. This is most likely\n"
+							"    a bad argument call.\n");
+		} else if ((word->length == 0) || (word->length > dict->maxLength)) {
+			finished = YES;
+		} else {
+			bucket = &(dict->buckets[word->length]);
+			lastBlock = (bucket->count + DICTIONARY_LANES - 1) / DICTIONARY_LANES;
+			firstBlock = (int) (((long) lastBlock * slice) / slices);
+			lastBlock = (int) (((long) lastBlock * (slice + 1)) / slices);
+			if (firstBlock >= lastBlock) {
+				finished = YES;
+			}
+		}
+	}
+
+	// next, boil the cypherword down to its pattern checks
+	if (!error && !finished) {
+		checks = (patternCheck *) malloc(((word->length * (word->length + 1)) / 2 + 1) * sizeof(patternCheck));
+		if (checks == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in MatchCypherwordToDictionarySlice() ***\n"
+							"    The pattern checks for the cypherword '%s' could not\n"
+							"    be allocated. This is a serious problem.\n", word->cyphertext);
+		} else {
+			checkCount = CreatePatternChecks(word->cyphertext, checks);
+		}
+	}
+
+	// now run each block of the bucket through the matcher
+	if (!error && !finished) {
+		int				block;
+		int				count;
+		int				k;
+		unsigned int	hits;
+
+		for (block = firstBlock; !error && (block < lastBlock); block++) {
+			count = bucket->count - (block * DICTIONARY_LANES);
+			if (count > DICTIONARY_LANES) {
+				count = DICTIONARY_LANES;
+			}
+
+			hits = MatchPatternBlockVector(&(bucket->columns[block * word->length * DICTIONARY_LANES]), count, checks, checkCount);
+			for (k = 0; hits != 0; k++, hits >>= 1) {
+				if ((hits & 1) && !AddPossiblePlaintextToCypherword(word,
+							&(bucket->text[((block * DICTIONARY_LANES) + k) * (word->length + 1)]))) {
+					error = YES;
+					break;
+				}
+			}
+		}
+	}
+
+	// in the end, release what we've used in this routine
+	if (checks != NULL) {
+		free(checks);
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This is the thread routine that matches the task's slice of the
+ *	dictionary against each of the task's cypherwords.
+ */
+void *MatchDictionarySlice(void *arg) {
+	ingestTask	*task = (ingestTask *) arg;
+	int			i;
+
+	for (i = 0; (i < task->wordCount) && !task->error; i++) {
+		if (!MatchCypherwordToDictionarySlice(task->words[i], task->dict, task->slice, task->slices)) {
+			task->error = YES;
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+ *	This routine matches every cypherword in the list against the
+ *	dictionary using up to 'threads' threads. The first thread adds
+ *	its possibles right to the cypherwords in the list, and all the
+ *	others use their own copies of the cypherwords. When they are
+ *	all done, the copies are added to the list's cypherwords in
+ *	slice order so that the possibles are in dictionary order.
+ */
+BOOL MatchCypherwordsToDictionary(cypherword **list, int count, dictionary *dict, int threads) {
+	BOOL		error = NO;
+	ingestTask	tasks[MAX_THREADS];
+	pthread_t	tids[MAX_THREADS];
+	BOOL		started[MAX_THREADS];
+	int			slices = 1;
+	int			t, i, j;
+
+	// first, check and see if we have something to do
+	if (!error) {
+		if ((list == NULL) || (dict == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in MatchCypherwordsToDictionary() ***\n"
+							"    The passed-in cypherwords or dictionary was NULL, and\n"
+							"    therefore nothing can be matched. This is most likely\n"
+							"    a bad argument call.\n");
+		}
+	}
+
+	// there's no sense in more slices than the work warrants
+	if (!error) {
+		slices = threads;
+		if (slices > (dict->wordCount / MIN_MATCH_SLICE_SIZE)) {
+			slices = dict->wordCount / MIN_MATCH_SLICE_SIZE;
+		}
+		if (slices > MAX_THREADS) {
+			slices = MAX_THREADS;
+		}
+		if (slices < 1) {
+			slices = 1;
+		}
+	}
+
+	// set up the tasks - each but the first with its own cypherwords
+	if (!error) {
+		for (t = 0; t < slices; t++) {
+			tasks[t].dict = dict;
+			tasks[t].words = list;
+			tasks[t].wordCount = count;
+			tasks[t].slice = t;
+			tasks[t].slices = slices;
+			tasks[t].error = NO;
+			started[t] = NO;
+			if (t > 0) {
+				tasks[t].words = (cypherword **) calloc(count, sizeof(cypherword *));
+				if (tasks[t].words == NULL) {
+					tasks[t].error = YES;
+				}
+				for (i = 0; (i < count) && !tasks[t].error; i++) {
+					tasks[t].words[i] = CreateCypherword(list[i]->cyphertext);
+					if (tasks[t].words[i] == NULL) {
+						tasks[t].error = YES;
+					}
+				}
+			}
+		}
+	}
+
+	// match each slice - on its own thread, if we can
+	if (!error) {
+		for (t = 1; t < slices; t++) {
+			if (!tasks[t].error) {
+				started[t] = (pthread_create(&tids[t], NULL, MatchDictionarySlice, &tasks[t]) == 0);
+			}
+		}
+		MatchDictionarySlice(&tasks[0]);
+		for (t = 1; t < slices; t++) {
+			if (started[t]) {
+				pthread_join(tids[t], NULL);
+			} else if (!tasks[t].error) {
+				MatchDictionarySlice(&tasks[t]);
+			}
+		}
+	}
+
+	// now add each slice's possibles to the real cypherwords, in order
+	if (!error) {
+		for (t = 0; t < slices; t++) {
+			if (tasks[t].error) {
+				error = YES;
+				fprintf(stderr, "*** Error in MatchCypherwordsToDictionary() ***\n"
+								"    While matching slice %d of the dictionary against\n"
+								"    the cypherwords, an error occurred. Check the logs\n"
+								"    to see why this might have happened.\n", t);
+			}
+			if ((t == 0) || (tasks[t].words == NULL)) {
+				continue;
+			}
+			for (i = 0; i < count; i++) {
+				if (tasks[t].words[i] == NULL) {
+					continue;
+				}
+				for (j = 0; (j < tasks[t].words[i]->numberOfPossibles) && !error; j++) {
+					if (!AddPossiblePlaintextToCypherword(list[i], tasks[t].words[i]->possiblePlaintext[j])) {
+						error = YES;
+					}
+				}
+				tasks[t].words[i] = DestroyCypherword(tasks[t].words[i]);
+			}
+			free(tasks[t].words);
+		}
+	}
+
+	return !error;
+}
+
+
+/************************************************************************
+ *
+ *	Legend functions
+ *
+ *	These functions are used to manipulate the decryption data a.k.a.
+ *	the legend in a manner that is very high level so that the user
+ *	doesn't have to fiddle around with low-level allocation routines
+ *	to get the job done. In a more OO design, these functions would
+ *	be the methods on the legend object.
+ *
+ ************************************************************************/
+/*
+ *	This routine creates a new legend structure with the single
+ *	character mapping of the 'plainChar' for the 'cryptChar' in
+ *	the cyphertext. This is useful, for example, in the beginning
+ *	when a single mapping pair is given to the program to start.
+ */
+legend *CreateLegend(char cryptChar, char plainChar) {
+	BOOL		error = NO;
+	legend		*retval = NULL;
+
+	// first, let's get the space, if we can
+	if (!error) {
+		retval = (legend *) malloc(sizeof(legend));
+		if (retval == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in CreateLegend() ***\n"
+							"    The creation of the legend structure failed in\n"
+							"    trying to get the necessary memory from the\n"
+							"    pool. This is a serious memory problem.\n");
+		}
+	}
+
+	// let's zero out the legend to start with
+	if (!error) {
+		int		i;
+
+		for (i = 0; i < 26; i++) {
+			retval->map[i] = 0;
+		}
+	}
+
+	// now, let's assign the character we have
+	if (!error) {
+		retval->map[cryptChar - 'a'] = plainChar;
+	}
+
+	return error ? NULL : retval;
+}
+
+
+/*
+ *	This routine takes care of releasing the resources used in the
+ *	passed-in legend structure, and then the structure itself.
+ */
+legend *DestroyLegend(legend* map) {
+
+	// first, free up the resources of the legend
+	if (map != NULL) {
+		// this is easy - now... there's nothing to do
+	}
+
+	// now free up the legend structure itself
+	if (map != NULL) {
+		free(map);
+	}
+
+	return NULL;
+}
+
+
+/*
+ *	This routine returns a copy of the passed-in legend structure
+ *	which is useful if there's a know good part of a key, but the
+ *	user wants to experiment with additional keys without having
+ *	to keep track of what's been changed in the original legend.
+ */
+legend *DuplicateLegend(legend* map) {
+	BOOL		error = NO;
+    legend		*retval = NULL;
+
+	// first, see if we have anything to do
+	if (!error) {
+		if (map == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in DuplicateLegend() ***\n"
+							"    The passed-in legend is NULL. This is most\n"
+							"    likely a simple coding mistake.\n");
+		}
+	}
+
+	// next, create any old legend
+	if (!error) {
+		retval = CreateLegend('a', 'a');
+		if (retval == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in DuplicateLegend() ***\n"
+							"    While trying to duplicate a legend structure\n"
+							"    the new legend could not be created. This is\n"
+							"    a serious problem that needs to be addressed.\n");
+		} else {
+			// now we can copy over the contents of the old legend
+			SetLegendToLegend(retval, map);
+		}
+	}
+
+	return error ? NULL : retval;
+}
+
+
+/*
+ *	This routine creates a legend that's a random derangement of
+ *	the alphabet - every letter maps to some other letter - for
+ *	enciphering a plaintext. The letters are shuffled Fisher-Yates
+ *	style, and if any of them lands on itself, it's shuffled again.
+ *	That's needed less than three times on average, and it means
+ *	that every derangement is as likely as any other. The same seed
+ *	always makes the same legend, and the caller needs to destroy it.
+ */
+legend *CreateDerangedLegend(unsigned int *seed) {
+	BOOL		error = NO;
+	legend		*retval = NULL;
+	BOOL		deranged = NO;
+
+	// first, make sure we have a seed to use
+	if (!error) {
+		if (seed == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in CreateDerangedLegend() ***\n"
+							"    The passed-in seed is NULL, and that means that\n"
+							"    there's no way to make the legend. Please check\n"
+							"    this before calling this routine.\n");
+		}
+	}
+
+	// next, get a legend to shuffle
+	if (!error) {
+		retval = CreateLegend('a', 'a');
+		if (retval == NULL) {
+			error = YES;
+		}
+	}
+
+	// ...and shuffle it until no letter stands for itself
+	while (!error && !deranged) {
+		int		i, j;
+		char	t;
+
+		for (i = 0; i < 26; i++) {
+			retval->map[i] = 'a' + i;
+		}
+		for (i = 25; i > 0; i--) {
+			j = rand_r(seed) % (i + 1);
+			t = retval->map[i];
+			retval->map[i] = retval->map[j];
+			retval->map[j] = t;
+		}
+
+		deranged = YES;
+		for (i = 0; (i < 26) && deranged; i++) {
+			if (retval->map[i] == ('a' + i)) {
+				deranged = NO;
+			}
+		}
+	}
+
+	return error ? NULL : retval;
+}
+
+
+/*
+ *	This routine simply takes two legends and copies all the data
+ *	from the source legend to the destination legend. Both have
+ *	to exist, of course.
+ */
+void SetLegendToLegend(legend* dest, legend *src) {
+	BOOL		error = NO;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if ((dest == NULL) || (src == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in SetLegendToLegend() ***\n"
+							"    Either the source or destination legend is NULL. For\n"
+							"    this routine to work, bpth have to be non-NULL. Please\n"
+							"    make sure that they are both non-NULL.\n");
+		}
+	}
+
+	// now copy over the data from one to the other
+	if (!error) {
+		int		i;
+
+		for (i = 0; i < 26; i++) {
+			dest->map[i] = src->map[i];
+		}
+	}
+}
+
+
+/*
+ *	This routine returns TRUE if the two legends are equal in
+ *	content - though they may not be the same actual object.
+ *	This is a simple way to see if two legends under construction
+ *	are the same.
+ */
+BOOL DoesLegendEqualLegend(legend *a, legend *b) {
+	BOOL		error = NO;
+	BOOL		isEqual = YES;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if ((a == NULL) || (b == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in DoesLegendEqualLegend() ***\n"
+							"    Either the source or destination legend is NULL. For\n"
+							"    this routine to work, bpth have to be non-NULL. Please\n"
+							"    make sure that they are both non-NULL.\n");
+		}
+	}
+
+	// next, check each element for a mismatch
+	if (!error) {
+		int		i;
+
+		for (i = 0; (i < 26) && isEqual; i++) {
+			if (a->map[i] != b->map[i]) {
+				isEqual = NO;
+			}
+		}
+	}
+
+	// return what we have to the caller
+	return isEqual;
+}
+
+
+/*
+ *	This useful routine prints out the legend so that the user
+ *	can see what's contained within it.
+ */
+void PrintLegend(legend *map) {
+	int		i;
+
+	puts("cypher: abcdefghijklmnopqrstuvwxyz");
+	printf("plain:  ");
+	for (i = 0; i < 26; i++) {
+		printf("%c", (map->map[i] == 0 ? '.' : map->map[i]));
+	}
+	printf("\n");
+}
+
+
+/*
+ *	This routine takes a cyphertext character and a legend and
+ *	returns the plaintext character. This is used to decode the
+ *	cyphertext into plaintext - one character at a time.
+ */
+char CypherToPlainChar(legend *map, char c) {
+	BOOL		error = NO;
+	BOOL		upperCase = NO;
+	char		retval = c;
+
+	// make sure we have something to map through
+	if (!error) {
+		if (map == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in CypherToPlainChar() ***\n"
+							"    The passed-in legend structure was NULL which\n"
+							"    means that there can be no mapping. This is\n"
+							"    a serious problem - please look into it.\n");
+		}
+	}
+
+	// now, see if the character can be converted
+	if (!error) {
+		// see if it's upper case
+		if (isupper(retval)) {
+			upperCase = YES;
+			retval = tolower(retval);
+		}
+
+		if (islower(retval)) {
+			retval = map->map[retval - 'a'] + (upperCase ? ('A' - 'a') : 0);
+		}
+	}
+
+	// now return it to the caller
+	return error ? 0 : retval;
+}
+
+
+/*
+ *	This routine takes a plaintext character and a legend and
+ *	returns the cyphertext character. This is used to encode the
+ *	plaintext into cyphertext - one character at a time.
+ */
+char PlainToCypherChar(legend *map, char c) {
+	BOOL		error = NO;
+	BOOL		upperCase = NO;
+	char		retval = c;
+
+	// make sure we have something to map through
+	if (!error) {
+		if (map == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in PlainToCypherChar() ***\n"
+							"    The passed-in legend structure was NULL which\n"
+							"    means that there can be no mapping. This is\n"
+							"    a serious problem - please look into it.\n");
+		}
+	}
+
+	// now, see if the character can be converted
+	if (!error) {
+		// see if it's upper case
+		if (isupper(retval)) {
+			upperCase = YES;
+			retval = tolower(retval);
+		}
+
+		if (islower(retval)) {
+			// this is a back-search through the map
+			int		i;
+
+			for (i = 0; i < 26; i++) {
+				if (map->map[i] == retval) {
+					retval = (i + 'a') + (upperCase ? ('A' - 'a') : 0);
+					break;
+				}
+			}
+		}
+	}
+
+	// now return it to the caller
+	return error ? 0 : retval;
+}
+
+
+/*
+ *	This routine returns the set of plaintext letters that the legend
+ *	has for the cypherchars in 'cypherLetters' - both as 26-bit masks.
+ *	Passing ALL_LETTERS_MASK gives every plaintext letter already used
+ *	in the legend. A NULL legend has no letters at all.
+ */
+unsigned int GetPlainLetterMaskOfLegend(legend *map, unsigned int cypherLetters) {
+	unsigned int	retval = 0;
+	int				i;
+
+	if (map != NULL) {
+		for (i = 0; i < 26; i++) {
+			if ((cypherLetters & (1 << i)) && isalpha(map->map[i])) {
+				retval |= (1 << (tolower(map->map[i]) - 'a'));
+			}
+		}
+	}
+
+	return retval;
+}
+
+
+/*
+ *	This routine takes a cyphertext character string and converts
+ *	it to plaintext based on the legend provided. This is useful
+ *	for doing a complete decryption on a string based on a given
+ *	legend. The returned value is a new character string that
+ *	the caller is responsible for freeing - or NULL in case of
+ *	an error.
+ */
+char *CypherToPlainString(legend *map, char *cyphertext) {
+	return CypherToPlainStringInArena(NULL, map, cyphertext);
+}
+
+
+/*
+ *	This routine is just like CypherToPlainString(), but the plaintext
+ *	comes from the arena - if it's not NULL.
+ */
+char *CypherToPlainStringInArena(quipArena *arena, legend *map, char *cyphertext) {
+	BOOL		error = NO;
+	char		*retval = NULL;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if (map == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in CypherToPlainString() ***\n"
+							"    The legend structure passed-in to this routine\n"
+							"    is NULL, and therefore no transformation can\n"
+							"    take place. This is a serious problem that needs\n"
+							"    to be looked at.\n");
+		}
+	}
+	if (!error) {
+		if (cyphertext == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in CypherToPlainString() ***\n"
+							"    The cyphertext string passed-in to this routine\n"
+							"    is NULL, and therefore no transformation can\n"
+							"    take place. This is a serious problem that needs\n"
+							"    to be looked at.\n");
+		}
+	}
+
+	// now, I need to create a new string that's the right size
+	if (!error) {
+		retval = (char *) ArenaAlloc(arena, (strlen(cyphertext)+1) * sizeof(char));
+		if (retval == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in CypherToPlainString() ***\n"
+							"    A new string to contain the plaintext could not be\n"
+							"    allocated. This is a serious error.\n");
+		}
+	}
+
+	// now I can do the right conversion a character at a time
+	if (!error) {
+		int		i;
+		int		len = strlen(cyphertext);
+
+		for (i = 0; i < len; i++) {
+			retval[i] = CypherToPlainChar(map, cyphertext[i]);
+		}
+		retval[len] = '\0';
+	}
+
+	// if I had an error, ditch anything I might have allocated
+	if (error) {
+		if (retval != NULL) {
+			ArenaFree(arena, retval);
+		}
+	}
+
+	return error ? NULL : retval;
+}
+
+
+/*
+ *	This routine takes a plaintext character string and converts
+ *	it to cyphertext based on the legend provided. This is useful
+ *	for doing a complete encryption on a string based on a given
+ *	legend. The returned value is a new character string that
+ *	the caller is responsible for freeing - or NULL in case of
+ *	an error.
+ */
+char *PlainToCypherString(legend *map, char *plaintext) {
+	BOOL		error = NO;
+	char		*retval = NULL;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if (map == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in PlainToCypherString() ***\n"
+							"    The legend structure passed-in to this routine\n"
+							"    is NULL, and therefore no transformation can\n"
+							"    take place. This is a serious problem that needs\n"
+							"    to be looked at.\n");
+		}
+	}
+	if (!error) {
+		if (plaintext == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in PlainToCypherString() ***\n"
+							"    The plaintext string passed-in to this routine\n"
+							"    is NULL, and therefore no transformation can\n"
+							"    take place. This is a serious problem that needs\n"
+							"    to be looked at.\n");
+		}
+	}
+
+	// now, I need to create a new string that's the right size
+	if (!error) {
+		retval = (char *) malloc((strlen(plaintext)+1) * sizeof(char));
+		if (retval == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in PlainToCypherString() ***\n"
+							"    A new string to contain the cyphertext could not be\n"
+							"    allocated. This is a serious error.\n");
+		}
+	}
+
+	// now I can do the right conversion a character at a time
+	if (!error) {
+		int		i;
+		int		len = strlen(plaintext);
+
+		for (i = 0; i < len; i++) {
+			retval[i] = PlainToCypherChar(map, plaintext[i]);
+		}
+		retval[len] = '\0';
+	}
+
+	// if I had an error, ditch anything I might have allocated
+	if (error) {
+		if (retval != NULL) {
+			free(retval);
+		}
+	}
+
+	return error ? NULL : retval;
+}
+
+
+/*************************************************************************
+ *
+ *	Cyphertext functions
+ *
+ *	These functions are used at a high level to manipulate the
+ *	individual cypherwords in the system to try and find those
+ *	legends that completly and accurately specify the solution
+ *	to the problem.
+ *
+ ************************************************************************/
+/*
+ *	This function passes each of the cypherwords in the context to
+ *	the context's dictionary to pick up all the words that match its
+ *	pattern. Only the first cypherword with each pattern is matched,
+ *	and all the others with that pattern share its possibles. The
+ *	possibles point into the dictionary, so it has to stay around as
+ *	long as the cypherwords do.
+ */
+BOOL ProcessCypherwordsWithDictionary(quipContext *ctx) {
+	BOOL		error = NO;
+	cypherword	**owners = NULL;
+	int			*ownerOf = NULL;
+	int			ownerCount = 0;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if (ctx->dict == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in ProcessCypherwordsWithDictionary() ***\n"
+							"    The context has no dictionary, and this means no\n"
+							"    processing can be done because there are no words.\n"
+							"    Try loading one with LoadDictionary() first.\n");
+		}
+	}
+
+	// next, find the first cypherword with each pattern
+	if (!error) {
+		owners = (cypherword **) ArenaAlloc(ctx->arena, (ctx->wordCount + 1) * sizeof(cypherword *));
+		ownerOf = (int *) ArenaAlloc(ctx->arena, (ctx->wordCount + 1) * sizeof(int));
+		if ((owners == NULL) || (ownerOf == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in ProcessCypherwordsWithDictionary() ***\n"
+							"    The list of distinct cypherword patterns could not\n"
+							"    be allocated. This is a serious problem.\n");
+		} else {
+			int		i, j;
+
+			for (i = 0; i < ctx->wordCount; i++) {
+				for (j = 0; j < ownerCount; j++) {
+					if ((owners[j]->length == ctx->words[i]->length) &&
+						DoPatternsMatch(owners[j]->cyphertext, ctx->words[i]->cyphertext)) {
+						break;
+					}
+				}
+				if (j == ownerCount) {
+					owners[ownerCount++] = ctx->words[i];
+				}
+				ownerOf[i] = j;
+			}
+		}
+	}
+
+	// next, match just those cypherwords against the dictionary
+	if (!error) {
+		if (!MatchCypherwordsToDictionary(owners, ownerCount, ctx->dict, ctx->threadCount)) {
+			error = YES;
+			fprintf(stderr, "*** Error in ProcessCypherwordsWithDictionary() ***\n"
+							"    While checking the cypherwords against the dictionary,\n"
+							"    an error occurred. Check the logs to see why this\n"
+							"    might have happened.\n");
+		}
+	}
+
+	// ...and let all the others share their possibles
+	if (!error) {
+		int		i;
+
+		for (i = 0; !error && (i < ctx->wordCount); i++) {
+			if (!ShareCypherwordPossibles(ctx->words[i], owners[ownerOf[i]])) {
+				error = YES;
+			}
+		}
+	}
+
+	// in the end, release what we've used in this routine
+	if (ownerOf != NULL) {
+		ArenaFree(ctx->arena, ownerOf);
+	}
+	if (owners != NULL) {
+		ArenaFree(ctx->arena, owners);
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine takes a plaintext character string and encrypts
+ *	it so that it might be used for feeding into programs such
+ *	as this. This might be considered a program within a program
+ *	but it exists to make testing of the decoding program much
+ *	simpler and much faster. The puzzle is made with the seed,
+ *	so the same seed always makes the same puzzle - and it's
+ *	returned, along with a hint for solving it: 'hintCypher'
+ *	stands for 'hintPlain', both in lowercase. If 'usedLegend'
+ *	isn't NULL, it gets the encrypting legend, and the caller needs
+ *	to destroy it.
+ *	The returned cyphertext needs to be freed by the caller.
+ */
+char *EncipherPlaintext(char *text, unsigned int *seed, legend **usedLegend, char *hintCypher, char *hintPlain) {
+	BOOL		error = NO;
+	legend		*encryptingLegend = NULL;
+	char		*encrypted = NULL;
+
+	// first, make sure that we have something to do
+	if (!error) {
+		if ((text == NULL) || (seed == NULL) || (hintCypher == NULL) || (hintPlain == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in EncipherPlaintext() ***\n"
+							"    The plaintext, seed or hint was NULL so there's\n"
+							"    nothing we can really do. Check this before calling\n"
+							"    this routine.\n");
+		} else {
+			*hintCypher = '\0';
+			*hintPlain = '\0';
+			if (usedLegend != NULL) {
+				*usedLegend = NULL;
+			}
+		}
+	}
+
+	// ...and that there's at least one letter for the hint
+	if (!error) {
+		int		i = 0;
+
+		while ((text[i] != '\0') && !isalpha(text[i])) {
+			i++;
+		}
+		if (text[i] == '\0') {
+			error = YES;
+			fprintf(stderr, "*** Error in EncipherPlaintext() ***\n"
+							"    The plaintext '%s' has no letters in it, so\n"
+							"    there's nothing to encrypt and no hint to give.\n", text);
+		}
+	}
+
+	// next, we need a random legend where no letter stands for itself
+	if (!error) {
+		encryptingLegend = CreateDerangedLegend(seed);
+		if (encryptingLegend == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in EncipherPlaintext() ***\n"
+							"    While trying to encrypt the plaintext, the legend\n"
+							"    could not be created. This is a serious allocation\n"
+							"    problem that needs to be looked into.\n");
+		}
+	}
+
+	/*
+	 *	Next, let's encrypt this string with the new legend
+	 */
+	if (!error) {
+		encrypted = PlainToCypherString(encryptingLegend, text);
+		if (encrypted == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in EncipherPlaintext() ***\n"
+							"    The encrypted string could not be generated from\n"
+							"    the plaintext and the newly created legend. This\n"
+							"    is a serious problem.\n");
+		}
+	}
+
+	// now, pick a hint character to give them
+	if (!error) {
+		int		len = strlen(text);
+		int		i;
+
+		i = rand_r(seed) % len;
+		while (!isalpha(text[i])) {
+			i = (i + 1) % len;
+		}
+		*hintPlain = tolower(text[i]);
+		*hintCypher = PlainToCypherChar(encryptingLegend, *hintPlain);
+	}
+
+	// hand back the legend if they want it, and clean up if it failed
+	if (!error && (usedLegend != NULL)) {
+		*usedLegend = encryptingLegend;
+		encryptingLegend = NULL;
+	}
+	if (encryptingLegend != NULL) {
+		encryptingLegend = DestroyLegend(encryptingLegend);
+	}
+	if (error && (encrypted != NULL)) {
+		free(encrypted);
+		encrypted = NULL;
+	}
+
+	return encrypted;
+}
+
+
+/*
+ *	This routine makes a puzzle out of the plaintext and shows it
+ *	to the user - either as the cyphertext and hint, or as the
+ *	command line to solve it - with the legend, if asked for.
+ */
+void EncryptPlaintext(char *text, BOOL showLegend, BOOL genCmdLine, unsigned int *seed) {
+	legend		*encryptingLegend = NULL;
+	char		*encrypted = NULL;
+	char		hintCypher;
+	char		hintPlain;
+
+	encrypted = EncipherPlaintext(text, seed, &encryptingLegend, &hintCypher, &hintPlain);
+
+	// now I need to show it to the user, if he wants to see it
+	if ((encrypted != NULL) && showLegend) {
+		int		i;
+
+		printf("Generated encryption legend:\n");
+		for (i = 0; i < 26; i++) {
+			printf("   %c = %c\n", ('a' + i), encryptingLegend->map[i]);
+		}
+		printf("\n");
+	}
+
+	/*
+	 *	Next, we need to output the encrypted string in the
+	 *	right format based on what the user wants to see.
+	 */
+	if (encrypted != NULL) {
+		printf("%s%s%s", (genCmdLine ? "quip '" : ""), encrypted, (genCmdLine ? "'" : "\n"));
+		printf(" %s%c=%c\n", (genCmdLine ? "-k" : ""), hintCypher, hintPlain);
+	}
+
+	// now we can free the resources we've used in this routine
+	if (encryptingLegend != NULL) {
+		encryptingLegend = DestroyLegend(encryptingLegend);
+	}
+	if (encrypted != NULL) {
+		free(encrypted);
+	}
+}
+
+
+/*
+ *	This routine initializes the list of cyberwords by scanning
+ *	the provided text and makes all the cyberwords necessary to
+ *	model the decryption process. A word that appears more than
+ *	once in the text is only one cypherword, and the number of
+ *	times it appears is kept in the cypherword.
+ */
+BOOL CreateCypherwordsFromCyphertext(quipContext *ctx, char *text) {
+	BOOL		error = NO;
+	int			i;
+	char		*word = NULL;
+
+	// first, make sure that I have something to do
+	if (!error) {
+		if (text == NULL) {
+			error = YES;
+			if (ctx->htmlOutput) {
+				printf("*** Error in CreateCypherwordsFromCyphertext() ***<BR>\n"
+					   "    The passed-in cyphertext was NULL and so no parsing<BR>\n"
+					   "    could be done. This is probably a programming error.<BR>\n");
+			} else {
+				fprintf(stderr, "*** Error in CreateCypherwordsFromCyphertext() ***\n"
+								"    The passed-in cyphertext was NULL and so no parsing\n"
+								"    could be done. This is probably a programming error.\n");
+			}
+		} else {
+			int		len = strlen(text);
+
+			// make sure it contains nothing but legal characters
+			for (i = 0; i < len; i++) {
+				if (!(isspace(text[i]) || isalpha(text[i]) || ispunct(text[i]))) {
+					error = YES;
+					if (ctx->htmlOutput) {
+						printf("*** Error in CreateCypherwordsFromCyphertext() ***<BR>\n"
+							   "    The passed-in cyphertext contains characters other<BR>\n"
+							   "    than A-Z, a-z, spaces and simple punctuation. This<BR>\n"
+							   "    is the only form of the cyphertext that this parser<BR>\n"
+							   "    understands.<BR>\n");
+					} else {
+						fprintf(stderr, "*** Error in CreateCypherwordsFromCyphertext() ***\n"
+										"    The passed-in cyphertext contains characters other\n"
+										"    than A-Z, a-z, spaces and simple punctuation. This\n"
+										"    is the only form of the cyphertext that this parser\n"
+										"    understands.\n");
+					}
+					break;
+				}
+			}
+		}
+	}
+
+	// now I need to reset the list of cypherwords
+	if (!error) {
+		if ((ctx->words != NULL) && (ctx->wordCount > 0)) {
+			// first, ditch all the individual existing words
+			for (i = 0; i < ctx->wordCount; i++) {
+				ctx->words[i] = DestroyCypherword(ctx->words[i]);
+			}
+
+			// ...now free the array itself
+			ArenaFree(ctx->arena, ctx->words);
+			ctx->words = NULL;
+
+			// ...and reset the number of words in it
+			ctx->wordCount = 0;
+		}
+	}
+
+	// now I need to make a temp word buffer of the maximum size
+	if (!error) {
+		word = (char *) ArenaAlloc(ctx->arena, (strlen(text)+1) * sizeof(char));
+		if (word == NULL) {
+			error = YES;
+			if (ctx->htmlOutput) {
+				printf("*** Error in CreateCypherwordsFromCyphertext() ***<BR>\n"
+					   "    The temporary word buffer could not be created.<BR>\n"
+					   "    This is serious because this is used in the parsing<BR>\n"
+					   "    of the cyphertext into cypherwords.<BR>\n");
+			} else {
+				fprintf(stderr, "*** Error in CreateCypherwordsFromCyphertext() ***\n"
+								"    The temporary word buffer could not be created.\n"
+								"    This is serious because this is used in the parsing\n"
+								"    of the cyphertext into cypherwords.\n");
+			}
+		}
+	}
+
+	// now I need to count the number of words to know what to do
+	if (!error) {
+		int		len = strlen(text);
+		BOOL	countWord;
+
+		i = 0;
+		while (!error && (i < len)) {
+			// pass up any whitespace and stop at a character
+			while ((isspace(text[i]) || ispunct(text[i])) && (i < len)) {
+				i++;
+			}
+
+			// go through the word - just as it's done when saving it
+			countWord = NO;
+			while ((isalpha(text[i]) || (text[i] == '\'')) && (i < len)) {
+				i++;
+				countWord = YES;
+			}
+
+			// up the count if we actually had a word
+			if (countWord) {
+				ctx->wordCount++;
+			}
+		}
+
+		// now see if we had any words at all in the text
+		if (ctx->wordCount == 0) {
+			error = YES;
+			if (ctx->htmlOutput) {
+				printf("*** Error in CreateCypherwordsFromCyphertext() ***<BR>\n"
+					   "    There were no words found in the cyphertext. This<BR>\n"
+					   "    represents a trivial condition and won't be done.<BR>\n");
+			} else {
+				fprintf(stderr, "*** Error in CreateCypherwordsFromCyphertext() ***\n"
+								"    There were no words found in the cyphertext. This\n"
+								"    represents a trivial condition and won't be done.\n");
+			}
+		}
+	}
+
+	// now with the number of words, I can allocate the words array
+	if (!error) {
+		ctx->words = (cypherword **) ArenaAlloc(ctx->arena, ctx->wordCount * sizeof(cypherword *));
+		if (ctx->words == NULL) {
+			error = YES;
+			if (ctx->htmlOutput) {
+				printf("*** Error in CreateCypherwordsFromCyphertext() ***<BR>\n"
+					   "    The array of cypherwords could not be allocated.<BR>\n"
+					   "    This is a serious problem because this is used to<BR>\n"
+					   "    hold the cypherwords from the cyphertext.<BR>\n");
+			} else {
+				fprintf(stderr, "*** Error in CreateCypherwordsFromCyphertext() ***\n"
+								"    The array of cypherwords could not be allocated.\n"
+								"    This is a serious problem because this is used to\n"
+								"    hold the cypherwords from the cyphertext.\n");
+			}
+		}
+	}
+
+	// now I can go through the cyphertext again making cypherwords
+	if (!error) {
+		int		len = strlen(text);
+		int		j;
+		int		w = 0;
+
+		i = 0;
+		while (!error && (i < len)) {
+			// pass up any whitespace and stop at a character
+			while ((isspace(text[i]) || ispunct(text[i])) && (i < len)) {
+				i++;
+			}
+
+			// go through anything reasonable and save it
+			j = 0;
+			while ((isalpha(text[i]) || (text[i] == '\'')) && (i < len)) {
+				word[j++] = text[i++];
+			}
+			word[j] = '\0';
+
+			// see if we already have a cypherword for this word - in any case
+			if (j > 0) {
+				int		k;
+
+				for (k = 0; k < w; k++) {
+					if (strcasecmp(ctx->words[k]->cyphertext, word) == 0) {
+						ctx->words[k]->occurrences++;
+						break;
+					}
+				}
+				if (k < w) {
+					continue;
+				}
+			}
+
+			// create a new cypherword if there was a new word
+			if (j > 0) {
+				ctx->words[w] = CreateCypherwordInArena(ctx->arena, word);
+				if (ctx->words[w] == NULL) {
+					error = YES;
+					if (ctx->htmlOutput) {
+						printf("*** Error in CreateCypherwordsFromCyphertext() ***<BR>\n"
+							   "    The cypherword '%s' could not be created properly.<BR>\n"
+							   "    This is a serious problem and we can't go on.<BR>\n", word);
+					} else {
+						fprintf(stderr, "*** Error in CreateCypherwordsFromCyphertext() ***\n"
+										"    The cypherword '%s' could not be created properly.\n"
+										"    This is a serious problem and we can't go on.\n", word);
+					}
+				} else {
+					w++;
+				}
+			}
+		}
+
+		// ...and only the distinct words are cypherwords
+		ctx->wordCount = w;
+	}
+
+	// in the end, I have to release whatever I've used in this routine
+	if (word != NULL) {
+		ArenaFree(ctx->arena, word);
+	}
+
+	return !error;
+}
+
+
+/*************************************************************************
+ *
+ *	Frequency Counting and Histogram Routines
+ *
+ ************************************************************************/
+/*
+ *	This is an interesting little routine to determine the
+ *	frequency of each possible matching of plainchar to
+ *	cypherchar in the list of cypherwords. It also counts
+ *	the frequency of plaintext characters as well as the
+ *	frequency of cyphertext characters. This might be
+ *	useful in large lists of cypherwords to get some idea
+ *	of the possible legend for the solution based on the
+ *	relative frequency of characters in matched words.
+ *	The return value is a characterFrequencyData structure
+ *	that the caller MUST free on it's own.
+ *
+ *	The purpose of the legend is to say 'calculate the data
+ *	but only for the possible words that ALSO match this
+ *	legend'. In this way, there can be many different data
+ *	sets - one for each possible legend for the solution.
+ */
+characterFrequencyData *GenerateCharacterCountsWithLegend(quipContext *ctx, legend *map) {
+	BOOL					error = NO;
+	characterFrequencyData	*retval = NULL;
+	int						cypherchar, plainchar;
+	int						i, j;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if (ctx->wordCount == 0) {
+			error = YES;
+			fprintf(stderr, "*** Error in GenerateCharacterCountsWithLegend() ***\n"
+							"    There are no cypherwords to process, this means we\n"
+							"    cannot generate a histogram. Try again with words.\n");
+		}
+	}
+
+	// next, we need to make a return structure to hold the info
+	if (!error) {
+		retval = (characterFrequencyData *) malloc(sizeof(characterFrequencyData));
+		if (retval == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in GenerateCharacterCountsWithLegend() ***\n"
+							"    The characterFrequencyData structure used to return\n"
+							"    the information from this routine could not be allocated.\n"
+							"    This is a serious problem that needs to be addressed.\n");
+		}
+	}
+
+	// next, clear out the bins we'll be using for counting
+	if (!error) {
+		for (i = 0; i < 26; i++) {
+			// these are the total numbers of each type of character
+			retval->plaintext[i] = 0;
+			retval->cyphertext[i] = 0;
+			for (j = 0; j < 26; j++) {
+				// these are the number of 'matches' of each type
+				retval->crossMatch[i][j] = 0;
+			}
+		}
+	}
+
+	/*
+	 *	Now, for each word in the cypherword list, go through
+	 *	each possible plaintext word and tally up the 'hits'
+	 *	for each of the characters that might be substituted
+	 *	for each cypherchar.
+	 */
+	if (!error) {
+		BOOL		countWord;
+		int			pos;
+		char		ptc;
+
+		unsigned int	used = GetPlainLetterMaskOfLegend(map, ALL_LETTERS_MASK);
+		unsigned int	assigned;
+
+		// look at each cypherword in the array we have
+		for (i = 0; i < ctx->wordCount; i++) {
+			assigned = GetPlainLetterMaskOfLegend(map, ctx->words[i]->cypherLetterMask);
+			// ...for each word, look at each possible plaintext
+			for (pos = 0; pos < ctx->words[i]->numberOfPossibles; pos++) {
+				/*
+				 *	Check to see if the legend works for this
+				 *	cypher/plain pair - but only do so if the
+				 *	legend exists. If not, then assume that all
+				 *	words are to be counted.
+				 */
+				countWord = YES;
+				if ((map != NULL) && !CanLetterMasksMakePlain(ctx->words[i]->possibleLetterMask[pos], assigned, used)) {
+					countWord = NO;
+				} else if (map != NULL) {
+					for (j = 0; j < ctx->words[i]->length; j++) {
+						ptc = CypherToPlainChar(map, tolower(ctx->words[i]->cyphertext[j]));
+						if ((ptc != 0) && (ptc != tolower(ctx->words[i]->possiblePlaintext[pos][j]))) {
+							// skip this plaintext word because of legend
+							countWord = NO;
+							break;
+						}
+					}
+				}
+
+				// if this word passes the legend, count up the hits - of letters for letters
+				if (countWord) {
+					for (j = 0; j < ctx->words[i]->length; j++) {
+						if (isalpha(ctx->words[i]->cyphertext[j]) && isalpha(ctx->words[i]->possiblePlaintext[pos][j])) {
+							retval->plaintext[(tolower(ctx->words[i]->possiblePlaintext[pos][j]) - 'a')] += ctx->words[i]->occurrences;
+							retval->cyphertext[(tolower(ctx->words[i]->cyphertext[j]) - 'a')] += ctx->words[i]->occurrences;
+							retval->crossMatch[(tolower(ctx->words[i]->cyphertext[j]) - 'a')][(tolower(ctx->words[i]->possiblePlaintext[pos][j]) - 'a')] += ctx->words[i]->occurrences;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// if we had any trouble, release what we've created
+	if (error) {
+		if (retval != NULL) {
+			free(retval);
+		}
+	}
+
+	return error ? NULL : retval;
+}
+
+
+/*
+ *	This is a useful little routine that will print out a
+ *	nice picture of the cross-character histogram as output
+ *	by the routine GenerateCharacterHistogramWithLegend().
+ *	Because it's a little bit bigger than 26 lines long, it
+ *	won't all fit on a conventional 80x24 screen. But it does
+ *	fit in 80 characters wide...
+ */
+void PrintCrossMatchData(characterFrequencyData *data) {
+	BOOL		error = NO;
+	int			i, j;
+
+	/*
+	 *	The plaintext is across the top and the cyphertext
+	 *	is alongthe left side...
+	 */
+	if (!error) {
+		printf("   a  b  c  d  e  f  g  h  i  j  k  l  m  n  o  p  q  r  s  t  u  v  w  x  y  z\n");
+		for (i = 0; i < 26; i++) {
+			printf("%c ", (i + 'a'));
+			for (j = 0; j < 26; j++) {
+				printf("%2d ", data->crossMatch[i][j]);
+			}
+			printf("\n");
+		}
+	}
+}
+
+
+/*************************************************************************
+ *
+ *	Frequency-Counting Attack Routines
+ *
+ ************************************************************************/
+/*
+ *	This routine tries to solve the decryption using a modified
+ *	search algorithm based on the frequency of matched characters
+ *	between the cyphertext and the plaintext. Because this 'machine'
+ *	is only capable of solving for plaintext words it knows, the
+ *	cross-match frequency data tells me the only character-pairs
+ *	I need to be checking for in the legend.
+ *
+ *	With this reduced search space, the job should be much easier
+ *	and faster, since I know what I'm trying has some matches to it.
+ *
+ *	The purpose of the legend here is to reduce the search space
+ *	even further based on the "known" keys provided by the user.
+ *
+ *	Just like the word block attack, it gives up after 'maxSec', or
+ *	when the solve is cancelled - and then the context's
+ *	'frequencyTimedOut' is set.
+ */
+BOOL DoFrequencyAttack(quipContext *ctx, legend *map, int maxSec) {
+	BOOL					error = NO;
+	legend					*myMap = NULL;
+	struct timespec			start;
+	long					output_us;
+
+	// first, get the letters to try for each cypherchar
+	if (!error) {
+		if (!BuildFreqAttackCandidates(ctx, map)) {
+			error = YES;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+	output_us = ctx->phaseTime_us[PHASE_OUTPUT];
+
+	// see if we really have any time to do this
+	ctx->frequencyTimedOut = NO;
+	ctx->frequencyDeadline = time(NULL) + maxSec;
+	if (!error && (maxSec <= 0)) {
+		ctx->frequencyTimedOut = YES;
+	}
+
+	// duplicate the passed-in legend so we can fiddle with it
+	if (!error) {
+		myMap = (legend *) ArenaAlloc(ctx->arena, sizeof(legend));
+		if (myMap != NULL) {
+			SetLegendToLegend(myMap, map);
+		} else {
+			error = YES;
+			fprintf(stderr, "*** Error in DoFrequencyAttack() ***\n"
+							"    The passed-in legend needs to be copied so that I have a\n"
+							"    legend to work with in trying to solve this problem. As\n"
+							"    it turns out, that copy operation failed. So I won't have\n"
+							"    any luck in trying to get the solution through this plan.\n");
+		}
+	}
+
+	if (!error && !ctx->inPortfolio && !ctx->quiet) {
+		int		i, j;
+
+		puts("frequency attack:");
+		for (i = 0; i < 26; i++) {
+			if (ctx->possibleCharCount[i] > 0) {
+				printf("%c : ", (i + 'a'));
+				for (j = 0; j < ctx->possibleCharCount[i]; j++) {
+					printf("%c", ctx->possibleChar[i][j]);
+				}
+				printf("\n");
+			}
+		}
+	}
+
+	/*
+	 *	At this point, I have a list of possible plaintext
+	 *	characters for each cyphertext character - organized
+	 *	from highest probability of a match to lowest. I also
+	 *	have the corresponding number of possible matches
+	 *	by cypherchar so that doing a search over this space
+	 *	is both efficient and complete.
+	 *
+	 *	By calling BuildFreqAttackLegend() we're using
+	 *	recursion to scan the complete decoding space and
+	 *	call the necessary break-out routines to test a
+	 *	possible legend when the time is right.
+	 */
+	if (!error && !ctx->frequencyTimedOut) {
+		BuildFreqAttackLegend(ctx, 0, myMap);
+		if (ctx->frequencyTimedOut && !IsSolveCancelled(ctx) && !ctx->inPortfolio) {
+			fprintf(stderr, "*** Error in DoFrequencyAttack() ***\n"
+							"    We ran out of time while trying the legends in the\n"
+							"    attack. This is too bad, but could be because of too\n"
+							"    many letters to try for the cypherchars.\n");
+		}
+	}
+
+	// ...the solutions it found were output along the way - and that's not this
+	AddPhaseTime(ctx, PHASE_FREQUENCY, &start);
+	ctx->phaseTime_us[PHASE_FREQUENCY] -= ctx->phaseTime_us[PHASE_OUTPUT] - output_us;
+
+	return !error;
+}
+
+
+/*
+ *	This routine builds the letters the frequency attack is to try
+ *	for each cypherchar from the character counts of the possibles
+ *	with the legend 'map' - the plainchars that the cypherchar stands
+ *	for in any of them, most often first - into the context's
+ *	'possibleChar', with their counts in 'possibleCharHitCnt' and the
+ *	number of them in 'possibleCharCount'.
+ */
+BOOL BuildFreqAttackCandidates(quipContext *ctx, legend *map) {
+	BOOL					error = NO;
+	characterFrequencyData	*histo = NULL;
+	struct timespec			start;
+
+	// first, let's get the frequency data
+	clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+	if (!error) {
+		histo = GenerateCharacterCountsWithLegend(ctx, map);
+		if (histo == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in BuildFreqAttackCandidates() ***\n"
+							"    The basis of this attack is that with the frequency data\n"
+							"    the search space will be drastically reduced. Yet, I can't\n"
+							"    get that data. Check the logs for the cause of the problem.\n");
+		}
+	}
+	AddPhaseTime(ctx, PHASE_HISTOGRAM, &start);
+
+	/*
+	 *	Next, we need to build from the histographic data, the
+	 *	array of possible plaintext characters for each cyphertext
+	 *	character. When we get this 'list' for each cypherchar,
+	 *	we'll sort them by number of hits to make the most likely
+	 *	plaintext-to-cyphertext matches be the first ones chosen.
+	 *	We'll also be counting how many possibilities there are
+	 *	for each cypherchar so that we can easily loop through all
+	 *	of them and not miss a one.
+	 */
+	if (!error) {
+		int		i, j;
+		int		cc;
+
+		// do this for each cypherchar...
+		for (cc = 0; cc < 26; cc++) {
+			// reset the number of possibles for this character
+			ctx->possibleCharCount[cc] = 0;
+
+			// copy over the entire line of histographic data
+			for (i = 0; i < 26; i++) {
+				ctx->possibleChar[cc][i] = (i + 'a');
+				ctx->possibleCharHitCnt[cc][i] = histo->crossMatch[cc][i];
+				// see if there is a real 'hit'
+				if (ctx->possibleCharHitCnt[cc][i] > 0) {
+					ctx->possibleCharCount[cc]++;
+				}
+			}
+
+			// now sort the hits by weight along this cypherchar 'line'
+			if (ctx->possibleCharCount[cc] > 0) {
+				char	tempChar;
+				int		tempHits;
+
+				// I know a bubble sort is not the best, but it's easy
+				for (i = 0; i < 26; i++) {
+					for (j = i+1; j < 26; j++) {
+						if (ctx->possibleCharHitCnt[cc][i] < ctx->possibleCharHitCnt[cc][j]) {
+							tempChar = ctx->possibleChar[cc][i];
+							tempHits = ctx->possibleCharHitCnt[cc][i];
+
+							ctx->possibleChar[cc][i] = ctx->possibleChar[cc][j];
+							ctx->possibleCharHitCnt[cc][i] = ctx->possibleCharHitCnt[cc][j];
+
+							ctx->possibleChar[cc][j] = tempChar;
+							ctx->possibleCharHitCnt[cc][j] = tempHits;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// in the end, we need to free our unnecessary resources
+	if (histo != NULL) {
+		free(histo);
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine is complex to follow, but it's worth it.
+ *	The goal of the frequency attack is to reduce the number
+ *	of possible legends to try by first determining what the
+ *	possible make-up of all legends must be. The main attack
+ *	routine already did this. Now it's up to me to try each
+ *	of these different possibilities as a solution. To do
+ *	this is interesting... we need to use recursion in the
+ *	middle of the 'for' loop because I want to scan 'down'
+ *	the list of cyphertext characters before I move to the
+ *	next possible value of any given cyphertext character.
+ *
+ *	There's also the possibility that there are no known
+ *	possible values for a cyphertext character. This could
+ *	easily happen because a certain letter is not used in
+ *	a particular cyphertext. In this case, we have to act
+ *	as though everything is fine and continue on processing.
+ *
+ *	After each letter that's tried, the time limit and the cancel
+ *	are checked - and if either says to stop, the context's
+ *	'frequencyTimedOut' is set, and every level unwinds.
+ */
+void BuildFreqAttackLegend(quipContext *ctx, int cyphercharIndex, legend *map) {
+	// first, see if the cypherchar doesn't have any possibilities
+	if (ctx->possibleCharCount[cyphercharIndex] == 0) {
+		// is it the 'z'?
+		if (cyphercharIndex == 25) {
+			// yep, so we need to see if this legend is 'good'
+			TestFreqAttackLegend(ctx, map);
+		} else {
+			// nope, go get the next cypherchar to add to the legend
+			BuildFreqAttackLegend(ctx, (cyphercharIndex + 1), map);
+		}
+	} else {
+		int		i, j;
+		BOOL	skip = NO;
+
+		// OK... we have some to try - unless the caller has seen enough
+		for (i = 0; (i < ctx->possibleCharCount[cyphercharIndex]) && !ctx->stopRequested && !ctx->frequencyTimedOut; i++) {
+			/*
+			 *	If we're past the sypher 'a', then make sure that
+			 *	the character we want to substitute isn't already
+			 *	in the legend. If it is, then skip the character
+			 *	because we KNOW that the mapping is 1:1 and non-
+			 *	repeating.
+			 */
+			if (cyphercharIndex > 0) {
+				skip = NO;
+				for (j = (cyphercharIndex - 1); (j >= 0) && !skip; j--) {
+					if (map->map[j] == ctx->possibleChar[cyphercharIndex][i]) {
+						skip = YES;
+					}
+				}
+			}
+			if (ctx->stats != NULL) {
+				ctx->stats->freqTested[cyphercharIndex]++;
+				if (skip) {
+					ctx->stats->freqRejected[cyphercharIndex]++;
+					ctx->stats->conflicts[CONFLICT_PLAIN_TAKEN]++;
+				} else {
+					ctx->stats->freqNodes[cyphercharIndex]++;
+					if (cyphercharIndex > ctx->stats->freqMaxDepth) {
+						ctx->stats->freqMaxDepth = cyphercharIndex;
+					}
+				}
+			}
+
+			/*
+			 *	If we aren't supposed to skip this one due to
+			 *	duplicates in the legend, then carry on and do it.
+			 */
+			if (!skip) {
+				// try the next one in the list
+				map->map[cyphercharIndex] = ctx->possibleChar[cyphercharIndex][i];
+				// are we at the 'z'?
+				if (cyphercharIndex == 25) {
+					// yep, so we need to see if this legend is 'good'
+					TestFreqAttackLegend(ctx, map);
+				} else {
+					// nope, go get the next cypherchar to add to the legend
+					BuildFreqAttackLegend(ctx, (cyphercharIndex + 1), map);
+				}
+			}
+
+			// ...and see if we've been given all the time we're getting
+			if ((time(NULL) >= ctx->frequencyDeadline) || IsSolveCancelled(ctx)) {
+				ctx->frequencyTimedOut = YES;
+			}
+		}
+	}
+}
+
+
+/*
+ *	This routine takes a single completed legend from the
+ *	frequency attack plan and tests it against all the
+ *	cypherwords to see if it decrypts each. If so, it
+ *	prints out the answer. If not, then we'll figure out
+ *	if it gets close, and what to do about that later. In
+ *	a portfolio's race, only the answers are reported, so
+ *	it finds just what the word block attack does.
+ */
+void TestFreqAttackLegend(quipContext *ctx, legend *map) {
+	BOOL		error = NO;
+	BOOL		missed = NO;
+	int			hits = 0;
+	int			total = 0;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if (map == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in TestFreqAttackLegend() ***\n"
+							"    The legend to test was NULL, and this simply\n"
+							"    can't happen. Please verify that the legend\n"
+							"    is non-NULL before calling this routine.\n");
+		}
+	}
+
+	// now check each cypherword for a miss
+	if (!error) {
+		int		i;
+
+		ctx->searchNodes++;
+		for (i = 0; i < ctx->wordCount; i++) {
+			total += ctx->words[i]->occurrences;
+			if (IsCypherwordDecryptedByLegend(ctx->words[i], map)) {
+				// yeah! add another hit (or more) to the total
+				hits += ctx->words[i]->occurrences;
+			} else {
+				// darn! it's a miss on this word!
+				missed = YES;
+			}
+		}
+	}
+
+	// see if we have a 100% winner
+	if (!error && (ctx->stats != NULL)) {
+		ctx->stats->freqLegends++;
+		if ((hits == 0) && missed) {
+			ctx->stats->freqMisses++;
+		}
+	}
+	if (!error) {
+		if (!missed || ((hits > 0) && !ctx->inPortfolio)) {
+			char	*decoded = NULL;
+
+			decoded = CypherToPlainStringInArena(ctx->arena, map, ctx->initialCyphertext);
+			if (decoded == NULL) {
+				error = YES;
+				fprintf(stderr, "*** Error in TestFreqAttackLegend() ***\n"
+								"    We obtained a perfect decrypting legend for the\n"
+								"    cyphertext, but were unable to decrypt it to show\n"
+								"    it to you. This is a real shame because it worked.\n");
+			} else {
+				if (missed && !ctx->quiet) {
+					printf("[%d/%d]: '%s'\n", hits, total, decoded);
+				}
+				// ...and pass it on - or save it for the caller to print out
+				if (!ReportSolution(ctx, decoded)) {
+					error = YES;
+				}
+			}
+		}
+	}
+}
+
+
+/*************************************************************************
+ *
+ *	Word Block Attack Routines
+ *
+ ************************************************************************/
+/*
+ *	This is the general routine for starting the word block attack
+ *	on the cyphertext. The idea is that we start with a user-supplied
+ *	legend, and then for each plaintext word in the first cypherword
+ *	that matches the legend, we add those keys not in the legend, but
+ *	supplied by the plaintext to the legend and then try the next
+ *	cypherword in the same manner.
+ *
+ *	There will be quite a few 'passes' in this attack plan, but
+ *	hopefully not nearly as many as a character-based scheme. The
+ *	passes are made by NextWordBlockSolution() - this just weeds out
+ *	and orders the possibles, and sets up the search to start at the
+ *	first cypherword with the legend 'map'. If the context asks for
+ *	it, the size of the search is estimated first, and one that's
+ *	predicted to take more than 'maxSec' can be refused - and then
+ *	it's as if it had timed out without finding anything.
+ */
+BOOL StartWordBlockAttack(quipContext *ctx, legend *map, int maxSec) {
+	BOOL			error = NO;
+	BOOL			solvable = YES;
+	wordBlockSearch	*search = &(ctx->search);
+	struct timespec	start;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+
+	// clear out any old search
+	EndWordBlockAttack(ctx);
+
+	// first, see if we really have any time to do this
+	if (!error && solvable) {
+		if (maxSec <= 0) {
+			solvable = NO;
+			search->timedOut = YES;
+			fprintf(stderr, "*** Error in StartWordBlockAttack() ***\n"
+							"    The passed-in maximum time allotment is 0 which\n"
+							"    means that there's no time to do anything. This is\n"
+							"    too bad, but unaviodable in some cases.\n");
+		}
+	}
+
+	// weed out the possibles that can't be in any solution
+	if (!error && solvable && (ctx->wordCount > 0)) {
+		if (!ReduceCypherwordDomains(ctx, map, &solvable)) {
+			error = YES;
+		}
+	}
+	// ...and put the most promising possibles first, if asked
+	if (!error && solvable && (ctx->wordCount > 0)) {
+		if (!OrderCypherwordPossibles(ctx, ctx->possibleOrdering, map)) {
+			error = YES;
+		}
+	}
+	// ...and see how big the search will be - and if it's worth starting
+	memset(&(ctx->estimate), 0, sizeof(searchEstimate));
+	if (!error && solvable && (ctx->wordCount > 0) && (ctx->estimateMode != ESTIMATE_OFF)) {
+		if (!EstimateSearchSize(ctx, map, ESTIMATE_PROBES, ESTIMATE_SEED, maxSec * 1000000L, &(ctx->estimate))) {
+			error = YES;
+		} else {
+			ctx->estimate.limit_us = maxSec * 1000000L;
+			ctx->estimate.overBudget = (ctx->estimate.predicted_us > ctx->estimate.limit_us);
+			if (ctx->estimate.overBudget && (ctx->estimateMode != ESTIMATE_REPORT)) {
+				solvable = NO;
+				search->timedOut = YES;
+				ctx->estimate.refused = YES;
+			}
+		}
+	}
+
+	// now make the stack for the search - one level per cypherword
+	if (!error && solvable && (ctx->wordCount > 0)) {
+		search->next = (int *) ArenaAlloc(ctx->arena, ctx->wordCount * sizeof(int));
+		// ...with one more legend for folding in the last cypherword
+		search->legends = (legend *) ArenaAlloc(ctx->arena, (ctx->wordCount + 1) * sizeof(legend));
+		search->used = (unsigned int *) ArenaAlloc(ctx->arena, ctx->wordCount * sizeof(unsigned int));
+		search->assigned = (unsigned int *) ArenaAlloc(ctx->arena, ctx->wordCount * sizeof(unsigned int));
+		if ((search->next == NULL) || (search->legends == NULL) ||
+			(search->used == NULL) || (search->assigned == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in StartWordBlockAttack() ***\n"
+							"    The search stack for the %d cypherwords could not\n"
+							"    be created. This is a serious allocation error.\n",
+							ctx->wordCount);
+		} else {
+			search->next[0] = 0;
+			SetLegendToLegend(&(search->legends[0]), map);
+			search->used[0] = GetPlainLetterMaskOfLegend(map, ALL_LETTERS_MASK);
+			search->assigned[0] = GetPlainLetterMaskOfLegend(map, ctx->words[0]->cypherLetterMask);
+			search->deadline = time(NULL) + maxSec;
+			search->depth = 0;
+		}
+	}
+	// ...and if we're tracing it, start a new search in the trace
+	if (!error && (ctx->trace != NULL) && (ctx->wordCount > 0)) {
+		StartSearchTrace(ctx);
+	}
+	AddPhaseTime(ctx, PHASE_PREPARE, &start);
+
+	return !error;
+}
+
+
+/*
+ *	This routine runs the word block attack from wherever it left off
+ *	until it comes up with the next decoding of the cyphertext, and
+ *	passes that back in 'plaintext' - which is in the context's arena,
+ *	and so good until the context is reset. When the search is over,
+ *	'plaintext' is NULL, and the search's 'timedOut' says if it ran
+ *	out of time before it got to the end.
+ *
+ *	Each level of the search tries the possibles of its cypherword in
+ *	turn. If one fits the legend for that level, we're either at the
+ *	last cypherword and have a decoding, or the possible is added to
+ *	a copy of the legend for the next level down.
+ */
+BOOL NextWordBlockSolution(quipContext *ctx, char **plaintext) {
+	BOOL			error = NO;
+	wordBlockSearch	*search = &(ctx->search);
+	struct timespec	start;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+	*plaintext = NULL;
+	while (!error && (search->depth >= 0) && (*plaintext == NULL)) {
+		int			d = search->depth;
+		cypherword	*word = ctx->words[d];
+		legend		*map = &(search->legends[d]);
+		int			i;
+
+		// see if we've tried all the possibles on this level
+		if (search->next[d] >= word->numberOfPossibles) {
+			search->depth--;
+			continue;
+		}
+		i = search->next[d]++;
+		if (ctx->stats != NULL) {
+			ctx->stats->tested[d]++;
+		}
+
+		// does this map fit - allowing for missing gaps?
+		if (CanLetterMasksMakePlain(word->possibleLetterMask[i], search->assigned[d], search->used[d]) &&
+			CanCypherAndLegendMakePlain(word->cyphertext, map, word->possiblePlaintext[i], NO, ctx->noSelfMapping)) {
+			ctx->searchNodes++;
+			if (ctx->stats != NULL) {
+				ctx->stats->nodes[d]++;
+				if (d > ctx->stats->maxDepth) {
+					ctx->stats->maxDepth = d;
+				}
+			}
+			// good! Now let's see if we are done with  all words
+			if (d == (ctx->wordCount - 1)) {
+				/*
+				 *	Make sure we can really match the last word - on
+				 *	a copy of the legend, as the rest of the possibles
+				 *	on this level have to be tried against this one.
+				 */
+				legend		*finalMap = &(search->legends[d + 1]);
+
+				SetLegendToLegend(finalMap, map);
+				if (IncorporateCypherToPlainMapInLegend(word->cyphertext, word->possiblePlaintext[i], finalMap, ctx->noSelfMapping)) {
+					if (ctx->trace != NULL) {
+						AddSearchTraceEvent(ctx->trace, d, i, TRACE_SOLUTION);
+					}
+					// yeah! we have a successful decoding
+					*plaintext = CypherToPlainStringInArena(ctx->arena, finalMap, ctx->initialCyphertext);
+					if (*plaintext == NULL) {
+						error = YES;
+						fprintf(stderr, "*** Error in NextWordBlockSolution() ***\n"
+										"    We obtained a perfect decrypting legend for the\n"
+										"    cyphertext, but were unable to decrypt it to show\n"
+										"    it to you. This is a real shame because it worked.\n");
+					}
+				} else if (ctx->trace != NULL) {
+					AddSearchTraceEvent(ctx->trace, d, i, TRACE_REJECT_FOLD);
+				}
+			} else {
+				/*
+				 *	OK, we had a match but we have more cypherwords
+				 *	to check. So, copy the legend, add in the assumed
+				 *	values from the plaintext, and move to the next
+				 *	word.
+				 */
+				legend		*nextGenMap = &(search->legends[d + 1]);
+
+				SetLegendToLegend(nextGenMap, map);
+				if (IncorporateCypherToPlainMapInLegend(word->cyphertext, word->possiblePlaintext[i], nextGenMap, ctx->noSelfMapping)) {
+					search->next[d + 1] = 0;
+					search->used[d + 1] = GetPlainLetterMaskOfLegend(nextGenMap, ALL_LETTERS_MASK);
+					search->assigned[d + 1] = GetPlainLetterMaskOfLegend(nextGenMap, ctx->words[d + 1]->cypherLetterMask);
+					search->depth = d + 1;
+					if (ctx->trace != NULL) {
+						AddSearchTraceEvent(ctx->trace, d, i, TRACE_DESCEND);
+					}
+				} else if (ctx->trace != NULL) {
+					AddSearchTraceEvent(ctx->trace, d, i, TRACE_REJECT_FOLD);
+				}
+			}
+		} else {
+			// it didn't fit - so if we're keeping track, see why
+			if (ctx->stats != NULL) {
+				ctx->stats->rejected[d]++;
+				ctx->stats->conflicts[GetLegendConflict(word->cyphertext, map, word->possiblePlaintext[i], ctx->noSelfMapping)]++;
+			}
+			if (ctx->trace != NULL) {
+				AddSearchTraceEvent(ctx->trace, d, i,
+						(CanLetterMasksMakePlain(word->possibleLetterMask[i], search->assigned[d], search->used[d]) ?
+						 TRACE_REJECT_LEGEND : TRACE_REJECT_MASKS));
+			}
+		}
+
+		/*
+		 *	After each possible we really need to see if the amount
+		 *	of time we've been given has elapsed. If it has, then we
+		 *	need to quit regardless of what we've found.
+		 */
+		if (!error && (time(NULL) >= search->deadline)) {
+			search->depth = -1;
+			search->timedOut = YES;
+			if (!ctx->inPortfolio) {
+				fprintf(stderr, "*** Error in NextWordBlockSolution() ***\n"
+								"    We ran out of time while trying the next word in the\n"
+								"    attack. This is too bad, but could be because of too\n"
+								"    many words to check.\n");
+			}
+		} else if (!error && IsSolveCancelled(ctx)) {
+			// ...or someone else has the answer, and it's not needed
+			search->depth = -1;
+			search->timedOut = YES;
+		}
+	}
+	AddPhaseTime(ctx, PHASE_SEARCH, &start);
+
+	return !error;
+}
+
+
+/*
+ *	This routine releases the word block attack's search stack, and
+ *	marks the search as over - it's what's done when a search is
+ *	dropped before it gets to the end. The stack is in the context's
+ *	arena, so it's really gone when the arena is reset. If the search
+ *	is being traced, this is where the trace of it is ended.
+ */
+void EndWordBlockAttack(quipContext *ctx) {
+	wordBlockSearch	*search = &(ctx->search);
+
+	if (ctx->trace != NULL) {
+		EndSearchTrace(ctx);
+	}
+	if (search->next != NULL) {
+		ArenaFree(ctx->arena, search->next);
+		search->next = NULL;
+	}
+	if (search->legends != NULL) {
+		ArenaFree(ctx->arena, search->legends);
+		search->legends = NULL;
+	}
+	if (search->used != NULL) {
+		ArenaFree(ctx->arena, search->used);
+		search->used = NULL;
+	}
+	if (search->assigned != NULL) {
+		ArenaFree(ctx->arena, search->assigned);
+		search->assigned = NULL;
+	}
+	search->depth = -1;
+	search->timedOut = NO;
+}
+
+
+/*
+ *	This method sees if we can add the cyphertext-to-plaintext
+ *	mapping represented by the two words, into the existing legend
+ *	without violating the existing legend, or creating illegal
+ *	legend conditions such as different cypherchars going to the
+ *	same plainchar, etc.
+ */
+BOOL IncorporateCypherToPlainMapInLegend(char *cyphertext, char *plaintext, legend *map, BOOL noSelfMapping) {
+	BOOL		error = NO;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if (cyphertext == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in IncorporateCypherToPlainMapInLegend() ***\n"
+							"    The passed-in cyphertext was NULL which means that\n"
+							"    there's really nothing to do. Please make sure the\n"
+							"	arguments are non-NULL before calling this routine.\n");
+		}
+	}
+	if (!error) {
+		if (plaintext == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in IncorporateCypherToPlainMapInLegend() ***\n"
+							"    The passed-in plaintext was NULL which means that\n"
+							"    there's really nothing to do. Please make sure the\n"
+							"	arguments are non-NULL before calling this routine.\n");
+		}
+	}
+	if (!error) {
+		if (map == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in IncorporateCypherToPlainMapInLegend() ***\n"
+							"    The passed-in legend was NULL which means that\n"
+							"    there's really nothing to do. Please make sure the\n"
+							"	arguments are non-NULL before calling this routine.\n");
+		}
+	}
+
+	// make sure that the lengths are the same
+	if (!error) {
+		if (strlen(cyphertext) != strlen(plaintext)) {
+			error = YES;
+			fprintf(stderr, "*** Error in IncorporateCypherToPlainMapInLegend() ***\n"
+							"    The length of the cyphertext was %lu and the length of\n"
+							"    the plaintext was %lu. This means we can't match up the\n"
+							"    characters because they are of different lengths.\n",
+							strlen(cyphertext), strlen(plaintext));
+		}
+	}
+
+	/*
+	 *	OK... now we need to process each character in the cyphertext
+	 *	to see if it's already assigned in the legend, etc.
+	 */
+	if (!error) {
+		int		i, j;
+		int		len = strlen(cyphertext);
+		char	cc, pc;
+
+		for (i = 0; (i < len) && !error; i++) {
+			// first, get the plaintext and cyphertext characters
+			cc = tolower(cyphertext[i]);
+			pc = tolower(plaintext[i]);
+
+			/*
+			 *	Next, check for punctuation - if there's a mismatch
+			 *	it's no-go... if it's a match, then just skip it.
+			 */
+			// check for misplaced punctuation
+			if ((ispunct(cc) && !ispunct(pc)) || (!ispunct(cc) && ispunct(pc))) {
+				// one is punctuation, the other isn't - so no good
+				error = YES;
+				break;
+			}
+			// check to see if these are both punctuation
+			if (ispunct(cc) && ispunct(pc)) {
+				continue;
+			}
+
+			// under '-x' a letter can't stand for itself
+			if (noSelfMapping && (cc == pc)) {
+				error = YES;
+				break;
+			}
+
+			// next, see if either side of the mapping already exists
+			if (map->map[cc - 'a'] != 0) {
+				// OK... is it a match to the existing plaintext?
+				if (map->map[cc - 'a'] != pc) {
+					// nope... sorry, this is bad news...
+					error = YES;
+				}
+			} else {
+				// OK, see if the plaintext char is already mapped
+				for (j = 0; (j < 26) && !error; j++) {
+					if (map->map[j] == pc) {
+						// plaintext is already assigned to another cypherchar
+						error = YES;
+					}
+				}
+			}
+
+			// OK... new, valid, mapping data. Let's save it.
+			if (!error) {
+				map->map[cc - 'a'] = pc;
+			}
+		}
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine is the pre-search domain reduction for the word
+ *	block attack. Each cypherchar has a 'domain' - the set of the
+ *	plainchars it might still be - as a 26-bit mask. They all start
+ *	out as every letter, except for the cypherchars the legend has
+ *	already, and the letters in the legend are taken out of all the
+ *	other domains. Then, over and over until nothing changes:
+ *
+ *	  - every possible of every cypherword that has a plainchar not
+ *		in the domain of the cypherchar at that spot is removed,
+ *	  - the domain of each cypherchar in each cypherword is cut down
+ *		to the plainchars that its remaining possibles have for it,
+ *	  - any cypherchar down to a single plainchar takes that letter
+ *		out of the domains of all the other cypherchars.
+ *
+ *	With '-x' no cypherchar has itself in its domain to begin with.
+ *
+ *	This doesn't remove anything that could be part of a solution,
+ *	but it often empties a lot of the possibles lists before the
+ *	search even starts. If any cypherword ends up with no possibles
+ *	at all, there's no solution, and 'solvable' is set to NO.
+ */
+BOOL ReduceCypherwordDomains(quipContext *ctx, legend *map, BOOL *solvable) {
+	BOOL			error = NO;
+	BOOL			changed = YES;
+	unsigned int	domain[26];
+	unsigned int	inText = 0;
+	int				i, c;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if (solvable == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in ReduceCypherwordDomains() ***\n"
+							"    The place to say if the cyphertext is still solvable\n"
+							"    is NULL. This is most likely a bad argument call.\n");
+		} else {
+			*solvable = (ctx->wordCount > 0);
+		}
+	}
+
+	// start every domain as wide open - except for the legend's letters
+	if (!error) {
+		unsigned int	used = GetPlainLetterMaskOfLegend(map, ALL_LETTERS_MASK);
+
+		for (c = 0; c < 26; c++) {
+			if ((map != NULL) && isalpha(map->map[c])) {
+				domain[c] = (1 << (tolower(map->map[c]) - 'a'));
+			} else {
+				domain[c] = ALL_LETTERS_MASK & ~used;
+			}
+			if (ctx->noSelfMapping) {
+				domain[c] &= ~(1 << c);
+			}
+		}
+		for (i = 0; i < ctx->wordCount; i++) {
+			inText |= ctx->words[i]->cypherLetterMask;
+		}
+	}
+
+	// now keep at it until it all settles down
+	while (!error && *solvable && changed) {
+		changed = NO;
+
+		for (i = 0; (i < ctx->wordCount) && !error && *solvable; i++) {
+			cypherword		*word = ctx->words[i];
+			unsigned int	allowed[26];
+			int				pos, kept, j;
+			BOOL			fits;
+			char			*ptc;
+
+			for (c = 0; c < 26; c++) {
+				allowed[c] = 0;
+			}
+
+			// first, drop the possibles that don't fit the domains
+			kept = 0;
+			for (pos = 0; pos < word->numberOfPossibles; pos++) {
+				ptc = word->possiblePlaintext[pos];
+				fits = YES;
+				for (j = 0; (j < word->length) && fits; j++) {
+					if (isalpha(word->cyphertext[j])) {
+						fits = isalpha(ptc[j]) && (domain[tolower(word->cyphertext[j]) - 'a'] & (1 << (tolower(ptc[j]) - 'a')));
+					}
+				}
+				if (!fits) {
+					continue;
+				}
+
+				// ...it fits, so note what it has for each cypherchar
+				for (j = 0; j < word->length; j++) {
+					if (isalpha(word->cyphertext[j])) {
+						allowed[tolower(word->cyphertext[j]) - 'a'] |= (1 << (tolower(ptc[j]) - 'a'));
+					}
+				}
+
+				// ...and keep it - in a list of our own, if need be
+				if (kept != pos) {
+					if ((word->possiblesShareCount != NULL) && !MakeCypherwordPossiblesPrivate(word)) {
+						error = YES;
+						break;
+					}
+					word->possiblePlaintext[kept] = word->possiblePlaintext[pos];
+					word->possibleLetterMask[kept] = word->possibleLetterMask[pos];
+				}
+				kept++;
+			}
+			if (error) {
+				break;
+			}
+			if (kept < word->numberOfPossibles) {
+				// the tail is going, so it has to be our own list
+				if ((word->possiblesShareCount != NULL) && !MakeCypherwordPossiblesPrivate(word)) {
+					error = YES;
+					break;
+				}
+				word->numberOfPossibles = kept;
+			}
+			if (kept == 0) {
+				*solvable = NO;
+				break;
+			}
+
+			// next, cut down the domains of this word's cypherchars
+			for (c = 0; c < 26; c++) {
+				if ((word->cypherLetterMask & (1 << c)) && ((domain[c] & allowed[c]) != domain[c])) {
+					domain[c] &= allowed[c];
+					changed = YES;
+				}
+			}
+		}
+
+		// a cypherchar that's down to one plainchar has it all to itself
+		for (c = 0; (c < 26) && !error && *solvable; c++) {
+			if ((inText & (1 << c)) && (domain[c] != 0) && ((domain[c] & (domain[c] - 1)) == 0)) {
+				for (i = 0; i < 26; i++) {
+					if ((i != c) && (inText & (1 << i)) && (domain[i] & domain[c])) {
+						domain[i] &= ~domain[c];
+						changed = YES;
+						if (domain[i] == 0) {
+							*solvable = NO;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This is the comparison routine for sorting the possibles by
+ *	their scores - highest score first. Ties are kept in the order
+ *	they were in so that the sort is stable.
+ */
+int ComparePossibleScores(const void *a, const void *b) {
+	possibleScore	*x = (possibleScore *) a;
+	possibleScore	*y = (possibleScore *) b;
+
+	if (x->score > y->score) {
+		return -1;
+	} else if (x->score < y->score) {
+		return 1;
+	}
+	return (x->index - y->index);
+}
+
+
+/*
+ *	This routine re-orders the possibles of each cypherword so that
+ *	the word block attack tries the most promising ones first. The
+ *	'ordering' says how each possible is scored:
+ *
+ *	  ORDER_BY_CROSS_MATCH - add up, for each cypherchar in the word,
+ *		how often the possible's plainchar lines up with it across
+ *		all the possibles of all the cypherwords. This is the cross-
+ *		match data of GenerateCharacterCountsWithLegend().
+ *
+ *	  ORDER_BY_LEAST_CONSTRAINING - for each other cypherword that
+ *		shares a cypherchar with this one, see what fraction of its
+ *		possibles would still fit if this possible were chosen, and
+ *		add those up. A possible that leaves some cypherword with no
+ *		possibles at all goes to the very end of the list.
+ *
+ *	Only the possibles that fit the legend are counted in the scores.
+ *	Any cypherword that shares its possibles gets its own copy before
+ *	they are re-ordered.
+ */
+BOOL OrderCypherwordPossibles(quipContext *ctx, int ordering, legend *map) {
+	BOOL					error = NO;
+	BOOL					finished = NO;
+	characterFrequencyData	*histo = NULL;
+	int						(*support)[26][26] = NULL;
+	int						*fitting = NULL;
+	possibleScore			*scores = NULL;
+	char					**plain = NULL;
+	unsigned int			*masks = NULL;
+	int						maxPossibles = 0;
+	int						i;
+
+	// first, see if we really have anything to do
+	if (!error && !finished) {
+		if ((ordering == ORDER_BY_LIST) || (ctx->wordCount == 0)) {
+			finished = YES;
+		} else {
+			for (i = 0; i < ctx->wordCount; i++) {
+				if (ctx->words[i]->numberOfPossibles > maxPossibles) {
+					maxPossibles = ctx->words[i]->numberOfPossibles;
+				}
+			}
+			if (maxPossibles == 0) {
+				finished = YES;
+			}
+		}
+	}
+
+	// next, get the scratch space for the scores and the sorting
+	if (!error && !finished) {
+		scores = (possibleScore *) ArenaAlloc(ctx->arena, maxPossibles * sizeof(possibleScore));
+		plain = (char **) ArenaAlloc(ctx->arena, maxPossibles * sizeof(char *));
+		masks = (unsigned int *) ArenaAlloc(ctx->arena, maxPossibles * sizeof(unsigned int));
+		if ((scores == NULL) || (plain == NULL) || (masks == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in OrderCypherwordPossibles() ***\n"
+							"    The space to score and sort the %d possibles of the\n"
+							"    cypherwords could not be allocated. This is a serious\n"
+							"    problem.\n", maxPossibles);
+		}
+	}
+
+	/*
+	 *	Now get the data the scores are built on. For the cross-match
+	 *	scores it's simply the character counts. For the least
+	 *	constraining scores, it's the same counts - but one table for
+	 *	each cypherword - along with how many of its possibles fit.
+	 */
+	if (!error && !finished) {
+		if (ordering == ORDER_BY_CROSS_MATCH) {
+			histo = GenerateCharacterCountsWithLegend(ctx, map);
+			if (histo == NULL) {
+				error = YES;
+			}
+		} else {
+			support = (int (*)[26][26]) ArenaAlloc(ctx->arena, ctx->wordCount * sizeof(int[26][26]));
+			fitting = (int *) ArenaAlloc(ctx->arena, ctx->wordCount * sizeof(int));
+			if ((support == NULL) || (fitting == NULL)) {
+				error = YES;
+				fprintf(stderr, "*** Error in OrderCypherwordPossibles() ***\n"
+								"    The tables of cypherchar to plainchar counts for\n"
+								"    each cypherword could not be allocated. This is a\n"
+								"    serious problem.\n");
+			} else {
+				unsigned int	used = GetPlainLetterMaskOfLegend(map, ALL_LETTERS_MASK);
+				unsigned int	assigned;
+				int				pos, j;
+				char			*ptc;
+
+				memset(support, 0, ctx->wordCount * sizeof(int[26][26]));
+				memset(fitting, 0, ctx->wordCount * sizeof(int));
+
+				for (i = 0; i < ctx->wordCount; i++) {
+					assigned = GetPlainLetterMaskOfLegend(map, ctx->words[i]->cypherLetterMask);
+					for (pos = 0; pos < ctx->words[i]->numberOfPossibles; pos++) {
+						ptc = ctx->words[i]->possiblePlaintext[pos];
+						if ((map != NULL) &&
+							(!CanLetterMasksMakePlain(ctx->words[i]->possibleLetterMask[pos], assigned, used) ||
+							 !CanCypherAndLegendMakePlain(ctx->words[i]->cyphertext, map, ptc, NO, ctx->noSelfMapping))) {
+							continue;
+						}
+						fitting[i]++;
+						for (j = 0; j < ctx->words[i]->length; j++) {
+							if (isalpha(ctx->words[i]->cyphertext[j]) && isalpha(ptc[j])) {
+								support[i][tolower(ctx->words[i]->cyphertext[j]) - 'a'][tolower(ptc[j]) - 'a']++;
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// now score, sort and re-order each cypherword's possibles
+	for (i = 0; (i < ctx->wordCount) && !error && !finished; i++) {
+		cypherword	*word = ctx->words[i];
+		int			pos, j, v;
+		char		*ptc;
+
+		if (word->numberOfPossibles < 2) {
+			continue;
+		}
+
+		for (pos = 0; pos < word->numberOfPossibles; pos++) {
+			ptc = word->possiblePlaintext[pos];
+			scores[pos].index = pos;
+			scores[pos].score = 0.0;
+
+			if (ordering == ORDER_BY_CROSS_MATCH) {
+				for (j = 0; j < word->length; j++) {
+					if (isalpha(word->cyphertext[j]) && isalpha(ptc[j])) {
+						scores[pos].score += histo->crossMatch[tolower(word->cyphertext[j]) - 'a'][tolower(ptc[j]) - 'a'];
+					}
+				}
+			} else {
+				for (v = 0; v < ctx->wordCount; v++) {
+					int		left = -1;
+					int		c;
+
+					if ((v == i) || ((ctx->words[v]->cypherLetterMask & word->cypherLetterMask) == 0)) {
+						continue;
+					}
+					// the most this leaves is the fewest of any shared cypherchar
+					for (j = 0; j < word->length; j++) {
+						if (!isalpha(word->cyphertext[j]) || !isalpha(ptc[j])) {
+							continue;
+						}
+						c = tolower(word->cyphertext[j]) - 'a';
+						if ((ctx->words[v]->cypherLetterMask & (1 << c)) &&
+							((left < 0) || (support[v][c][tolower(ptc[j]) - 'a'] < left))) {
+							left = support[v][c][tolower(ptc[j]) - 'a'];
+						}
+					}
+					if (left == 0) {
+						scores[pos].score = -1.0;
+						break;
+					} else if ((left > 0) && (fitting[v] > 0)) {
+						scores[pos].score += ((double) left) / fitting[v];
+					}
+				}
+			}
+		}
+
+		// sort the scores, and then put the possibles in that order
+		qsort(scores, word->numberOfPossibles, sizeof(possibleScore), ComparePossibleScores);
+		if (!MakeCypherwordPossiblesPrivate(word)) {
+			error = YES;
+		} else {
+			for (pos = 0; pos < word->numberOfPossibles; pos++) {
+				plain[pos] = word->possiblePlaintext[scores[pos].index];
+				masks[pos] = word->possibleLetterMask[scores[pos].index];
+			}
+			memcpy(word->possiblePlaintext, plain, word->numberOfPossibles * sizeof(char *));
+			memcpy(word->possibleLetterMask, masks, word->numberOfPossibles * sizeof(unsigned int));
+		}
+	}
+
+	// in the end, release what we've used in this routine
+	if (histo != NULL) {
+		free(histo);
+	}
+	ArenaFree(ctx->arena, fitting);
+	ArenaFree(ctx->arena, support);
+	ArenaFree(ctx->arena, masks);
+	ArenaFree(ctx->arena, plain);
+	ArenaFree(ctx->arena, scores);
+
+	return !error;
+}
+
+
+/*
+ *	This routine estimates the size of the word block attack's search
+ *	from the legend 'map' - with the possibles as they'll be searched,
+ *	so it's done after they're weeded out and ordered. Each of the
+ *	'probes' dives goes down from the first cypherword, testing all
+ *	the possibles at each level just as the search would, and then
+ *	takes one of the ones that fit at random - from 'seed', so the
+ *	same puzzle gets the same estimate. If the weight of a level is
+ *	the product of the number that fit at each level above it, then
+ *	the possibles tested, nodes and solutions at each level are their
+ *	counts times that weight, and the estimate is the average of the
+ *	sums. The time for each possible tested on the dives is what's
+ *	used to predict the time for the whole search.
+ *
+ *	The dives stop early - after ESTIMATE_MIN_PROBES of them - once
+ *	they've cost more than ESTIMATE_BUDGET_FRACTION of the search
+ *	they predict, or ESTIMATE_LIMIT_FRACTION of its 'limit_us'. If
+ *	the product of the possibles is small, the most the search could
+ *	test - every possible under every node of the level above - is
+ *	used instead, and there's just the one dive, for the time.
+ */
+BOOL EstimateSearchSize(quipContext *ctx, legend *map, int probes, unsigned int seed, long limit_us, searchEstimate *estimate) {
+	BOOL			error = NO;
+	struct timespec	start, end;
+	double			bound = 0.0;
+	double			above = 1.0;
+	int				p, d, i;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if ((map == NULL) || (estimate == NULL) || (probes <= 0)) {
+			error = YES;
+			fprintf(stderr, "*** Error in EstimateSearchSize() ***\n"
+							"    The legend or the estimate is NULL, or there are no\n"
+							"    probes to make. This is most likely a bad call.\n");
+		} else {
+			memset(estimate, 0, sizeof(searchEstimate));
+			estimate->levels = ctx->wordCount;
+		}
+	}
+
+	// the most it could be is every possible of every cypherword
+	for (d = 0; !error && (d < ctx->wordCount); d++) {
+		estimate->productLog10 += log10((double) (ctx->words[d]->numberOfPossibles > 0 ? ctx->words[d]->numberOfPossibles : 1));
+		bound += above * ctx->words[d]->numberOfPossibles;
+		above *= ctx->words[d]->numberOfPossibles;
+	}
+	// ...and if that's small, it's close enough - but it still needs the time
+	if (!error && (estimate->productLog10 <= ESTIMATE_BOUND_LOG10)) {
+		estimate->bounded = YES;
+		probes = 1;
+	}
+
+	// now make the random dives down the search tree
+	clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+	for (p = 0; !error && (p < probes); p++) {
+		legend		current, next;
+		double		weight = 1.0;
+
+		SetLegendToLegend(&current, map);
+		for (d = 0; d < ctx->wordCount; d++) {
+			cypherword		*word = ctx->words[d];
+			unsigned int	used = GetPlainLetterMaskOfLegend(&current, ALL_LETTERS_MASK);
+			unsigned int	assigned = GetPlainLetterMaskOfLegend(&current, word->cypherLetterMask);
+			int				fits = 0;
+			int				children = 0;
+			int				chosen = -1;
+
+			// test every possible at this level, as the search would
+			for (i = 0; i < word->numberOfPossibles; i++) {
+				if (!CanLetterMasksMakePlain(word->possibleLetterMask[i], assigned, used) ||
+					!CanCypherAndLegendMakePlain(word->cyphertext, &current, word->possiblePlaintext[i], NO, ctx->noSelfMapping)) {
+					continue;
+				}
+				fits++;
+				SetLegendToLegend(&next, &current);
+				if (IncorporateCypherToPlainMapInLegend(word->cyphertext, word->possiblePlaintext[i], &next, ctx->noSelfMapping)) {
+					// ...keeping one of them at random
+					children++;
+					if ((rand_r(&seed) % children) == 0) {
+						chosen = i;
+					}
+				}
+			}
+			estimate->probeTested += word->numberOfPossibles;
+			estimate->tested += weight * word->numberOfPossibles;
+			estimate->nodes += weight * fits;
+
+			// ...and go down with the one we kept, if there's a level to go to
+			if (d == (ctx->wordCount - 1)) {
+				estimate->solutions += weight * children;
+			} else if (children > 0) {
+				SetLegendToLegend(&next, &current);
+				IncorporateCypherToPlainMapInLegend(word->cyphertext, word->possiblePlaintext[chosen], &next, ctx->noSelfMapping);
+				SetLegendToLegend(&current, &next);
+				weight *= children;
+				continue;
+			}
+			break;
+		}
+
+		// ...and see if the dives are costing more than they're worth
+		if ((p + 1) >= ESTIMATE_MIN_PROBES) {
+			clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+			if ((estimate->probeTested > ESTIMATE_BUDGET_FRACTION * estimate->tested / (p + 1)) ||
+				(((end.tv_sec - start.tv_sec) * 1000000.0 + (end.tv_nsec - start.tv_nsec) / 1000.0) >
+				 ESTIMATE_LIMIT_FRACTION * limit_us)) {
+				p++;
+				break;
+			}
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+
+	// ...and average them, and see what they say about the time
+	if (!error) {
+		estimate->probes = p;
+		estimate->tested /= p;
+		estimate->nodes /= p;
+		estimate->solutions /= p;
+		if (estimate->bounded) {
+			estimate->tested = bound;
+		}
+		estimate->probe_ns = (end.tv_sec - start.tv_sec) * 1000000000L
+							 + (end.tv_nsec - start.tv_nsec);
+		if (estimate->probeTested > 0) {
+			estimate->predicted_us = estimate->tested * estimate->probe_ns / estimate->probeTested / 1000.0;
+		}
+		estimate->done = YES;
+	}
+
+	return !error;
+}
+
+
+/*************************************************************************
+ *
+ *	Solve context routines
+ *
+ *	A solve context holds everything about solving one cyphertext,
+ *	so that a program can have as many of them as it likes - each
+ *	solving on its own thread, if need be - all sharing the one
+ *	dictionary of words.
+ *
+ ************************************************************************/
+/*
+ *	This routine creates a new, empty, solve context that will use
+ *	the dictionary 'dict' for its words. The dictionary isn't owned
+ *	by the context, and has to stay around as long as it does. It
+ *	can be NULL for now, so long as the context's 'dict' is set
+ *	before anything is solved with it.
+ */
+quipContext *CreateQuipContext(dictionary *dict) {
+	BOOL			error = NO;
+	quipContext		*retval = NULL;
+
+	// make the context, and set it to the defaults
+	if (!error) {
+		retval = (quipContext *) calloc(1, sizeof(quipContext));
+		if (retval == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in CreateQuipContext() ***\n"
+							"    The solve context could not be created. This is a\n"
+							"    serious allocation error.\n");
+		} else {
+			retval->dict = dict;
+			retval->htmlOutput = NO;
+			retval->quiet = NO;
+			retval->threadCount = 1;
+			retval->possibleOrdering = ORDER_BY_LIST;
+			retval->noSelfMapping = NO;
+			retval->frequencyTimeLimit = 0;
+			retval->search.depth = -1;
+		}
+	}
+
+	// ...and give it the arena for all the per-solve memory
+	if (!error) {
+		retval->arena = CreateArena(ARENA_CHUNK_SIZE);
+		if (retval->arena == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in CreateQuipContext() ***\n"
+							"    The arena for the solve context could not be created.\n"
+							"    This is a serious allocation error.\n");
+			free(retval);
+			retval = NULL;
+		}
+	}
+
+	return retval;
+}
+
+
+/*
+ *	This routine releases the solve context and everything in it -
+ *	except for the dictionary, which isn't the context's to release.
+ */
+quipContext *DestroyQuipContext(quipContext *ctx) {
+	if (ctx != NULL) {
+		ResetQuipContext(ctx);
+		ctx->arena = DestroyArena(ctx->arena);
+		free(ctx);
+	}
+
+	return NULL;
+}
+
+
+/*
+ *	This routine releases everything that was built up to solve
+ *	one cyphertext - the cypherwords, known substitutions, legends,
+ *	solutions, etc. - and puts the options on how to attack it back
+ *	to the defaults, so that the next one can be solved from a clean
+ *	slate. The dictionary, thread count, output format, solution
+ *	callback and cancel are left alone. Since all of that lives in the context's
+ *	arena, this is just a matter of forgetting it and resetting the
+ *	arena - no matter how many cypherwords or solutions there were.
+ */
+void ResetQuipContext(quipContext *ctx) {
+	if (ctx == NULL) {
+		return;
+	}
+
+	ctx->initialCyphertext = NULL;
+	ctx->userLegend = NULL;
+	ctx->words = NULL;
+	ctx->wordCount = 0;
+
+	if (ctx->legends != NULL) {
+		int		i;
+
+		for (i = 0; i < ctx->legendCount; i++) {
+			ctx->legends[i] = DestroyLegend(ctx->legends[i]);
+		}
+		free(ctx->legends);
+
+		ctx->legends = NULL;
+		ctx->legendCount = 0;
+	}
+
+	ctx->plainText = NULL;
+	ctx->plainTextCnt = 0;
+	ctx->plainTextMaxCnt = 0;
+
+	EndWordBlockAttack(ctx);
+	ResetArena(ctx->arena);
+
+	ctx->possibleOrdering = ORDER_BY_LIST;
+	ctx->noSelfMapping = NO;
+	ctx->frequencyTimeLimit = 0;
+	ctx->searchNodes = 0;
+	ctx->collectingStats = NO;
+	ctx->stats = NULL;
+	ctx->estimateMode = ESTIMATE_OFF;
+	memset(&(ctx->estimate), 0, sizeof(searchEstimate));
+	ctx->choosingAttack = NO;
+	memset(&(ctx->choice), 0, sizeof(attackChoice));
+	ctx->runningPortfolio = NO;
+	ctx->portfolio = NULL;
+	memset(ctx->phaseTime_us, 0, sizeof(ctx->phaseTime_us));
+	ctx->stopRequested = NO;
+	ctx->cached = NO;
+}
+
+
+/*
+ *	This routine sets the cyphertext the context is to solve. The
+ *	context keeps its own copy of it in its arena.
+ */
+BOOL SetCyphertextInContext(quipContext *ctx, char *text) {
+	BOOL		error = NO;
+	char		*copy = NULL;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if ((ctx == NULL) || (text == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in SetCyphertextInContext() ***\n"
+							"    The context or the cyphertext is NULL, and that\n"
+							"    means there's nothing to do. This is a bad call.\n");
+		}
+	}
+
+	// now make our own copy of it
+	if (!error) {
+		copy = ArenaStrdup(ctx->arena, text);
+		if (copy == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in SetCyphertextInContext() ***\n"
+							"    The cyphertext '%s' could not be copied for use\n"
+							"    by the context. This is a serious problem.\n", text);
+		} else {
+			ctx->initialCyphertext = copy;
+		}
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine adds the known substitution of the plaintext
+ *	character 'plainChar' for the cyphertext character 'cypherChar'
+ *	to the ones the context starts its attacks with.
+ */
+BOOL AddKnownSubstitutionToContext(quipContext *ctx, char cypherChar, char plainChar) {
+	BOOL		error = NO;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if ((ctx == NULL) || !isalpha(cypherChar) || !isalpha(plainChar)) {
+			error = YES;
+			fprintf(stderr, "*** Error in AddKnownSubstitutionToContext() ***\n"
+							"    The context is NULL, or the substitution isn't one\n"
+							"    letter for another. This is a bad call.\n");
+		}
+	}
+
+	// now, add it to the user legend
+	if (!error) {
+		if (ctx->userLegend == NULL) {
+			// we need to create a new user legend
+			ctx->userLegend = (legend *) ArenaAlloc(ctx->arena, sizeof(legend));
+			if (ctx->userLegend != NULL) {
+				memset(ctx->userLegend, 0, sizeof(legend));
+				ctx->userLegend->map[tolower(cypherChar) - 'a'] = plainChar;
+			} else {
+				error = YES;
+				fprintf(stderr, "*** Error in AddKnownSubstitutionToContext() ***\n"
+								"    The known substitution could not be used to create\n"
+								"    a new user legend structure. This is a serious\n"
+								"    problem because there will be no way to know where\n"
+								"    to start in the solution.\n");
+			}
+		} else {
+			// we can simply add to the existing legend
+			ctx->userLegend->map[tolower(cypherChar) - 'a'] = plainChar;
+		}
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine gives the context a 'callback' to be called with
+ *	each new solution as it's found - with the 'userData' for the
+ *	caller's own use. The solutions are still kept in the context's
+ *	'plainText', so that one found again isn't passed on again, and
+ *	the callback can stop the search by returning NO. A NULL callback
+ *	puts the context back to just keeping them.
+ */
+void SetSolutionCallbackInContext(quipContext *ctx, solutionCallback callback, void *userData) {
+	if (ctx != NULL) {
+		ctx->onSolution = callback;
+		ctx->onSolutionData = userData;
+	}
+}
+
+
+/*
+ *	This routine takes a decoding the attacks came up with in the
+ *	context's arena, and adds it to the list of solutions in
+ *	'plainText' - if it's not already there. If it's new, and the
+ *	context has a callback, the callback gets it right away, too.
+ */
+BOOL ReportSolution(quipContext *ctx, char *plaintext) {
+	BOOL		error = NO;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if (plaintext == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in ReportSolution() ***\n"
+							"    The passed-in solution is NULL, and that means\n"
+							"    there's nothing to report. This is a bad call.\n");
+		}
+	}
+
+	// save it if it's new
+	if (!error) {
+		int		j;
+		BOOL	newPlainText = YES;
+
+		// see if it matches any of the answers we have
+		for (j = 0; (j < ctx->plainTextCnt) && newPlainText; j++) {
+			if (strcmp(plaintext, ctx->plainText[j]) == 0) {
+				newPlainText = NO;
+			}
+		}
+
+		// if it's a new answer then save it
+		if (!newPlainText) {
+			if (ctx->stats != NULL) {
+				ctx->stats->duplicates++;
+			}
+			ArenaFree(ctx->arena, plaintext);
+		} else {
+			// see if there's enough room in the list
+			if (ctx->plainTextCnt == ctx->plainTextMaxCnt) {
+				/*
+				 *	OK... we need to expand the array the right
+				 *	amount. It's in the arena, so the old one is
+				 *	only given back on the reset - doubling it
+				 *	keeps that waste to no more than what we use.
+				 */
+				int		newMaxCnt = (ctx->plainTextMaxCnt == 0 ? STARTING_POSSIBLES_SIZE : 2 * ctx->plainTextMaxCnt);
+
+				ctx->plainText = (char **) ArenaRealloc(ctx->arena, ctx->plainText,
+								ctx->plainTextMaxCnt * sizeof(char *), newMaxCnt * sizeof(char *));
+				if (ctx->plainText == NULL) {
+					error = YES;
+					fprintf(stderr, "*** Error in ReportSolution() ***\n"
+									"    While trying to add the plaintext answer '%s' to the\n"
+									"    array of valid decodings for this cyphertext,\n"
+									"	the array needed to be expanded to hold %d decodings, but\n"
+									"    couldn't. This is a real big problem!\n", plaintext,
+									newMaxCnt);
+
+					// if it's gone, we need to update the sizes
+					ctx->plainTextCnt = 0;
+					ctx->plainTextMaxCnt = 0;
+				} else {
+					/*
+					 *	OK! it worked, so let's reflect the size
+					 *	change
+					 */
+					ctx->plainTextMaxCnt = newMaxCnt;
+				}
+			}
+
+			// save it for the caller to print out
+			if (!error) {
+				ctx->plainText[ctx->plainTextCnt++] = plaintext;
+			}
+
+			// ...and see if the caller wants to see it right now
+			if (!error && (ctx->onSolution != NULL)) {
+				struct timespec	outputStart;
+
+				clock_gettime(CLOCK_MONOTONIC_RAW, &outputStart);
+				if (!ctx->onSolution(plaintext, ctx->onSolutionData)) {
+					ctx->stopRequested = YES;
+				}
+				AddPhaseTime(ctx, PHASE_OUTPUT, &outputStart);
+			}
+		}
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine gets the cyphertext in the context ready to be
+ *	attacked - it splits it into the cypherwords and matches them
+ *	against the dictionary. The time it took is returned in
+ *	microseconds, if anyone wants it. There has to be at least one
+ *	known substitution, as every attack starts from them.
+ */
+BOOL PrepareCyphertext(quipContext *ctx, int *matchTime_us) {
+	BOOL			error = NO;
+	struct timespec	start, end;
+	struct timespec	phaseStart;
+
+	/*
+	 *	Without any known substitutions, there's no legend for the
+	 *	attacks to start from - and no telling what they'd come up
+	 *	with - so it's an error to try.
+	 */
+	if (!error && (ctx->userLegend == NULL)) {
+		error = YES;
+		fprintf(stderr, "*** Error ***\n"
+						"    There are no known substitutions for the cyphertext,\n"
+						"    and the attacks need at least one to start from. Give\n"
+						"    one with the '-ka=b' option.\n");
+	}
+
+	/*
+	 *	With '-x', none of the known substitutions can have a letter
+	 *	standing for itself - that's a contradiction from the start.
+	 */
+	if (!error && ctx->noSelfMapping && (ctx->userLegend != NULL)) {
+		int		c;
+
+		for (c = 0; (c < 26) && !error; c++) {
+			if (tolower(ctx->userLegend->map[c]) == ('a' + c)) {
+				error = YES;
+				fprintf(stderr, "*** Error ***\n"
+								"    The known substitution '-k%c=%c' has a letter standing\n"
+								"    for itself, and that can't be with the '-x' option.\n",
+								'a' + c, 'a' + c);
+			}
+		}
+	}
+
+	/*
+	 *	First, we need to split up the rawText into a bunch of
+	 *	cypherwords and prepare the system for a solution.
+	 */
+	clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+	phaseStart = start;
+	if (!error) {
+		if (!CreateCypherwordsFromCyphertext(ctx, ctx->initialCyphertext)) {
+			error = YES;
+			if (ctx->htmlOutput) {
+				printf("*** Error ***<BR>\n"
+					   "    The passsed in cyphertext could not be parsed into<BR>\n"
+					   "    cyberwords properly. Please check for messages<BR>\n"
+					   "    indicating what might have gone wrong.<BR>\n");
+			} else {
+				fprintf(stderr, "*** Error ***\n"
+								"    The passsed in cyphertext could not be parsed into\n"
+								"    cyberwords properly. Please check for messages\n"
+								"    indicating what might have gone wrong.\n");
+			}
+		}
+	}
+
+	AddPhaseTime(ctx, PHASE_PARSE, &phaseStart);
+
+	/*
+	 *	Next, we need to check each word in the dictionary to
+	 *	see if it's a possible match to each cypherword.
+	 */
+	clock_gettime(CLOCK_MONOTONIC_RAW, &phaseStart);
+	if (!error) {
+		if (!ProcessCypherwordsWithDictionary(ctx)) {
+			error = YES;
+			fprintf(stderr, "*** Error ***\n"
+							"    The words could not be processed properly.\n"
+							"    This is a serious problem, but there should be\n"
+							"    some indication as to the cause in the log.\n");
+		}
+	}
+	AddPhaseTime(ctx, PHASE_MATCH, &phaseStart);
+	clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+	if (matchTime_us != NULL) {
+		*matchTime_us = (end.tv_sec - start.tv_sec) * 1000000
+						+ (end.tv_nsec - start.tv_nsec) / 1000;
+	}
+
+	// ...and if the search is to be watched, get ready for that
+	if (!error && ctx->collectingStats) {
+		ctx->stats = CreateSearchStats(ctx);
+		if (ctx->stats == NULL) {
+			error = YES;
+		}
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine starts solving the cyphertext in the context with
+ *	the word block attack, but doesn't look for any solutions - that's
+ *	what SolveNext() is for. The search has 'timeLimit' seconds from
+ *	now, no matter how long the caller takes between solutions.
+ */
+BOOL StartSolve(quipContext *ctx, int timeLimit, int *matchTime_us) {
+	BOOL		error = NO;
+
+	if (!error) {
+		if (!PrepareCyphertext(ctx, matchTime_us)) {
+			error = YES;
+		}
+	}
+	if (!error) {
+		ctx->searchNodes = 0;
+		ctx->stopRequested = NO;
+		if (!StartWordBlockAttack(ctx, ctx->userLegend, timeLimit)) {
+			error = YES;
+		}
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine picks up the search started by StartSolve() where it
+ *	left off, and returns the next solution in 'plaintext' - which is
+ *	the context's, and good until it's reset, so the caller mustn't
+ *	free it. When there are no more, 'plaintext' is NULL, and
+ *	'finished' says if the search got to the end, or ran out of time.
+ *	The search can be dropped at any point with ResetQuipContext().
+ */
+BOOL SolveNext(quipContext *ctx, char **plaintext, BOOL *finished) {
+	BOOL		error = NO;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if ((ctx == NULL) || (plaintext == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in SolveNext() ***\n"
+							"    The context or the place for the solution is NULL,\n"
+							"    and that means there's nothing to do. This is a\n"
+							"    bad call.\n");
+		} else {
+			*plaintext = NULL;
+		}
+	}
+
+	// now run the search to the next solution
+	if (!error) {
+		if (!NextWordBlockSolution(ctx, plaintext)) {
+			error = YES;
+			EndWordBlockAttack(ctx);
+		}
+	}
+
+	if (finished != NULL) {
+		*finished = (!error && !ctx->search.timedOut);
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine solves the cyphertext in the context with its known
+ *	substitutions - it splits it into the cypherwords, matches them
+ *	against the dictionary, and then runs the attacks asked for. The
+ *	solutions are left in the context's 'plainText' - or passed to
+ *	its callback as they're found - and the number of legends tried
+ *	is in its 'searchNodes'.
+ *
+ *	'finished' is set to NO if an attack ran out of time, or was
+ *	stopped by the callback. The frequency attack has a time limit
+ *	of its own - the context's 'frequencyTimeLimit', if it has one -
+ *	and running out of it doesn't stop the word block attack from
+ *	being tried after it, with all of 'timeLimit'. The time spent matching the words
+ *	and searching for the solutions is returned in microseconds - if
+ *	anyone wants it. If the context is 'choosingAttack', the attacks
+ *	asked for are only for the cache key, and the one that's run is
+ *	the one that ChooseAttack() picks - and if it's 'runningPortfolio',
+ *	they're all raced by RunPortfolio().
+ *
+ *	If the context has a cache, and the result is in it, the cached
+ *	solutions are reported and that's it - with 'cached' set, and no
+ *	time spent matching or searching. Otherwise, a search that isn't
+ *	cut short has its solutions added to the cache. When the search
+ *	statistics are asked for, the search is always done.
+ */
+BOOL SolveCyphertext(quipContext *ctx, int timeLimit, BOOL tryingFrequencyAttack, BOOL tryingWordBlockAttack, BOOL *finished, int *matchTime_us, int *searchTime_us) {
+	BOOL			error = NO;
+	BOOL			keepGoing = YES;
+	BOOL			frequencyFinished = YES;
+	BOOL			searchStarted = NO;
+	int				frequencyTimeLimit = timeLimit;
+	char			*cacheKey = NULL;
+	struct timespec	start, end;
+
+	// the frequency attack may have a time limit of its own
+	if (ctx->frequencyTimeLimit != 0) {
+		frequencyTimeLimit = ctx->frequencyTimeLimit;
+	}
+
+	// first, see if we already know the answer
+	ctx->cached = NO;
+	if (!error && (ctx->cache != NULL)) {
+		clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+		cacheKey = CreateCacheKey(ctx, tryingFrequencyAttack, tryingWordBlockAttack);
+		// ...unless it's the search that's to be looked at
+		if ((cacheKey != NULL) && !ctx->collectingStats && (ctx->trace == NULL)) {
+			ctx->searchNodes = 0;
+			ctx->stopRequested = NO;
+			if (!LookupQuipCache(ctx->cache, ctx, cacheKey, &ctx->cached)) {
+				error = YES;
+			} else if (ctx->cached) {
+				AddPhaseTime(ctx, PHASE_CACHE, &start);
+				if (matchTime_us != NULL) {
+					*matchTime_us = 0;
+				}
+				if (searchTime_us != NULL) {
+					*searchTime_us = 0;
+				}
+				if (finished != NULL) {
+					*finished = !ctx->stopRequested;
+				}
+				return YES;
+			}
+		}
+		AddPhaseTime(ctx, PHASE_CACHE, &start);
+	}
+
+	// ...and if not, get the cypherwords and their possibles
+	if (!error) {
+		if (!PrepareCyphertext(ctx, matchTime_us)) {
+			error = YES;
+		}
+	}
+
+	/*
+	 *	Let's try a frequency-based attack on the problem.
+	 *	it isn't as 'smart' as others, but it's a complete
+	 *	search through all possible legends, and with a
+	 *	reduced search space, it should be reasonably fast.
+	 */
+	clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+	ctx->searchNodes = 0;
+	ctx->stopRequested = NO;
+
+	/*
+	 *	If we're to pick the attack, then start the word block
+	 *	attack to get the estimate of its search, and see what the
+	 *	frequency attack would take - and go with the cheaper one.
+	 */
+	memset(&(ctx->choice), 0, sizeof(attackChoice));
+	if (!error && keepGoing && ctx->runningPortfolio) {
+		if (!RunPortfolio(ctx, timeLimit, &keepGoing)) {
+			error = YES;
+		}
+		tryingFrequencyAttack = NO;
+		tryingWordBlockAttack = NO;
+	} else if (!error && keepGoing && ctx->choosingAttack) {
+		if (ctx->estimateMode == ESTIMATE_OFF) {
+			ctx->estimateMode = ESTIMATE_REPORT;
+		}
+		if (!StartWordBlockAttack(ctx, ctx->userLegend, timeLimit) ||
+			!ChooseAttack(ctx, ctx->userLegend, timeLimit, &(ctx->choice))) {
+			error = YES;
+		} else {
+			tryingFrequencyAttack = (ctx->choice.chosen == ATTACK_FREQUENCY);
+			tryingWordBlockAttack = (ctx->choice.chosen == ATTACK_WORD_BLOCK);
+			searchStarted = tryingWordBlockAttack;
+			if (!searchStarted) {
+				EndWordBlockAttack(ctx);
+			}
+		}
+	}
+
+	if (!error && keepGoing && tryingFrequencyAttack) {
+		if (!DoFrequencyAttack(ctx, ctx->userLegend, frequencyTimeLimit) || ctx->stopRequested) {
+			keepGoing = NO;
+		}
+		// ...running out of time isn't a reason to skip the word block attack
+		frequencyFinished = !ctx->frequencyTimedOut;
+	}
+
+	/*
+	 *	Let's try a word-by-word attack on the solution.
+	 *	Start with the first plaintext word of the first
+	 *	cypherword and put all missing keys into the legend.
+	 *	Then, move to the next cypherword and repeat. If
+	 *	we do it right, blocks of the legend will be tried
+	 *	at once and therefore make it a little more speedy.
+	 */
+	if (!error && keepGoing && tryingWordBlockAttack) {
+		char		*decoded = NULL;
+
+		if (!searchStarted && !StartWordBlockAttack(ctx, ctx->userLegend, timeLimit)) {
+			error = YES;
+		}
+		while (!error && !ctx->stopRequested) {
+			if (!NextWordBlockSolution(ctx, &decoded)) {
+				error = YES;
+			} else if (decoded == NULL) {
+				break;
+			} else if (!ReportSolution(ctx, decoded)) {
+				error = YES;
+			}
+		}
+		if (error || ctx->stopRequested || ctx->search.timedOut) {
+			keepGoing = NO;
+		}
+		EndWordBlockAttack(ctx);
+	}
+
+	/*
+	 *	If the word block attack was refused because it was going
+	 *	to take too long, and we're to reroute it, then try the
+	 *	frequency attack - if it hasn't already been tried.
+	 */
+	if (!error && ctx->estimate.refused && (ctx->estimateMode == ESTIMATE_REROUTE) &&
+		!tryingFrequencyAttack && !ctx->stopRequested) {
+		keepGoing = YES;
+		if (!DoFrequencyAttack(ctx, ctx->userLegend, frequencyTimeLimit) || ctx->stopRequested) {
+			keepGoing = NO;
+		}
+		frequencyFinished = !ctx->frequencyTimedOut;
+	}
+	// ...and it's only done if every attack that was tried was done
+	keepGoing = keepGoing && frequencyFinished;
+	clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+	if (searchTime_us != NULL) {
+		*searchTime_us = (end.tv_sec - start.tv_sec) * 1000000
+						 + (end.tv_nsec - start.tv_nsec) / 1000;
+	}
+	// ...and if the attack was picked, see how good a pick it was
+	if (!error) {
+		CheckAttackChoice(ctx, &(ctx->choice), keepGoing);
+	}
+
+	// a complete answer is worth keeping for the next time - and if
+	// it can't be, it's still the answer - but not one from an attack
+	// that wasn't the one the key is for
+	if (!error && keepGoing && (cacheKey != NULL) && !ctx->estimate.refused &&
+		(ctx->choice.chosen != ATTACK_FREQUENCY)) {
+		clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+		AddToQuipCache(ctx->cache, cacheKey, ctx->plainText, ctx->plainTextCnt);
+		AddPhaseTime(ctx, PHASE_CACHE, &start);
+	}
+
+	if (finished != NULL) {
+		*finished = keepGoing;
+	}
+
+	return !error;
+}
+
+
+/************************************************************************
+ *
+ *	Attack choosing functions
+ *
+ *	With the context's 'choosingAttack', the attack isn't the one the
+ *	caller asked for, but the one that's predicted to be cheaper for
+ *	this cyphertext - and once it's run, the prediction is checked
+ *	against what it really took.
+ *
+ ************************************************************************/
+/*
+ *	This routine estimates what the frequency attack would cost on
+ *	the cypherwords in the context with the legend 'map'. It's done
+ *	just like the estimate of the word block attack's search: each
+ *	of the 'probes' dives goes through the cypherchars, taking one of
+ *	the letters that aren't already taken at random, and the weight
+ *	of each cypherchar is the product of the number of them that
+ *	could have been taken for those before it. A dive that gets to
+ *	the end has a whole legend, and the time to test it against the
+ *	cypherwords is what's used for testing every legend. The spread
+ *	of what the dives say is kept as the relative standard error of
+ *	their average, in 'frequencyError'.
+ */
+BOOL EstimateFrequencyAttack(quipContext *ctx, legend *map, int probes, unsigned int seed, attackChoice *choice) {
+	BOOL			error = NO;
+	long			tested = 0;
+	long			legends = 0;
+	long			probe_ns = 0;
+	long			test_ns = 0;
+	int				hits = 0;
+	double			sum = 0.0;
+	double			sumOfSquares = 0.0;
+	struct timespec	start, end, testStart;
+	int				p, cc, i, j;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if ((map == NULL) || (choice == NULL) || (probes <= 0)) {
+			error = YES;
+			fprintf(stderr, "*** Error in EstimateFrequencyAttack() ***\n"
+							"    The legend or the choice is NULL, or there are no\n"
+							"    probes to make. This is most likely a bad call.\n");
+		} else {
+			choice->frequencyTested = 0.0;
+			choice->frequencyLegends = 0.0;
+			choice->frequencyError = 0.0;
+			choice->frequency_us = 0.0;
+		}
+	}
+
+	// ...and get the letters the attack would try for each cypherchar
+	if (!error) {
+		if (!BuildFreqAttackCandidates(ctx, map)) {
+			error = YES;
+		}
+	}
+
+	// now make the random dives through the cypherchars
+	clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+	for (p = 0; !error && (p < probes); p++) {
+		legend		current;
+		double		weight = 1.0;
+		double		work = 0.0;
+		BOOL		dead = NO;
+
+		SetLegendToLegend(&current, map);
+		for (cc = 0; (cc < 26) && !dead; cc++) {
+			int		children = 0;
+			int		chosen = -1;
+			BOOL	skip;
+
+			if (ctx->possibleCharCount[cc] == 0) {
+				continue;
+			}
+			// the ones not taken by a cypherchar before this one go on
+			for (i = 0; i < ctx->possibleCharCount[cc]; i++) {
+				skip = NO;
+				for (j = (cc - 1); (j >= 0) && !skip; j--) {
+					if (current.map[j] == ctx->possibleChar[cc][i]) {
+						skip = YES;
+					}
+				}
+				if (!skip) {
+					children++;
+					if ((rand_r(&seed) % children) == 0) {
+						chosen = i;
+					}
+				}
+			}
+			tested += ctx->possibleCharCount[cc];
+			work += weight * ctx->possibleCharCount[cc];
+			if (children == 0) {
+				dead = YES;
+			} else {
+				current.map[cc] = ctx->possibleChar[cc][chosen];
+				weight *= children;
+			}
+		}
+
+		// ...and if it got to a whole legend, see what it takes to test it
+		if (!dead) {
+			clock_gettime(CLOCK_MONOTONIC_RAW, &testStart);
+			for (i = 0; i < ctx->wordCount; i++) {
+				if (IsCypherwordDecryptedByLegend(ctx->words[i], &current)) {
+					hits++;
+				}
+			}
+			clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+			test_ns += (end.tv_sec - testStart.tv_sec) * 1000000000L
+					   + (end.tv_nsec - testStart.tv_nsec);
+			legends++;
+			choice->frequencyLegends += weight;
+			work += weight;
+		}
+		// ...and keep what this dive says, for how far off they are
+		choice->frequencyTested += work - (dead ? 0.0 : weight);
+		sum += work;
+		sumOfSquares += work * work;
+	}
+	clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+
+	// ...and average them, and see what they say about the time
+	if (!error) {
+		probe_ns = (end.tv_sec - start.tv_sec) * 1000000000L
+				   + (end.tv_nsec - start.tv_nsec);
+		choice->frequencyTested /= probes;
+		choice->frequencyLegends /= probes;
+		if ((probes > 1) && (sum > 0.0)) {
+			double	variance = (sumOfSquares - sum * sum / probes) / (probes - 1);
+
+			choice->frequencyError = sqrt((variance > 0.0 ? variance : 0.0) / probes) / (sum / probes);
+		}
+		if (tested > 0) {
+			choice->frequency_us += choice->frequencyTested * (probe_ns - test_ns) / tested / 1000.0;
+		}
+		if (legends > 0) {
+			choice->frequency_us += choice->frequencyLegends * test_ns / legends / 1000.0;
+		}
+		choice->frequency_us *= ATTACK_FREQUENCY_WEIGHT;
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine picks the attack for the cypherwords in the context
+ *	with the legend 'map' - once the word block attack has been
+ *	started with its estimate, so it's the search as it would be
+ *	run. Whichever is predicted to be cheaper is picked - except that
+ *	the frequency attack isn't picked if it's predicted to take more
+ *	than 'maxSec', as it would just run out of time, or if the dives
+ *	are too far apart for its prediction to be trusted. If there's
+ *	no word block search to estimate, because the possibles have
+ *	already ruled out any solution, then that's as cheap as it gets.
+ */
+BOOL ChooseAttack(quipContext *ctx, legend *map, int maxSec, attackChoice *choice) {
+	BOOL		error = NO;
+	int			letters = 0;
+	int			covered = 0;
+	char		*ptr;
+	int			i;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if ((map == NULL) || (choice == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in ChooseAttack() ***\n"
+							"    The legend or the choice is NULL, and that means\n"
+							"    there's nothing to do. This is a bad call.\n");
+		} else {
+			memset(choice, 0, sizeof(attackChoice));
+			choice->chosen = ATTACK_WORD_BLOCK;
+		}
+	}
+
+	// see how many hints there are, and how much of the cyphertext they cover
+	if (!error) {
+		for (i = 0; i < 26; i++) {
+			if (map->map[i] != 0) {
+				choice->hints++;
+			}
+		}
+		for (ptr = ctx->initialCyphertext; (ptr != NULL) && (*ptr != '\0'); ptr++) {
+			if (isalpha(*ptr)) {
+				letters++;
+				if (map->map[tolower(*ptr) - 'a'] != 0) {
+					covered++;
+				}
+			}
+		}
+		choice->coverage = (letters > 0 ? ((double) covered) / letters : 0.0);
+	}
+
+	// now see what each attack is predicted to cost, and go with the cheaper
+	if (!error && ctx->estimate.done) {
+		choice->wordBlock_us = ctx->estimate.predicted_us * ATTACK_WORD_BLOCK_WEIGHT;
+		if (!EstimateFrequencyAttack(ctx, map, ESTIMATE_PROBES, ESTIMATE_SEED, choice)) {
+			error = YES;
+		} else {
+			choice->unreliable = (choice->frequencyError > ATTACK_MAX_RELATIVE_ERROR);
+			if ((choice->frequency_us < choice->wordBlock_us) && !choice->unreliable &&
+				(choice->frequency_us <= maxSec * 1000000.0)) {
+				choice->chosen = ATTACK_FREQUENCY;
+			}
+		}
+	}
+	if (!error) {
+		choice->done = YES;
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine checks the prediction of the attack that was picked
+ *	against the time it really took - with the solutions it found
+ *	taken out of it - and marks it as a misprediction if it's off by
+ *	more than ATTACK_MISPREDICT_FACTOR either way. If the attack
+ *	wasn't 'finished', it could only have taken longer.
+ */
+void CheckAttackChoice(quipContext *ctx, attackChoice *choice, BOOL finished) {
+	double		predicted;
+
+	if ((choice == NULL) || !choice->done) {
+		return;
+	}
+
+	if (choice->chosen == ATTACK_FREQUENCY) {
+		predicted = choice->frequency_us;
+		choice->actual_us = ctx->phaseTime_us[PHASE_FREQUENCY];
+	} else {
+		predicted = choice->wordBlock_us;
+		choice->actual_us = ctx->phaseTime_us[PHASE_SEARCH];
+	}
+	choice->mispredicted = (((choice->actual_us >= ATTACK_MISPREDICT_FLOOR_US) ||
+							 (predicted >= ATTACK_MISPREDICT_FLOOR_US)) &&
+							((choice->actual_us > predicted * ATTACK_MISPREDICT_FACTOR) ||
+							 (finished && (choice->actual_us * ATTACK_MISPREDICT_FACTOR < predicted))));
+}
+
+
+/*
+ *	This routine returns the name of the ATTACK_* attack, for the
+ *	reports.
+ */
+char *GetAttackName(int attack) {
+	switch (attack) {
+		case ATTACK_WORD_BLOCK :
+			return "word block";
+		case ATTACK_FREQUENCY :
+			return "frequency";
+		default :
+			return "none";
+	}
+}
+
+
+/*
+ *	This routine prints how the attack was picked - if it was - with
+ *	what each was predicted to take, and what the one that was picked
+ *	really took.
+ */
+void PrintAttackChoice(quipContext *ctx) {
+	attackChoice	*choice = &(ctx->choice);
+
+	if (!choice->done) {
+		return;
+	}
+
+	if (ctx->htmlOutput) {
+		printf("<PRE>\n");
+	}
+	printf("Attack choice:\n");
+	printf("  hints: %d, covering %.0f%% of the letters\n", choice->hints, choice->coverage * 100.0);
+	printf("  predicted: word block %.4g ms, frequency %.4g ms (%.3g legends, +/- %.0f%%)\n",
+		   choice->wordBlock_us / 1000.0, choice->frequency_us / 1000.0, choice->frequencyLegends,
+		   choice->frequencyError * 100.0);
+	if (choice->unreliable) {
+		printf("  *** the frequency attack's prediction is too uncertain to go by ***\n");
+	}
+	printf("  picked the %s attack, and it took %.3f ms\n",
+		   GetAttackName(choice->chosen), choice->actual_us / 1000.0);
+	if (choice->mispredicted) {
+		printf("  *** the time it took was mispredicted ***\n");
+	}
+	if (ctx->htmlOutput) {
+		printf("</PRE>\n");
+	}
+}
+
+
+/************************************************************************
+ *
+ *	Portfolio functions
+ *
+ *	With the context's 'runningPortfolio', all the attacks are raced
+ *	on threads of their own, each with its own solve context on the
+ *	possibles of the one running the race, and the first one to get
+ *	through its search has the answer.
+ *
+ ************************************************************************/
+/*
+ *	This routine returns YES if the attacks in the context are to
+ *	stop because another one has the answer - or time's up. It's
+ *	checked just as often as the time limit is.
+ */
+BOOL IsSolveCancelled(quipContext *ctx) {
+	return ((ctx->cancel != NULL) && (*ctx->cancel != 0));
+}
+
+
+/*
+ *	This routine returns the name of the PORTFOLIO_* strategy, for
+ *	the reports.
+ */
+char *GetPortfolioStrategyName(int strategy) {
+	switch (strategy) {
+		case PORTFOLIO_WORD_BLOCK_LIST :
+			return "word block, list order";
+		case PORTFOLIO_WORD_BLOCK_CROSS_MATCH :
+			return "word block, cross-match order";
+		case PORTFOLIO_WORD_BLOCK_LEAST_CONSTRAINING :
+			return "word block, least constraining order";
+		case PORTFOLIO_FREQUENCY :
+			return "frequency";
+		default :
+			return "none";
+	}
+}
+
+
+/*
+ *	This routine creates the solve context for the PORTFOLIO_* strategy
+ *	from the context 'owner' - once it's matched and weeded out its
+ *	possibles. The new one has the same cyphertext, known substitutions
+ *	and options, and its cypherwords share the owner's possibles - with
+ *	their own copies of the arrays of them, so that the strategy can
+ *	re-order and weed them out on its own thread. The strings are the
+ *	owner's, so it has to outlive the new context.
+ */
+quipContext *CreatePortfolioContext(quipContext *owner, int strategy) {
+	BOOL			error = NO;
+	quipContext		*retval = NULL;
+	int				i;
+
+	// make the context, and give it the same things to solve
+	if (!error) {
+		retval = CreateQuipContext(owner->dict);
+		if (retval == NULL) {
+			error = YES;
+		} else {
+			retval->noSelfMapping = owner->noSelfMapping;
+			retval->inPortfolio = YES;
+			switch (strategy) {
+				case PORTFOLIO_WORD_BLOCK_CROSS_MATCH :
+					retval->possibleOrdering = ORDER_BY_CROSS_MATCH;
+					break;
+				case PORTFOLIO_WORD_BLOCK_LEAST_CONSTRAINING :
+					retval->possibleOrdering = ORDER_BY_LEAST_CONSTRAINING;
+					break;
+				default :
+					retval->possibleOrdering = ORDER_BY_LIST;
+					break;
+			}
+			if (!SetCyphertextInContext(retval, owner->initialCyphertext)) {
+				error = YES;
+			}
+		}
+	}
+	if (!error && (owner->userLegend != NULL)) {
+		retval->userLegend = (legend *) ArenaAlloc(retval->arena, sizeof(legend));
+		if (retval->userLegend == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in CreatePortfolioContext() ***\n"
+							"    The known substitutions could not be copied for the\n"
+							"    '%s' strategy. This is a serious allocation error.\n",
+							GetPortfolioStrategyName(strategy));
+		} else {
+			SetLegendToLegend(retval->userLegend, owner->userLegend);
+		}
+	}
+
+	// ...and split it up the same way, sharing the owner's possibles
+	if (!error) {
+		if (!CreateCypherwordsFromCyphertext(retval, retval->initialCyphertext)) {
+			error = YES;
+		} else if (retval->wordCount != owner->wordCount) {
+			error = YES;
+			fprintf(stderr, "*** Error in CreatePortfolioContext() ***\n"
+							"    The cyphertext split up into %d cypherwords for the\n"
+							"    '%s' strategy, and %d for the portfolio. This can't\n"
+							"    happen, and it's a serious problem.\n",
+							retval->wordCount, GetPortfolioStrategyName(strategy), owner->wordCount);
+		}
+	}
+	for (i = 0; !error && (i < retval->wordCount); i++) {
+		if (!ShareCypherwordPossibles(retval->words[i], owner->words[i]) ||
+			!MakeCypherwordPossiblesPrivate(retval->words[i])) {
+			error = YES;
+		}
+	}
+
+	// if we had any trouble, release what we've created
+	if (error) {
+		retval = DestroyQuipContext(retval);
+	}
+
+	return retval;
+}
+
+
+/*
+ *	This is the thread routine for one of the strategies in the race.
+ *	It runs its attack until it gets through it, runs out of time, or
+ *	is cancelled - and if it's the first to get through, it's the
+ *	winner, and it cancels the rest. The winner is claimed as soon as
+ *	it's through, with a compare-and-swap, so it's the first one to
+ *	finish - not the first one to get the lock afterwards.
+ */
+void *RunPortfolioStrategy(void *arg) {
+	portfolioStrategy	*strategy = (portfolioStrategy *) arg;
+	portfolio			*race = strategy->portfolio;
+	quipContext			*ctx = strategy->ctx;
+	BOOL				error = NO;
+	BOOL				finished = NO;
+	struct timespec		end;
+
+	if (strategy->strategy == PORTFOLIO_FREQUENCY) {
+		if (!DoFrequencyAttack(ctx, ctx->userLegend, race->timeLimit)) {
+			error = YES;
+		} else {
+			finished = !ctx->frequencyTimedOut;
+		}
+	} else {
+		char		*decoded = NULL;
+
+		if (!StartWordBlockAttack(ctx, ctx->userLegend, race->timeLimit)) {
+			error = YES;
+		}
+		while (!error) {
+			if (!NextWordBlockSolution(ctx, &decoded)) {
+				error = YES;
+			} else if (decoded == NULL) {
+				break;
+			} else if (!ReportSolution(ctx, decoded)) {
+				error = YES;
+			}
+		}
+		finished = (!error && !ctx->search.timedOut);
+		EndWordBlockAttack(ctx);
+	}
+	clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+
+	// ...and see if we're the first one through
+	if (finished && __sync_bool_compare_and_swap(&race->winner, -1, strategy->strategy)) {
+		race->cancel = 1;
+	}
+	pthread_mutex_lock(&race->lock);
+	strategy->finished = finished;
+	strategy->error = error;
+	strategy->nodes = ctx->searchNodes;
+	strategy->solutions = ctx->plainTextCnt;
+	strategy->elapsed_us = (end.tv_sec - race->start.tv_sec) * 1000000
+						   + (end.tv_nsec - race->start.tv_nsec) / 1000;
+	race->running--;
+	pthread_cond_signal(&race->done);
+	pthread_mutex_unlock(&race->lock);
+
+	return NULL;
+}
+
+
+/*
+ *	This routine races the strategies on the cyphertext in the context
+ *	- once it's been matched against the dictionary - for no more than
+ *	'timeLimit' seconds, and reports the solutions of the one that won
+ *	as if the context had found them itself. 'finished' is NO if none
+ *	of them got through their search, or the caller stopped it. The
+ *	'searchNodes' are those of all the strategies together, and the
+ *	search time is the time the race took.
+ */
+BOOL RunPortfolio(quipContext *ctx, int timeLimit, BOOL *finished) {
+	BOOL			error = NO;
+	BOOL			solvable = YES;
+	portfolio		*race = NULL;
+	struct timespec	start, deadline;
+	int				i;
+
+	*finished = NO;
+
+	// first, weed out the possibles once - for all of them
+	clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+	if (!error && (ctx->wordCount > 0)) {
+		if (!ReduceCypherwordDomains(ctx, ctx->userLegend, &solvable)) {
+			error = YES;
+		}
+	}
+	AddPhaseTime(ctx, PHASE_PREPARE, &start);
+	// ...and if there's no way to a solution, there's no race to run
+	if (!error && (!solvable || (ctx->wordCount == 0))) {
+		*finished = YES;
+		return YES;
+	}
+
+	// now set up the race, with a context for each strategy
+	clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+	if (!error) {
+		race = (portfolio *) ArenaAlloc(ctx->arena, sizeof(portfolio));
+		if (race == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in RunPortfolio() ***\n"
+							"    The portfolio of strategies could not be created.\n"
+							"    This is a serious allocation error.\n");
+		} else {
+			memset(race, 0, sizeof(portfolio));
+			race->owner = ctx;
+			race->timeLimit = timeLimit;
+			race->winner = -1;
+			race->taken = -1;
+			pthread_mutex_init(&race->lock, NULL);
+			pthread_cond_init(&race->done, NULL);
+			ctx->portfolio = race;
+		}
+	}
+	for (i = 0; !error && (i < PORTFOLIO_STRATEGIES); i++) {
+		race->strategies[i].strategy = i;
+		race->strategies[i].portfolio = race;
+		race->strategies[i].ctx = CreatePortfolioContext(ctx, i);
+		if (race->strategies[i].ctx == NULL) {
+			error = YES;
+		} else {
+			race->strategies[i].ctx->cancel = &race->cancel;
+		}
+	}
+
+	// ...and start them all off - without the lock, so none has to wait for it
+	if (!error) {
+		clock_gettime(CLOCK_MONOTONIC_RAW, &race->start);
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += timeLimit;
+		for (i = 0; !error && (i < PORTFOLIO_STRATEGIES); i++) {
+			pthread_mutex_lock(&race->lock);
+			race->running++;
+			pthread_mutex_unlock(&race->lock);
+			if (pthread_create(&race->strategies[i].thread, NULL, RunPortfolioStrategy, &race->strategies[i]) != 0) {
+				error = YES;
+				fprintf(stderr, "*** Error in RunPortfolio() ***\n"
+								"    The thread for the '%s' strategy could not be\n"
+								"    started, so the race is off.\n",
+								GetPortfolioStrategyName(i));
+				pthread_mutex_lock(&race->lock);
+				race->running--;
+				pthread_mutex_unlock(&race->lock);
+			} else {
+				race->strategies[i].started = YES;
+			}
+		}
+
+		// wait for the first one through - or for the time to run out
+		pthread_mutex_lock(&race->lock);
+		while (!error && (race->winner < 0) && (race->running > 0)) {
+			if (pthread_cond_timedwait(&race->done, &race->lock, &deadline) == ETIMEDOUT) {
+				break;
+			}
+		}
+		race->cancel = 1;
+		pthread_mutex_unlock(&race->lock);
+	}
+
+	// ...then get them all back, and take the winner's solutions
+	for (i = 0; (race != NULL) && (i < PORTFOLIO_STRATEGIES); i++) {
+		if (race->strategies[i].started) {
+			pthread_join(race->strategies[i].thread, NULL);
+		}
+	}
+	if (!error) {
+		race->taken = race->winner;
+		/*
+		 *	If none of them got through, take what the word block
+		 *	attack in list order found - how far each of them got
+		 *	depends on how the threads were run, so taking the one
+		 *	that found the most would make the answer depend on it.
+		 */
+		if ((race->winner < 0) && !race->strategies[PORTFOLIO_WORD_BLOCK_LIST].error &&
+			(race->strategies[PORTFOLIO_WORD_BLOCK_LIST].solutions > 0)) {
+			race->taken = PORTFOLIO_WORD_BLOCK_LIST;
+		}
+		for (i = 0; i < PORTFOLIO_STRATEGIES; i++) {
+			ctx->searchNodes += race->strategies[i].nodes;
+		}
+	}
+	AddPhaseTime(ctx, PHASE_SEARCH, &start);
+	if (!error && (race->taken >= 0)) {
+		quipContext		*winner = race->strategies[race->taken].ctx;
+		char			*copy = NULL;
+
+		for (i = 0; !error && !ctx->stopRequested && (i < winner->plainTextCnt); i++) {
+			copy = ArenaStrdup(ctx->arena, winner->plainText[i]);
+			if ((copy == NULL) || !ReportSolution(ctx, copy)) {
+				error = YES;
+			}
+		}
+	}
+	if (!error) {
+		*finished = ((race->winner >= 0) && !ctx->stopRequested);
+	}
+
+	// in the end, release the strategies' contexts
+	for (i = 0; (race != NULL) && (i < PORTFOLIO_STRATEGIES); i++) {
+		race->strategies[i].ctx = DestroyQuipContext(race->strategies[i].ctx);
+	}
+	if (race != NULL) {
+		pthread_cond_destroy(&race->done);
+		pthread_mutex_destroy(&race->lock);
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine prints how the race of the strategies went - if
+ *	there was one - with how far each got, and which one's solutions
+ *	were taken.
+ */
+void PrintPortfolio(quipContext *ctx) {
+	portfolio	*race = ctx->portfolio;
+	int			i;
+
+	if (race == NULL) {
+		return;
+	}
+
+	if (ctx->htmlOutput) {
+		printf("<PRE>\n");
+	}
+	printf("Portfolio:\n");
+	printf("    %-36s %8s %12s %12s %10s\n", "strategy", "finished", "time (ms)", "nodes", "solutions");
+	for (i = 0; i < PORTFOLIO_STRATEGIES; i++) {
+		printf("    %-36s %8s %12.3f %12ld %10d\n", GetPortfolioStrategyName(i),
+			   (race->strategies[i].error ? "error" : (race->strategies[i].finished ? "yes" : "no")),
+			   race->strategies[i].elapsed_us / 1000.0, race->strategies[i].nodes,
+			   race->strategies[i].solutions);
+	}
+	if (race->winner >= 0) {
+		printf("  the '%s' strategy won\n", GetPortfolioStrategyName(race->winner));
+	} else if (race->taken >= 0) {
+		printf("  none finished - the solutions are those of the '%s' strategy\n",
+			   GetPortfolioStrategyName(race->taken));
+	} else {
+		printf("  none finished, or found any solutions\n");
+	}
+	if (ctx->htmlOutput) {
+		printf("</PRE>\n");
+	}
+}
+
+
+/************************************************************************
+ *
+ *	Search statistics functions
+ *
+ *	These functions keep track of how the attacks searched for the
+ *	solutions - when it's asked for with the context's 'collectingStats'
+ *	- so that the cypherword that's blowing up the search can be found.
+ *	When it's not asked for, the attacks only check that the context's
+ *	'stats' is NULL, and the search itself isn't changed at all.
+ *
+ ************************************************************************/
+/*
+ *	This routine creates the empty statistics for searching the
+ *	cypherwords in the context. They're in the context's arena, and
+ *	so they're good until it's reset.
+ */
+searchStats *CreateSearchStats(quipContext *ctx) {
+	BOOL		error = NO;
+	searchStats	*retval = NULL;
+	int			levels = (ctx->wordCount > 0 ? ctx->wordCount : 1);
+
+	// get the space for the statistics and the counts by cypherword
+	if (!error) {
+		retval = (searchStats *) ArenaAlloc(ctx->arena, sizeof(searchStats));
+		if (retval != NULL) {
+			memset(retval, 0, sizeof(searchStats));
+			retval->tested = (long *) ArenaAlloc(ctx->arena, 3 * levels * sizeof(long));
+		}
+		if ((retval == NULL) || (retval->tested == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in CreateSearchStats() ***\n"
+							"    The statistics for searching the %d cypherwords could\n"
+							"    not be created. This is a serious allocation error.\n",
+							ctx->wordCount);
+		}
+	}
+
+	// ...and they all start at nothing
+	if (!error) {
+		memset(retval->tested, 0, 3 * levels * sizeof(long));
+		retval->levels = ctx->wordCount;
+		retval->rejected = &(retval->tested[levels]);
+		retval->nodes = &(retval->tested[2 * levels]);
+		retval->maxDepth = -1;
+		retval->freqMaxDepth = -1;
+	}
+
+	return error ? NULL : retval;
+}
+
+
+/*
+ *	This routine looks at why the cyphertext and legend can't make
+ *	the plaintext - one of the CONFLICT_* causes. The first letter
+ *	that doesn't fit decides it: its cypherchar might already stand
+ *	for another letter, its plaintext letter might already come from
+ *	another cypherchar, or with 'noSelfMapping', it might stand for
+ *	itself. If none of those, it's CONFLICT_OTHER.
+ */
+int GetLegendConflict(char *cyphertext, legend *map, char *plaintext, BOOL noSelfMapping) {
+	int			retval = CONFLICT_OTHER;
+	int			i, j;
+	char		c, p;
+
+	for (i = 0; (cyphertext[i] != '\0') && (plaintext[i] != '\0') && (retval == CONFLICT_OTHER); i++) {
+		if (!isalpha(cyphertext[i])) {
+			continue;
+		}
+		c = tolower(cyphertext[i]);
+		p = tolower(plaintext[i]);
+		if (map->map[c - 'a'] != 0) {
+			if (tolower(map->map[c - 'a']) != p) {
+				retval = CONFLICT_CYPHER_MAPPED;
+			}
+		} else if (noSelfMapping && (c == p)) {
+			retval = CONFLICT_SELF_MAPPING;
+		} else {
+			for (j = 0; j < 26; j++) {
+				if (tolower(map->map[j]) == p) {
+					retval = CONFLICT_PLAIN_TAKEN;
+					break;
+				}
+			}
+		}
+	}
+
+	return retval;
+}
+
+
+/*
+ *	This routine returns the name of the CONFLICT_* cause, for the
+ *	reports.
+ */
+char *GetConflictName(int cause) {
+	switch (cause) {
+		case CONFLICT_CYPHER_MAPPED :
+			return "mapped";
+		case CONFLICT_PLAIN_TAKEN :
+			return "taken";
+		case CONFLICT_SELF_MAPPING :
+			return "self";
+		default :
+			return "other";
+	}
+}
+
+
+/*
+ *	This routine prints out the statistics of the last search in
+ *	the context - if there are any. The word block attack's are by
+ *	cypherword, in the order they were searched, and the frequency
+ *	attack's are by cypherchar, for those it had letters to try for.
+ */
+void PrintSearchStats(quipContext *ctx) {
+	searchStats	*stats = ctx->stats;
+	int			i;
+
+	if (stats == NULL) {
+		return;
+	}
+
+	if (ctx->htmlOutput) {
+		printf("<PRE>\n");
+	}
+	printf("Search statistics:\n");
+	printf("  nodes: %ld, duplicate solutions: %ld\n", ctx->searchNodes, stats->duplicates);
+	printf("  conflicts:");
+	for (i = 0; i < CONFLICT_CAUSES; i++) {
+		printf(" %s %ld%s", GetConflictName(i), stats->conflicts[i], (i < CONFLICT_CAUSES - 1 ? "," : "\n"));
+	}
+	if ((stats->levels > 0) && (stats->tested[0] > 0)) {
+		printf("  word block attack: max depth %d of %d\n", (stats->maxDepth + 1), stats->levels);
+		printf("    %5s  %-20s %9s %12s %12s %12s\n", "depth", "cypherword", "possibles",
+			   "tested", "rejected", "nodes");
+		for (i = 0; i < stats->levels; i++) {
+			printf("    %5d  %-20s %9d %12ld %12ld %12ld\n", (i + 1), ctx->words[i]->cyphertext,
+				   ctx->words[i]->numberOfPossibles, stats->tested[i], stats->rejected[i],
+				   stats->nodes[i]);
+		}
+	}
+	if ((stats->freqMaxDepth >= 0) || (stats->freqLegends > 0)) {
+		printf("  frequency attack: %ld legends, %ld missed\n", stats->freqLegends, stats->freqMisses);
+		printf("    %10s %9s %12s %12s %12s\n", "cypherchar", "letters", "tested", "rejected", "nodes");
+		for (i = 0; i < 26; i++) {
+			if (ctx->possibleCharCount[i] > 0) {
+				printf("    %10c %9d %12ld %12ld %12ld\n", ('a' + i), ctx->possibleCharCount[i],
+					   stats->freqTested[i], stats->freqRejected[i], stats->freqNodes[i]);
+			}
+		}
+	}
+	if (ctx->htmlOutput) {
+		printf("</PRE>\n");
+	}
+}
+
+
+/*
+ *	This routine prints the estimate of the size of the word block
+ *	attack's search - if one was made - along with how long it was
+ *	predicted to take, and what was done about it.
+ */
+void PrintSearchEstimate(quipContext *ctx) {
+	searchEstimate	*estimate = &(ctx->estimate);
+
+	if (!estimate->done) {
+		return;
+	}
+
+	if (ctx->htmlOutput) {
+		printf("<PRE>\n");
+	}
+	printf("Search estimate:\n");
+	printf("  cypherwords: %d, product of the possibles: 10^%.1f\n",
+		   estimate->levels, estimate->productLog10);
+	printf("  random probes: %d, testing %ld possibles in %.3f ms%s\n",
+		   estimate->probes, estimate->probeTested, estimate->probe_ns / 1000000.0,
+		   (estimate->bounded ? " - the rest is the bound" : ""));
+	printf("  estimated: %.3g possibles tested, %.3g nodes, %.3g solutions\n",
+		   estimate->tested, estimate->nodes, estimate->solutions);
+	printf("  predicted time: %.3f ms, of the %ld ms allowed\n",
+		   estimate->predicted_us / 1000.0, estimate->limit_us / 1000);
+	if (estimate->refused) {
+		printf("  *** the search was predicted to take too long, and wasn't started ***\n");
+	} else if (estimate->overBudget) {
+		printf("  *** the search is predicted to take too long ***\n");
+	}
+	if (ctx->htmlOutput) {
+		printf("</PRE>\n");
+	}
+}
+
+
+/************************************************************************
+ *
+ *	Phase timing functions
+ *
+ *	These functions keep track of the time spent in each phase of a
+ *	solve - from parsing the cyphertext to printing the solutions -
+ *	and report it, with the memory that was used to do it.
+ *
+ ************************************************************************/
+/*
+ *	This routine adds the time since 'start' to the phase in the
+ *	context.
+ */
+void AddPhaseTime(quipContext *ctx, int phase, struct timespec *start) {
+	struct timespec	now;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+	ctx->phaseTime_us[phase] += (now.tv_sec - start->tv_sec) * 1000000
+								+ (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+
+/*
+ *	This routine returns the name of the PHASE_* phase, for the
+ *	reports.
+ */
+char *GetPhaseName(int phase) {
+	switch (phase) {
+		case PHASE_LOAD :
+			return "load";
+		case PHASE_PARSE :
+			return "parse";
+		case PHASE_MATCH :
+			return "match";
+		case PHASE_CACHE :
+			return "cache";
+		case PHASE_HISTOGRAM :
+			return "histogram";
+		case PHASE_FREQUENCY :
+			return "frequency";
+		case PHASE_PREPARE :
+			return "prepare";
+		case PHASE_SEARCH :
+			return "search";
+		case PHASE_OUTPUT :
+			return "output";
+		default :
+			return "other";
+	}
+}
+
+
+/*
+ *	This routine prints out the time spent in each phase of the last
+ *	solve in the context - and if the caller knows the 'total_us' it
+ *	took, then the time not in any of them, too. After that are the
+ *	allocations from the context's arena, and the peak resident size
+ *	of the process. With the HTML output, it's all in a table.
+ */
+void PrintPhaseTimes(quipContext *ctx, long total_us) {
+	struct rusage	usage;
+	long			sum_us = 0;
+	long			peak_kb = 0;
+	int				i;
+
+	for (i = 0; i < PHASE_COUNT; i++) {
+		sum_us += ctx->phaseTime_us[i];
+	}
+	if (total_us < sum_us) {
+		total_us = sum_us;
+	}
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+		peak_kb = usage.ru_maxrss;
+	}
+
+	if (ctx->htmlOutput) {
+		printf("<TABLE>\n<TR><TH>phase</TH><TH>us</TH><TH>%%</TH></TR>\n");
+		for (i = 0; i < PHASE_COUNT; i++) {
+			printf("<TR><TD>%s</TD><TD>%ld</TD><TD>%.1f</TD></TR>\n", GetPhaseName(i),
+				   ctx->phaseTime_us[i], (total_us > 0 ? 100.0 * ctx->phaseTime_us[i] / total_us : 0.0));
+		}
+		printf("<TR><TD>other</TD><TD>%ld</TD><TD>%.1f</TD></TR>\n", (total_us - sum_us),
+			   (total_us > 0 ? 100.0 * (total_us - sum_us) / total_us : 0.0));
+		printf("<TR><TD>total</TD><TD>%ld</TD><TD>100.0</TD></TR>\n</TABLE>\n", total_us);
+		printf("Arena: %ld allocations, %lu bytes, %ld chunks<BR>\n", ctx->arena->allocations,
+			   (unsigned long) ctx->arena->allocatedBytes, ctx->arena->chunkAllocations);
+		printf("Peak RSS: %ld KB<BR>\n", peak_kb);
+	} else {
+		printf("Phase times:\n");
+		for (i = 0; i < PHASE_COUNT; i++) {
+			printf("  %-10s %10ld us %5.1f%%\n", GetPhaseName(i), ctx->phaseTime_us[i],
+				   (total_us > 0 ? 100.0 * ctx->phaseTime_us[i] / total_us : 0.0));
+		}
+		printf("  %-10s %10ld us %5.1f%%\n", "other", (total_us - sum_us),
+			   (total_us > 0 ? 100.0 * (total_us - sum_us) / total_us : 0.0));
+		printf("  %-10s %10ld us\n", "total", total_us);
+		printf("  arena: %ld allocations, %lu bytes, %ld chunks\n", ctx->arena->allocations,
+			   (unsigned long) ctx->arena->allocatedBytes, ctx->arena->chunkAllocations);
+		printf("  peak RSS: %ld KB\n", peak_kb);
+	}
+}
+
+
+/************************************************************************
+ *
+ *	Search trace functions
+ *
+ *	These functions write the trace of the word block attack - every
+ *	possible it tries, and what became of it - to a file, so that the
+ *	search can be looked over, and picked apart, long after it's done.
+ *
+ ************************************************************************/
+/*
+ *	This routine creates the file 'filename' for a search trace, and
+ *	returns the trace to put in the context - or NULL, having said
+ *	why, if it can't. The caller needs to close it with
+ *	CloseSearchTrace() when the context is done with it.
+ */
+searchTrace *OpenSearchTrace(char *filename) {
+	BOOL			error = NO;
+	searchTrace		*retval = NULL;
+
+	// first, make the trace and its buffer of events
+	if (!error) {
+		retval = (searchTrace *) calloc(1, sizeof(searchTrace));
+		if (retval != NULL) {
+			retval->events = (unsigned int *) malloc(SEARCH_TRACE_BUFFER * sizeof(unsigned int));
+		}
+		if ((retval == NULL) || (retval->events == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in OpenSearchTrace() ***\n"
+							"    The search trace, and its buffer of %d events, could\n"
+							"    not be created. This is a serious allocation error.\n",
+							SEARCH_TRACE_BUFFER);
+		}
+	}
+
+	// ...and the file to write it to
+	if (!error) {
+		retval->fp = fopen(filename, "w");
+		if (retval->fp == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in OpenSearchTrace() ***\n"
+							"    The trace file '%s' could not be created: %s\n",
+							filename, strerror(errno));
+		}
+	}
+
+	if (error && (retval != NULL)) {
+		retval = CloseSearchTrace(retval);
+	}
+
+	return retval;
+}
+
+
+/*
+ *	This routine writes out whatever is left of the trace, closes
+ *	the file and releases the trace. It always returns NULL.
+ */
+searchTrace *CloseSearchTrace(searchTrace *trace) {
+	if (trace != NULL) {
+		if (trace->fp != NULL) {
+			FlushSearchTrace(trace);
+			if (fclose(trace->fp) != 0) {
+				fprintf(stderr, "*** Error in CloseSearchTrace() ***\n"
+								"    The trace file could not be closed: %s\n", strerror(errno));
+			}
+		}
+		if (trace->events != NULL) {
+			free(trace->events);
+		}
+		free(trace);
+	}
+
+	return NULL;
+}
+
+
+/*
+ *	This routine writes the events in the trace's buffer to its file,
+ *	and empties the buffer. If the file can't be written, the trace
+ *	is stopped, as what's in it wouldn't make sense anymore.
+ */
+void FlushSearchTrace(searchTrace *trace) {
+	if ((trace->count > 0) && !trace->error) {
+		if (fwrite(trace->events, sizeof(unsigned int), trace->count, trace->fp) != (size_t) trace->count) {
+			trace->error = YES;
+			trace->inSearch = NO;
+			fprintf(stderr, "*** Error in FlushSearchTrace() ***\n"
+							"    The search trace could not be written: %s\n"
+							"    No more of the search will be traced.\n", strerror(errno));
+		}
+	}
+	trace->count = 0;
+}
+
+
+/*
+ *	This routine starts a new search in the trace - it's called by
+ *	StartWordBlockAttack() once the possibles have been weeded out,
+ *	and put in order, as the events refer to them by where they are
+ *	in that order. The header has the cyphertext and then each of the
+ *	cypherwords, in the order they're searched, with all of their
+ *	possibles. A search that's too big for the events to describe
+ *	isn't traced at all.
+ */
+BOOL StartSearchTrace(quipContext *ctx) {
+	BOOL				error = NO;
+	BOOL				finished = NO;
+	searchTrace			*trace = ctx->trace;
+	searchTraceHeader	header;
+	searchTraceWord		entry;
+	int					i, p;
+
+	// first, see if the search can be traced at all
+	if (!error && !finished) {
+		if (trace->error) {
+			finished = YES;
+		} else if (ctx->wordCount > TRACE_MAX_DEPTH) {
+			finished = YES;
+			fprintf(stderr, "*** Error in StartSearchTrace() ***\n"
+							"    The quip has %d cypherwords, and a trace can only\n"
+							"    follow a search of %d of them. It won't be traced.\n",
+							ctx->wordCount, TRACE_MAX_DEPTH);
+		} else {
+			for (i = 0; (i < ctx->wordCount) && !finished; i++) {
+				if (ctx->words[i]->numberOfPossibles > TRACE_MAX_INDEX) {
+					finished = YES;
+					fprintf(stderr, "*** Error in StartSearchTrace() ***\n"
+									"    The cypherword '%s' has %d possibles, and a trace\n"
+									"    can only follow %d of them. It won't be traced.\n",
+									ctx->words[i]->cyphertext, ctx->words[i]->numberOfPossibles,
+									TRACE_MAX_INDEX);
+				}
+			}
+		}
+	}
+
+	// now write out the header, the cyphertext, and the cypherwords
+	if (!error && !finished) {
+		FlushSearchTrace(trace);
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, SEARCH_TRACE_MAGIC, sizeof(header.magic));
+		header.version = SEARCH_TRACE_VERSION;
+		header.wordCount = ctx->wordCount;
+		header.cyphertextLength = strlen(ctx->initialCyphertext);
+		header.noSelfMapping = ctx->noSelfMapping;
+		header.possibleOrdering = ctx->possibleOrdering;
+		if ((fwrite(&header, sizeof(header), 1, trace->fp) != 1) ||
+			(fwrite(ctx->initialCyphertext, 1, header.cyphertextLength, trace->fp) != (size_t) header.cyphertextLength)) {
+			error = YES;
+		}
+		for (i = 0; !error && (i < ctx->wordCount); i++) {
+			entry.length = ctx->words[i]->length;
+			entry.numberOfPossibles = ctx->words[i]->numberOfPossibles;
+			if ((fwrite(&entry, sizeof(entry), 1, trace->fp) != 1) ||
+				(fwrite(ctx->words[i]->cyphertext, 1, entry.length, trace->fp) != (size_t) entry.length)) {
+				error = YES;
+			}
+			for (p = 0; !error && (p < entry.numberOfPossibles); p++) {
+				if (fwrite(ctx->words[i]->possiblePlaintext[p], 1, entry.length, trace->fp) != (size_t) entry.length) {
+					error = YES;
+				}
+			}
+		}
+		if (error) {
+			trace->error = YES;
+			fprintf(stderr, "*** Error in StartSearchTrace() ***\n"
+							"    The start of the search could not be written to the\n"
+							"    trace: %s\n", strerror(errno));
+		} else {
+			trace->inSearch = YES;
+			trace->searches++;
+		}
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine adds one event to the trace - the 'index'-th possible
+ *	of the cypherword at 'depth', and the TRACE_* outcome of trying
+ *	it. It's all that's done on the search path, so it only puts the
+ *	event in the buffer, unless the buffer is full.
+ */
+void AddSearchTraceEvent(searchTrace *trace, int depth, int index, int outcome) {
+	if (trace->inSearch) {
+		trace->events[trace->count++] = TRACE_EVENT(depth, index, outcome);
+		trace->recorded++;
+		if (trace->count == SEARCH_TRACE_BUFFER) {
+			FlushSearchTrace(trace);
+		}
+	}
+}
+
+
+/*
+ *	This routine ends the search in the trace with a TRACE_END event,
+ *	whose index is the TRACE_END_* reason the search ended - it's
+ *	called by EndWordBlockAttack(), which is the one place every
+ *	search goes through once it's over, or dropped.
+ */
+void EndSearchTrace(quipContext *ctx) {
+	searchTrace		*trace = ctx->trace;
+	int				reason = TRACE_END_FINISHED;
+
+	if (trace->inSearch) {
+		if (ctx->search.timedOut) {
+			reason = TRACE_END_TIMED_OUT;
+		} else if (ctx->search.depth >= 0) {
+			reason = TRACE_END_ABANDONED;
+		}
+		AddSearchTraceEvent(trace, 0, reason, TRACE_END);
+		trace->inSearch = NO;
+		FlushSearchTrace(trace);
+	}
+}
+
+
+/************************************************************************
+ *
+ *	Result cache functions
+ *
+ *	These functions keep the results of solving the cyphertexts in a
+ *	file, so that a quip that's been solved before - even with a
+ *	different key - is answered without any matching or searching at
+ *	all. One cache can be used by all the contexts in a program, as
+ *	it's only looked at, or changed, with its lock held.
+ *
+ ************************************************************************/
+/*
+ *	This routine adds the 'len' characters of 'str' to the FNV-1a
+ *	'hash' - which starts out as CACHE_HASH_SEED - and returns it.
+ */
+unsigned int HashString(unsigned int hash, char *str, size_t len) {
+	size_t		i;
+
+	for (i = 0; i < len; i++) {
+		hash ^= (unsigned char) str[i];
+		hash *= CACHE_HASH_PRIME;
+	}
+
+	return hash;
+}
+
+
+/*
+ *	This routine returns the hash of all the words in the dictionary.
+ *	A cache file is only good for the dictionary its results came
+ *	from, and this is how that's known.
+ */
+unsigned int GetDictionarySignature(dictionary *dict) {
+	unsigned int	retval = CACHE_HASH_SEED;
+	int				len;
+
+	if ((dict != NULL) && (dict->buckets != NULL)) {
+		for (len = 0; len <= dict->maxLength; len++) {
+			if (dict->buckets[len].text != NULL) {
+				retval = HashString(retval, dict->buckets[len].text,
+									dict->buckets[len].count * (len + 1));
+			}
+		}
+	}
+
+	return retval;
+}
+
+
+/*
+ *	This routine makes the cache key for the cyphertext in the context
+ *	- in its arena - with the attacks that are to be tried. It looks
+ *	like:
+ *
+ *		-W-|at|Abcd E aff
+ *
+ *	with the attacks and '-x' - but not the ordering of the possibles,
+ *	as they all find the same solutions - then
+ *	the known substitutions, and the relabeled cyphertext. A known
+ *	substitution for a letter that's not in the cyphertext is just
+ *	'?' and the plainchar, as all it does is take that plainchar. A
+ *	cyphertext with a tab or a newline can't be put in the file, and
+ *	then NULL is returned, and the cache isn't used.
+ */
+char *CreateCacheKey(quipContext *ctx, BOOL tryingFrequencyAttack, BOOL tryingWordBlockAttack) {
+	BOOL		error = NO;
+	char		*retval = NULL;
+	char		*text = NULL;
+	char		label[26];
+	int			pos = 0;
+	int			c, i;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if ((ctx == NULL) || (ctx->initialCyphertext == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in CreateCacheKey() ***\n"
+							"    The context or its cyphertext is NULL, and that\n"
+							"    means there's nothing to do. This is a bad call.\n");
+		} else if (strpbrk(ctx->initialCyphertext, "\t\n") != NULL) {
+			error = YES;
+		} else {
+			text = ctx->initialCyphertext;
+		}
+	}
+
+	// ...and get the space for it
+	if (!error) {
+		retval = (char *) ArenaAlloc(ctx->arena, strlen(text) + 64);
+		if (retval == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in CreateCacheKey() ***\n"
+							"    The cache key for the cyphertext '%s' could not\n"
+							"    be created. This is a serious allocation error.\n", text);
+		}
+	}
+
+	/*
+	 *	Relabel the cypherchars in the order they first appear - or,
+	 *	if the letters themselves matter, leave them all as they are.
+	 */
+	if (!error) {
+		int		next = 0;
+
+		memset(label, 0, sizeof(label));
+		if (ctx->noSelfMapping || tryingFrequencyAttack) {
+			for (c = 0; c < 26; c++) {
+				label[c] = 'a' + c;
+			}
+		} else {
+			for (i = 0; text[i] != '\0'; i++) {
+				if (isalpha(text[i]) && (label[tolower(text[i]) - 'a'] == 0)) {
+					label[tolower(text[i]) - 'a'] = 'a' + next++;
+				}
+			}
+		}
+	}
+
+	// now put the key together
+	if (!error) {
+		pos = sprintf(retval, "%c%c%c|", (tryingFrequencyAttack ? 'F' : '-'),
+					  (tryingWordBlockAttack ? 'W' : '-'), (ctx->noSelfMapping ? 'x' : '-'));
+		if (ctx->userLegend != NULL) {
+			// the known substitutions in the order of the new labels...
+			for (i = 0; i < 26; i++) {
+				for (c = 0; c < 26; c++) {
+					if ((label[c] == ('a' + i)) && (ctx->userLegend->map[c] != 0)) {
+						retval[pos++] = label[c];
+						retval[pos++] = ctx->userLegend->map[c];
+					}
+				}
+			}
+			// ...and then the ones for letters not in the cyphertext
+			for (i = 0; i < 26; i++) {
+				for (c = 0; c < 26; c++) {
+					if ((label[c] == 0) && (tolower(ctx->userLegend->map[c]) == ('a' + i))) {
+						retval[pos++] = '?';
+						retval[pos++] = ctx->userLegend->map[c];
+					}
+				}
+			}
+		}
+		retval[pos++] = '|';
+		for (i = 0; text[i] != '\0'; i++) {
+			if (!isalpha(text[i])) {
+				retval[pos++] = text[i];
+			} else if (isupper(text[i])) {
+				retval[pos++] = toupper(label[tolower(text[i]) - 'a']);
+			} else {
+				retval[pos++] = label[text[i] - 'a'];
+			}
+		}
+		retval[pos] = '\0';
+	}
+
+	return error ? NULL : retval;
+}
+
+
+/*
+ *	This routine opens the cache in the file 'filename' for the
+ *	results of solving with the dictionary 'dict' - keeping no more
+ *	than 'maxBytes' of them in memory, or CACHE_DEFAULT_SIZE if it's
+ *	0. The file is made if it's not there, and started over if its
+ *	results were for a different dictionary.
+ */
+quipCache *OpenQuipCache(char *filename, size_t maxBytes, dictionary *dict) {
+	BOOL			error = NO;
+	quipCache		*retval = NULL;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if ((filename == NULL) || (dict == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in OpenQuipCache() ***\n"
+							"    The name of the cache file or the dictionary is\n"
+							"    NULL. This is most likely a bad call.\n");
+		}
+	}
+
+	// make the empty cache
+	if (!error) {
+		retval = (quipCache *) calloc(1, sizeof(quipCache));
+		if (retval != NULL) {
+			retval->filename = strdup(filename);
+			retval->hashSize = CACHE_STARTING_HASH_SIZE;
+			retval->table = (cacheEntry **) calloc(retval->hashSize, sizeof(cacheEntry *));
+			pthread_mutex_init(&retval->lock, NULL);
+		}
+		if ((retval == NULL) || (retval->filename == NULL) || (retval->table == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in OpenQuipCache() ***\n"
+							"    The cache for the file '%s' could not be created.\n"
+							"    This is a serious allocation error.\n", filename);
+		} else {
+			retval->signature = GetDictionarySignature(dict);
+			retval->maxBytes = (maxBytes > 0 ? maxBytes : CACHE_DEFAULT_SIZE);
+		}
+	}
+
+	// ...and fill it up with what's in the file
+	if (!error) {
+		if (!ReadQuipCacheFile(retval, YES)) {
+			error = YES;
+		} else if ((retval->fileBytes == 0) ||
+				   (retval->fileBytes > CACHE_COMPACT_FACTOR * retval->maxBytes)) {
+			if (!CompactQuipCache(retval)) {
+				error = YES;
+			}
+		}
+	}
+
+	if (error && (retval != NULL)) {
+		retval = CloseQuipCache(retval);
+	}
+
+	return retval;
+}
+
+
+/*
+ *	This routine releases the cache and everything in it - after
+ *	adding the entries that were used since the file was rewritten
+ *	to it, so everything in it is in the file.
+ */
+quipCache *CloseQuipCache(quipCache *cache) {
+	if (cache != NULL) {
+		if (cache->touchCount > 0) {
+			pthread_mutex_lock(&cache->lock);
+			// it's only a cache - if the file can't say so, that's OK
+			AppendQuipCacheTouches(cache);
+			pthread_mutex_unlock(&cache->lock);
+		}
+		while (cache->newest != NULL) {
+			cacheEntry	*entry = cache->newest;
+
+			UnlinkCacheEntry(cache, entry);
+			DestroyCacheEntry(entry);
+		}
+		if (cache->table != NULL) {
+			free(cache->table);
+		}
+		if (cache->filename != NULL) {
+			free(cache->filename);
+		}
+		pthread_mutex_destroy(&cache->lock);
+		free(cache);
+	}
+
+	return NULL;
+}
+
+
+/*
+ *	This routine finds the entry in the cache with the 'key' - or
+ *	returns NULL if there isn't one. The lock has to be held.
+ */
+cacheEntry *FindCacheEntry(quipCache *cache, char *key) {
+	cacheEntry		*retval = NULL;
+
+	retval = cache->table[HashString(CACHE_HASH_SEED, key, strlen(key)) % cache->hashSize];
+	while ((retval != NULL) && (strcmp(retval->key, key) != 0)) {
+		retval = retval->hashNext;
+	}
+
+	return retval;
+}
+
+
+/*
+ *	This routine takes the entry out of the cache's hash table and
+ *	its list of the used entries - but doesn't release it. The lock
+ *	has to be held.
+ */
+void UnlinkCacheEntry(quipCache *cache, cacheEntry *entry) {
+	cacheEntry		**link;
+
+	link = &(cache->table[HashString(CACHE_HASH_SEED, entry->key, strlen(entry->key)) % cache->hashSize]);
+	while ((*link != NULL) && (*link != entry)) {
+		link = &((*link)->hashNext);
+	}
+	if (*link != NULL) {
+		*link = entry->hashNext;
+	}
+
+	if (entry->newer != NULL) {
+		entry->newer->older = entry->older;
+	} else {
+		cache->newest = entry->older;
+	}
+	if (entry->older != NULL) {
+		entry->older->newer = entry->newer;
+	} else {
+		cache->oldest = entry->newer;
+	}
+	entry->hashNext = NULL;
+	entry->newer = NULL;
+	entry->older = NULL;
+	if (entry->touched) {
+		entry->touched = NO;
+		cache->touchCount--;
+	}
+
+	cache->entryCount--;
+	cache->bytes -= entry->bytes;
+}
+
+
+/*
+ *	This routine releases the cache entry and its copies of the key
+ *	and solutions.
+ */
+void DestroyCacheEntry(cacheEntry *entry) {
+	int		i;
+
+	if (entry != NULL) {
+		if (entry->solutions != NULL) {
+			for (i = 0; i < entry->solutionCount; i++) {
+				if (entry->solutions[i] != NULL) {
+					free(entry->solutions[i]);
+				}
+			}
+			free(entry->solutions);
+		}
+		if (entry->key != NULL) {
+			free(entry->key);
+		}
+		free(entry);
+	}
+}
+
+
+/*
+ *	This routine puts a copy of the result - the 'key' and its
+ *	'solutions' - into the cache in memory, as the most recently
+ *	used, in place of any that's there for the same key. Then the
+ *	least recently used are dropped until it fits in 'maxBytes'. A
+ *	result too big for the cache at all just isn't put in. The lock
+ *	has to be held.
+ */
+BOOL PutCacheEntry(quipCache *cache, char *key, char **solutions, int solutionCount) {
+	BOOL			error = NO;
+	cacheEntry		*entry = NULL;
+	size_t			bytes = sizeof(cacheEntry) + strlen(key) + 1;
+	int				i;
+
+	// first, see how big it is, and if it's worth keeping
+	for (i = 0; i < solutionCount; i++) {
+		bytes += sizeof(char *) + strlen(solutions[i]) + 1;
+	}
+	if (bytes > cache->maxBytes) {
+		return YES;
+	}
+
+	// make the copy of the result
+	if (!error) {
+		entry = (cacheEntry *) calloc(1, sizeof(cacheEntry));
+		if (entry != NULL) {
+			entry->key = strdup(key);
+			entry->bytes = bytes;
+			if (solutionCount > 0) {
+				entry->solutions = (char **) calloc(solutionCount, sizeof(char *));
+				for (i = 0; (entry->solutions != NULL) && (i < solutionCount); i++) {
+					entry->solutions[i] = strdup(solutions[i]);
+					if (entry->solutions[i] != NULL) {
+						entry->solutionCount++;
+					} else {
+						error = YES;
+					}
+				}
+			}
+		}
+		if ((entry == NULL) || (entry->key == NULL) || error ||
+			((solutionCount > 0) && (entry->solutions == NULL))) {
+			error = YES;
+			fprintf(stderr, "*** Error in PutCacheEntry() ***\n"
+							"    The result for the cache key '%s' could not be\n"
+							"    copied into the cache. This is a serious problem.\n", key);
+			DestroyCacheEntry(entry);
+			entry = NULL;
+		}
+	}
+
+	// if the hash table is getting full, double it
+	if (!error && (cache->entryCount >= cache->hashSize)) {
+		int			size = 2 * cache->hashSize;
+		cacheEntry	**table = (cacheEntry **) calloc(size, sizeof(cacheEntry *));
+
+		if (table != NULL) {
+			cacheEntry	*other;
+			int			slot;
+
+			for (other = cache->newest; other != NULL; other = other->older) {
+				slot = HashString(CACHE_HASH_SEED, other->key, strlen(other->key)) % size;
+				other->hashNext = table[slot];
+				table[slot] = other;
+			}
+			free(cache->table);
+			cache->table = table;
+			cache->hashSize = size;
+		}
+	}
+
+	// now put it in place of the old one, as the newest
+	if (!error) {
+		cacheEntry	*old = FindCacheEntry(cache, key);
+		int			slot = HashString(CACHE_HASH_SEED, key, strlen(key)) % cache->hashSize;
+
+		if (old != NULL) {
+			UnlinkCacheEntry(cache, old);
+			DestroyCacheEntry(old);
+		}
+		entry->hashNext = cache->table[slot];
+		cache->table[slot] = entry;
+		entry->older = cache->newest;
+		if (cache->newest != NULL) {
+			cache->newest->newer = entry;
+		} else {
+			cache->oldest = entry;
+		}
+		cache->newest = entry;
+		cache->entryCount++;
+		cache->bytes += entry->bytes;
+	}
+
+	// ...and make room for it
+	while (!error && (cache->bytes > cache->maxBytes) && (cache->oldest != NULL)) {
+		cacheEntry	*oldest = cache->oldest;
+
+		UnlinkCacheEntry(cache, oldest);
+		DestroyCacheEntry(oldest);
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine makes the entry the most recently used in the cache.
+ *	The lock has to be held.
+ */
+void UseCacheEntry(quipCache *cache, cacheEntry *entry) {
+	if (entry != cache->newest) {
+		// take it out of the list...
+		entry->newer->older = entry->older;
+		if (entry->older != NULL) {
+			entry->older->newer = entry->newer;
+		} else {
+			cache->oldest = entry->newer;
+		}
+		// ...and put it back in at the front
+		entry->newer = NULL;
+		entry->older = cache->newest;
+		cache->newest->newer = entry;
+		cache->newest = entry;
+	}
+}
+
+
+/*
+ *	This routine plays back the records in the cache file - in the
+ *	order they were written - so that the cache has what every process
+ *	sharing the file has added to it. If 'fromStart', what's in memory
+ *	is thrown out, and it's all read in again, otherwise it's just
+ *	the records since the last time it was read. If the file isn't
+ *	there, or its results were for a different dictionary, the cache
+ *	is left empty, with 'fileBytes' at 0. A record that's not all
+ *	there yet is left for the next time. The entries that were used,
+ *	but aren't in the file as used yet, are used again after they're
+ *	read back in. The lock has to be held.
+ */
+BOOL ReadQuipCacheFile(quipCache *cache, BOOL fromStart) {
+	BOOL		error = NO;
+	FILE		*fp = NULL;
+	char		*line = NULL;
+	size_t		lineSize = 0;
+	ssize_t		len;
+	char		**fields = NULL;
+	int			fieldSize = 0;
+	char		**touched = NULL;
+	int			touchCount = 0;
+	struct stat	info;
+	int			i;
+
+	// throw out what we have now, if we're starting over
+	if (fromStart) {
+		// ...holding on to the keys of what's been used, oldest first
+		if (cache->touchCount > 0) {
+			touched = (char **) calloc(cache->touchCount, sizeof(char *));
+			if (touched != NULL) {
+				cacheEntry	*entry;
+
+				for (entry = cache->oldest; entry != NULL; entry = entry->newer) {
+					if (entry->touched && ((touched[touchCount] = strdup(entry->key)) != NULL)) {
+						touchCount++;
+					}
+				}
+			}
+		}
+		while (cache->newest != NULL) {
+			cacheEntry	*entry = cache->newest;
+
+			UnlinkCacheEntry(cache, entry);
+			DestroyCacheEntry(entry);
+		}
+		cache->fileBytes = 0;
+		cache->readOffset = 0;
+	}
+
+	// open it up, and see where we're to start
+	fp = fopen(cache->filename, "r");
+	if (fp == NULL) {
+		if (errno != ENOENT) {
+			error = YES;
+			fprintf(stderr, "*** Error in ReadQuipCacheFile() ***\n"
+							"    The cache file '%s' could not be opened: %s\n",
+							cache->filename, strerror(errno));
+		}
+		for (i = 0; i < touchCount; i++) {
+			free(touched[i]);
+		}
+		if (touched != NULL) {
+			free(touched);
+		}
+		return !error;
+	}
+	if (fstat(fileno(fp), &info) == 0) {
+		cache->fileDevice = info.st_dev;
+		cache->fileInode = info.st_ino;
+		cache->fileBytes = info.st_size;
+	}
+	if (cache->readOffset == 0) {
+		char	header[64];
+
+		// ...a new file has to be for our dictionary
+		snprintf(header, sizeof(header), "%s\t%d\t%08x\n", CACHE_FILE_MAGIC, CACHE_FILE_VERSION, cache->signature);
+		if (((len = getline(&line, &lineSize, fp)) < 0) || (strcmp(line, header) != 0)) {
+			error = YES;
+			cache->fileBytes = 0;
+		} else {
+			cache->readOffset = len;
+		}
+	} else if (fseeko(fp, cache->readOffset, SEEK_SET) != 0) {
+		error = YES;
+	}
+
+	// now play back every record from there on
+	while (!error && ((len = getline(&line, &lineSize, fp)) > 0)) {
+		int		count = 0;
+		char	*field = line;
+		char	*tab;
+
+		if (line[len - 1] != '\n') {
+			break;
+		}
+		line[len - 1] = '\0';
+		cache->readOffset += len;
+
+		// split it up into the tab-separated fields
+		while (!error && (field != NULL)) {
+			if (count == fieldSize) {
+				fieldSize = (fieldSize == 0 ? 64 : 2 * fieldSize);
+				fields = (char **) realloc(fields, fieldSize * sizeof(char *));
+				if (fields == NULL) {
+					error = YES;
+					fprintf(stderr, "*** Error in ReadQuipCacheFile() ***\n"
+									"    The list of %d fields for a record in the cache\n"
+									"    file could not be grown. This is a serious problem.\n",
+									fieldSize);
+					break;
+				}
+			}
+			fields[count++] = field;
+			tab = strchr(field, '\t');
+			if (tab != NULL) {
+				*tab++ = '\0';
+			}
+			field = tab;
+		}
+
+		// ...and see what kind of record it is
+		if (!error && (count >= 3) && (strcmp(fields[0], "+") == 0) &&
+			(atoi(fields[2]) == (count - 3))) {
+			if (!PutCacheEntry(cache, fields[1], &(fields[3]), count - 3)) {
+				error = YES;
+			}
+		} else if (!error && (count == 2) && (strcmp(fields[0], "=") == 0)) {
+			cacheEntry	*entry = FindCacheEntry(cache, fields[1]);
+
+			if (entry != NULL) {
+				UseCacheEntry(cache, entry);
+			}
+		}
+	}
+
+	// ...and then use again what was used, but isn't in the file yet
+	for (i = 0; i < touchCount; i++) {
+		cacheEntry	*entry = FindCacheEntry(cache, touched[i]);
+
+		if (entry != NULL) {
+			UseCacheEntry(cache, entry);
+			if (!entry->touched) {
+				entry->touched = YES;
+				cache->touchCount++;
+			}
+		}
+	}
+
+	// in the end, release what we've used in this routine
+	fclose(fp);
+	if (line != NULL) {
+		free(line);
+	}
+	if (fields != NULL) {
+		free(fields);
+	}
+	for (i = 0; i < touchCount; i++) {
+		free(touched[i]);
+	}
+	if (touched != NULL) {
+		free(touched);
+	}
+
+	// a file that's not ours isn't an error - it's just started over
+	return !error || (cache->fileBytes == 0);
+}
+
+
+/*
+ *	This routine reads in whatever the other processes sharing the
+ *	cache file have added to it since it was last read - or all of it
+ *	again, if it's been rewritten since then. The lock has to be held.
+ */
+BOOL RefreshQuipCache(quipCache *cache) {
+	BOOL		error = NO;
+	struct stat	info;
+
+	if (stat(cache->filename, &info) == 0) {
+		if ((info.st_dev != cache->fileDevice) || (info.st_ino != cache->fileInode) ||
+			(info.st_size < cache->readOffset)) {
+			error = !ReadQuipCacheFile(cache, YES);
+		} else if (info.st_size > cache->readOffset) {
+			error = !ReadQuipCacheFile(cache, NO);
+		}
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine adds a record for the cache entry to the end of the
+ *	cache file - a '+' with its key and solutions when it's added,
+ *	or a '=' with just its key when it's used. The whole record is
+ *	written at once, so the records of the processes sharing the
+ *	file never get mixed up. If the file has gotten too big, it's
+ *	then compacted. The lock has to be held.
+ */
+BOOL AppendQuipCacheRecord(quipCache *cache, char type, cacheEntry *entry) {
+	BOOL		error = NO;
+	char		*record = NULL;
+	size_t		size = 0;
+	FILE		*fp = NULL;
+	int			fd = -1;
+	int			i;
+
+	// first, make up the record
+	if (!error) {
+		fp = open_memstream(&record, &size);
+		if (fp == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in AppendQuipCacheRecord() ***\n"
+							"    The record for the cache key '%s' could not be\n"
+							"    made. This is a serious allocation error.\n", entry->key);
+		} else {
+			fprintf(fp, "%c\t%s", type, entry->key);
+			if (type == '+') {
+				fprintf(fp, "\t%d", entry->solutionCount);
+				for (i = 0; i < entry->solutionCount; i++) {
+					fprintf(fp, "\t%s", entry->solutions[i]);
+				}
+			}
+			fputc('\n', fp);
+			fclose(fp);
+		}
+	}
+
+	// ...and write it out
+	if (!error) {
+		fd = open(cache->filename, O_WRONLY | O_APPEND | O_CREAT, 0644);
+		if ((fd < 0) || (write(fd, record, size) != (ssize_t) size)) {
+			error = YES;
+			fprintf(stderr, "*** Error in AppendQuipCacheRecord() ***\n"
+							"    The record for the cache key '%s' could not be\n"
+							"    added to the cache file '%s': %s\n",
+							entry->key, cache->filename, strerror(errno));
+		} else {
+			cache->fileBytes += size;
+		}
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+
+	// see if it's time to squeeze it down
+	if (!error && (cache->fileBytes > CACHE_COMPACT_FACTOR * cache->maxBytes)) {
+		if (!CompactQuipCache(cache)) {
+			error = YES;
+		}
+	}
+
+	if (record != NULL) {
+		free(record);
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine adds a '=' record to the end of the cache file for
+ *	each of the entries that were used since it was last rewritten -
+ *	from the least to the most recently used - all in one append, so
+ *	they can't get mixed up with the records of the other processes
+ *	sharing the file. The lock has to be held.
+ */
+BOOL AppendQuipCacheTouches(quipCache *cache) {
+	BOOL		error = NO;
+	char		*records = NULL;
+	size_t		size = 0;
+	FILE		*fp = NULL;
+	int			fd = -1;
+	cacheEntry	*entry = NULL;
+
+	// first, make up the records
+	if (!error) {
+		fp = open_memstream(&records, &size);
+		if (fp == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in AppendQuipCacheTouches() ***\n"
+							"    The records for the %d used cache entries could not\n"
+							"    be made. This is a serious allocation error.\n", cache->touchCount);
+		} else {
+			for (entry = cache->oldest; entry != NULL; entry = entry->newer) {
+				if (entry->touched) {
+					fprintf(fp, "=\t%s\n", entry->key);
+				}
+			}
+			fclose(fp);
+		}
+	}
+
+	// ...and write them out
+	if (!error && (size > 0)) {
+		fd = open(cache->filename, O_WRONLY | O_APPEND | O_CREAT, 0644);
+		if ((fd < 0) || (write(fd, records, size) != (ssize_t) size)) {
+			error = YES;
+			fprintf(stderr, "*** Error in AppendQuipCacheTouches() ***\n"
+							"    The records for the %d used cache entries could not\n"
+							"    be added to the cache file '%s': %s\n",
+							cache->touchCount, cache->filename, strerror(errno));
+		} else {
+			cache->fileBytes += size;
+		}
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+
+	// they're all in the file now
+	if (!error) {
+		for (entry = cache->oldest; entry != NULL; entry = entry->newer) {
+			entry->touched = NO;
+		}
+		cache->touchCount = 0;
+	}
+
+	if (records != NULL) {
+		free(records);
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine rewrites the cache file with just what's still in
+ *	the cache - from the least to the most recently used, so the
+ *	uses that were only kept in memory are in it, too. It's read
+ *	in again first, so nothing another process added is lost, and
+ *	the new file is written next to the old one and then renamed
+ *	over it. A record another process adds while that's happening
+ *	may be lost - but then that quip just has to be solved again.
+ *	The lock has to be held.
+ */
+BOOL CompactQuipCache(quipCache *cache) {
+	BOOL		error = NO;
+	char		*tempName = NULL;
+	FILE		*fp = NULL;
+	cacheEntry	*entry = NULL;
+	struct stat	info;
+	int			i;
+
+	// first, get everything that's in the file
+	if (!error) {
+		if (!ReadQuipCacheFile(cache, YES)) {
+			error = YES;
+		}
+	}
+
+	// ...and then write out the new file
+	if (!error) {
+		tempName = (char *) malloc(strlen(cache->filename) + 32);
+		if (tempName == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in CompactQuipCache() ***\n"
+							"    The name of the new cache file could not be made.\n"
+							"    This is a serious allocation error.\n");
+		} else {
+			sprintf(tempName, "%s.%ld.tmp", cache->filename, (long) getpid());
+			fp = fopen(tempName, "w");
+			if (fp == NULL) {
+				error = YES;
+				fprintf(stderr, "*** Error in CompactQuipCache() ***\n"
+								"    The new cache file '%s' could not be created: %s\n",
+								tempName, strerror(errno));
+			}
+		}
+	}
+	if (!error) {
+		fprintf(fp, "%s\t%d\t%08x\n", CACHE_FILE_MAGIC, CACHE_FILE_VERSION, cache->signature);
+		for (entry = cache->oldest; entry != NULL; entry = entry->newer) {
+			fprintf(fp, "+\t%s\t%d", entry->key, entry->solutionCount);
+			for (i = 0; i < entry->solutionCount; i++) {
+				fprintf(fp, "\t%s", entry->solutions[i]);
+			}
+			fputc('\n', fp);
+		}
+		cache->fileBytes = ftell(fp);
+		cache->readOffset = cache->fileBytes;
+		if ((fflush(fp) != 0) || (fstat(fileno(fp), &info) != 0) ||
+			(fclose(fp) != 0) || (rename(tempName, cache->filename) != 0)) {
+			error = YES;
+			fprintf(stderr, "*** Error in CompactQuipCache() ***\n"
+							"    The new cache file '%s' could not be put in place\n"
+							"    of '%s': %s\n", tempName, cache->filename, strerror(errno));
+			unlink(tempName);
+		} else {
+			cache->fileDevice = info.st_dev;
+			cache->fileInode = info.st_ino;
+			// ...and now the order they were used in is in it, too
+			for (entry = cache->oldest; entry != NULL; entry = entry->newer) {
+				entry->touched = NO;
+			}
+			cache->touchCount = 0;
+		}
+	}
+
+	if (tempName != NULL) {
+		free(tempName);
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine looks for the result for the 'key' in the cache -
+ *	after catching up on the cache file - and if it's there, 'found'
+ *	is set, and its solutions are reported to the context - just as
+ *	if they'd been found by the attacks. They're copied out first, so
+ *	the lock isn't held while a callback has them. Using it is only
+ *	noted in memory, and gets to the file when it's next rewritten.
+ */
+BOOL LookupQuipCache(quipCache *cache, quipContext *ctx, char *key, BOOL *found) {
+	BOOL		error = NO;
+	char		**copies = NULL;
+	int			count = 0;
+	int			i;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if ((cache == NULL) || (ctx == NULL) || (key == NULL) || (found == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in LookupQuipCache() ***\n"
+							"    The cache, context, key or the place for the answer\n"
+							"    is NULL. This is most likely a bad call.\n");
+		} else {
+			*found = NO;
+		}
+	}
+
+	// see if it's there, and copy out its solutions if it is
+	if (!error) {
+		cacheEntry	*entry = NULL;
+
+		pthread_mutex_lock(&cache->lock);
+		// another process may have just solved it
+		RefreshQuipCache(cache);
+		entry = FindCacheEntry(cache, key);
+		if (entry == NULL) {
+			cache->misses++;
+		} else {
+			cache->hits++;
+			*found = YES;
+			count = entry->solutionCount;
+			if (count > 0) {
+				copies = (char **) ArenaAlloc(ctx->arena, count * sizeof(char *));
+				for (i = 0; (copies != NULL) && (i < count) && !error; i++) {
+					copies[i] = ArenaStrdup(ctx->arena, entry->solutions[i]);
+					if (copies[i] == NULL) {
+						error = YES;
+					}
+				}
+				if (copies == NULL) {
+					error = YES;
+				}
+			}
+			if (error) {
+				fprintf(stderr, "*** Error in LookupQuipCache() ***\n"
+								"    The %d cached solutions could not be copied for\n"
+								"    the context. This is a serious allocation error.\n", count);
+			} else {
+				// ...it's in the file as used when it's next rewritten
+				UseCacheEntry(cache, entry);
+				if (!entry->touched) {
+					entry->touched = YES;
+					cache->touchCount++;
+				}
+			}
+		}
+		pthread_mutex_unlock(&cache->lock);
+	}
+
+	// ...and then hand them over to the context
+	for (i = 0; !error && (i < count) && !ctx->stopRequested; i++) {
+		if (!ReportSolution(ctx, copies[i])) {
+			error = YES;
+		}
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine adds the 'solutions' for the 'key' to the cache, and
+ *	its file - in place of any that were there.
+ */
+BOOL AddToQuipCache(quipCache *cache, char *key, char **solutions, int solutionCount) {
+	BOOL		error = NO;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if ((cache == NULL) || (key == NULL) || ((solutions == NULL) && (solutionCount > 0))) {
+			error = YES;
+			fprintf(stderr, "*** Error in AddToQuipCache() ***\n"
+							"    The cache, the key or the solutions are NULL. This\n"
+							"    is most likely a bad call.\n");
+		}
+	}
+
+	// now put it in the cache, and then the file
+	if (!error) {
+		cacheEntry	*entry = NULL;
+
+		pthread_mutex_lock(&cache->lock);
+		if (!PutCacheEntry(cache, key, solutions, solutionCount)) {
+			error = YES;
+		} else {
+			entry = FindCacheEntry(cache, key);
+			if ((entry != NULL) && !AppendQuipCacheRecord(cache, '+', entry)) {
+				error = YES;
+			}
+		}
+		pthread_mutex_unlock(&cache->lock);
+	}
+
+	return !error;
+}
@@ -0,0 +1,821 @@
+/*
+ *	microbench.c - micro-benchmarks of the kernels of libquip. These
+ *				   are the little routines that the solver calls
+ *				   millions of times on a hard quip, and they are
+ *				   timed here one at a time - away from the rest of
+ *				   the search - so that a change to one of them can
+ *				   be measured on its own.
+ *
+ *				   The inputs are all made from the words file: a
+ *				   set of sample words is drawn with a fixed seed,
+ *				   each is enciphered with its own legend, and
+ *				   matched against the dictionary for its possibles,
+ *				   just as the solver would. Each kernel can have
+ *				   more than one implementation - a 'variant' - and
+ *				   all the variants of a kernel are run on the same
+ *				   inputs and reported side by side.
+ *
+ *	Copyright 2000 Robert E. Beaty, Ph.D. All Rights Reserved
+ */
+
+/*
+ *	Standard system-level includes
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <ctype.h>
+
+/*
+ *	The solving engine
+ */
+#include "quip.h"
+
+/*
+ *	Constants
+ */
+// this is the default filename of the words file
+#define DEFAULT_WORDS_FILE		"words"
+
+// the samples are drawn with this seed - the same as the bench
+#define MICRO_SEED				20021213
+
+// this is how many sample words are drawn, by default
+#define MICRO_DEFAULT_SAMPLES	2000
+#define MICRO_MAX_SAMPLES		100000
+
+// ...and how long each variant is run for, by default, in msec
+#define MICRO_DEFAULT_TIME		200
+#define MICRO_MAX_TIME			60000
+
+// each sample is pattern matched against this many blocks of its bucket
+#define MICRO_WINDOW_BLOCKS		16
+
+/*
+ *	Each sample is a word from the dictionary, enciphered with a
+ *	legend of its own, as a cypherword with all its possibles. The
+ *	'partial' legend is the 'full' one with about half the letters
+ *	left out - which is what the search has in hand most of the time.
+ *	The pattern kernels match the cypherword against the run of
+ *	'blockCount' blocks of its bucket starting at 'firstBlock'.
+ */
+typedef struct {
+	char		*plaintext;
+	cypherword	*word;
+	legend		*full;
+	legend		*partial;
+	int			firstBlock;
+	int			blockCount;
+} microSample_t;
+typedef microSample_t microSample;
+typedef microSample *microSample_ptr;
+
+/*
+ *	These are all the inputs for the kernels - along with the scratch
+ *	space that some of the variants need - so that nothing has to be
+ *	allocated in the timed loops that the real solver wouldn't.
+ */
+typedef struct {
+	dictionary		*dict;
+	microSample		*samples;
+	int				sampleCount;
+	patternCheck	*checks;
+	quipArena		*arena;
+} microInputs_t;
+typedef microInputs_t microInputs;
+typedef microInputs *microInputs_ptr;
+
+/*
+ *	A variant of a kernel is a routine that makes one pass over all
+ *	the samples. It adds the number of calls - or words tested - to
+ *	'ops', and returns the number of 'hits' it had, so that the
+ *	variants of one kernel can be checked against one another.
+ *
+ *	A variant that's 'compared' computes just what the first variant
+ *	of its kernel does - so it has to have the same hits, and its
+ *	speedup over it means something. One that isn't does something
+ *	else with the same inputs, and gets a line with no speedup.
+ */
+typedef long (*microPass)(microInputs *in, long *ops);
+
+typedef struct {
+	char		*kernel;
+	char		*variant;
+	microPass	pass;
+	BOOL		compared;
+} microVariant_t;
+typedef microVariant_t microVariant;
+typedef microVariant *microVariant_ptr;
+
+/*
+ *	Forward references
+ */
+// Sample routines
+char *PickSampleWord(dictionary *dict, unsigned int *seed);
+BOOL CreateMicroInputs(microInputs *in, char *wordsFilename, int sampleCount);
+void DestroyMicroInputs(microInputs *in);
+// Kernel variants
+long PassPatternsByString(microInputs *in, long *ops);
+long PassPatternsByScalarBlock(microInputs *in, long *ops);
+long PassPatternsByVectorBlock(microInputs *in, long *ops);
+long PassLegendCheck(microInputs *in, long *ops);
+long PassLegendCheckWithMasks(microInputs *in, long *ops);
+long PassIncorporate(microInputs *in, long *ops);
+long PassIncorporateWithMasks(microInputs *in, long *ops);
+long PassToPlainOnHeap(microInputs *in, long *ops);
+long PassToPlainInArena(microInputs *in, long *ops);
+long PassPossibleForPartial(microInputs *in, long *ops);
+long PassPossibleForFull(microInputs *in, long *ops);
+// Timing routines
+long GetElapsed_ns(struct timespec *start);
+BOOL IsVariantWanted(microVariant *variant, int argc, char *argv[], int first);
+BOOL RunMicroVariant(microInputs *in, microVariant *variant, int time_ms, double *baseline, long *baselineHits);
+
+/*
+ *	These are all the variants of all the kernels, in the order they
+ *	are run. The first variant of each kernel is the one the 'compared'
+ *	ones are checked and timed against.
+ */
+microVariant microVariants[] = {
+	{ "DoPatternsMatch", "string", PassPatternsByString, NO },
+	{ "DoPatternsMatch", "checks+scalar", PassPatternsByScalarBlock, YES },
+	{ "DoPatternsMatch", "checks+vector", PassPatternsByVectorBlock, YES },
+	{ "CanCypherAndLegendMakePlain", "direct", PassLegendCheck, NO },
+	{ "CanCypherAndLegendMakePlain", "masks+check", PassLegendCheckWithMasks, NO },
+	{ "IncorporateCypherToPlainMapInLegend", "direct", PassIncorporate, NO },
+	{ "IncorporateCypherToPlainMapInLegend", "masks+incorporate", PassIncorporateWithMasks, YES },
+	{ "CypherToPlainString", "heap", PassToPlainOnHeap, NO },
+	{ "CypherToPlainString", "arena", PassToPlainInArena, YES },
+	{ "GetPossibleOfCypherwordForLegend", "partial", PassPossibleForPartial, NO },
+	{ "GetPossibleOfCypherwordForLegend", "complete", PassPossibleForFull, NO },
+	{ NULL, NULL, NULL, NO }
+};
+
+
+/************************************************************************
+ *
+ *	Main entry point
+ *
+ ************************************************************************/
+int main(int argc, char *argv[]) {
+	BOOL			error = NO;
+	char			*wordsFilename = DEFAULT_WORDS_FILE;
+	int				sampleCount = MICRO_DEFAULT_SAMPLES;
+	int				time_ms = MICRO_DEFAULT_TIME;
+	int				firstKernelArg = argc;
+	microInputs		in;
+
+	memset(&in, 0, sizeof(in));
+
+	/*
+	 *	First, read in the command line options - anything that's not
+	 *	an option picks the kernels, or variants, to run
+	 */
+	if (!error) {
+		int		i;
+
+		for (i = 1; (i < argc) && !error && (firstKernelArg == argc); i++) {
+			if (strncmp(argv[i], "-f", 2) == 0) {
+				wordsFilename = &(argv[i][2]);
+			} else if (strncmp(argv[i], "-n", 2) == 0) {
+				sampleCount = atoi(&(argv[i][2]));
+				if ((sampleCount < 1) || (sampleCount > MICRO_MAX_SAMPLES)) {
+					error = YES;
+					printf("*** Error in main() ***\n"
+						   "    The number of samples has to be from 1 to %d,\n"
+						   "    and '%s' was given.\n", MICRO_MAX_SAMPLES, argv[i]);
+				}
+			} else if (strncmp(argv[i], "-t", 2) == 0) {
+				time_ms = atoi(&(argv[i][2]));
+				if ((time_ms < 1) || (time_ms > MICRO_MAX_TIME)) {
+					error = YES;
+					printf("*** Error in main() ***\n"
+						   "    The time for each variant has to be from 1 to %d\n"
+						   "    msec, and '%s' was given.\n", MICRO_MAX_TIME, argv[i]);
+				}
+			} else if (argv[i][0] == '-') {
+				error = YES;
+				printf("usage: microbench [-f<words>] [-n<samples>] [-t<msec>] [kernel|variant ...]\n"
+					   "  -f<words>    the words file the samples come from [%s]\n"
+					   "  -n<samples>  the number of sample words to draw [%d]\n"
+					   "  -t<msec>     how long to run each variant [%d]\n"
+					   "  kernel       only run the kernels, or variants, named\n",
+					   DEFAULT_WORDS_FILE, MICRO_DEFAULT_SAMPLES, MICRO_DEFAULT_TIME);
+			} else {
+				firstKernelArg = i;
+			}
+		}
+	}
+
+	// next, make all the inputs from the words
+	if (!error) {
+		if (!CreateMicroInputs(&in, wordsFilename, sampleCount)) {
+			error = YES;
+		}
+	}
+
+	// now run each variant that's wanted, and report it
+	if (!error) {
+		int		i;
+		double	baseline = 0.0;
+		long	baselineHits = 0;
+		char	*kernel = NULL;
+
+		printf("# quip %d.%d.%d microbench: seed %d, %d samples from '%s', %d msec per variant\n",
+			   QUIP_VERSION_MAJOR, QUIP_VERSION_MINOR, QUIP_VERSION_RELEASE,
+			   MICRO_SEED, in.sampleCount, wordsFilename, time_ms);
+		printf("# %-36s %-18s %10s %10s %10s %8s %10s\n", "kernel", "variant",
+			   "ops/pass", "ns/op", "Mops/s", "speedup", "hits/pass");
+		for (i = 0; (microVariants[i].kernel != NULL) && !error; i++) {
+			if (!IsVariantWanted(&(microVariants[i]), argc, argv, firstKernelArg)) {
+				continue;
+			}
+			// the first variant run of each kernel is the baseline
+			if ((kernel == NULL) || (strcmp(kernel, microVariants[i].kernel) != 0)) {
+				kernel = microVariants[i].kernel;
+				baseline = 0.0;
+			}
+			if (!RunMicroVariant(&in, &(microVariants[i]), time_ms, &baseline, &baselineHits)) {
+				error = YES;
+			}
+		}
+	}
+
+	// in the end, release what we've used
+	DestroyMicroInputs(&in);
+
+	return error ? 1 : 0;
+}
+
+
+/************************************************************************
+ *
+ *	Sample routines
+ *
+ ************************************************************************/
+/*
+ *	This routine picks a word at random from the dictionary - every
+ *	word as likely as any other. Words that aren't all lowercase
+ *	letters are skipped, as are the one-letter words, as they have
+ *	no pattern to speak of. The returned word is in the dictionary,
+ *	so the caller must not free it.
+ */
+char *PickSampleWord(dictionary *dict, unsigned int *seed) {
+	char				*retval = NULL;
+	dictionaryBucket	*bucket;
+	int					pick;
+	int					len;
+	int					i;
+
+	while (retval == NULL) {
+		pick = rand_r(seed) % dict->wordCount;
+		for (len = 0; len <= dict->maxLength; len++) {
+			if (pick < dict->buckets[len].count) {
+				break;
+			}
+			pick -= dict->buckets[len].count;
+		}
+		if ((len < 2) || (len > dict->maxLength)) {
+			continue;
+		}
+		bucket = &(dict->buckets[len]);
+		retval = &(bucket->text[pick * (len + 1)]);
+		for (i = 0; i < len; i++) {
+			if (!islower(retval[i])) {
+				retval = NULL;
+				break;
+			}
+		}
+	}
+
+	return retval;
+}
+
+
+/*
+ *	This routine loads the words and makes all the samples from them
+ *	with the fixed seed - so the inputs are the same from run to run
+ *	for the same words file. It returns NO, having said why, if any
+ *	of it can't be done. Whatever was made is cleaned up by
+ *	DestroyMicroInputs() either way.
+ */
+BOOL CreateMicroInputs(microInputs *in, char *wordsFilename, int sampleCount) {
+	BOOL			error = NO;
+	unsigned int	seed = MICRO_SEED;
+
+	// first, get the words
+	if (!error) {
+		in->dict = LoadDictionary(wordsFilename, 1);
+		if ((in->dict == NULL) || (in->dict->wordCount == 0)) {
+			error = YES;
+			printf("*** Error in CreateMicroInputs() ***\n"
+				   "    The file '%s' could not be loaded as a dictionary,\n"
+				   "    or it has no words, and the samples are made from it.\n",
+				   wordsFilename);
+		}
+	}
+
+	// ...and the room for the samples and the scratch space
+	if (!error) {
+		in->samples = (microSample *) calloc(sampleCount, sizeof(microSample));
+		in->checks = (patternCheck *) malloc(((in->dict->maxLength * (in->dict->maxLength + 1)) / 2 + 1) * sizeof(patternCheck));
+		in->arena = CreateArena(0);
+		if ((in->samples == NULL) || (in->checks == NULL) || (in->arena == NULL)) {
+			error = YES;
+			printf("*** Error in CreateMicroInputs() ***\n"
+				   "    The %d samples, or the scratch space for them, could\n"
+				   "    not be created. This is a serious allocation error.\n",
+				   sampleCount);
+		}
+	}
+
+	// now make each of the samples
+	if (!error) {
+		int				i, c;
+		int				blocks;
+		char			*cyphertext;
+		microSample		*sample;
+
+		for (i = 0; (i < sampleCount) && !error; i++) {
+			sample = &(in->samples[i]);
+			in->sampleCount++;
+
+			// pick the word, and encipher it with a legend of its own
+			sample->plaintext = PickSampleWord(in->dict, &seed);
+			sample->full = CreateDerangedLegend(&seed);
+			sample->partial = CreateLegend('\0', '\0');
+			if ((sample->full == NULL) || (sample->partial == NULL)) {
+				error = YES;
+				break;
+			}
+			for (c = 0; c < 26; c++) {
+				if (rand_r(&seed) & 1) {
+					sample->partial->map[c] = sample->full->map[c];
+				}
+			}
+			cyphertext = PlainToCypherString(sample->full, sample->plaintext);
+			if (cyphertext == NULL) {
+				error = YES;
+				break;
+			}
+
+			// ...then find all its possibles, as the solver would
+			sample->word = CreateCypherword(cyphertext);
+			free(cyphertext);
+			if ((sample->word == NULL) || !MatchCypherwordToDictionary(sample->word, in->dict)) {
+				error = YES;
+				printf("*** Error in CreateMicroInputs() ***\n"
+					   "    The cypherword for the sample '%s' could not be\n"
+					   "    created and matched to the dictionary.\n", sample->plaintext);
+				break;
+			}
+
+			// ...and the run of blocks of its bucket for the pattern kernels
+			blocks = (in->dict->buckets[sample->word->length].count + DICTIONARY_LANES - 1) / DICTIONARY_LANES;
+			sample->blockCount = (blocks < MICRO_WINDOW_BLOCKS ? blocks : MICRO_WINDOW_BLOCKS);
+			sample->firstBlock = rand_r(&seed) % (blocks - sample->blockCount + 1);
+		}
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine releases everything CreateMicroInputs() made - even
+ *	if it only got part of the way there.
+ */
+void DestroyMicroInputs(microInputs *in) {
+	int		i;
+
+	if (in->samples != NULL) {
+		for (i = 0; i < in->sampleCount; i++) {
+			if (in->samples[i].word != NULL) {
+				DestroyCypherword(in->samples[i].word);
+			}
+			if (in->samples[i].full != NULL) {
+				DestroyLegend(in->samples[i].full);
+			}
+			if (in->samples[i].partial != NULL) {
+				DestroyLegend(in->samples[i].partial);
+			}
+		}
+		free(in->samples);
+		in->samples = NULL;
+	}
+	if (in->checks != NULL) {
+		free(in->checks);
+		in->checks = NULL;
+	}
+	if (in->arena != NULL) {
+		in->arena = DestroyArena(in->arena);
+	}
+	if (in->dict != NULL) {
+		in->dict = DestroyDictionary(in->dict);
+	}
+	in->sampleCount = 0;
+}
+
+
+/************************************************************************
+ *
+ *	Kernel variants
+ *
+ *	Each of these makes one pass over all the samples with one way
+ *	of doing what a kernel does. The variants of a kernel are given
+ *	the same inputs, but only those that get the same answers from
+ *	them can have their ns/op compared directly.
+ *
+ ************************************************************************/
+/*
+ *	This is the pattern match the way CheckCypherwordForPossiblePlaintext()
+ *	does it - the cypherword against one word of the bucket at a time.
+ */
+long PassPatternsByString(microInputs *in, long *ops) {
+	long				hits = 0;
+	int					i, w;
+	int					first, last;
+	microSample			*sample;
+	dictionaryBucket	*bucket;
+
+	for (i = 0; i < in->sampleCount; i++) {
+		sample = &(in->samples[i]);
+		bucket = &(in->dict->buckets[sample->word->length]);
+		first = sample->firstBlock * DICTIONARY_LANES;
+		last = (sample->firstBlock + sample->blockCount) * DICTIONARY_LANES;
+		if (last > bucket->count) {
+			last = bucket->count;
+		}
+		for (w = first; w < last; w++) {
+			if (DoPatternsMatch(sample->word->cyphertext, &(bucket->text[w * (sample->word->length + 1)]))) {
+				hits++;
+			}
+		}
+		*ops += (last - first);
+	}
+
+	return hits;
+}
+
+
+/*
+ *	This is the pattern match the way MatchCypherwordToDictionary()
+ *	does it - the checks are made once for the cypherword, and each
+ *	transposed block is run through them. This does it a word at a
+ *	time in the block, and the next does the whole block at once.
+ */
+long PassPatternsByScalarBlock(microInputs *in, long *ops) {
+	long				hits = 0;
+	int					i, b;
+	int					count, checkCount;
+	unsigned int		matched;
+	microSample			*sample;
+	dictionaryBucket	*bucket;
+
+	for (i = 0; i < in->sampleCount; i++) {
+		sample = &(in->samples[i]);
+		bucket = &(in->dict->buckets[sample->word->length]);
+		checkCount = CreatePatternChecks(sample->word->cyphertext, in->checks);
+		for (b = sample->firstBlock; b < (sample->firstBlock + sample->blockCount); b++) {
+			count = bucket->count - (b * DICTIONARY_LANES);
+			if (count > DICTIONARY_LANES) {
+				count = DICTIONARY_LANES;
+			}
+			matched = MatchPatternBlockScalar(&(bucket->columns[b * sample->word->length * DICTIONARY_LANES]),
+											  count, in->checks, checkCount);
+			hits += __builtin_popcount(matched);
+			*ops += count;
+		}
+	}
+
+	return hits;
+}
+
+
+long PassPatternsByVectorBlock(microInputs *in, long *ops) {
+	long				hits = 0;
+	int					i, b;
+	int					count, checkCount;
+	unsigned int		matched;
+	microSample			*sample;
+	dictionaryBucket	*bucket;
+
+	for (i = 0; i < in->sampleCount; i++) {
+		sample = &(in->samples[i]);
+		bucket = &(in->dict->buckets[sample->word->length]);
+		checkCount = CreatePatternChecks(sample->word->cyphertext, in->checks);
+		for (b = sample->firstBlock; b < (sample->firstBlock + sample->blockCount); b++) {
+			count = bucket->count - (b * DICTIONARY_LANES);
+			if (count > DICTIONARY_LANES) {
+				count = DICTIONARY_LANES;
+			}
+			matched = MatchPatternBlockVector(&(bucket->columns[b * sample->word->length * DICTIONARY_LANES]),
+											  count, in->checks, checkCount);
+			hits += __builtin_popcount(matched);
+			*ops += count;
+		}
+	}
+
+	return hits;
+}
+
+
+/*
+ *	This checks every possible of each sample against its partial
+ *	legend - one character at a time. The next one puts the letter
+ *	set prefilter in front of it, as the search does, and that can
+ *	only have as many hits, or fewer: the letter sets also rule out
+ *	a possible that needs a letter the legend already has for some
+ *	other cypherchar.
+ */
+long PassLegendCheck(microInputs *in, long *ops) {
+	long			hits = 0;
+	int				i, p;
+	microSample		*sample;
+
+	for (i = 0; i < in->sampleCount; i++) {
+		sample = &(in->samples[i]);
+		for (p = 0; p < sample->word->numberOfPossibles; p++) {
+			if (CanCypherAndLegendMakePlain(sample->word->cyphertext, sample->partial,
+											sample->word->possiblePlaintext[p], NO, NO)) {
+				hits++;
+			}
+		}
+		*ops += sample->word->numberOfPossibles;
+	}
+
+	return hits;
+}
+
+
+long PassLegendCheckWithMasks(microInputs *in, long *ops) {
+	long			hits = 0;
+	int				i, p;
+	unsigned int	used, assigned;
+	microSample		*sample;
+
+	for (i = 0; i < in->sampleCount; i++) {
+		sample = &(in->samples[i]);
+		used = GetPlainLetterMaskOfLegend(sample->partial, ALL_LETTERS_MASK);
+		assigned = GetPlainLetterMaskOfLegend(sample->partial, sample->word->cypherLetterMask);
+		for (p = 0; p < sample->word->numberOfPossibles; p++) {
+			if (CanLetterMasksMakePlain(sample->word->possibleLetterMask[p], assigned, used) &&
+				CanCypherAndLegendMakePlain(sample->word->cyphertext, sample->partial,
+											sample->word->possiblePlaintext[p], NO, NO)) {
+				hits++;
+			}
+		}
+		*ops += sample->word->numberOfPossibles;
+	}
+
+	return hits;
+}
+
+
+/*
+ *	This folds every possible of each sample into a copy of its
+ *	partial legend - which is what each level of the word block
+ *	search does - and the copy is part of the cost. The next one
+ *	puts the letter set prefilter in front of it, and they have to
+ *	have the same hits, as the prefilter only skips possibles that
+ *	can't be folded in.
+ */
+long PassIncorporate(microInputs *in, long *ops) {
+	long			hits = 0;
+	int				i, p;
+	legend			scratch;
+	microSample		*sample;
+
+	for (i = 0; i < in->sampleCount; i++) {
+		sample = &(in->samples[i]);
+		for (p = 0; p < sample->word->numberOfPossibles; p++) {
+			SetLegendToLegend(&scratch, sample->partial);
+			if (IncorporateCypherToPlainMapInLegend(sample->word->cyphertext,
+							sample->word->possiblePlaintext[p], &scratch, NO)) {
+				hits++;
+			}
+		}
+		*ops += sample->word->numberOfPossibles;
+	}
+
+	return hits;
+}
+
+
+long PassIncorporateWithMasks(microInputs *in, long *ops) {
+	long			hits = 0;
+	int				i, p;
+	unsigned int	used, assigned;
+	legend			scratch;
+	microSample		*sample;
+
+	for (i = 0; i < in->sampleCount; i++) {
+		sample = &(in->samples[i]);
+		used = GetPlainLetterMaskOfLegend(sample->partial, ALL_LETTERS_MASK);
+		assigned = GetPlainLetterMaskOfLegend(sample->partial, sample->word->cypherLetterMask);
+		for (p = 0; p < sample->word->numberOfPossibles; p++) {
+			if (!CanLetterMasksMakePlain(sample->word->possibleLetterMask[p], assigned, used)) {
+				continue;
+			}
+			SetLegendToLegend(&scratch, sample->partial);
+			if (IncorporateCypherToPlainMapInLegend(sample->word->cyphertext,
+							sample->word->possiblePlaintext[p], &scratch, NO)) {
+				hits++;
+			}
+		}
+		*ops += sample->word->numberOfPossibles;
+	}
+
+	return hits;
+}
+
+
+/*
+ *	This deciphers each sample with its full legend into a new string
+ *	on the heap, and frees it. The next one gets the strings from an
+ *	arena instead - which is reset at the end of each pass, as the
+ *	solve context's arena is at the end of each solve.
+ */
+long PassToPlainOnHeap(microInputs *in, long *ops) {
+	long			hits = 0;
+	int				i;
+	char			*plaintext;
+	microSample		*sample;
+
+	for (i = 0; i < in->sampleCount; i++) {
+		sample = &(in->samples[i]);
+		plaintext = CypherToPlainString(sample->full, sample->word->cyphertext);
+		if (plaintext != NULL) {
+			if (strcmp(plaintext, sample->plaintext) == 0) {
+				hits++;
+			}
+			free(plaintext);
+		}
+	}
+	*ops += in->sampleCount;
+
+	return hits;
+}
+
+
+long PassToPlainInArena(microInputs *in, long *ops) {
+	long			hits = 0;
+	int				i;
+	char			*plaintext;
+	microSample		*sample;
+
+	for (i = 0; i < in->sampleCount; i++) {
+		sample = &(in->samples[i]);
+		plaintext = CypherToPlainStringInArena(in->arena, sample->full, sample->word->cyphertext);
+		if ((plaintext != NULL) && (strcmp(plaintext, sample->plaintext) == 0)) {
+			hits++;
+		}
+	}
+	ResetArena(in->arena);
+	*ops += in->sampleCount;
+
+	return hits;
+}
+
+
+/*
+ *	This looks for the first possible of each sample that its partial
+ *	legend can make - holes and all - as the frequency attack does.
+ *	The next one needs the possible to be made completely, with the
+ *	full legend, and that always finds the sample's own word - unless
+ *	another word is made by the same legend first.
+ */
+long PassPossibleForPartial(microInputs *in, long *ops) {
+	long			hits = 0;
+	int				i;
+	char			*plaintext;
+
+	for (i = 0; i < in->sampleCount; i++) {
+		plaintext = GetPossibleOfCypherwordForLegend(in->samples[i].word, in->samples[i].partial, NO);
+		if (plaintext != NULL) {
+			hits++;
+			free(plaintext);
+		}
+	}
+	*ops += in->sampleCount;
+
+	return hits;
+}
+
+
+long PassPossibleForFull(microInputs *in, long *ops) {
+	long			hits = 0;
+	int				i;
+	char			*plaintext;
+
+	for (i = 0; i < in->sampleCount; i++) {
+		plaintext = GetPossibleOfCypherwordForLegend(in->samples[i].word, in->samples[i].full, YES);
+		if (plaintext != NULL) {
+			hits++;
+			free(plaintext);
+		}
+	}
+	*ops += in->sampleCount;
+
+	return hits;
+}
+
+
+/************************************************************************
+ *
+ *	Timing routines
+ *
+ ************************************************************************/
+/*
+ *	This routine returns the number of nsec since 'start'.
+ */
+long GetElapsed_ns(struct timespec *start) {
+	struct timespec		now;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+	return ((now.tv_sec - start->tv_sec) * 1000000000L) + (now.tv_nsec - start->tv_nsec);
+}
+
+
+/*
+ *	This routine returns YES if the variant is to be run - which is
+ *	when no kernels were named on the command line, or when one of
+ *	the names given is its kernel, or its variant.
+ */
+BOOL IsVariantWanted(microVariant *variant, int argc, char *argv[], int first) {
+	BOOL	retval = (first >= argc);
+	int		i;
+
+	for (i = first; (i < argc) && !retval; i++) {
+		if ((strcmp(argv[i], variant->kernel) == 0) || (strcmp(argv[i], variant->variant) == 0)) {
+			retval = YES;
+		}
+	}
+
+	return retval;
+}
+
+
+/*
+ *	This routine runs one variant, a pass at a time, until it's run
+ *	for 'time_ms' - after one pass to warm the caches that isn't
+ *	counted - and prints its line of the report. The ns/op and hits of
+ *	the first variant of a kernel are left in 'baseline' and
+ *	'baselineHits', and the speedup of a 'compared' variant is given
+ *	relative to them - if it has the same hits. If it doesn't, it's
+ *	not doing the same thing, and NO is returned, having said so.
+ */
+BOOL RunMicroVariant(microInputs *in, microVariant *variant, int time_ms, double *baseline, long *baselineHits) {
+	BOOL				error = NO;
+	BOOL				comparing = NO;
+	char				speedup[16];
+	struct timespec		start;
+	long				ops = 0;
+	long				passOps = 0;
+	long				hits = 0;
+	long				elapsed_ns = 0;
+	double				ns_per_op = 0.0;
+
+	// warm up, and see how much work is in a pass
+	hits = variant->pass(in, &passOps);
+
+	// now run it for as long as we're asked to
+	clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+	do {
+		variant->pass(in, &ops);
+		elapsed_ns = GetElapsed_ns(&start);
+	} while (elapsed_ns < (time_ms * 1000000L));
+
+	if (ops > 0) {
+		ns_per_op = (double) elapsed_ns / ops;
+	}
+	if (*baseline == 0.0) {
+		*baseline = ns_per_op;
+		*baselineHits = hits;
+	} else if (variant->compared) {
+		comparing = YES;
+	}
+
+	// ...a speedup only means something if it gets the same answers
+	if (comparing && (hits != *baselineHits)) {
+		error = YES;
+		printf("*** Error in RunMicroVariant() ***\n"
+			   "    The variant '%s' of %s had %ld hits a pass, and the\n"
+			   "    one it's compared to had %ld. They aren't doing the same\n"
+			   "    thing, so there's no speedup to give.\n",
+			   variant->variant, variant->kernel, hits, *baselineHits);
+	}
+
+	if (!error) {
+		if (comparing && (ns_per_op > 0.0)) {
+			snprintf(speedup, sizeof(speedup), "%.2fx", *baseline / ns_per_op);
+		} else {
+			snprintf(speedup, sizeof(speedup), "-");
+		}
+		printf("  %-36s %-18s %10ld %10.2f %10.2f %8s %10ld\n", variant->kernel, variant->variant,
+			   passOps, ns_per_op, (ns_per_op > 0.0 ? 1000.0 / ns_per_op : 0.0), speedup, hits);
+	}
+
+	return !error;
+}
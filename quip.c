@@ -10,6 +10,9 @@
  *			 'hint' decoded. It's then the job of the solver to decode
  *			 the rest of the cyphertext.
  *
+ *			 This is the command line, server and batch front end
+ *			 to libquip, which does the solving - see quip.h.
+ *
  *	$Id: quip.c,v 1.6 2002/12/13 00:57:28 drbob Exp $
  *
  *	Copyright 2000 Robert E. Beaty, Ph.D. All Rights Reserved
@@ -25,115 +28,220 @@
 #include <sys/types.h>
 #include <sys/time.h>
 #include <time.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <pthread.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
 
 /*
- *	System-level & Data type definitions
+ *	The solving engine
  */
-// nobody but NeXT ever seems to do Boolean data right
-#ifndef TRUE
-#define TRUE 1
-#endif
-#ifndef YES
-#define YES 1
-#endif
-#ifndef FALSE
-#define FALSE 0
-#endif
-#ifndef NO
-#define NO 0
-#endif
-#ifndef BOOL
-typedef int BOOL;
-#endif
+#include "quip.h"
 
 /*
- *	Public Constants
+ *	Constants
  */
-// define the version for this program
-#ifndef QUIP_VERSION_MAJOR
-#define QUIP_VERSION_MAJOR		0
-#endif
-#ifndef QUIP_VERSION_MINOR
-#define QUIP_VERSION_MINOR		1
-#endif
-#ifndef QUIP_VERSION_RELEASE
-#define QUIP_VERSION_RELEASE	0
-#endif
-#define QUIP_VERSION	QUIP_VERSION_MAJOR.QUIP_VERSION_MINOR.QUIP_VERSION_RELEASE
-
 // this is the default filename of the words file
 #define DEFAULT_WORDS_FILE		"words"
 
-// this is the default logging file
-#define DEFAULT_LOG_FILE		"/tmp/quip.log"
+// this is the default time limit on a search - in seconds
+#define DEFAULT_TIME_LIMIT		20
+
+// a server request can't have more arguments than this
+#define MAX_REQUEST_ARGS		64
 
-// assume that we don't need logging
-#define LOG						NO
+// the benchmark puzzles are made with this seed, and run this many times
+#define BENCH_SEED				20021213
+#define BENCH_DEFAULT_RUNS		5
+#define BENCH_MAX_RUNS			1000
 
 /*
- *	When creating a new cypherword, the array of possibles starts
- *	this large, and then jumps up in increments this large. This
- *	is to keep the number of reallocations to a minimum and keep
- *	memory usage to a reasonable level.
+ *	The server answers requests with a pool of threads, each with its
+ *	own solve context on the one dictionary - and this is what each
+ *	of them is told when it's started.
  */
-#define STARTING_POSSIBLES_SIZE		50
-#define INCREMENT_POSSIBLES_SIZE	10
+typedef struct {
+	int				listener;
+	dictionary		*dict;
+	quipCache		*cache;
+	int				timeLimit;
+	pthread_t		thread;
+} serverWorker_t;
+typedef serverWorker_t serverWorker;
+typedef serverWorker *serverWorker_ptr;
 
+/*
+ *	The command line prints the solutions as they're found, and this
+ *	is what it needs to do that - when it started solving, and how
+ *	many it's printed so far.
+ */
+typedef struct {
+	struct timespec	start;
+	int				count;
+} solutionPrinter_t;
+typedef solutionPrinter_t solutionPrinter;
+typedef solutionPrinter *solutionPrinter_ptr;
 
 /*
- *	We need to have some structures for dealing with the data.
- *	Let's put them all here to make it easy.
+ *	In batch mode, the puzzles are solved by a pool of threads, each
+ *	with its own solve context on the one dictionary - as the server's
+ *	are - and this is what they all share: the puzzles, the next one
+ *	to be taken, and the answers, left for the main thread to write
+ *	out in order. Each worker has the puzzle it's working on (-1 when
+ *	it's idle), when it started on it, and the cancel for its solve. A
+ *	puzzle gets its time limit plus this many seconds before that's set.
  */
+#define BATCH_DEADLINE_GRACE		2
+
+typedef struct {
+	char			**puzzles;
+	char			**answers;
+	int				puzzleCount;
+	int				nextPuzzle;
+	dictionary		*dict;
+	quipCache		*cache;
+	int				timeLimit;
+	int				running;
+	BOOL			error;
+	pthread_mutex_t	lock;
+	pthread_cond_t	answered;
+} batchRun_t;
+typedef batchRun_t batchRun;
+typedef batchRun *batchRun_ptr;
+
+typedef struct {
+	batchRun		*run;
+	int				puzzle;
+	struct timespec	started;
+	volatile int	cancel;
+	pthread_t		thread;
+} batchWorker_t;
+typedef batchWorker_t batchWorker;
+typedef batchWorker *batchWorker_ptr;
+
 /*
- *	This is the 'solution' to the quip - the substitution pattern
- *	that, when applied to the cyphertext yields the plaintext. The
- *	mapping is read: the legend element in the cyphertext and the
- *	value of the legend element is the plaintext.
+ *	The benchmark reads the hardware counters around each phase of
+ *	a solve - the matching, and then the search - if the system lets
+ *	it. Each counter is opened on its own, so the ones that can't be
+ *	had are just left out, and if none of them can, the benchmark is
+ *	the same as without them. 'reason' says why a counter couldn't
+ *	be opened.
  */
-typedef union {
-	char a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p, q, r, s, t, u, v, w, x, y, z;
-	char map[26];
-} legend_t;
-typedef legend_t legend;
-typedef legend *legend_ptr;
+#define BENCH_CYCLES				0
+#define BENCH_INSTRUCTIONS			1
+#define BENCH_L1D_MISSES			2
+#define BENCH_LLC_MISSES			3
+#define BENCH_BRANCH_MISSES			4
+#define BENCH_COUNTERS				5
+
+typedef struct {
+	int				fd[BENCH_COUNTERS];
+	int				opened;
+	char			reason[80];
+} benchCounters_t;
+typedef benchCounters_t benchCounters;
+typedef benchCounters *benchCounters_ptr;
 
 /*
- *	This is the 'meat' of the problem - a single cypherword. This
- *	word contains it's size (for convenience) and a list of all
- *	possible matching words based on the structure of the cypherword.
- *	When a legend is applied to a cypherword, some of the possible
- *	words will be generated for that legend, and they can be used
- *	with other 'solutions' from the other cypherwords in the system
- *	to achieve a total cyphertext 'solution'.
+ *	With '--generate', the puzzles are made a chunk at a time by a
+ *	pool of threads, and this is what each of them is told - the
+ *	sentences to pick from, the seed, and the part of the chunk it
+ *	makes the lines for. Every puzzle has its own seed made from the
+ *	seed and its number, so the puzzles don't depend on the threads.
  */
+#define GENERATE_CHUNK_SIZE			4096
+
 typedef struct {
-	int		length;
-	char	*cyphertext;
-	int		numberOfPossibles;
-	char	**possiblePlaintext;
-	int		possiblePlaintextSize;
-} cypherword_t;
-typedef cypherword_t cypherword;
-typedef cypherword *cypherword_ptr;
+	char			**sentences;
+	int				sentenceCount;
+	unsigned int	seed;
+	long			first;
+	int				count;
+	char			**lines;
+	BOOL			error;
+	pthread_t		thread;
+} puzzleGenerator_t;
+typedef puzzleGenerator_t puzzleGenerator;
+typedef puzzleGenerator *puzzleGenerator_ptr;
 
 /*
- *	One of the utilities we have at our disposal is a character
- *	frequency counter. This is useful for looking at the relative
- *	frequency of both plaintext characters as well as cyphertext
- *	characters. The routine that calculates these numbers is called
- *	GenerateCharacterHistogramWithLegend(legend *map, BOOL showHisto)
- *	and takes a legend to use as the 'givens'. There's also a routine
- *	that prints out the table of relative hits, etc.
+ *	With '--log', every solve - on the command line, in the server
+ *	or in a batch worker - leaves a record in the log. The solve only
+ *	copies its record into a ring in memory, and a thread of its own
+ *	takes them out, a bunch at a time, and writes them to the end of
+ *	the log file as lines of JSON. That thread isn't woken for every
+ *	record - that would be a system call on the solve path - but it
+ *	looks every LOG_DRAIN_INTERVAL msec, and is woken when the ring
+ *	gets half full. If the ring is ever full, the record is dropped
+ *	and counted instead of holding up the solve, and the count goes
+ *	into the next record written. The records have no pointers but
+ *	to constant strings, so they can be copied as they are - which
+ *	is why how each strategy in a portfolio's race did is copied into
+ *	one of these, and not pointed to.
  */
+#define LOG_RING_SIZE				4096
+#define LOG_DRAIN_BATCH				64
+#define LOG_DRAIN_INTERVAL			200
+#define LOG_RECORD_SIZE				2048
+
+typedef struct {
+	BOOL			finished;
+	BOOL			error;
+	long			elapsed_us;
+	long			nodes;
+	int				solutions;
+} strategyResult_t;
+typedef strategyResult_t strategyResult;
+typedef strategyResult *strategyResult_ptr;
+
+typedef struct {
+	struct timespec	when;
+	char			*status;
+	unsigned int	quipHash;
+	int				length;
+	char			hints[53];
+	int				solutions;
+	BOOL			cached;
+	long			nodes;
+	long			phaseTime_us[PHASE_COUNT];
+	long			total_us;
+	attackChoice	choice;
+	// ...and if there was a race, who won it, and how each of them did
+	char			*strategy;
+	BOOL			raced;
+	char			*winner;
+	strategyResult	strategies[PORTFOLIO_STRATEGIES];
+} logRecord_t;
+typedef logRecord_t logRecord;
+typedef logRecord *logRecord_ptr;
+
 typedef struct {
-	int		crossMatch[26][26];
-	int		plaintext[26];
-	int		cyphertext[26];
-} characterFrequencyData_t;
-typedef characterFrequencyData_t characterFrequencyData;
-typedef characterFrequencyData *characterFrequencyData_ptr;
+	int				fd;
+	char			*source;
+	char			user[32];
+	pid_t			pid;
+	logRecord		*ring;
+	unsigned long	head;
+	unsigned long	tail;
+	unsigned long	dropped;
+	BOOL			stopping;
+	BOOL			closed;
+	pthread_mutex_t	lock;
+	pthread_cond_t	ready;
+	pthread_t		drainer;
+} solveLog_t;
+typedef solveLog_t solveLog;
+typedef solveLog *solveLog_ptr;
 
 
 /************************************************************************
@@ -146,48 +254,53 @@ typedef characterFrequencyData *characterFrequencyData_ptr;
  *	order the functions are defined.
  *
  ************************************************************************/
-// ...these are the cypherword functions
-BOOL 		DoPatternsMatch(char *cyphertext, char *plaintext);
-BOOL		CanCypherAndLegendMakePlain(char *cyphertext, legend *map, char *plaintext, BOOL mustBeComplete);
-char 		*GetPossibleOfCypherwordForLegend(cypherword *word, legend *map, BOOL mustBeComplete);
-BOOL 		IsCypherwordDecryptedByLegend(cypherword *word, legend *map);
-cypherword 	*CreateCypherword(char *str);
-cypherword 	*DestroyCypherword(cypherword *word);
-BOOL 		CheckCypherwordForPossiblePlaintext(cypherword *word, char *str);
-
-// ...these are the legend functions
-legend 		*CreateLegend(char cryptChar, char plainChar);
-legend 		*DestroyLegend(legend *map);
-legend 		*DuplicateLegend(legend *map);
-void 		SetLegendToLegend(legend *dest, legend *src);
-BOOL		DoesLegendEqualLegend(legend *a, legend *b);
-void		PrintLegend(legend *map);
-char 		CypherToPlainChar(legend *map, char c);
-char 		PlainToCypherChar(legend *map, char c);
-char 		*CypherToPlainString(legend *map, char *cyphertext);
-char 		*PlainToCypherString(legend *map, char *plaintext);
-
-// ...these are the high-level cypherword and encrypting functions
-BOOL 		ReadAndProcessPlaintextFile(char* filename);
-void 		EncryptPlaintext(char *text, BOOL showLegend, BOOL genCmdLine);
-BOOL 		CreateCypherwordsFromCyphertext(char *text);
-
-// ...these are the character frequency counting routines
-characterFrequencyData 	*GenerateCharacterCountsWithLegend(legend *map);
-void 		PrintCrossMatchData(characterFrequencyData *data);
-
-// ...these are the frequency attack functions
-BOOL 		DoFrequencyAttack(legend *map, int maxSec);
-void 		BuildFreqAttackLegend(int cyphercharIndex, legend *map);
-void 		TestFreqAttackLegend(legend *map);
-
-// ...these are the word block attack functions
-BOOL 		DoWordBlockAttack(int cypherwordIndex, legend *map, int maxSec);
-BOOL 		IncorporateCypherToPlainMapInLegend(char *cyphertext, char *plaintext, legend *map);
+// ...these are the option functions
+BOOL		ParseSolveOption(quipContext *ctx, char *opt, int *timeLimit, BOOL *tryingFrequencyAttack, BOOL *tryingWordBlockAttack, BOOL *handled);
+
+// ...these are the server functions
+int			SplitRequestLine(char *line, char **args, int maxArgs);
+void		WriteJSONString(FILE *fp, char *str);
+void		WriteSearchStats(FILE *fp, quipContext *ctx);
+void		WriteSearchEstimate(FILE *fp, quipContext *ctx);
+void		WriteAttackChoice(FILE *fp, quipContext *ctx);
+void		WritePortfolio(FILE *fp, quipContext *ctx);
+BOOL		AnswerRequest(quipContext *ctx, char *line, FILE *fp, int defaultTimeLimit);
+void		ServeConnection(quipContext *ctx, int fd, int timeLimit);
+void		StopServer(int sig);
+void		*ServeRequests(void *arg);
+BOOL		ServeQuips(char *socketPath, char *wordsFilename, char *cacheFilename, size_t cacheSize, int workers, int timeLimit);
+
+// ...these are the batch functions
+void		*SolveBatchPuzzles(void *arg);
+BOOL		SolveBatch(char *filename, char *wordsFilename, char *cacheFilename, size_t cacheSize, int workers, int timeLimit);
+
+// ...these are the benchmark functions
+int			CompareLatencies(const void *a, const void *b);
+void		OpenBenchCounters(benchCounters *counters);
+void		StartBenchCounters(benchCounters *counters);
+void		ReadBenchCounters(benchCounters *counters, double *totals);
+void		CloseBenchCounters(benchCounters *counters);
+void		PrintBenchCounters(benchCounters *counters, char *phase, double *totals, int runs, long nodes);
+BOOL		RunBenchmark(char *wordsFilename, int runs, int timeLimit);
+
+// ...these are the puzzle generating functions
+char		**LoadSentences(char *filename, int *count);
+char		*CreatePuzzleLine(char **sentences, int sentenceCount, unsigned int seed, long puzzle);
+void		*GeneratePuzzles(void *arg);
+BOOL		GeneratePuzzleFile(char *corpusFilename, long count, unsigned int seed, int workers);
 
 // ...these are the general UI functions
+dictionary	*LoadWords(char *wordsFilename);
 void 		showUsage();
-void		logIt(char *msg);
+BOOL		PrintSolution(char *plaintext, void *userData);
+
+// ...these are the solve log functions
+solveLog	*OpenSolveLog(char *filename, char *source);
+void		CloseSolveLog(solveLog *log);
+solveLog	*DestroySolveLog(solveLog *log);
+void		LogSolve(solveLog *log, quipContext *ctx, char *status, int solutions, long total_us);
+void		*DrainSolveLog(void *arg);
+int			FormatLogRecord(solveLog *log, logRecord *rec, unsigned long dropped, char *buf, int size);
 
 
 /************************************************************************
@@ -198,2107 +311,1772 @@ void		logIt(char *msg);
 /*
  *	These are the global variables that will be used in this program.
  */
-int				wordCount = 0;
-cypherword		**words = NULL;
-int				legendCount = 0;
-legend			**legends = NULL;
-legend			*userLegend = NULL;
-unsigned int	randSeed;
-char			*initialCyphertext = NULL;
-char			**plainText;
-int				plainTextMaxCnt;
-int				plainTextCnt;
 BOOL			htmlOutput = NO;
+int				threadCount = 1;
+char			*imageFilename = NULL;
+char			*logFilename = NULL;
+solveLog		*logger = NULL;
+volatile sig_atomic_t	serverStopping = 0;
+
+/*
+ *	This is the benchmark corpus - from a few words to a couple of
+ *	dozen, some full of short, common words that match most anything
+ *	and some with long words that pin the legend down right away.
+ *	Each one is made into a puzzle by EncipherPlaintext() with the
+ *	seed BENCH_SEED plus its place in the list, so the puzzles are
+ *	the same every time, and adding one doesn't change the others.
+ *	Every word is in the default words file, so each has an answer.
+ */
+char			*benchCorpus[] = {
+	"The cat sat",
+	"Time flies like an arrow",
+	"A big red dog ran",
+	"Where there is smoke there is fire",
+	"An apple a day keeps the doctor away",
+	"Good dogs make good pals",
+	"All that does glitter is not gold",
+	"A penny kept is a penny made",
+	"Each cloud has a silver line",
+	"When I see thunderstorms I reach for an umbrella",
+	"The best things in life are free",
+	"If you want something done right you have to do it yourself",
+	"The first bird gets the worm but the second mouse gets the cheese",
+	"Never put off until tomorrow what you can do today because tomorrow you may find something better to do",
+	NULL
+};
 
 
-/************************************************************************
- *
- *	Cypherword functions
+/*************************************************************************
  *
- *	These functions are used to allow the main code to manipulate
- *	the cypherwords at a very high level and not have to do a loe
- *	of low-level textual manipulation. In a more OO design, these
- *	would be the methods on the cyphertext object.
+ *	Option routines
  *
  ************************************************************************/
 /*
- *	This is an interesting little routine - it looks at a
- *	plaintext and cyphertext and sees if the pattern of
- *	characters exhibited in both match. If they do, then
- *	this routine returns TRUE, if not, then it returns
- *	FALSE.
+ *	This routine looks at one option that changes how a cyphertext
+ *	is solved - the known substitutions, the time limit, and the
+ *	attacks to try - and updates the arguments or the globals for
+ *	it. If it isn't one of these options, 'handled' is set to NO
+ *	and nothing else is done. A NO return means the option was one
+ *	of these, but it was badly formed.
  */
-BOOL DoPatternsMatch(char *cyphertext, char *plaintext) {
+BOOL ParseSolveOption(quipContext *ctx, char *opt, int *timeLimit, BOOL *tryingFrequencyAttack, BOOL *tryingWordBlockAttack, BOOL *handled) {
 	BOOL		error = NO;
-	BOOL		matched = YES;
-	BOOL		finished = NO;
-
-	// first, see if we have an easy match or not...
-	if (!error && !finished) {
-		if ((cyphertext == NULL) && (plaintext == NULL)) {
-			// they are both NULL, so they match - sort-of...
-			matched = YES;
-			finished = YES;
-		} else if ((cyphertext == NULL) || (plaintext == NULL)) {
-			// one is NULL and the other isn't - no match
-			matched = NO;
-			finished = YES;
-		}
-	}
-
-	// OK... check the length of the strings
-	if (!error && !finished) {
-		if (strlen(cyphertext) != strlen(plaintext)) {
-			// wrong length
-			matched = NO;
-			finished = YES;
-		}
-	}
-
-	// now check the pattern of characters
-	if (!error && !finished) {
-		int		i, j;
-		int		len = strlen(cyphertext);
-		char	cypherchar, plainchar;
-
-		for (i = 0; (i < len) && (!finished); i++) {
-			// get the cyphertext and plaintext characters
-			cypherchar = cyphertext[i];
-			plainchar = plaintext[i];
-
-			// check all the remaining chars for the same match
-			for (j = (i+1); (j < len) && (!finished); j++) {
-				/*
-				 *	Check for a repeating in one text and not
-				 *	in the other. If they both don't match,
-				 *	then stop checking.
-				 */
-				if (((cyphertext[j] == cypherchar) &&
-				     (plaintext[j] != plainchar)) ||
-				    ((plaintext[j] == plainchar) &&
-					 (cyphertext[j] != cypherchar))) {
-					matched = NO;
-					finished = YES;
-					break;
+
+	// first, make sure we have something to do
+	if (!error) {
+		if ((opt == NULL) || (opt[0] != '-') || (timeLimit == NULL) ||
+			(tryingFrequencyAttack == NULL) || (tryingWordBlockAttack == NULL) ||
+			(handled == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in ParseSolveOption() ***\n"
+							"    One of the arguments is NULL, or the option doesn't\n"
+							"    start with a '-'. This is most likely a bad call.\n");
+		} else {
+			*handled = YES;
+		}
+	}
+
+	// now see what the option is
+	if (!error) {
+		switch (opt[1]) {
+			case 'k' :
+				// check to see that it's the right format
+				if ((!isalpha(opt[2])) || (opt[3] != '=') || (!isalpha(opt[4]))) {
+					error = YES;
+					fprintf(stderr, "*** Error ***\n"
+									"    The format of the '-k' option is bad.\n");
 				}
-			}
+
+				// now, add the known info to the user legend
+				if (!error) {
+					if (!AddKnownSubstitutionToContext(ctx, opt[2], opt[4])) {
+						error = YES;
+					}
+				}
+				break;
+			case 'T' :
+				if (strlen(opt) > 2) {
+					*timeLimit = atoi( &(opt[2]) );
+					if (*timeLimit < 0) {
+						*timeLimit = -1;
+					} else if (*timeLimit > 300) {
+						*timeLimit = 300;
+					}
+				}
+				break;
+			case 'F' :
+				*tryingFrequencyAttack = YES;
+				if (strlen(opt) > 2) {
+					ctx->frequencyTimeLimit = atoi( &(opt[2]) );
+					if (ctx->frequencyTimeLimit < 0) {
+						ctx->frequencyTimeLimit = -1;
+					} else if (ctx->frequencyTimeLimit > 300) {
+						ctx->frequencyTimeLimit = 300;
+					}
+				}
+				break;
+			case 'W' :
+				*tryingWordBlockAttack = YES;
+				break;
+			case 'x' :
+				ctx->noSelfMapping = YES;
+				break;
+			case 'S' :
+				ctx->collectingStats = YES;
+				break;
+			case 'A' :
+				if (strcmp(&(opt[2]), "auto") == 0) {
+					ctx->choosingAttack = YES;
+					ctx->runningPortfolio = NO;
+				} else if (strcmp(&(opt[2]), "portfolio") == 0) {
+					ctx->runningPortfolio = YES;
+					ctx->choosingAttack = NO;
+				} else {
+					error = YES;
+					fprintf(stderr, "*** Error ***\n"
+									"    The format of the '-A' option is bad.\n");
+				}
+				break;
+			case 'E' :
+				switch (opt[2]) {
+					case '\0' :
+						ctx->estimateMode = ESTIMATE_REPORT;
+						break;
+					case 'r' :
+						ctx->estimateMode = ESTIMATE_REFUSE;
+						break;
+					case 'f' :
+						ctx->estimateMode = ESTIMATE_REROUTE;
+						break;
+					default :
+						error = YES;
+						fprintf(stderr, "*** Error ***\n"
+										"    The format of the '-E' option is bad.\n");
+						break;
+				}
+				break;
+			case 'O' :
+				switch (opt[2]) {
+					case 'l' :
+						ctx->possibleOrdering = ORDER_BY_LIST;
+						break;
+					case 'c' :
+						ctx->possibleOrdering = ORDER_BY_CROSS_MATCH;
+						break;
+					case 'n' :
+						ctx->possibleOrdering = ORDER_BY_LEAST_CONSTRAINING;
+						break;
+					default :
+						error = YES;
+						fprintf(stderr, "*** Error ***\n"
+										"    The format of the '-O' option is bad.\n");
+						break;
+				}
+				break;
+			default :
+				*handled = NO;
+				break;
 		}
 	}
 
-	return error ? error : matched;
+	return !error;
 }
 
 
-/*
- *	This is an interesting little routine... It takes three things:
- *	a cyphertext, a legned and a plaintext - along with a
- *	'mustBeComplete' boolean flag, and sees if the legend can be
- *	used to generate the plaintext from the cyphertext. If the
- *	'mustBeComplete' is YES, then the legend must completly decode
- *	the cyphertext into the plaintext. Otherwise, 'holes' in the
- *	conversion are assumed to be in the favor of the match.
+/*************************************************************************
+ *
+ *	Server routines
  *
- *	This can be used to see if a legend and a cyphertext are on
- *	the right track to the plsintext - or, if they are 100% there.
- *	The boolean return value simply says 'Yes' they match.
+ *	With '--serve', quip loads the words file once, and then answers
+ *	requests on a Unix socket. Each request is one line with the
+ *	cyphertext and the options for solving it - just as they'd be on
+ *	the command line - and each answer is one line of JSON with the
+ *	solutions and timings. The requests are answered by a pool of
+ *	worker processes, each taking one connection at a time, and all
+ *	of them sharing the one copy of the loaded words file.
+ *
+ ************************************************************************/
+/*
+ *	This routine splits the request line into its arguments - in
+ *	place - the way the shell would: on whitespace, with single or
+ *	double quotes around an argument that has spaces in it. A '#'
+ *	starting an argument is a comment to the end of the line. The
+ *	return value is the number of arguments, or -1 if there were
+ *	more than 'maxArgs' or a quote was never closed.
  */
-BOOL CanCypherAndLegendMakePlain(char *cyphertext, legend *map, char *plaintext, BOOL mustBeComplete) {
-	BOOL		error = NO;
-	BOOL		finished = NO;
-	BOOL		mismatch = NO;
-
-	// first, let's make sure we have something to do
-	if (!error && !finished) {
-		if (cyphertext == NULL) {
-			error = YES;
-			printf("*** Error in CanCypherAndLegendMakePlain() ***\n"
-				   "    The cyphertext is NULL, and that means we have\n"
-				   "    nothing to do. Please make sure it isn't NULL.\n");
-		}
-	}
-	if (!error && !finished) {
-		if (map == NULL) {
-			error = YES;
-			printf("*** Error in CanCypherAndLegendMakePlain() ***\n"
-				   "    The legend is NULL, and that means that we have\n"
-				   "    nothing to do. Please make sure it isn't NULL.\n");
+int SplitRequestLine(char *line, char **args, int maxArgs) {
+	int		count = 0;
+	char	*src = line;
+	char	*dest = line;
+	char	quote;
+
+	while ((src != NULL) && (*src != '\0')) {
+		// skip the whitespace before the next argument
+		while (isspace(*src)) {
+			src++;
+		}
+		if ((*src == '\0') || (*src == '#')) {
+			break;
+		}
+		if (count == maxArgs) {
+			return -1;
+		}
+
+		// ...and copy it down to where it belongs, without quotes
+		args[count++] = dest;
+		quote = 0;
+		while ((*src != '\0') && (quote || !isspace(*src))) {
+			if (quote && (*src == quote)) {
+				quote = 0;
+			} else if (!quote && ((*src == '\'') || (*src == '"'))) {
+				quote = *src;
+			} else {
+				*dest++ = *src;
+			}
+			src++;
 		}
-	}
-	if (!error && !finished) {
-		if (plaintext == NULL) {
-			error = YES;
-			printf("*** Error in CanCypherAndLegendMakePlain() ***\n"
-				   "    The plaintext is NULL, and that means we have\n"
-				   "    nothing to do. Please make sure it isn't NULL.\n");
+		if (quote) {
+			return -1;
 		}
-	}
-
-	// well... see if they are the right length
-	if (!error && !finished) {
-		if (strlen(cyphertext) != strlen(plaintext)) {
-			mismatch = YES;
-			finished = YES;
+		if (*src != '\0') {
+			src++;
 		}
+		*dest++ = '\0';
 	}
 
-	// now we need to check each character in the mapping
-	if (!error && !finished) {
-		int			i;
-		char		ppc;
+	return count;
+}
 
-		for (i = 0; i < strlen(cyphertext); i++) {
-			// get the possible plaintext char from the mapping
-			ppc = CypherToPlainChar(map, tolower(cyphertext[i]));
 
-			// check for completness based on the user's desires
-			if ((ppc == 0) && mustBeComplete) {
-				mismatch = YES;
-				finished = YES;
-				break;
-			}
+/*
+ *	This routine writes the string to the file as a JSON string -
+ *	quoted, and with anything that needs it escaped.
+ */
+void WriteJSONString(FILE *fp, char *str) {
+	int		i;
 
-			// now see if they match
-			if (ppc != 0) {
-				if (tolower(ppc) != tolower(plaintext[i])) {
-					mismatch = YES;
-					finished = YES;
-				}
-			}
+	fputc('"', fp);
+	for (i = 0; (str != NULL) && (str[i] != '\0'); i++) {
+		if ((str[i] == '"') || (str[i] == '\\')) {
+			fprintf(fp, "\\%c", str[i]);
+		} else if ((unsigned char) str[i] < ' ') {
+			fprintf(fp, "\\u%04x", (unsigned char) str[i]);
+		} else {
+			fputc(str[i], fp);
 		}
 	}
-
-	return error ? NO : !mismatch;
+	fputc('"', fp);
 }
 
 
 /*
- *	This is an interesting little routine... It takes a cypherword
- *	and a legend and sees which, if any, of the possible plaintexts
- *	this cypherword has matches the legend and the cyphertext. If
- *	'mustBeComplete' is TRUE, then there can be no 'missing' letters
- *	in the mapping. If it's FALSE, then missing letters are OK.
- *
- *	The return value will be a pointer to a copy of the cypherword's
- *	possible plaintext, or NULL, if none is found. The caller is
- *	expected to free this copy when they are done with it.
+ *	This routine writes the search statistics in the context to the
+ *	answer as a JSON object - the same as the command line's '-S'
+ *	report, with the word block attack's by cypherword, and the
+ *	frequency attack's by cypherchar.
  */
-char *GetPossibleOfCypherwordForLegend(cypherword *word, legend *map, BOOL mustBeComplete) {
-	BOOL		error = NO;
-	BOOL		finished = NO;
-	char		*retval = NULL;
+void WriteSearchStats(FILE *fp, quipContext *ctx) {
+	searchStats	*stats = ctx->stats;
+	int			i;
 
-	// first, let's make sure we have something to do
-	if (!error && !finished) {
-		if (word == NULL) {
-			error = YES;
-			printf("*** Error in GetPossibleOfCypherwordForLegend() ***\n"
-				   "    The cypherword is NULL, and that means we have\n"
-				   "    nothing to do. Please make sure it isn't NULL.\n");
-		}
+	fprintf(fp, "{\"duplicates\":%ld,\"conflicts\":{", stats->duplicates);
+	for (i = 0; i < CONFLICT_CAUSES; i++) {
+		fprintf(fp, "%s\"%s\":%ld", (i > 0 ? "," : ""), GetConflictName(i), stats->conflicts[i]);
 	}
-	if (!error && !finished) {
-		if (map == NULL) {
-			error = YES;
-			printf("*** Error in GetPossibleOfCypherwordForLegend() ***\n"
-				   "    The legend is NULL, and that means that we have\n"
-				   "    nothing to do. Please make sure it isn't NULL.\n");
-		}
+	fprintf(fp, "},\"max_depth\":%d,\"words\":[", (stats->maxDepth + 1));
+	for (i = 0; i < stats->levels; i++) {
+		fputs((i > 0 ? ",{\"cypherword\":" : "{\"cypherword\":"), fp);
+		WriteJSONString(fp, ctx->words[i]->cyphertext);
+		fprintf(fp, ",\"possibles\":%d,\"tested\":%ld,\"rejected\":%ld,\"nodes\":%ld}",
+				ctx->words[i]->numberOfPossibles, stats->tested[i], stats->rejected[i], stats->nodes[i]);
 	}
+	fprintf(fp, "],\"freq_legends\":%ld,\"freq_misses\":%ld,\"freq_max_depth\":%d}",
+			stats->freqLegends, stats->freqMisses, (stats->freqMaxDepth + 1));
+}
 
-	// next, we need to look at each one of the possibles and check it
-	if (!error && !finished) {
-		int		i;
 
-		for (i = 0; (i < word->numberOfPossibles) && !finished; i++) {
-			if (CanCypherAndLegendMakePlain(word->cyphertext, map, word->possiblePlaintext[i], mustBeComplete)) {
-				// we have a match!
-				finished = YES;
-				// ...now copy it for return to the caller
-				retval = strdup(word->possiblePlaintext[i]);
-				if (retval == NULL) {
-					error = YES;
-					printf("*** Error in GetPossibleOfCypherwordForLegend() ***\n"
-						   "    A copy of the plaintext word that matches this cypherword\n"
-						   "    and legend could not be obtained due to memory allocation\n"
-						   "    problems. This is too bad because we had a solution.\n");
-				}
-			}
-		}
-	}
+/*
+ *	This routine writes the estimate of the size of the search in
+ *	the context to the answer as a JSON object - the same as the
+ *	command line's '-E' report.
+ */
+void WriteSearchEstimate(FILE *fp, quipContext *ctx) {
+	searchEstimate	*estimate = &(ctx->estimate);
+
+	fprintf(fp, "{\"product_log10\":%.2f,\"bounded\":%s,\"probes\":%d,\"probe_us\":%ld,\"tested\":%.4g,"
+			"\"nodes\":%.4g,\"solutions\":%.4g,\"predicted_us\":%.6g,\"limit_us\":%ld,"
+			"\"over_budget\":%s,\"refused\":%s}",
+			estimate->productLog10, (estimate->bounded ? "true" : "false"),
+			estimate->probes, estimate->probe_ns / 1000,
+			estimate->tested, estimate->nodes, estimate->solutions, estimate->predicted_us,
+			estimate->limit_us, (estimate->overBudget ? "true" : "false"),
+			(estimate->refused ? "true" : "false"));
+}
 
-	return error ? NULL : retval;
+
+/*
+ *	This routine writes how the attack was picked, with '-Aauto', to
+ *	the answer as a JSON object - the same as the command line's
+ *	report of it.
+ */
+void WriteAttackChoice(FILE *fp, quipContext *ctx) {
+	attackChoice	*choice = &(ctx->choice);
+
+	fprintf(fp, "{\"picked\":\"%s\",\"hints\":%d,\"coverage\":%.3f,\"word_block_us\":%.6g,"
+			"\"frequency_us\":%.6g,\"frequency_error\":%.3f,\"unreliable\":%s,\"actual_us\":%ld,"
+			"\"mispredicted\":%s}",
+			GetAttackName(choice->chosen), choice->hints, choice->coverage, choice->wordBlock_us,
+			choice->frequency_us, choice->frequencyError, (choice->unreliable ? "true" : "false"),
+			choice->actual_us, (choice->mispredicted ? "true" : "false"));
 }
 
 
 /*
- *	This is an interesting routine... it returns TRUE if the legend
- *	TOTALLY decodes the cypherword into one of it's possible
- *	plaintext words. This routine calls the more general routine
- *	GetPossibleOfCypherwordForLegend() with the 'mustBeComplete'
- *	argument set to TRUE.
- *
- *	This routine is very helpful in testing a legend to see if it
- *	decodes all the cypherwords - one at a time.
+ *	This routine writes how the race of the strategies went, with
+ *	'-Aportfolio', to the answer as a JSON object - the same as the
+ *	command line's report of it.
  */
-BOOL IsCypherwordDecryptedByLegend(cypherword *word, legend *map) {
-	BOOL		error = NO;
-	BOOL		retval = NO;
-	char		*plaintext = NULL;
+void WritePortfolio(FILE *fp, quipContext *ctx) {
+	portfolio	*race = ctx->portfolio;
+	int			i;
 
-	// first, let's make sure we have something to do
-	if (!error) {
-		if (word == NULL) {
-			error = YES;
-			printf("*** Error in IsCypherwordDecryptedByLegend() ***\n"
-				   "    The cypherword is NULL, and that means we have\n"
-				   "    nothing to do. Please make sure it isn't NULL.\n");
-		}
+	fputs("{\"winner\":", fp);
+	if (race->winner >= 0) {
+		WriteJSONString(fp, GetPortfolioStrategyName(race->winner));
+	} else {
+		fputs("null", fp);
 	}
-	if (!error) {
-		if (map == NULL) {
-			error = YES;
-			printf("*** Error in IsCypherwordDecryptedByLegend() ***\n"
-				   "    The legend is NULL, and that means that we have\n"
-				   "    nothing to do. Please make sure it isn't NULL.\n");
-		}
+	fputs(",\"taken\":", fp);
+	if (race->taken >= 0) {
+		WriteJSONString(fp, GetPortfolioStrategyName(race->taken));
+	} else {
+		fputs("null", fp);
 	}
-
-	// next, let's see what the word might be...
-	if (!error) {
-		plaintext = GetPossibleOfCypherwordForLegend(word, map, TRUE);
-		if (plaintext == NULL) {
-			retval = NO;
-		} else {
-			retval = YES;
-			// don't forget to free the plaintext we received
-			free(plaintext);
-		}
+	fputs(",\"strategies\":[", fp);
+	for (i = 0; i < PORTFOLIO_STRATEGIES; i++) {
+		fputs((i > 0 ? ",{\"strategy\":" : "{\"strategy\":"), fp);
+		WriteJSONString(fp, GetPortfolioStrategyName(i));
+		fprintf(fp, ",\"finished\":%s,\"error\":%s,\"elapsed_us\":%ld,\"nodes\":%ld,\"solutions\":%d}",
+				(race->strategies[i].finished ? "true" : "false"), (race->strategies[i].error ? "true" : "false"),
+				race->strategies[i].elapsed_us, race->strategies[i].nodes, race->strategies[i].solutions);
 	}
-
-	return error ? error : retval;
+	fputs("]}", fp);
 }
 
 
 /*
- *	This routine creates a new cypherword based on the passed-in
- *	character string as the basis of the cyphertext. The cypherword
- *	structure that's returned is completly initialized for use in
- *	this system.
+ *	This routine answers one request line - it's solved from a clean
+ *	slate and the answer is written to 'fp' as one line of JSON:
+ *
+ *	  {"cyphertext":"...","status":"...","solutions":["...",...],
+ *	   "cached":b,"nodes":n,"match_us":n,"search_us":n,"total_us":n}
+ *
+ *	where the status is "solved", "unsolved" (the search finished
+ *	without any solutions), "timeout" (the solutions are the ones
+ *	found in time), "refused" (with '-Er', the search was predicted
+ *	to take too long, and wasn't started), or "error" - with a
+ *	"message" saying why. The "nodes" are the legends tried in the
+ *	search, and "cached" says if the answer came out of the cache
+ *	instead. With '-E', there's the "estimate" of the search, too, and
+ *	with '-Aauto', the "attack" that was picked, and why - or with
+ *	'-Aportfolio', how the race of the "portfolio" went. Blank and comment
+ *	lines get no answer at all. The time limit is the one given, if
+ *	the line doesn't have its own. The return value is NO only if
+ *	the answer couldn't be written.
  */
-cypherword *CreateCypherword(char *str) {
-	BOOL		error = NO;
-	cypherword	*retval = NULL;
-
-	// first, make sure we have something to do
-	if (!error) {
-		if (str == NULL) {
-			error = YES;
-			printf("*** Error in CreateCypherword() ***\n"
-				   "    The passed-in cyphertext was NULL and so no\n"
-				   "    cypherword will be created. Try to call this\n"
-				   "    routine with a valid cyphertext string.\n");
+BOOL AnswerRequest(quipContext *ctx, char *line, FILE *fp, int defaultTimeLimit) {
+	char			*args[MAX_REQUEST_ARGS];
+	int				argCount;
+	int				timeLimit = defaultTimeLimit;
+	BOOL			tryingFrequencyAttack = NO;
+	BOOL			tryingWordBlockAttack = YES;
+	BOOL			finished = NO;
+	BOOL			handled;
+	int				matchTime_us = 0;
+	int				searchTime_us = 0;
+	char			message[256];
+	struct timespec	start, end;
+	int				i;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+	message[0] = '\0';
+
+	// every request starts with the defaults
+	ResetQuipContext(ctx);
+
+	// pick out the cyphertext and the options
+	argCount = SplitRequestLine(line, args, MAX_REQUEST_ARGS);
+	if (argCount == 0) {
+		return YES;
+	} else if (argCount < 0) {
+		snprintf(message, sizeof(message), "the request has an unclosed quote or too many arguments");
+	}
+	for (i = 0; (i < argCount) && (message[0] == '\0'); i++) {
+		if ((i == 0) && (strcmp(args[i], "quip") == 0)) {
+			// it's fine to send the whole command line
+			continue;
+		}
+		if ((args[i][0] == '-') && (args[i][1] != '\0')) {
+			if (!ParseSolveOption(ctx, args[i], &timeLimit, &tryingFrequencyAttack, &tryingWordBlockAttack, &handled)) {
+				snprintf(message, sizeof(message), "the option '%s' is badly formed", args[i]);
+			} else if (!handled) {
+				snprintf(message, sizeof(message), "the option '%s' can't be used in a request", args[i]);
+			}
+		} else if (ctx->initialCyphertext == NULL) {
+			if (!SetCyphertextInContext(ctx, args[i])) {
+				snprintf(message, sizeof(message), "the cyphertext could not be copied");
+			}
+		} else {
+			snprintf(message, sizeof(message), "there is more than one cyphertext in the request");
 		}
 	}
+	if ((message[0] == '\0') && (ctx->initialCyphertext == NULL)) {
+		snprintf(message, sizeof(message), "there is no cyphertext in the request");
+	}
+	if ((message[0] == '\0') && (ctx->userLegend == NULL)) {
+		snprintf(message, sizeof(message), "there are no known substitutions (-ka=b) in the request");
+	}
 
-	// next, we need to allocate a new cypherword structure
-	if (!error) {
-		retval = (cypherword *) malloc(sizeof(cypherword));
-		if (retval == NULL) {
-			error = YES;
-			printf("*** Error in CreateCypherword() ***\n"
-				   "    A new, blank, cypherword could not be allocated.\n"
-				   "    This is a significant problem and we can't do anymore.\n");
+	// ...now solve it
+	if (message[0] == '\0') {
+		if (!SolveCyphertext(ctx, timeLimit, tryingFrequencyAttack, tryingWordBlockAttack, &finished, &matchTime_us, &searchTime_us)) {
+			snprintf(message, sizeof(message), "the cyphertext could not be solved - see the solver's messages");
 		}
 	}
+	clock_gettime(CLOCK_MONOTONIC_RAW, &end);
 
-	// now we can set up the cypherword's internal variables
-	if (!error) {
-		// first, set the length of the cyphertext
-		retval->length = strlen(str);
+	// ...and write out the answer
+	fputs("{\"cyphertext\":", fp);
+	WriteJSONString(fp, ctx->initialCyphertext);
+	if (message[0] != '\0') {
+		fputs(",\"status\":\"error\",\"message\":", fp);
+		WriteJSONString(fp, message);
+	} else {
+		fprintf(fp, ",\"status\":\"%s\"", (!finished ? (ctx->estimate.refused && (ctx->estimateMode == ESTIMATE_REFUSE) ? "refused" : "timeout") :
+											 (ctx->plainTextCnt > 0 ? "solved" : "unsolved")));
+	}
+	fputs(",\"solutions\":[", fp);
+	for (i = 0; (message[0] == '\0') && (i < ctx->plainTextCnt); i++) {
+		if (i > 0) {
+			fputc(',', fp);
+		}
+		WriteJSONString(fp, ctx->plainText[i]);
+	}
+	fprintf(fp, "],\"cached\":%s,\"nodes\":%ld,\"match_us\":%d,\"search_us\":%d,\"total_us\":%ld",
+			((message[0] == '\0') && ctx->cached ? "true" : "false"),
+			(message[0] == '\0' ? ctx->searchNodes : 0), matchTime_us, searchTime_us,
+			(long) ((end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000));
+	if ((message[0] == '\0') && (ctx->stats != NULL)) {
+		fputs(",\"stats\":", fp);
+		WriteSearchStats(fp, ctx);
+	}
+	if ((message[0] == '\0') && ctx->estimate.done) {
+		fputs(",\"estimate\":", fp);
+		WriteSearchEstimate(fp, ctx);
+	}
+	if ((message[0] == '\0') && ctx->choice.done) {
+		fputs(",\"attack\":", fp);
+		WriteAttackChoice(fp, ctx);
+	}
+	if ((message[0] == '\0') && (ctx->portfolio != NULL)) {
+		fputs(",\"portfolio\":", fp);
+		WritePortfolio(fp, ctx);
+	}
+	fputs("}\n", fp);
+	fflush(fp);
+
+	LogSolve(logger, ctx, (message[0] != '\0' ? "error" :
+						   (!finished ? (ctx->estimate.refused && (ctx->estimateMode == ESTIMATE_REFUSE) ? "refused" : "timeout") :
+							(ctx->plainTextCnt > 0 ? "solved" : "unsolved"))),
+			 ctx->plainTextCnt, (long) ((end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000));
+	ResetQuipContext(ctx);
+
+	return !ferror(fp);
+}
 
-		// next, copy the cyphertext
-		retval->cyphertext = strdup(str);
-		if (retval->cyphertext == NULL) {
-			error = YES;
-			printf("*** Error in CreateCypherword() ***\n"
-				   "    While trying to initialize the new cypherword, the\n"
-				   "    cyphertext could not be copied into the cypherword's\n"
-				   "    internal structures. This is a serious problem.\n");
-		}
 
-		// next, allocate the starting possible array
-		if (!error) {
-			retval->possiblePlaintext = (char **) malloc(STARTING_POSSIBLES_SIZE * sizeof(char*));
-			if (retval->possiblePlaintext == NULL) {
-				error = YES;
-				printf("*** Error in CreateCypherword() ***\n"
-					   "    The initial array for holding possible plaintext matches\n"
-					   "    to this cypherword could not be allocated. This is a\n"
-					   "    serious problem and is cause for great concern.\n");
-			} else {
-				// all went OK, so save the size and number used
-				retval->possiblePlaintextSize = STARTING_POSSIBLES_SIZE;
-				retval->numberOfPossibles = 0;
+/*
+ *	This routine answers the requests on one connection until the
+ *	client closes it - or the answers can't be sent back.
+ */
+void ServeConnection(quipContext *ctx, int fd, int timeLimit) {
+	FILE		*in = NULL;
+	FILE		*out = NULL;
+	char		*line = NULL;
+	size_t		lineSize = 0;
+
+	in = fdopen(fd, "r");
+	if (in == NULL) {
+		close(fd);
+	} else {
+		int		outFd = dup(fd);
+
+		if (outFd >= 0) {
+			out = fdopen(outFd, "w");
+			if (out == NULL) {
+				close(outFd);
 			}
 		}
 	}
 
-	// if I've run into troubles, I need to free what I might have allocated
-	if (error) {
-		if (retval != NULL) {
-			retval = DestroyCypherword(retval);
+	if ((in != NULL) && (out != NULL)) {
+		while (getline(&line, &lineSize, in) >= 0) {
+			if (!AnswerRequest(ctx, line, out, timeLimit)) {
+				break;
+			}
+			// ...and get anything the solver had to say into the log
+			fflush(stdout);
 		}
 	}
 
-	return error ? NULL : retval;
+	if (line != NULL) {
+		free(line);
+	}
+	if (out != NULL) {
+		fclose(out);
+	}
+	if (in != NULL) {
+		fclose(in);
+	}
 }
 
 
 /*
- *	When a cypherword structure is no longer needed, this routine
- *	can be called to carefully remove all the resources used in
- *	the structure so that when it's gone, there's a 'zero sum'
- *	resource game.
+ *	This is the signal handler for the server - it just notes that
+ *	it's time to stop, and the main loop of the server does the rest.
  */
-cypherword *DestroyCypherword(cypherword *word) {
-	BOOL		error = NO;
-	BOOL		finished = NO;
-
-	// first, make sure we have something to do
-	if (!error && !finished) {
-		if (word == NULL) {
-			// while we could flag this as an error, we can
-			// leave it be as a NULL is already 'destroyed'
-			finished = YES;
-		}
-	}
-
-	// now we need to release the cyphertext in this cypherword
-	if (!error && !finished) {
-		if (word->cyphertext != NULL) {
-			free(word->cyphertext);
-		}
-	}
+void StopServer(int sig) {
+	serverStopping = 1;
+}
 
-	// now we need to release all the possible plaintexts
-	if (!error && !finished) {
-		int		i;
 
-		if (word->possiblePlaintext != NULL) {
-			// first, release each word in the array
-			for (i = 0; i < word->numberOfPossibles; i++) {
-				if (word->possiblePlaintext[i] != NULL) {
-					free(word->possiblePlaintext[i]);
-				}
+/*
+ *	This is the thread routine for one of the server's workers. It
+ *	has a solve context of its own on the shared dictionary, and
+ *	takes connections off the listening socket, one at a time, until
+ *	the socket is shut down.
+ */
+void *ServeRequests(void *arg) {
+	serverWorker	*worker = (serverWorker *) arg;
+	quipContext		*ctx = NULL;
+	int				fd;
+
+	ctx = CreateQuipContext(worker->dict);
+	if (ctx != NULL) {
+		ctx->cache = worker->cache;
+	}
+	while ((ctx != NULL) && !serverStopping) {
+		fd = accept(worker->listener, NULL, NULL);
+		if (fd >= 0) {
+			ServeConnection(ctx, fd, worker->timeLimit);
+		} else if ((errno != EINTR) && (errno != ECONNABORTED)) {
+			if (!serverStopping) {
+				fprintf(stderr, "*** Error in ServeRequests() ***\n"
+								"    A worker could not accept a connection: %s\n",
+								strerror(errno));
 			}
-
-			// ...and now release the array itself
-			free(word->possiblePlaintext);
+			break;
 		}
 	}
-
-	// finally, we need to release the cypherword itself
-	if (!error && !finished) {
-		free(word);
-	}
+	ctx = DestroyQuipContext(ctx);
 
 	return NULL;
 }
 
 
 /*
- *	This routine takes a cypherword and a character string and
- *	checks to see if the string has the right structural pattern
- *	to match the cypherword. If so, the cypherword copies this
- *	character string into it's list of possible plaintext words.
- *	The cypherword will take care of the deallocation of these
- *	resources when the time comes.
+ *	This is the server itself. It loads the words file, opens the
+ *	cache in 'cacheFilename' - if there is one - of no more than
+ *	'cacheSize' bytes, starts listening on the Unix socket at
+ *	'socketPath', and starts the
+ *	pool of 'workers' threads to answer the requests - with the
+ *	'timeLimit' for those that don't have their own. Then it just
+ *	waits until it's told to stop with a SIGINT or SIGTERM, and
+ *	cleans up. Any answers still being worked on are dropped.
  */
-BOOL CheckCypherwordForPossiblePlaintext(cypherword *word, char *str) {
-	BOOL		error = NO;
-	BOOL		finished = NO;
+BOOL ServeQuips(char *socketPath, char *wordsFilename, char *cacheFilename, size_t cacheSize, int workers, int timeLimit) {
+	BOOL				error = NO;
+	dictionary			*dict = NULL;
+	quipCache			*cache = NULL;
+	int					listener = -1;
+	serverWorker		*pool = NULL;
+	int					started = 0;
+	struct sockaddr_un	addr;
+	struct stat			info;
+	sigset_t			waitMask;
+	int					i;
 
-	// first, check and see if we have something to do
-	if (!error && !finished) {
-		if (word == NULL) {
+	// first, make sure we have something to do
+	if (!error) {
+		if ((socketPath == NULL) || (strlen(socketPath) >= sizeof(addr.sun_path))) {
 			error = YES;
-			printf("*** Error in CheckCypherwordForPossiblePlaintext() ***\n"
-				   "    The passed-in cypherword was NULL, and therefore nothing\n"
-				   "    can be used to check against the plaintext. This is most\n"
-				   "    likely a bad argument call.\n");
+			fprintf(stderr, "*** Error in ServeQuips() ***\n"
+							"    The path for the socket is missing or too long. It\n"
+							"    has to be less than %d characters.\n", (int) sizeof(addr.sun_path));
 		}
 	}
-	if (!error && !finished) {
-		if (str == NULL) {
+	if (!error) {
+		if (workers < 1) {
+			workers = 1;
+		}
+		pool = (serverWorker *) calloc(workers, sizeof(serverWorker));
+		if (pool == NULL) {
 			error = YES;
-			printf("*** Error in CheckCypherwordForPossiblePlaintext() ***\n"
-				   "    The passed in plaintext is NULL, and therefore nothing\n"
-				   "    can really be done. Please check arguments before calling.\n");
+			fprintf(stderr, "*** Error in ServeQuips() ***\n"
+							"    The list of the %d workers could not be created.\n"
+							"    This is a serious problem.\n", workers);
 		}
 	}
 
-	// now we need to see if the pattern matches
-	if (!error && !finished) {
-		if (!DoPatternsMatch(word->cyphertext, str)) {
-			// they don't match, so stop checking
-			finished = YES;
+	// load the words file once - the workers all share it
+	if (!error) {
+		if (wordsFilename == NULL) {
+			wordsFilename = DEFAULT_WORDS_FILE;
+		}
+		dict = LoadWords(wordsFilename);
+		if (dict == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in ServeQuips() ***\n"
+							"    The file '%s' could not be loaded as a dictionary.\n"
+							"    There's no point in serving quips without it.\n", wordsFilename);
 		}
 	}
 
-	/*
-	 *	If we're here, then add it to the array of possibles.
-	 *	First, see if we have room in the already allocated array,
-	 *	and if not, we need to up that by the appropriate amount.
-	 *	When we have room in the array, we then need to copy the
-	 *	plaintext over to the next available slot.
-	 *
-	 *	First, check to see if we have room in this array...
-	 */
-	if (!error && !finished) {
-		if (word->numberOfPossibles == word->possiblePlaintextSize) {
-			/*
-			 *	OK... we need to expand the array the right amount.
-			 */
-			if (word->possiblePlaintextSize == 0) {
-				word->possiblePlaintext = (char **) malloc(STARTING_POSSIBLES_SIZE * sizeof(char *));
+	// ...and the cache of answers, if we're to use one
+	if (!error && (cacheFilename != NULL)) {
+		cache = OpenQuipCache(cacheFilename, cacheSize, dict);
+		if (cache == NULL) {
+			error = YES;
+		}
+	}
+
+	// clear out an old socket - but nothing else - and listen on it
+	if (!error) {
+		if (lstat(socketPath, &info) == 0) {
+			if (S_ISSOCK(info.st_mode)) {
+				unlink(socketPath);
 			} else {
-				word->possiblePlaintext = (char **) realloc(word->possiblePlaintext, (word->possiblePlaintextSize + INCREMENT_POSSIBLES_SIZE)*sizeof(char *));
+				error = YES;
+				fprintf(stderr, "*** Error in ServeQuips() ***\n"
+								"    The path '%s' is already there, and it's not\n"
+								"    a socket. It's not going to be replaced.\n", socketPath);
 			}
-			if (word->possiblePlaintext == NULL) {
+		}
+	}
+	if (!error) {
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strcpy(addr.sun_path, socketPath);
+		listener = socket(AF_UNIX, SOCK_STREAM, 0);
+		if ((listener < 0) ||
+			(bind(listener, (struct sockaddr *) &addr, sizeof(addr)) != 0) ||
+			(listen(listener, SOMAXCONN) != 0)) {
+			error = YES;
+			fprintf(stderr, "*** Error in ServeQuips() ***\n"
+							"    The socket '%s' could not be set up: %s\n",
+							socketPath, strerror(errno));
+		}
+	}
+
+	// start up the workers - with the stop signals blocked, so that
+	// only this thread sees them
+	if (!error) {
+		struct sigaction	action;
+		sigset_t			stopSignals;
+
+		sigemptyset(&stopSignals);
+		sigaddset(&stopSignals, SIGINT);
+		sigaddset(&stopSignals, SIGTERM);
+		pthread_sigmask(SIG_BLOCK, &stopSignals, &waitMask);
+		memset(&action, 0, sizeof(action));
+		action.sa_handler = StopServer;
+		sigemptyset(&action.sa_mask);
+		sigaction(SIGINT, &action, NULL);
+		sigaction(SIGTERM, &action, NULL);
+		signal(SIGPIPE, SIG_IGN);
+
+		printf("quip: serving on '%s' with %d workers and %d words\n",
+			   socketPath, workers, dict->wordCount);
+		fflush(stdout);
+		for (i = 0; (i < workers) && !error; i++) {
+			pool[i].listener = listener;
+			pool[i].dict = dict;
+			pool[i].cache = cache;
+			pool[i].timeLimit = timeLimit;
+			if (pthread_create(&pool[i].thread, NULL, ServeRequests, &pool[i]) != 0) {
 				error = YES;
-				printf("*** Error in CheckCypherwordForPossiblePlaintext() ***\n"
-					   "    While trying to add the plaintext word '%s' to the\n"
-					   "    array of possible plaintext words for this cypherword,\n"
-					   "	the array needed to be expanded to hold %d words, but\n"
-					   "    couldn't. This is a real big problem!\n", str,
-					   (word->possiblePlaintextSize == 0 ? STARTING_POSSIBLES_SIZE : (word->possiblePlaintextSize + INCREMENT_POSSIBLES_SIZE)) );
-
-				// if it's gone, we need to update the sizes
-				word->possiblePlaintextSize = 0;
-				word->numberOfPossibles = 0;
+				fprintf(stderr, "*** Error in ServeQuips() ***\n"
+								"    Worker #%d could not be started.\n", i);
 			} else {
-				/*
-				 *	OK! it worked, so let's reflect the size change
-				 */
-				word->possiblePlaintextSize += INCREMENT_POSSIBLES_SIZE;
+				started++;
 			}
 		}
 	}
 
-	// now, we can get a copy of the string and place it in the next slot
-	if (!error && !finished) {
-		word->possiblePlaintext[word->numberOfPossibles] = strdup(str);
-		if (word->possiblePlaintext[word->numberOfPossibles] == NULL) {
-			error = YES;
-			printf("*** Error in CheckCypherwordForPossiblePlaintext() ***\n"
-				   "    A copy of the plaintext '%s' could not be obtained\n"
-				   "    for this cypherword. This is a problem because it might\n"
-				   "    have been the key to the whole puzzle... too bad. Check\n"
-				   "    on it.\n", str);
-		} else {
-			// went well, so up the count
-			word->numberOfPossibles++;
+	// ...and keep them going until we're told to stop
+	while (!error && !serverStopping) {
+		sigsuspend(&waitMask);
+	}
+
+	// shut it all down
+	serverStopping = 1;
+	if (listener >= 0) {
+		shutdown(listener, SHUT_RDWR);
+		close(listener);
+		unlink(socketPath);
+	}
+	if (pool != NULL) {
+		for (i = 0; i < started; i++) {
+			pthread_detach(pool[i].thread);
 		}
 	}
+	// ...the pool, the dictionary and the cache are left for the exit
+	// to clean up, as a worker could still be in the middle of an answer
 
 	return !error;
 }
 
 
-/************************************************************************
+/*************************************************************************
  *
- *	Legend functions
+ *	Batch routines
  *
- *	These functions are used to manipulate the decryption data a.k.a.
- *	the legend in a manner that is very high level so that the user
- *	doesn't have to fiddle around with low-level allocation routines
- *	to get the job done. In a more OO design, these functions would
- *	be the methods on the legend object.
+ *	With '--batch', quip loads the words file once and solves every
+ *	puzzle in a file - one per line, written just like a server
+ *	request. The puzzles are taken, one at a time, by a pool of
+ *	worker threads - each with a solve context of its own, as the
+ *	server's are - and the answers - the same JSON lines as the
+ *	server's, plus the line number - are written out in the order
+ *	of the file. A puzzle that's still running BATCH_DEADLINE_GRACE
+ *	seconds past its time limit has its solve cancelled, and is
+ *	answered as a "timeout" with what it found by then.
  *
  ************************************************************************/
 /*
- *	This routine creates a new legend structure with the single
- *	character mapping of the 'plainChar' for the 'cryptChar' in
- *	the cyphertext. This is useful, for example, in the beginning
- *	when a single mapping pair is given to the program to start.
+ *	This is the thread routine for one of the batch workers. It takes
+ *	the next puzzle that no one else has, answers it into a string of
+ *	its own, and leaves that for the main thread to write out - and
+ *	then does it again, until there are no puzzles left. The solver
+ *	is kept quiet, as stdout is for the answers.
  */
-legend *CreateLegend(char cryptChar, char plainChar) {
-	BOOL		error = NO;
-	legend		*retval = NULL;
-
-	// first, let's get the space, if we can
-	if (!error) {
-		retval = (legend *) malloc(sizeof(legend));
-		if (retval == NULL) {
+void *SolveBatchPuzzles(void *arg) {
+	BOOL			error = NO;
+	batchWorker		*worker = (batchWorker *) arg;
+	batchRun		*run = worker->run;
+	quipContext		*ctx = NULL;
+	char			*answer = NULL;
+	size_t			answerSize = 0;
+	FILE			*fp = NULL;
+	int				puzzle = -1;
+
+	ctx = CreateQuipContext(run->dict);
+	if (ctx == NULL) {
+		error = YES;
+	} else {
+		ctx->cache = run->cache;
+		ctx->cancel = &worker->cancel;
+		ctx->quiet = YES;
+	}
+
+	while (!error) {
+		// take the next puzzle - if there's one left
+		pthread_mutex_lock(&run->lock);
+		puzzle = -1;
+		if (run->nextPuzzle < run->puzzleCount) {
+			puzzle = run->nextPuzzle++;
+			worker->puzzle = puzzle;
+			worker->cancel = 0;
+			clock_gettime(CLOCK_MONOTONIC, &worker->started);
+		}
+		pthread_mutex_unlock(&run->lock);
+		if (puzzle < 0) {
+			break;
+		}
+
+		// ...answer it
+		answer = NULL;
+		answerSize = 0;
+		fp = open_memstream(&answer, &answerSize);
+		if (fp == NULL) {
 			error = YES;
-			printf("*** Error in CreateLegend() ***\n"
-				   "    The creation of the legend structure failed in\n"
-				   "    trying to get the necessary memory from the\n"
-				   "    pool. This is a serious memory problem.\n");
+		} else {
+			if (!AnswerRequest(ctx, run->puzzles[puzzle], fp, run->timeLimit)) {
+				error = YES;
+			}
+			fclose(fp);
+			if (answerSize == 0) {
+				error = YES;
+			}
+		}
+		if (error) {
+			fprintf(stderr, "*** Error in SolveBatchPuzzles() ***\n"
+							"    The answer to puzzle #%d could not be made. This is\n"
+							"    a serious problem.\n", (puzzle + 1));
+			if (answer != NULL) {
+				free(answer);
+				answer = NULL;
+			}
 		}
-	}
-
-	// let's zero out the legend to start with
-	if (!error) {
-		int		i;
 
-		for (i = 0; i < 26; i++) {
-			retval->map[i] = 0;
+		// ...and hand it over to be written out
+		pthread_mutex_lock(&run->lock);
+		run->answers[puzzle] = answer;
+		worker->puzzle = -1;
+		if (error) {
+			run->error = YES;
 		}
+		pthread_cond_signal(&run->answered);
+		pthread_mutex_unlock(&run->lock);
 	}
 
-	// now, let's assign the character we have
-	if (!error) {
-		retval->map[cryptChar - 'a'] = plainChar;
-	}
+	// let the main thread know there's one less of us
+	pthread_mutex_lock(&run->lock);
+	run->running--;
+	pthread_cond_signal(&run->answered);
+	pthread_mutex_unlock(&run->lock);
 
-	return error ? NULL : retval;
+	ctx = DestroyQuipContext(ctx);
+
+	return NULL;
 }
 
 
 /*
- *	This routine takes care of releasing the resources used in the
- *	passed-in legend structure, and then the structure itself.
+ *	This is the batch solver. It reads all the puzzles in the file
+ *	'filename' - or stdin if it's "-" - skipping the blank and
+ *	comment lines, loads the words file - and the cache, as for the
+ *	server - and then starts the pool of 'workers' threads on them.
+ *	The answers are written to stdout, in the order of the file, as
+ *	soon as all the ones before them are - and in between, the solves
+ *	that are past their deadline are cancelled.
  */
-legend *DestroyLegend(legend* map) {
-
-	// first, free up the resources of the legend
-	if (map != NULL) {
-		// this is easy - now... there's nothing to do
-	}
-
-	// now free up the legend structure itself
-	if (map != NULL) {
-		free(map);
-	}
+BOOL SolveBatch(char *filename, char *wordsFilename, char *cacheFilename, size_t cacheSize, int workers, int timeLimit) {
+	BOOL				error = NO;
+	FILE				*fp = NULL;
+	char				**puzzles = NULL;
+	int					*lineNumbers = NULL;
+	int					puzzleCount = 0;
+	int					puzzleSize = 0;
+	dictionary			*dict = NULL;
+	quipCache			*cache = NULL;
+	batchRun			run;
+	batchWorker			*pool = NULL;
+	BOOL				runStarted = NO;
+	int					started = 0;
+	int					i;
+
+	memset(&run, 0, sizeof(run));
 
-	return NULL;
-}
-
-
-/*
- *	This routine returns a copy of the passed-in legend structure
- *	which is useful if there's a know good part of a key, but the
- *	user wants to experiment with additional keys without having
- *	to keep track of what's been changed in the original legend.
- */
-legend *DuplicateLegend(legend* map) {
-	BOOL		error = NO;
-    legend		*retval = NULL;
-
-	// first, see if we have anything to do
-	if (!error) {
-		if (map == NULL) {
-			error = YES;
-			printf("*** Error in DuplicateLegend() ***\n"
-				   "    The passed-in legend is NULL. This is most\n"
-				   "    likely a simple coding mistake.\n");
-		}
-	}
-
-	// next, create any old legend
+	// first, make sure we have something to do
 	if (!error) {
-		retval = CreateLegend('a', 'a');
-		if (retval == NULL) {
+		if (filename == NULL) {
 			error = YES;
-			printf("*** Error in DuplicateLegend() ***\n"
-				   "    While trying to duplicate a legend structure\n"
-				   "    the new legend could not be created. This is\n"
-				   "    a serious problem that needs to be addressed.\n");
+			fprintf(stderr, "*** Error in SolveBatch() ***\n"
+							"    The name of the file of puzzles is NULL. This is\n"
+							"    most likely a bad call.\n");
+		} else if (strcmp(filename, "-") == 0) {
+			fp = stdin;
 		} else {
-			// now we can copy over the contents of the old legend
-			SetLegendToLegend(retval, map);
+			fp = fopen(filename, "r");
+			if (fp == NULL) {
+				error = YES;
+				fprintf(stderr, "*** Error in SolveBatch() ***\n"
+								"    The file of puzzles '%s' could not be opened: %s\n",
+								filename, strerror(errno));
+			}
 		}
 	}
 
-	return error ? NULL : retval;
-}
-
-
-/*
- *	This routine simply takes two legends and copies all the data
- *	from the source legend to the destination legend. Both have
- *	to exist, of course.
- */
-void SetLegendToLegend(legend* dest, legend *src) {
-	BOOL		error = NO;
-
-	// first, make sure we have something to do
+	// read in all the puzzles - keeping their line numbers
 	if (!error) {
-		if ((dest == NULL) || (src == NULL)) {
-			error = YES;
-			printf("*** Error in SetLegendToLegend() ***\n"
-				   "    Either the source or destination legend is NULL. For\n"
-				   "    this routine to work, bpth have to be non-NULL. Please\n"
-				   "    make sure that they are both non-NULL.\n");
+		char		*line = NULL;
+		size_t		lineSize = 0;
+		int			lineNumber = 0;
+		char		*start;
+
+		while (!error && (getline(&line, &lineSize, fp) >= 0)) {
+			lineNumber++;
+			for (start = line; isspace(*start); start++) {
+				// skip the leading whitespace
+			}
+			if ((*start == '\0') || (*start == '#')) {
+				continue;
+			}
+			if (puzzleCount == puzzleSize) {
+				puzzleSize = (puzzleSize == 0 ? 64 : 2 * puzzleSize);
+				puzzles = (char **) realloc(puzzles, puzzleSize * sizeof(char *));
+				lineNumbers = (int *) realloc(lineNumbers, puzzleSize * sizeof(int));
+				if ((puzzles == NULL) || (lineNumbers == NULL)) {
+					error = YES;
+					fprintf(stderr, "*** Error in SolveBatch() ***\n"
+									"    The list of %d puzzles could not be grown.\n"
+									"    This is a serious problem.\n", puzzleSize);
+					break;
+				}
+			}
+			puzzles[puzzleCount] = strdup(line);
+			if (puzzles[puzzleCount] == NULL) {
+				error = YES;
+				fprintf(stderr, "*** Error in SolveBatch() ***\n"
+								"    The puzzle on line %d could not be copied.\n", lineNumber);
+				break;
+			}
+			lineNumbers[puzzleCount++] = lineNumber;
 		}
-	}
-
-	// now copy over the data from one to the other
-	if (!error) {
-		int		i;
-
-		for (i = 0; i < 26; i++) {
-			dest->map[i] = src->map[i];
+		if (line != NULL) {
+			free(line);
 		}
-	}
-}
-
-
-/*
- *	This routine returns TRUE if the two legends are equal in
- *	content - though they may not be the same actual object.
- *	This is a simple way to see if two legends under construction
- *	are the same.
- */
-BOOL DoesLegendEqualLegend(legend *a, legend *b) {
-	BOOL		error = NO;
-	BOOL		isEqual = YES;
-
-	// first, make sure we have something to do
-	if (!error) {
-		if ((a == NULL) || (b == NULL)) {
-			error = YES;
-			printf("*** Error in DoesLegendEqualLegend() ***\n"
-				   "    Either the source or destination legend is NULL. For\n"
-				   "    this routine to work, bpth have to be non-NULL. Please\n"
-				   "    make sure that they are both non-NULL.\n");
+		if (fp != stdin) {
+			fclose(fp);
 		}
 	}
 
-	// next, check each element for a mismatch
-	if (!error) {
-		int		i;
-
-		for (i = 0; (i < 26) && isEqual; i++) {
-			if (a->map[i] != b->map[i]) {
-				isEqual = NO;
-			}
+	// load the words file once - the workers all share it
+	if (!error && (puzzleCount > 0)) {
+		if (wordsFilename == NULL) {
+			wordsFilename = DEFAULT_WORDS_FILE;
+		}
+		dict = LoadWords(wordsFilename);
+		if (dict == NULL) {
+			error = YES;
+			fprintf(stderr, "*** Error in SolveBatch() ***\n"
+							"    The file '%s' could not be loaded as a dictionary.\n"
+							"    There's no point in solving the puzzles without it.\n", wordsFilename);
 		}
 	}
-
-	// return what we have to the caller
-	return isEqual;
-}
-
-
-/*
- *	This useful routine prints out the legend so that the user
- *	can see what's contained within it.
- */
-void PrintLegend(legend *map) {
-	int		i;
-
-	puts("cypher: abcdefghijklmnopqrstuvwxyz");
-	printf("plain:  ");
-	for (i = 0; i < 26; i++) {
-		printf("%c", (map->map[i] == 0 ? '.' : map->map[i]));
-	}
-	printf("\n");
-}
-
-
-/*
- *	This routine takes a cyphertext character and a legend and
- *	returns the plaintext character. This is used to decode the
- *	cyphertext into plaintext - one character at a time.
- */
-char CypherToPlainChar(legend *map, char c) {
-	BOOL		error = NO;
-	BOOL		upperCase = NO;
-	char		retval = c;
-
-	// make sure we have something to map through
-	if (!error) {
-		if (map == NULL) {
+	if (!error && (puzzleCount > 0) && (cacheFilename != NULL)) {
+		cache = OpenQuipCache(cacheFilename, cacheSize, dict);
+		if (cache == NULL) {
 			error = YES;
-			printf("*** Error in CypherToPlainChar() ***\n"
-				   "    The passed-in legend structure was NULL which\n"
-				   "    means that there can be no mapping. This is\n"
-				   "    a serious problem - please look into it.\n");
 		}
 	}
 
-	// now, see if the character can be converted
-	if (!error) {
-		// see if it's upper case
-		if (isupper(retval)) {
-			upperCase = YES;
-			retval = tolower(retval);
+	// get the pool of workers going
+	if (!error && (puzzleCount > 0)) {
+		if (workers > puzzleCount) {
+			workers = puzzleCount;
 		}
-
-		if (islower(retval)) {
-			retval = map->map[retval - 'a'] + (upperCase ? ('A' - 'a') : 0);
+		if (workers < 1) {
+			workers = 1;
 		}
-	}
-
-	// now return it to the caller
-	return error ? 0 : retval;
-}
-
-
-/*
- *	This routine takes a plaintext character and a legend and
- *	returns the cyphertext character. This is used to encode the
- *	plaintext into cyphertext - one character at a time.
- */
-char PlainToCypherChar(legend *map, char c) {
-	BOOL		error = NO;
-	BOOL		upperCase = NO;
-	char		retval = c;
-
-	// make sure we have something to map through
-	if (!error) {
-		if (map == NULL) {
+		run.answers = (char **) calloc(puzzleCount, sizeof(char *));
+		pool = (batchWorker *) calloc(workers, sizeof(batchWorker));
+		if ((run.answers == NULL) || (pool == NULL)) {
 			error = YES;
-			printf("*** Error in PlainToCypherChar() ***\n"
-				   "    The passed-in legend structure was NULL which\n"
-				   "    means that there can be no mapping. This is\n"
-				   "    a serious problem - please look into it.\n");
+			fprintf(stderr, "*** Error in SolveBatch() ***\n"
+							"    The pool of %d workers for the %d puzzles could\n"
+							"    not be created. This is a serious problem.\n", workers, puzzleCount);
+		}
+	}
+	if (!error && (puzzleCount > 0)) {
+		pthread_condattr_t	attr;
+
+		run.puzzles = puzzles;
+		run.puzzleCount = puzzleCount;
+		run.dict = dict;
+		run.cache = cache;
+		run.timeLimit = timeLimit;
+		// ...the deadlines are on the monotonic clock, and so is the wait
+		pthread_mutex_init(&run.lock, NULL);
+		pthread_condattr_init(&attr);
+		pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+		pthread_cond_init(&run.answered, &attr);
+		pthread_condattr_destroy(&attr);
+		runStarted = YES;
+
+		pthread_mutex_lock(&run.lock);
+		for (i = 0; (i < workers) && !error; i++) {
+			pool[i].run = &run;
+			pool[i].puzzle = -1;
+			if (pthread_create(&pool[i].thread, NULL, SolveBatchPuzzles, &pool[i]) != 0) {
+				error = YES;
+				fprintf(stderr, "*** Error in SolveBatch() ***\n"
+								"    Worker #%d could not be started.\n", i);
+			} else {
+				run.running++;
+				started++;
+			}
 		}
+		pthread_mutex_unlock(&run.lock);
 	}
 
-	// now, see if the character can be converted
-	if (!error) {
-		// see if it's upper case
-		if (isupper(retval)) {
-			upperCase = YES;
-			retval = tolower(retval);
-		}
-
-		if (islower(retval)) {
-			// this is a back-search through the map
-			int		i;
+	/*
+	 *	Now write out the answers as they come in - in order - and
+	 *	cancel the solves that run past their deadlines.
+	 */
+	if (runStarted) {
+		int				nextAnswer = 0;
+		long			deadline_ms = ((timeLimit > 0 ? timeLimit : 0) + BATCH_DEADLINE_GRACE) * 1000L;
+		long			elapsed_ms;
+		long			wait_ms;
+		struct timespec	now, wake;
+
+		pthread_mutex_lock(&run.lock);
+		while (!error && !run.error) {
+			// write out all the answers we can
+			while ((nextAnswer < puzzleCount) && (run.answers[nextAnswer] != NULL)) {
+				printf("{\"line\":%d,%s", lineNumbers[nextAnswer], run.answers[nextAnswer] + 1);
+				free(run.answers[nextAnswer]);
+				run.answers[nextAnswer] = NULL;
+				nextAnswer++;
+			}
+			fflush(stdout);
+			if (nextAnswer >= puzzleCount) {
+				break;
+			} else if (run.running == 0) {
+				error = YES;
+				fprintf(stderr, "*** Error in SolveBatch() ***\n"
+								"    The workers are all gone, and the puzzle on line %d\n"
+								"    was never answered.\n", lineNumbers[nextAnswer]);
+				break;
+			}
 
-			for (i = 0; i < 26; i++) {
-				if (map->map[i] == retval) {
-					retval = (i + 'a') + (upperCase ? ('A' - 'a') : 0);
-					break;
+			// ...cancel the solves that have had their time
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			wait_ms = -1;
+			for (i = 0; i < started; i++) {
+				if ((pool[i].puzzle >= 0) && !pool[i].cancel) {
+					elapsed_ms = (now.tv_sec - pool[i].started.tv_sec) * 1000
+								 + (now.tv_nsec - pool[i].started.tv_nsec) / 1000000;
+					if (elapsed_ms >= deadline_ms) {
+						pool[i].cancel = 1;
+					} else if ((wait_ms < 0) || (deadline_ms - elapsed_ms < wait_ms)) {
+						wait_ms = deadline_ms - elapsed_ms;
+					}
 				}
 			}
-		}
-	}
 
-	// now return it to the caller
-	return error ? 0 : retval;
-}
-
-
-/*
- *	This routine takes a cyphertext character string and converts
- *	it to plaintext based on the legend provided. This is useful
- *	for doing a complete decryption on a string based on a given
- *	legend. The returned value is a new character string that
- *	the caller is responsible for freeing - or NULL in case of
- *	an error.
- */
-char *CypherToPlainString(legend *map, char *cyphertext) {
-	BOOL		error = NO;
-	char		*retval = NULL;
-
-	// first, make sure we have something to do
-	if (!error) {
-		if (map == NULL) {
-			error = YES;
-			printf("*** Error in CypherToPlainString() ***\n"
-				   "    The legend structure passed-in to this routine\n"
-				   "    is NULL, and therefore no transformation can\n"
-				   "    take place. This is a serious problem that needs\n"
-				   "    to be looked at.\n");
+			// ...and wait for the next answer, or the next deadline
+			if (wait_ms < 0) {
+				pthread_cond_wait(&run.answered, &run.lock);
+			} else {
+				wake.tv_sec = now.tv_sec + (wait_ms / 1000);
+				wake.tv_nsec = now.tv_nsec + (wait_ms % 1000) * 1000000L;
+				if (wake.tv_nsec >= 1000000000L) {
+					wake.tv_sec++;
+					wake.tv_nsec -= 1000000000L;
+				}
+				pthread_cond_timedwait(&run.answered, &run.lock, &wake);
+			}
 		}
-	}
-	if (!error) {
-		if (cyphertext == NULL) {
+		if (run.error) {
 			error = YES;
-			printf("*** Error in CypherToPlainString() ***\n"
-				   "    The cyphertext string passed-in to this routine\n"
-				   "    is NULL, and therefore no transformation can\n"
-				   "    take place. This is a serious problem that needs\n"
-				   "    to be looked at.\n");
 		}
-	}
 
-	// now, I need to create a new string that's the right size
-	if (!error) {
-		retval = (char *) malloc((strlen(cyphertext)+1) * sizeof(char));
-		if (retval == NULL) {
-			error = YES;
-			printf("*** Error in CypherToPlainString() ***\n"
-				   "    A new string to contain the plaintext could not be\n"
-				   "    allocated. This is a serious error.\n");
+		// ...and if we're stopping early, the rest are dropped
+		run.nextPuzzle = puzzleCount;
+		for (i = 0; i < started; i++) {
+			pool[i].cancel = 1;
 		}
+		pthread_mutex_unlock(&run.lock);
 	}
 
-	// now I can do the right conversion a character at a time
-	if (!error) {
-		int		i;
-		int		len = strlen(cyphertext);
-
-		for (i = 0; i < len; i++) {
-			retval[i] = CypherToPlainChar(map, cyphertext[i]);
-		}
-		retval[len] = '\0';
+	// in the end, release what we've used in this routine
+	for (i = 0; i < started; i++) {
+		pthread_join(pool[i].thread, NULL);
 	}
-
-	// if I had an error, ditch anything I might have allocated
-	if (error) {
-		if (retval != NULL) {
-			free(retval);
-		}
+	if (runStarted) {
+		pthread_cond_destroy(&run.answered);
+		pthread_mutex_destroy(&run.lock);
 	}
-
-	return error ? NULL : retval;
-}
-
-
-/*
- *	This routine takes a plaintext character string and converts
- *	it to cyphertext based on the legend provided. This is useful
- *	for doing a complete encryption on a string based on a given
- *	legend. The returned value is a new character string that
- *	the caller is responsible for freeing - or NULL in case of
- *	an error.
- */
-char *PlainToCypherString(legend *map, char *plaintext) {
-	BOOL		error = NO;
-	char		*retval = NULL;
-
-	// first, make sure we have something to do
-	if (!error) {
-		if (map == NULL) {
-			error = YES;
-			printf("*** Error in PlainToCypherString() ***\n"
-				   "    The legend structure passed-in to this routine\n"
-				   "    is NULL, and therefore no transformation can\n"
-				   "    take place. This is a serious problem that needs\n"
-				   "    to be looked at.\n");
-		}
+	if (pool != NULL) {
+		free(pool);
 	}
-	if (!error) {
-		if (plaintext == NULL) {
-			error = YES;
-			printf("*** Error in PlainToCypherString() ***\n"
-				   "    The plaintext string passed-in to this routine\n"
-				   "    is NULL, and therefore no transformation can\n"
-				   "    take place. This is a serious problem that needs\n"
-				   "    to be looked at.\n");
+	if (run.answers != NULL) {
+		for (i = 0; i < puzzleCount; i++) {
+			if (run.answers[i] != NULL) {
+				free(run.answers[i]);
+			}
 		}
+		free(run.answers);
 	}
-
-	// now, I need to create a new string that's the right size
-	if (!error) {
-		retval = (char *) malloc((strlen(plaintext)+1) * sizeof(char));
-		if (retval == NULL) {
-			error = YES;
-			printf("*** Error in PlainToCypherString() ***\n"
-				   "    A new string to contain the cyphertext could not be\n"
-				   "    allocated. This is a serious error.\n");
+	if (puzzles != NULL) {
+		for (i = 0; i < puzzleCount; i++) {
+			free(puzzles[i]);
 		}
+		free(puzzles);
 	}
-
-	// now I can do the right conversion a character at a time
-	if (!error) {
-		int		i;
-		int		len = strlen(plaintext);
-
-		for (i = 0; i < len; i++) {
-			retval[i] = PlainToCypherChar(map, plaintext[i]);
-		}
-		retval[len] = '\0';
+	if (lineNumbers != NULL) {
+		free(lineNumbers);
 	}
-
-	// if I had an error, ditch anything I might have allocated
-	if (error) {
-		if (retval != NULL) {
-			free(retval);
-		}
+	if (cache != NULL) {
+		cache = CloseQuipCache(cache);
+	}
+	if (dict != NULL) {
+		dict = DestroyDictionary(dict);
 	}
 
-	return error ? NULL : retval;
+	return !error;
 }
 
 
 /*************************************************************************
  *
- *	Cyphertext functions
+ *	Benchmark routines
  *
- *	These functions are used at a high level to manipulate the
- *	individual cypherwords in the system to try and find those
- *	legends that completly and accurately specify the solution
- *	to the problem.
+ *	With '--bench', quip makes the puzzles in the benchmark corpus,
+ *	solves each of them a few times, and reports the fastest, median
+ *	and 99th percentile times along with the search nodes and the
+ *	solutions found. The puzzles and the counts are the same from
+ *	build to build, so two reports can be diffed to see what a change
+ *	did to the times - and that it didn't change the answers.
  *
  ************************************************************************/
 /*
- *	This function takes the name of a text file that has one
- *	word per line and reads in each word and passes it to each
- *	of the known cypherwords in the system.
+ *	This is the qsort() comparison for the solve times of a puzzle
+ *	so that they're in increasing order.
  */
-BOOL ReadAndProcessPlaintextFile(char* filename) {
-	BOOL		error = NO;
-	FILE		*fp = NULL;
-	char		linebuf[2048];
-
-	// first, make sure we have something to do
-	if (!error) {
-		if (filename == NULL) {
-			error = YES;
-			printf("*** Error in ReadAndProcessPlaintextFile() ***\n"
-				   "    The name of the file is NULL, and this means no\n"
-				   "    processing can be done because no file. Try giving\n"
-				   "    this routine a valid filename.\n");
-		}
-	}
+int CompareLatencies(const void *a, const void *b) {
+	long	la = *((long *) a);
+	long	lb = *((long *) b);
 
-	// next, try to open the file for reading
-	if (!error) {
-		fp = fopen(filename, "r");
-		if (fp == NULL) {
-			error = YES;
-			printf("*** Error in ReadAndProcessPlaintextFile() ***\n"
-				   "    The file '%s' could not be opened for reading.\n"
-				   "    This is a serious problem as the file is the basis\n"
-				   "    for the decryption of the cyphertext.\n", filename);
-		}
-	}
-
-	// next, go through all the words in the file and process each
-	if (!error) {
-		int		lpos;
-		int		i;
-
-		while (!error && (fgets(linebuf, 2048, fp) != NULL)) {
-			// skip past anything not a character in the buffer
-			lpos = 0;
-			while (!isalpha(linebuf[lpos]) && (lpos < 2048)) {
-				lpos++;
-			}
-
-			// ...go through the word that is on this line...
-			i = lpos;
-			while ((isalpha(linebuf[i]) || (linebuf[i] == '\'') || (linebuf[i] == '-')) && (i < 2048)) {
-				i++;
-			}
-
-			// ...and NULL terminate it when it's done
-			linebuf[i] = '\0';
-
-			for (i = 0; i < wordCount; i++) {
-				if (!CheckCypherwordForPossiblePlaintext(words[i], &(linebuf[lpos]))) {
-					error = YES;
-					printf("*** Error in ReadAndProcessPlaintextFile() ***\n"
-						   "    While checking the plaintext word '%s' against\n"
-						   "    the cypherwords, an error occurred. Check the logs\n"
-						   "    to see why this might have happened.\n", linebuf);
-				}
-			}
-		}
-	}
-
-	// now we can close the file because we're done
-	if (!error) {
-		if (fp != NULL) {
-			fclose(fp);
-		}
-	}
-
-	return !error;
+	return (la < lb ? -1 : (la > lb ? 1 : 0));
 }
 
 
 /*
- *	This routine takes a plaintext character string and encrypts
- *	it so that it might be used for feeding into programs such
- *	as this. This might be considered a program within a program
- *	but it exists to make testing of the decoding program much
- *	simpler and much faster.
+ *	This routine opens the hardware counters for the benchmark - for
+ *	this process, in user space only - and leaves them stopped. The
+ *	ones that can't be opened have an 'fd' of -1.
  */
-void EncryptPlaintext(char *text, BOOL showLegend, BOOL genCmdLine) {
-	BOOL		error = NO;
-	BOOL		keepGoing = YES;
-	legend		*encryptingLegend = NULL;
-	char		*encrypted = NULL;
+void OpenBenchCounters(benchCounters *counters) {
+	int		i;
 
-	// first, make sure that we have something to do
-	if (!error && keepGoing) {
-		if (text == NULL) {
-			error = YES;
-			printf("*** Error in EncryptPlaintext() ***\n"
-				   "    The plaintext was NULL so there's nothing\n"
-				   "    we can really do. Check this before calling\n"
-				   "    this routine.\n");
-		}
+	counters->opened = 0;
+	snprintf(counters->reason, sizeof(counters->reason), "not supported on this system");
+	for (i = 0; i < BENCH_COUNTERS; i++) {
+		counters->fd[i] = -1;
 	}
 
-	/*
-	 *	Next, we need a 1:1 legend and then we need to
-	 *	scramble it up so that it's an encrypting legend
-	 */
-	if (!error && keepGoing) {
-		encryptingLegend = CreateLegend('a', 'a');
-		if (encryptingLegend == NULL) {
-			error = YES;
-			printf("*** Error in EncryptPlaintext() ***\n"
-				   "    While trying to encrypt the plaintext, the legend\n"
-				   "    could not be created. This is a serious allocation\n"
-				   "    problem that needs to be looked into.\n");
-		}
-	}
+#ifdef __linux__
+	for (i = 0; i < BENCH_COUNTERS; i++) {
+		struct perf_event_attr	attr;
 
-	// now we need to populate the rest of the legend
-	if (!error && keepGoing) {
-		char	c;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		switch (i) {
+			case BENCH_CYCLES :
+				attr.config = PERF_COUNT_HW_CPU_CYCLES;
+				break;
+			case BENCH_INSTRUCTIONS :
+				attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+				break;
+			case BENCH_L1D_MISSES :
+				attr.type = PERF_TYPE_HW_CACHE;
+				attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+							  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+				break;
+			case BENCH_LLC_MISSES :
+				attr.config = PERF_COUNT_HW_CACHE_MISSES;
+				break;
+			case BENCH_BRANCH_MISSES :
+				attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+				break;
+		}
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		// ...if they have to share the hardware, they can be scaled up
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
 
-		for (c = 'b'; c <= 'z'; c++) {
-			encryptingLegend->map[c - 'a'] = c;
+		counters->fd[i] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+		if (counters->fd[i] >= 0) {
+			counters->opened++;
+		} else if (counters->opened == 0) {
+			snprintf(counters->reason, sizeof(counters->reason), "%s", strerror(errno));
 		}
 	}
+#endif
+}
 
-	// now we need to scramble it up quite a bit
-	if (!error && keepGoing) {
-		int		i;
-		int		ia, ib;
-		char	t;
-
-		for (i = 0; i < 500; i++) {
-			ia = rand_r(&randSeed) % 26;
-			ib = (ia + (rand_r(&randSeed) % 26)) % 26;
-
-			t = encryptingLegend->map[ib];
-			encryptingLegend->map[ib] = encryptingLegend->map[ia];
-			encryptingLegend->map[ia] = t;
-		}
 
-		// check the integrity of the legend by checking the scramble
-		for (i = 0; i < 26; i++) {
-			if (encryptingLegend->map[i] == ('a' + i)) {
-				// switch this 'a' = 'a' with someone else
-				ib = (i + (rand_r(&randSeed) % 26)) % 26;
-				if (i == ib) {
-					ib = (i + 1) % 26;
-				}
+/*
+ *	This routine zeroes and starts all the counters that are open.
+ */
+void StartBenchCounters(benchCounters *counters) {
+	int		i;
 
-				t = encryptingLegend->map[ib];
-				encryptingLegend->map[ib] = encryptingLegend->map[i];
-				encryptingLegend->map[i] = t;
-			}
+	for (i = 0; i < BENCH_COUNTERS; i++) {
+		if (counters->fd[i] >= 0) {
+#ifdef __linux__
+			ioctl(counters->fd[i], PERF_EVENT_IOC_RESET, 0);
+			ioctl(counters->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+#endif
 		}
 	}
+}
 
-	// now I need to show it to the user, if he wants to see it
-	if (!error && keepGoing) {
-		if (showLegend) {
-			int		i;
 
-			printf("Generated encryption legend:\n");
-			for (i = 0; i < 26; i++) {
-				printf("   %c = %c\n", ('a' + i), encryptingLegend->map[i]);
+/*
+ *	This routine stops the counters that are open, and adds what
+ *	they counted to 'totals' - scaled up for the time they weren't
+ *	on the hardware, if they had to share it.
+ */
+void ReadBenchCounters(benchCounters *counters, double *totals) {
+	unsigned long long	value[3];
+	int					i;
+
+	for (i = 0; i < BENCH_COUNTERS; i++) {
+		if (counters->fd[i] >= 0) {
+#ifdef __linux__
+			ioctl(counters->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+#endif
+			if ((read(counters->fd[i], value, sizeof(value)) == sizeof(value)) && (value[2] > 0)) {
+				totals[i] += (double) value[0] * ((double) value[1] / (double) value[2]);
 			}
-			printf("\n");
-		}
-	}
-
-	/*
-	 *	Next, let's encrypt this string with the new legend
-	 */
-	if (!error && keepGoing) {
-		encrypted = PlainToCypherString(encryptingLegend, text);
-		if (encrypted == NULL) {
-			error = YES;
-			printf("*** Error in EncryptPlaintext() ***\n"
-				   "    The encrypted string could not be generated from\n"
-				   "    the plaintext and the newly created legend. This\n"
-				   "    is a serious problem.\n");
 		}
 	}
+}
 
-	/*
-	 *	Next, we need to output the encrypted string in the
-	 *	right format based on what the user wants to see.
-	 */
-	if (!error && keepGoing) {
-		int		i;
 
-		// show the user the encrypted string
-		printf("%s%s%s", (genCmdLine ? "quip '" : ""), encrypted, (genCmdLine ? "'" : "\n"));
+/*
+ *	This routine closes all the counters that are open.
+ */
+void CloseBenchCounters(benchCounters *counters) {
+	int		i;
 
-		// now, pick a hint character to give them
-		i = rand_r(&randSeed) % strlen(text);
-		while (!isalpha(text[i])) {
-			i = (i + 1) % strlen(text);
+	for (i = 0; i < BENCH_COUNTERS; i++) {
+		if (counters->fd[i] >= 0) {
+			close(counters->fd[i]);
+			counters->fd[i] = -1;
 		}
-		printf(" %s%c=%c\n", (genCmdLine ? "-k" : ""), PlainToCypherChar(encryptingLegend, text[i]), text[i]);
-	}
-
-	// now we can free the resources we've used in this routine
-	if (encryptingLegend != NULL) {
-		encryptingLegend = DestroyLegend(encryptingLegend);
-	}
-	if (encrypted != NULL) {
-		free(encrypted);
 	}
+	counters->opened = 0;
 }
 
 
 /*
- *	This routine initializes the list of cyberwords by scanning
- *	the provided text and makes all the cyberwords necessary to
- *	model the decryption process.
+ *	This routine prints the counters for one phase of a puzzle - the
+ *	average of the runs - with the instructions per cycle, and the
+ *	misses per search node. A counter that couldn't be opened is a
+ *	'-', as is anything that's worked out from one.
  */
-BOOL CreateCypherwordsFromCyphertext(char *text) {
-	BOOL		error = NO;
+void PrintBenchCounters(benchCounters *counters, char *phase, double *totals, int runs, long nodes) {
+	char		*names[BENCH_COUNTERS] = { "cycles", "instr", "l1d", "llc", "branch" };
 	int			i;
-	char		*word = NULL;
 
-	// first, make sure that I have something to do
-	if (!error) {
-		if (text == NULL) {
-			error = YES;
-			if (htmlOutput) {
-				printf("*** Error in CreateCypherwordsFromCyphertext() ***<BR>\n"
-					   "    The passed-in cyphertext was NULL and so no parsing<BR>\n"
-					   "    could be done. This is probably a programming error.<BR>\n");
-			} else {
-				printf("*** Error in CreateCypherwordsFromCyphertext() ***\n"
-					   "    The passed-in cyphertext was NULL and so no parsing\n"
-					   "    could be done. This is probably a programming error.\n");
-			}
+	printf("       %-6s", phase);
+	for (i = 0; i < BENCH_COUNTERS; i++) {
+		if (counters->fd[i] >= 0) {
+			printf(" %s %.0f", names[i], totals[i] / runs);
 		} else {
-			int		len = strlen(text);
-
-			// make sure it contains nothing but legal characters
-			for (i = 0; i < len; i++) {
-				if (!(isspace(text[i]) || isalpha(text[i]) || ispunct(text[i]))) {
-					error = YES;
-					if (htmlOutput) {
-						printf("*** Error in CreateCypherwordsFromCyphertext() ***<BR>\n"
-							   "    The passed-in cyphertext contains characters other<BR>\n"
-							   "    than A-Z, a-z, spaces and simple punctuation. This<BR>\n"
-							   "    is the only form of the cyphertext that this parser<BR>\n"
-							   "    understands.<BR>\n");
-					} else {
-						printf("*** Error in CreateCypherwordsFromCyphertext() ***\n"
-							   "    The passed-in cyphertext contains characters other\n"
-							   "    than A-Z, a-z, spaces and simple punctuation. This\n"
-							   "    is the only form of the cyphertext that this parser\n"
-							   "    understands.\n");
-					}
-					break;
-				}
-			}
-		}
-	}
-
-	// now I need to reset the list of cypherwords
-	if (!error) {
-		if ((words != NULL) && (wordCount > 0)) {
-			// first, ditch all the individual existing words
-			for (i = 0; i < wordCount; i++) {
-				words[i] = DestroyCypherword(words[i]);
-			}
-
-			// ...now free the array itself
-			free(words);
-			words = NULL;
-
-			// ...and reset the number of words in it
-			wordCount = 0;
-		}
-	}
-
-	// now I need to make a temp word buffer of the maximum size
-	if (!error) {
-		word = (char *) malloc((strlen(text)+1) * sizeof(char));
-		if (word == NULL) {
-			error = YES;
-			if (htmlOutput) {
-				printf("*** Error in CreateCypherwordsFromCyphertext() ***<BR>\n"
-					   "    The temporary word buffer could not be created.<BR>\n"
-					   "    This is serious because this is used in the parsing<BR>\n"
-					   "    of the cyphertext into cypherwords.<BR>\n");
-			} else {
-				printf("*** Error in CreateCypherwordsFromCyphertext() ***\n"
-					   "    The temporary word buffer could not be created.\n"
-					   "    This is serious because this is used in the parsing\n"
-					   "    of the cyphertext into cypherwords.\n");
-			}
+			printf(" %s -", names[i]);
 		}
 	}
-
-	// now I need to count the number of words to know what to do
-	if (!error) {
-		int		len = strlen(text);
-		BOOL	countWord;
-
-		i = 0;
-		while (!error && (i < len)) {
-			// pass up any whitespace and stop at a character
-			while ((isspace(text[i]) || ispunct(text[i])) && (i < len)) {
-				i++;
-			}
-
-			// go through anything not whitespace
-			countWord = NO;
-			while ((isalpha(text[i]) || ispunct(text[i])) && (i < len)) {
-				i++;
-				countWord = YES;
-			}
-
-			// up the count if we actually had a word
-			if (countWord) {
-				wordCount++;
-			}
-		}
-
-		// now see if we had any words at all in the text
-		if (wordCount == 0) {
-			error = YES;
-			if (htmlOutput) {
-				printf("*** Error in CreateCypherwordsFromCyphertext() ***<BR>\n"
-					   "    There were no words found in the cyphertext. This<BR>\n"
-					   "    represents a trivial condition and won't be done.<BR>\n");
-			} else {
-				printf("*** Error in CreateCypherwordsFromCyphertext() ***\n"
-					   "    There were no words found in the cyphertext. This\n"
-					   "    represents a trivial condition and won't be done.\n");
-			}
-		}
+	if ((counters->fd[BENCH_CYCLES] >= 0) && (counters->fd[BENCH_INSTRUCTIONS] >= 0) &&
+		(totals[BENCH_CYCLES] > 0)) {
+		printf("  ipc %.2f", totals[BENCH_INSTRUCTIONS] / totals[BENCH_CYCLES]);
+	} else {
+		printf("  ipc -");
 	}
-
-	// now with the number of words, I can allocate the words array
-	if (!error) {
-		words = (cypherword **) malloc(wordCount * sizeof(cypherword *));
-		if (words == NULL) {
-			error = YES;
-			if (htmlOutput) {
-				printf("*** Error in CreateCypherwordsFromCyphertext() ***<BR>\n"
-					   "    The array of cypherwords could not be allocated.<BR>\n"
-					   "    This is a serious problem because this is used to<BR>\n"
-					   "    hold the cypherwords from the cyphertext.<BR>\n");
+	if (nodes > 0) {
+		for (i = BENCH_L1D_MISSES; i <= BENCH_BRANCH_MISSES; i++) {
+			if (counters->fd[i] >= 0) {
+				printf("  %s/node %.2f", names[i], totals[i] / runs / nodes);
 			} else {
-				printf("*** Error in CreateCypherwordsFromCyphertext() ***\n"
-					   "    The array of cypherwords could not be allocated.\n"
-					   "    This is a serious problem because this is used to\n"
-					   "    hold the cypherwords from the cyphertext.\n");
+				printf("  %s/node -", names[i]);
 			}
 		}
 	}
-
-	// now I can go through the cyphertext again making cypherwords
-	if (!error) {
-		int		len = strlen(text);
-		int		j;
-		int		w = 0;
-
-		i = 0;
-		while (!error && (i < len)) {
-			// pass up any whitespace and stop at a character
-			while ((isspace(text[i]) || ispunct(text[i])) && (i < len)) {
-				i++;
-			}
-
-			// go through anything reasonable and save it
-			j = 0;
-			while ((isalpha(text[i]) || (text[i] == '\'')) && (i < len)) {
-				word[j++] = text[i++];
-			}
-			word[j] = '\0';
-
-			// create a new cypherword if there was a word
-			if (j > 0) {
-				words[w] = CreateCypherword(word);
-				if (words[w] == NULL) {
-					error = YES;
-					if (htmlOutput) {
-						printf("*** Error in CreateCypherwordsFromCyphertext() ***<BR>\n"
-							   "    The cypherword '%s' could not be created properly.<BR>\n"
-							   "    This is a serious problem and we can't go on.<BR>\n", word);
-					} else {
-						printf("*** Error in CreateCypherwordsFromCyphertext() ***\n"
-							   "    The cypherword '%s' could not be created properly.\n"
-							   "    This is a serious problem and we can't go on.\n", word);
-					}
-				} else {
-					w++;
-				}
-			}
-		}
-	}
-
-	// in the end, I have to release whatever I've used in this routine
-	if (word != NULL) {
-		free(word);
-	}
-
-	return !error;
+	printf("\n");
 }
 
 
-/*************************************************************************
- *
- *	Frequency Counting and Histogram Routines
- *
- ************************************************************************/
 /*
- *	This is an interesting little routine to determine the
- *	frequency of each possible matching of plainchar to
- *	cypherchar in the list of cypherwords. It also counts
- *	the frequency of plaintext characters as well as the
- *	frequency of cyphertext characters. This might be
- *	useful in large lists of cypherwords to get some idea
- *	of the possible legend for the solution based on the
- *	relative frequency of characters in matched words.
- *	The return value is a characterFrequencyData structure
- *	that the caller MUST free on it's own.
- *
- *	The purpose of the legend is to say 'calculate the data
- *	but only for the possible words that ALSO match this
- *	legend'. In this way, there can be many different data
- *	sets - one for each possible legend for the solution.
+ *	This routine runs the benchmark - each puzzle in the corpus is
+ *	solved 'runs' times with the default attack, and its line in the
+ *	report has the times in microseconds, the nodes searched and the
+ *	solutions found on the last run, and the puzzle itself. If there
+ *	are hardware counters, that's followed by a line of them for the
+ *	matching, and another for the search.
  */
-characterFrequencyData *GenerateCharacterCountsWithLegend(legend *map) {
-	BOOL					error = NO;
-	characterFrequencyData	*retval = NULL;
-	int						cypherchar, plainchar;
-	int						i, j;
+BOOL RunBenchmark(char *wordsFilename, int runs, int timeLimit) {
+	BOOL			error = NO;
+	dictionary		*dict = NULL;
+	quipContext		*ctx = NULL;
+	long			*latencies = NULL;
+	long			totalMedian_us = 0;
+	int				puzzleCount = 0;
+	benchCounters	counters;
+
+	OpenBenchCounters(&counters);
 
 	// first, make sure we have something to do
 	if (!error) {
-		if (wordCount == 0) {
+		if (runs < 1) {
 			error = YES;
-			printf("*** Error in GenerateCharacterCountsWithLegend() ***\n"
-				   "    There are no cypherwords to process, this means we\n"
-				   "    cannot generate a histogram. Try again with words.\n");
+			fprintf(stderr, "*** Error in RunBenchmark() ***\n"
+							"    Each puzzle has to be run at least once, and %d\n"
+							"    runs was asked for.\n", runs);
 		}
 	}
 
-	// next, we need to make a return structure to hold the info
+	// get the words, a solve context, and room for the times
 	if (!error) {
-		retval = (characterFrequencyData *) malloc(sizeof(characterFrequencyData));
-		if (retval == NULL) {
+		dict = LoadWords((wordsFilename != NULL ? wordsFilename : DEFAULT_WORDS_FILE));
+		if (dict == NULL) {
 			error = YES;
-			printf("*** Error in GenerateCharacterCountsWithLegend() ***\n"
-				   "    The characterFrequencyData structure used to return\n"
-				   "    the information from this routine could not be allocated.\n"
-				   "    This is a serious problem that needs to be addressed.\n");
-		}
-	}
-
-	// next, clear out the bins we'll be using for counting
-	if (!error) {
-		for (i = 0; i < 26; i++) {
-			// these are the total numbers of each type of character
-			retval->plaintext[i] = 0;
-			retval->cyphertext[i] = 0;
-			for (j = 0; j < 26; j++) {
-				// these are the number of 'matches' of each type
-				retval->crossMatch[i][j] = 0;
-			}
+			fprintf(stderr, "*** Error in RunBenchmark() ***\n"
+							"    The file '%s' could not be loaded as a dictionary,\n"
+							"    and there's no way to solve the puzzles without it.\n",
+							(wordsFilename != NULL ? wordsFilename : DEFAULT_WORDS_FILE));
 		}
 	}
-
-	/*
-	 *	Now, for each word in the cypherword list, go through
-	 *	each possible plaintext word and tally up the 'hits'
-	 *	for each of the characters that might be substituted
-	 *	for each cypherchar.
-	 */
 	if (!error) {
-		BOOL		countWord;
-		int			pos;
-		char		ptc;
-
-		// look at each cypherword in the array we have
-		for (i = 0; i < wordCount; i++) {
-			// ...for each word, look at each possible plaintext
-			for (pos = 0; pos < words[i]->numberOfPossibles; pos++) {
-				/*
-				 *	Check to see if the legend works for this
-				 *	cypher/plain pair - but only do so if the
-				 *	legend exists. If not, then assume that all
-				 *	words are to be counted.
-				 */
-				countWord = YES;
-				if (map != NULL) {
-					for (j = 0; j < words[i]->length; j++) {
-						ptc = CypherToPlainChar(map, words[i]->cyphertext[j]);
-						if ((ptc != 0) && (tolower(ptc) != tolower(words[i]->possiblePlaintext[pos][j]))) {
-							// skip this plaintext word because of legend
-							countWord = NO;
-							break;
-						}
-					}
-				}
-
-				// if this word passes the legend, count up the hits
-				if (countWord) {
-					for (j = 0; j < words[i]->length; j++) {
-						if (isalpha(words[i]->cyphertext[j])) {
-							retval->plaintext[(tolower(words[i]->possiblePlaintext[pos][j]) - 'a')]++;
-							retval->cyphertext[(tolower(words[i]->cyphertext[j]) - 'a')]++;
-							retval->crossMatch[(tolower(words[i]->cyphertext[j]) - 'a')][(tolower(words[i]->possiblePlaintext[pos][j]) - 'a')]++;
-						}
-					}
-				}
-			}
-		}
-	}
-
-	// if we had any trouble, release what we've created
-	if (error) {
-		if (retval != NULL) {
-			free(retval);
+		ctx = CreateQuipContext(dict);
+		latencies = (long *) malloc(runs * sizeof(long));
+		if ((ctx == NULL) || (latencies == NULL)) {
+			error = YES;
+			fprintf(stderr, "*** Error in RunBenchmark() ***\n"
+							"    The solve context or the list of %d times could\n"
+							"    not be created. This is a serious allocation error.\n", runs);
+		} else {
+			ctx->threadCount = threadCount;
 		}
 	}
 
-	return error ? NULL : retval;
-}
-
-
-/*
- *	This is a useful little routine that will print out a
- *	nice picture of the cross-character histogram as output
- *	by the routine GenerateCharacterHistogramWithLegend().
- *	Because it's a little bit bigger than 26 lines long, it
- *	won't all fit on a conventional 80x24 screen. But it does
- *	fit in 80 characters wide...
- */
-void PrintCrossMatchData(characterFrequencyData *data) {
-	BOOL		error = NO;
-	int			i, j;
-
-	/*
-	 *	The plaintext is across the top and the cyphertext
-	 *	is alongthe left side...
-	 */
+	// the header says what this is a report of
 	if (!error) {
-		printf("   a  b  c  d  e  f  g  h  i  j  k  l  m  n  o  p  q  r  s  t  u  v  w  x  y  z\n");
-		for (i = 0; i < 26; i++) {
-			printf("%c ", (i + 'a'));
-			for (j = 0; j < 26; j++) {
-				printf("%2d ", data->crossMatch[i][j]);
-			}
-			printf("\n");
+		printf("# quip %d.%d.%d bench: seed %d, %d run%s per puzzle, %d sec limit\n",
+			   QUIP_VERSION_MAJOR, QUIP_VERSION_MINOR, QUIP_VERSION_RELEASE,
+			   BENCH_SEED, runs, (runs == 1 ? "" : "s"), timeLimit);
+		if (counters.opened > 0) {
+			printf("# hardware counters: %d of %d, averaged over the runs for the match and search\n",
+				   counters.opened, BENCH_COUNTERS);
+		} else {
+			printf("# hardware counters: not available - %s\n", counters.reason);
 		}
+		printf("# %-4s %6s %10s %10s %10s %12s %9s  %-8s %s\n", "no", "words",
+			   "min_us", "median_us", "p99_us", "nodes", "solutions", "status", "cyphertext");
 	}
-}
 
+	// now make and run each of the puzzles
+	while (!error && (benchCorpus[puzzleCount] != NULL)) {
+		unsigned int	seed = BENCH_SEED + puzzleCount;
+		char			*cyphertext = NULL;
+		char			hintCypher, hintPlain;
+		BOOL			finished = NO;
+		int				wordCount = 0;
+		long			median_us;
+		double			matchCounts[BENCH_COUNTERS];
+		double			searchCounts[BENCH_COUNTERS];
+		struct timespec	start, matched, searching, end;
+		int				i;
 
-/*************************************************************************
- *
- *	Frequency-Counting Attack Routines
- *
- ************************************************************************/
-/*
- *	These are the quasi-global variables used in the execution
- *	of the frequency attack. They are a pain to pass between
- *	routines, so I'll keep them here as global variables but
- *	defined close to their point of use.
- */
-char	possibleChar[26][26];
-int		possibleCharHitCnt[26][26];
-int		possibleCharCount[26];
+		memset(matchCounts, 0, sizeof(matchCounts));
+		memset(searchCounts, 0, sizeof(searchCounts));
 
-/*
- *	This routine tries to solve the decryption using a modified
- *	search algorithm based on the frequency of matched characters
- *	between the cyphertext and the plaintext. Because this 'machine'
- *	is only capable of solving for plaintext words it knows, the
- *	cross-match frequency data tells me the only character-pairs
- *	I need to be checking for in the legend.
- *
- *	With this reduced search space, the job should be much easier
- *	and faster, since I know what I'm trying has some matches to it.
- *
- *	The purpose of the legend here is to reduce the search space
- *	even further based on the "known" keys provided by the user.
- */
-BOOL DoFrequencyAttack(legend *map, int maxSec) {
-	BOOL					error = NO;
-	characterFrequencyData	*histo = NULL;
-	legend					*myMap = NULL;
-
-	// first, let's get the frequency data
-	if (!error) {
-		histo = GenerateCharacterCountsWithLegend(map);
-		if (histo == NULL) {
-			error = YES;
-			printf("*** Error in DoFrequencyAttack() ***\n"
-				   "    The basis of this attack is that with the frequency data\n"
-				   "    the search space will be drastically reduced. Yet, I can't\n"
-				   "    get that data. Check the logs for the cause of the problem.\n");
-		}
-	}
-
-	// duplicate the passed-in legend so we can fiddle with it
-	if (!error) {
-		myMap = DuplicateLegend(map);
-		if (myMap == NULL) {
+		cyphertext = EncipherPlaintext(benchCorpus[puzzleCount], &seed, NULL, &hintCypher, &hintPlain);
+		if (cyphertext == NULL) {
 			error = YES;
-			printf("*** Error in DoFrequencyAttack() ***\n"
-				   "    The passed-in legend needs to be copied so that I have a\n"
-				   "    legend to work with in trying to solve this problem. As\n"
-				   "    it turns out, that copy operation failed. So I won't have\n"
-				   "    any luck in trying to get the solution through this plan.\n");
 		}
-	}
 
-	/*
-	 *	Next, we need to build from the histographic data, the
-	 *	array of possible plaintext characters for each cyphertext
-	 *	character. When we get this 'list' for each cypherchar,
-	 *	we'll sort them by number of hits to make the most likely
-	 *	plaintext-to-cyphertext matches be the first ones chosen.
-	 *	We'll also be counting how many possibilities there are
-	 *	for each cypherchar so that we can easily loop through all
-	 *	of them and not miss a one.
-	 */
-	if (!error) {
-		int		i, j;
-		int		cc;
-
-		// do this for each cypherchar...
-		for (cc = 0; cc < 26; cc++) {
-			// reset the number of possibles for this character
-			possibleCharCount[cc] = 0;
-
-			// copy over the entire line of histographic data
-			for (i = 0; i < 26; i++) {
-				possibleChar[cc][i] = (i + 'a');
-				possibleCharHitCnt[cc][i] = histo->crossMatch[cc][i];
-				// see if there is a real 'hit'
-				if (possibleCharHitCnt[cc][i] > 0) {
-					possibleCharCount[cc]++;
-				}
+		/*
+		 *	Each run is timed in two parts - the matching and the
+		 *	search - so that the counters can be read in between
+		 *	without adding that to the time.
+		 */
+		for (i = 0; !error && (i < runs); i++) {
+			char	*plaintext = NULL;
+
+			StartBenchCounters(&counters);
+			clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+			ResetQuipContext(ctx);
+			if (!SetCyphertextInContext(ctx, cyphertext) ||
+				!AddKnownSubstitutionToContext(ctx, hintCypher, hintPlain) ||
+				!StartSolve(ctx, timeLimit, NULL)) {
+				error = YES;
 			}
+			clock_gettime(CLOCK_MONOTONIC_RAW, &matched);
+			ReadBenchCounters(&counters, matchCounts);
 
-			// now sort the hits by weight along this cypherchar 'line'
-			if (possibleCharCount[cc] > 0) {
-				char	tempChar;
-				int		tempHits;
-
-				// I know a bubble sort is not the best, but it's easy
-				for (i = 0; i < 26; i++) {
-					for (j = i+1; j < 26; j++) {
-						if (possibleCharHitCnt[cc][i] < possibleCharHitCnt[cc][j]) {
-							tempChar = possibleChar[cc][i];
-							tempHits = possibleCharHitCnt[cc][i];
-
-							possibleChar[cc][i] = possibleChar[cc][j];
-							possibleCharHitCnt[cc][i] = possibleCharHitCnt[cc][j];
-
-							possibleChar[cc][j] = tempChar;
-							possibleCharHitCnt[cc][j] = tempHits;
-						}
-					}
+			StartBenchCounters(&counters);
+			clock_gettime(CLOCK_MONOTONIC_RAW, &searching);
+			do {
+				if (!error && !SolveNext(ctx, &plaintext, &finished)) {
+					error = YES;
+				} else if ((plaintext != NULL) && !ReportSolution(ctx, plaintext)) {
+					error = YES;
 				}
+			} while (!error && (plaintext != NULL));
+			clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+			ReadBenchCounters(&counters, searchCounts);
+
+			if (error) {
+				fprintf(stderr, "*** Error in RunBenchmark() ***\n"
+								"    The benchmark puzzle '%s' could not be solved.\n"
+								"    See the solver's messages for why.\n", cyphertext);
 			}
+			latencies[i] = (matched.tv_sec - start.tv_sec) * 1000000
+							+ (matched.tv_nsec - start.tv_nsec) / 1000
+							+ (end.tv_sec - searching.tv_sec) * 1000000
+							+ (end.tv_nsec - searching.tv_nsec) / 1000;
 		}
-	}
-
-	if (!error) {
-		int		i, j;
 
-		puts("frequency attack:");
-		for (i = 0; i < 26; i++) {
-			if (possibleCharCount[i] > 0) {
-				printf("%c : ", (i + 'a'));
-				for (j = 0; j < possibleCharCount[i]; j++) {
-					printf("%c", possibleChar[i][j]);
+		// ...and report on it
+		if (!error) {
+			qsort(latencies, runs, sizeof(long), CompareLatencies);
+			median_us = (latencies[(runs - 1) / 2] + latencies[runs / 2]) / 2;
+			totalMedian_us += median_us;
+			for (i = 0; benchCorpus[puzzleCount][i] != '\0'; i++) {
+				if (!isspace(benchCorpus[puzzleCount][i]) &&
+					((i == 0) || isspace(benchCorpus[puzzleCount][i - 1]))) {
+					wordCount++;
 				}
-				printf("\n");
 			}
+			printf("  %-4d %6d %10ld %10ld %10ld %12ld %9d  %-8s %s -k%c=%c\n",
+				   (puzzleCount + 1), wordCount, latencies[0], median_us,
+				   latencies[(99 * runs + 99) / 100 - 1], ctx->searchNodes, ctx->plainTextCnt,
+				   (!finished ? "timeout" : (ctx->plainTextCnt > 0 ? "solved" : "unsolved")),
+				   cyphertext, hintCypher, hintPlain);
+			if (counters.opened > 0) {
+				PrintBenchCounters(&counters, "match", matchCounts, runs, 0);
+				PrintBenchCounters(&counters, "search", searchCounts, runs, ctx->searchNodes);
+			}
+			fflush(stdout);
 		}
+
+		if (cyphertext != NULL) {
+			free(cyphertext);
+		}
+		puzzleCount++;
 	}
 
-	/*
-	 *	At this point, I have a list of possible plaintext
-	 *	characters for each cyphertext character - organized
-	 *	from highest probability of a match to lowest. I also
-	 *	have the corresponding number of possible matches
-	 *	by cypherchar so that doing a search over this space
-	 *	is both efficient and complete.
-	 *
-	 *	By calling BuildFreqAttackLegend() we're using
-	 *	recursion to scan the complete decoding space and
-	 *	call the necessary break-out routines to test a
-	 *	possible legend when the time is right.
-	 */
+	// ...and finish with the sum of the medians as the one number
 	if (!error) {
-		BuildFreqAttackLegend(0, myMap);
+		printf("# %d puzzles, total median_us %ld\n", puzzleCount, totalMedian_us);
 	}
 
-	// in the end, we need to free our unnecessary resources
-	if (histo != NULL) {
-		free(histo);
+	// clean up what we've used
+	CloseBenchCounters(&counters);
+	if (ctx != NULL) {
+		ctx = DestroyQuipContext(ctx);
+	}
+	if (latencies != NULL) {
+		free(latencies);
+	}
+	if (dict != NULL) {
+		dict = DestroyDictionary(dict);
 	}
 
 	return !error;
 }
 
 
-/*
- *	This routine is complex to follow, but it's worth it.
- *	The goal of the frequency attack is to reduce the number
- *	of possible legends to try by first determining what the
- *	possible make-up of all legends must be. The main attack
- *	routine already did this. Now it's up to me to try each
- *	of these different possibilities as a solution. To do
- *	this is interesting... we need to use recursion in the
- *	middle of the 'for' loop because I want to scan 'down'
- *	the list of cyphertext characters before I move to the
- *	next possible value of any given cyphertext character.
+/*************************************************************************
  *
- *	There's also the possibility that there are no known
- *	possible values for a cyphertext character. This could
- *	easily happen because a certain letter is not used in
- *	a particular cyphertext. In this case, we have to act
- *	as though everything is fine and continue on processing.
- */
-void BuildFreqAttackLegend(int cyphercharIndex, legend *map) {
-	// first, see if the cypherchar doesn't have any possibilities
-	if (possibleCharCount[cyphercharIndex] == 0) {
-		// is it the 'z'?
-		if (cyphercharIndex == 25) {
-			// yep, so we need to see if this legend is 'good'
-			TestFreqAttackLegend(map);
-		} else {
-			// nope, go get the next cypherchar to add to the legend
-			BuildFreqAttackLegend((cyphercharIndex + 1), map);
-		}
-	} else {
-		int		i, j;
-		BOOL	skip;
-
-		// OK... we have some to try
-		for (i = 0; i < possibleCharCount[cyphercharIndex]; i++) {
-			/*
-			 *	If we're past the sypher 'a', then make sure that
-			 *	the character we want to substitute isn't already
-			 *	in the legend. If it is, then skip the character
-			 *	because we KNOW that the mapping is 1:1 and non-
-			 *	repeating.
-			 */
-			if (cyphercharIndex > 0) {
-				skip = NO;
-				for (j = (cyphercharIndex - 1); (j >= 0) && !skip; j--) {
-					if (map->map[j] == possibleChar[cyphercharIndex][i]) {
-						skip = YES;
-					}
-				}
-			}
-
-			/*
-			 *	If we aren't supposed to skip this one due to
-			 *	duplicates in the legend, then carry on and do it.
-			 */
-			if (!skip) {
-				// try the next one in the list
-				map->map[cyphercharIndex] = possibleChar[cyphercharIndex][i];
-				// are we at the 'z'?
-				if (cyphercharIndex == 25) {
-					// yep, so we need to see if this legend is 'good'
-					TestFreqAttackLegend(map);
-				} else {
-					// nope, go get the next cypherchar to add to the legend
-					BuildFreqAttackLegend((cyphercharIndex + 1), map);
-				}
-			}
-		}
-	}
-}
-
-
+ *	Puzzle generating routines
+ *
+ *	With '--generate', quip makes as many puzzles as asked for out of
+ *	a file of sentences - or the benchmark corpus - for load and soak
+ *	testing. Each is written as a '--batch' request, with its answer
+ *	and legend in the comment after it, and the same seed always makes
+ *	the same puzzles, no matter how many threads are making them.
+ *
+ ************************************************************************/
 /*
- *	This routine takes a single completed legend from the
- *	frequency attack plan and tests it against all the
- *	cypherwords to see if it decrypts each. If so, it
- *	prints out the answer. If not, then we'll figure out
- *	if it gets close, and what to do about that later.
+ *	This routine reads the sentences in the file 'filename' - or
+ *	stdin if it's "-" - one to a line, skipping the blank and comment
+ *	lines, just like a batch file. Each has to have a letter in it,
+ *	and can't have both kinds of quotes, as then it can't be quoted
+ *	in a request. The list and the sentences in it are the caller's
+ *	to free.
  */
-void TestFreqAttackLegend(legend *map) {
+char **LoadSentences(char *filename, int *count) {
 	BOOL		error = NO;
-	BOOL		missed = NO;
-	int			hits = 0;
+	FILE		*fp = NULL;
+	char		**retval = NULL;
+	int			size = 0;
 
 	// first, make sure we have something to do
 	if (!error) {
-		if (map == NULL) {
+		if ((filename == NULL) || (count == NULL)) {
 			error = YES;
-			printf("*** Error in TestFreqAttackLegend() ***\n"
-				   "    The legend to test was NULL, and this simply\n"
-				   "    can't happen. Please verify that the legend\n"
-				   "    is non-NULL before calling this routine.\n");
-		}
-	}
-
-	// now check each cypherword for a miss
-	if (!error) {
-		int		i;
-
-		for (i = 0; i < wordCount; i++) {
-			if (IsCypherwordDecryptedByLegend(words[i], map)) {
-				// yeah! add another hit to the total
-				hits++;
-			} else {
-				// darn! it's a miss on this word!
-				missed = YES;
+			fprintf(stderr, "*** Error in LoadSentences() ***\n"
+							"    The name of the file of sentences, or where to put\n"
+							"    the count of them, is NULL. This is a bad call.\n");
+		} else if (strcmp(filename, "-") == 0) {
+			*count = 0;
+			fp = stdin;
+		} else {
+			*count = 0;
+			fp = fopen(filename, "r");
+			if (fp == NULL) {
+				error = YES;
+				fprintf(stderr, "*** Error in LoadSentences() ***\n"
+								"    The file of sentences '%s' could not be opened: %s\n",
+								filename, strerror(errno));
 			}
 		}
 	}
 
-	// see if we have a 100% winner
+	// read in each of the sentences
 	if (!error) {
-		if ((hits > 0) || (!missed)) {
-			char	*decoded = NULL;
-
-			decoded = CypherToPlainString(map, initialCyphertext);
-			if (decoded == NULL) {
+		char		*line = NULL;
+		size_t		lineSize = 0;
+		int			lineNumber = 0;
+		char		*start;
+		char		*end;
+
+		while (!error && (getline(&line, &lineSize, fp) >= 0)) {
+			lineNumber++;
+			for (start = line; isspace(*start); start++) {
+				// skip the leading whitespace
+			}
+			if ((*start == '\0') || (*start == '#')) {
+				continue;
+			}
+			for (end = start + strlen(start); (end > start) && isspace(end[-1]); end--) {
+				// ...and drop the trailing whitespace
+			}
+			*end = '\0';
+			for (end = start; (*end != '\0') && !isalpha(*end); end++) {
+				// ...and make sure there's a letter
+			}
+			if ((*end == '\0') || ((strchr(start, '\'') != NULL) && (strchr(start, '"') != NULL))) {
 				error = YES;
-				printf("*** Error in TestFreqAttackLegend() ***\n"
-					   "    We obtained a perfect decrypting legend for the\n"
-					   "    cyphertext, but were unable to decrypt it to show\n"
-					   "    it to you. This is a real shame because it worked.\n");
-			} else {
-				int		j;
-				BOOL	newPlainText = YES;
-
-				// see if it matches any of the answers we have
-				for (j = 0; (j < plainTextCnt) && newPlainText; j++) {
-					if (strcmp(decoded, plainText[j]) == 0) {
-						newPlainText = NO;
-					}
-				}
-
-				// if it's a new answer then save it and write it out
-				if (newPlainText) {
-					// see if there's enough room in the list
-					if (plainTextCnt == plainTextMaxCnt) {
-						/*
-						 *	OK... we need to expand the array the right
-						 *	amount.
-						 */
-						if (plainTextMaxCnt == 0) {
-							plainText = (char **) malloc(STARTING_POSSIBLES_SIZE * sizeof(char *));
-						} else {
-							plainText = (char **) realloc(plainText, (plainTextMaxCnt + INCREMENT_POSSIBLES_SIZE)*sizeof(char *));
-						}
-						if (plainText == NULL) {
-							error = YES;
-							printf("*** Error in TestFreqAttackLegend() ***\n"
-								   "    While trying to add the plaintext answer '%s' to the\n"
-								   "    array of valid decodings for this cyphertext,\n"
-								   "	the array needed to be expanded to hold %d decodings, but\n"
-								   "    couldn't. This is a real big problem!\n", decoded,
-								   (plainTextMaxCnt == 0 ? STARTING_POSSIBLES_SIZE : (plainTextMaxCnt + INCREMENT_POSSIBLES_SIZE)) );
-
-							// if it's gone, we need to update the sizes
-							plainTextCnt = 0;
-							plainTextMaxCnt = 0;
-						} else {
-							/*
-							 *	OK! it worked, so let's reflect the size
-							 *	change
-							 */
-							plainTextMaxCnt += INCREMENT_POSSIBLES_SIZE;
-						}
-					}
-
-					// save it for the caller to print out
-					if (!error) {
-						plainText[plainTextCnt++] = decoded;
-						if (missed) {
-							printf("[%d/%d]: '%s'\n", hits, wordCount, decoded);
-						}
-					}
+				fprintf(stderr, "*** Error in LoadSentences() ***\n"
+								"    The sentence on line %d has no letters, or both\n"
+								"    kinds of quotes, so it can't be made into a puzzle.\n", lineNumber);
+				break;
+			}
+			if (*count == size) {
+				size = (size == 0 ? 64 : 2 * size);
+				retval = (char **) realloc(retval, size * sizeof(char *));
+				if (retval == NULL) {
+					error = YES;
+					fprintf(stderr, "*** Error in LoadSentences() ***\n"
+									"    The list of %d sentences could not be grown.\n"
+									"    This is a serious problem.\n", size);
+					break;
 				}
 			}
+			retval[*count] = strdup(start);
+			if (retval[*count] == NULL) {
+				error = YES;
+				fprintf(stderr, "*** Error in LoadSentences() ***\n"
+								"    The sentence on line %d could not be copied.\n", lineNumber);
+				break;
+			}
+			(*count)++;
+		}
+		if (line != NULL) {
+			free(line);
 		}
 	}
-}
-
+	if (!error && (*count == 0)) {
+		error = YES;
+		fprintf(stderr, "*** Error in LoadSentences() ***\n"
+						"    There are no sentences in '%s' to make puzzles of.\n", filename);
+	}
 
-/*************************************************************************
- *
- *	Word Block Attack Routines
- *
- ************************************************************************/
-/*
- *	This is the general routine for carrying out the word block
- *	attack on the cyphertext. The idea is that we start with a
- *	user-supplied legend, and then for each plaintext word in the
- *	first cypherword that matches the legend, we add those keys
- *	not in the legend, but supplied by the plaintext to the legend
- *	and then try the next cypherword in the same manner.
- *
- *	There will be quite a few 'passes' in this attack plan, but
- *	hopefully not nearly as many as a character-based scheme.
- */
-BOOL DoWordBlockAttack(int cypherwordIndex, legend *map, int maxSec) {
-	BOOL		error = NO;
-	int			startTime = time(NULL);
+	// clean up - and on an error, it's all thrown away
+	if ((fp != NULL) && (fp != stdin)) {
+		fclose(fp);
+	}
+	if (error && (retval != NULL)) {
+		int		i;
 
-	// first, see if we really have any time to do this
-	if (!error) {
-		if (maxSec <= 0) {
-			error = YES;
-			printf("*** Error in DoWordBlockAttack() ***\n"
-					"    The passed-in maximum time allotment is 0 which\n"
-					"    means that there's no time to do anything. This is\n"
-					"    too bad, but unaviodable in some cases.\n");
+		for (i = 0; i < *count; i++) {
+			free(retval[i]);
 		}
+		free(retval);
+		retval = NULL;
 	}
 
-	// now do the meat of the word attack loop
-	if (!error) {
-		int			i;
-
-		// search over all possibles for this cypherword
-		for (i = 0; (i < words[cypherwordIndex]->numberOfPossibles) && !error; i++) {
-			// does this map fit - allowing for missing gaps?
-			if (CanCypherAndLegendMakePlain(words[cypherwordIndex]->cyphertext, map, words[cypherwordIndex]->possiblePlaintext[i], NO)) {
-				// good! Now let's see if we are done with  all words
-				if (cypherwordIndex == (wordCount - 1)) {
-					// make sure we can really match the last word
-					if (IncorporateCypherToPlainMapInLegend(words[cypherwordIndex]->cyphertext, words[cypherwordIndex]->possiblePlaintext[i], map)) {
-						// yeah! we have a successful decoding
-						char	*decoded = NULL;
-
-						// ...and use this complete legend to decode the text
-						decoded = CypherToPlainString(map, initialCyphertext);
-						if (decoded == NULL) {
-							error = YES;
-							printf("*** Error in DoWordBlockAttack() ***\n"
-								   "    We obtained a perfect decrypting legend for the\n"
-								   "    cyphertext, but were unable to decrypt it to show\n"
-								   "    it to you. This is a real shame because it worked.\n");
-						} else {
-							int		j;
-							BOOL	newPlainText = YES;
-
-							// see if it matches any of the answers we have
-							for (j = 0; (j < plainTextCnt) && newPlainText; j++) {
-								if (strcmp(decoded, plainText[j]) == 0) {
-									newPlainText = NO;
-								}
-							}
-
-							// if it's a new answer then save it and write it out
-							if (newPlainText) {
-								// see if there's enough room in the list
-								if (plainTextCnt == plainTextMaxCnt) {
-									/*
-									 *	OK... we need to expand the array the right
-									 *	amount.
-									 */
-									if (plainTextMaxCnt == 0) {
-										plainText = (char **) malloc(STARTING_POSSIBLES_SIZE * sizeof(char *));
-									} else {
-										plainText = (char **) realloc(plainText, (plainTextMaxCnt + INCREMENT_POSSIBLES_SIZE)*sizeof(char *));
-									}
-									if (plainText == NULL) {
-										error = YES;
-										printf("*** Error in DoWordBlockAttack() ***\n"
-											   "    While trying to add the plaintext answer '%s' to the\n"
-											   "    array of valid decodings for this cyphertext,\n"
-											   "	the array needed to be expanded to hold %d decodings, but\n"
-											   "    couldn't. This is a real big problem!\n", decoded,
-											   (plainTextMaxCnt == 0 ? STARTING_POSSIBLES_SIZE : (plainTextMaxCnt + INCREMENT_POSSIBLES_SIZE)) );
-
-										// if it's gone, we need to update the sizes
-										plainTextCnt = 0;
-										plainTextMaxCnt = 0;
-									} else {
-										/*
-										 *	OK! it worked, so let's reflect the size
-										 *	change
-										 */
-										plainTextMaxCnt += INCREMENT_POSSIBLES_SIZE;
-									}
-								}
-
-								// save it for the caller to print out
-								if (!error) {
-									plainText[plainTextCnt++] = decoded;
-								}
-							}
-						}
-					}
-				} else {
-					/*
-					 *	OK, we had a match but we have more cypherwords
-					 *	to check. So, copy the legend, add in the assumed
-					 *	values from the plaintext, and move to the next
-					 *	word.
-					 *
-					 *	BUT FIRST, we need to check the run-time. If we're
-					 *	past the alloted time given to us then we need to
-					 *	bail out - regardless of the state of the
-					 *	decryption.
-					 */
-					int			remainingSec = -1;
-					legend		*nextGenMap = NULL;
-
-					/*
-					 *	First, check the runtime... Get the remaining time
-					 *	for later, if it's applicable.
-					 */
-					remainingSec = maxSec - (time(NULL) - startTime);
-					if (remainingSec <= 0) {
-						// no time left - gotta bail out now
-						error = YES;
-						printf("*** Error in DoWordBlockAttack() ***\n"
-								"    We simply ran out of time while trying to solve the\n"
-								"    problem. This could be because of too small a word\n"
-								"    set or too many possibilities in the words themselves.\n");
-						break;
-					}
+	return retval;
+}
 
-					/*
-					 *	Now we can set things up to check the next word
-					 */
-					nextGenMap = DuplicateLegend(map);
-					if (nextGenMap == NULL) {
-						error = YES;
-						printf("*** Error in DoWordBlockAttack() ***\n"
-							   "    The legend passed for cypherword #%d, so we need\n"
-							   "    to make a copy to move to the next word. This copy\n"
-							   "    could not be made. Please check the logs as to\n"
-							   "    why.\n", cypherwordIndex);
-						break;
-					} else {
-						// now we need to augment it from the plaintext
-						if (IncorporateCypherToPlainMapInLegend(words[cypherwordIndex]->cyphertext, words[cypherwordIndex]->possiblePlaintext[i], nextGenMap)) {
-							// ...and use this new legend for the next word
-							DoWordBlockAttack((cypherwordIndex + 1), nextGenMap, remainingSec);
-						}
 
-						// ...and don't forget to clean up our messes
-						free(nextGenMap);
-					}
-				}
-			}
+/*
+ *	This routine makes puzzle number 'puzzle' - picking one of the
+ *	sentences and enciphering it, both with the puzzle's own seed -
+ *	and returns its line for the file: the cyphertext and hint as a
+ *	request, with the number, plaintext and legend in the comment.
+ *	The legend is the cypher letter for each of 'a' to 'z'. The line
+ *	needs to be freed by the caller.
+ */
+char *CreatePuzzleLine(char **sentences, int sentenceCount, unsigned int seed, long puzzle) {
+	char			*retval = NULL;
+	unsigned int	puzzleSeed;
+	char			*sentence;
+	char			*cyphertext = NULL;
+	legend			*encryptingLegend = NULL;
+	char			hintCypher, hintPlain;
+	char			key[27];
+	char			quote;
+	size_t			size;
+	int				i;
+
+	// every puzzle gets its own seed - stirred up a bit to start
+	puzzleSeed = seed ^ ((unsigned int) puzzle * 2654435761U);
+	rand_r(&puzzleSeed);
+	rand_r(&puzzleSeed);
+
+	sentence = sentences[rand_r(&puzzleSeed) % sentenceCount];
+	cyphertext = EncipherPlaintext(sentence, &puzzleSeed, &encryptingLegend, &hintCypher, &hintPlain);
+	if (cyphertext != NULL) {
+		for (i = 0; i < 26; i++) {
+			key[i] = encryptingLegend->map[i];
+		}
+		key[26] = '\0';
+		quote = (strchr(sentence, '\'') == NULL ? '\'' : '"');
 
-			/*
-			 *	At the end of each loop we really need to see if the amount
-			 *	of time we've been given by the caller has elapsed. If it
-			 *	has, then we need to quit regardless of what we've found.
-			 */
-			if ((time(NULL) - startTime) >= maxSec) {
-				error = YES;
-				printf("*** Error in DoWordBlockAttack() ***\n"
-						"    We ran out of time while trying the next word in the\n"
-						"    attack. This is too bad, but could be because of too\n"
-						"    many words to check.\n");
-			}
+		size = 2 * strlen(sentence) + 96;
+		retval = (char *) malloc(size);
+		if (retval != NULL) {
+			snprintf(retval, size, "%c%s%c -k%c=%c\t# %ld %c%s%c %s",
+					 quote, cyphertext, quote, hintCypher, hintPlain,
+					 (puzzle + 1), quote, sentence, quote, key);
 		}
 	}
 
-	return !error;
+	if (cyphertext != NULL) {
+		free(cyphertext);
+	}
+	if (encryptingLegend != NULL) {
+		encryptingLegend = DestroyLegend(encryptingLegend);
+	}
+
+	return retval;
 }
 
 
 /*
- *	This method sees if we can add the cyphertext-to-plaintext
- *	mapping represented by the two words, into the existing legend
- *	without violating the existing legend, or creating illegal
- *	legend conditions such as different cypherchars going to the
- *	same plainchar, etc.
+ *	This is the thread routine for making the puzzles - it makes
+ *	the lines for its part of the chunk.
  */
-BOOL IncorporateCypherToPlainMapInLegend(char *cyphertext, char *plaintext, legend *map) {
-	BOOL		error = NO;
+void *GeneratePuzzles(void *arg) {
+	puzzleGenerator	*gen = (puzzleGenerator *) arg;
+	int				i;
 
-	// first, make sure we have something to do
-	if (!error) {
-		if (cyphertext == NULL) {
-			error = YES;
-			printf("*** Error in IncorporateCypherToPlainMapInLegend() ***\n"
-				   "    The passed-in cyphertext was NULL which means that\n"
-				   "    there's really nothing to do. Please make sure the\n"
-				   "	arguments are non-NULL before calling this routine.\n");
-		}
-	}
-	if (!error) {
-		if (plaintext == NULL) {
-			error = YES;
-			printf("*** Error in IncorporateCypherToPlainMapInLegend() ***\n"
-				   "    The passed-in plaintext was NULL which means that\n"
-				   "    there's really nothing to do. Please make sure the\n"
-				   "	arguments are non-NULL before calling this routine.\n");
+	for (i = 0; (i < gen->count) && !gen->error; i++) {
+		gen->lines[i] = CreatePuzzleLine(gen->sentences, gen->sentenceCount, gen->seed, gen->first + i);
+		if (gen->lines[i] == NULL) {
+			gen->error = YES;
 		}
 	}
+
+	return NULL;
+}
+
+
+/*
+ *	This routine writes 'count' puzzles to stdout, made from the
+ *	sentences in 'corpusFilename' - or the benchmark corpus if it's
+ *	NULL - with 'seed'. They're made a chunk at a time, with each of
+ *	the 'workers' threads making its share of the chunk, and then
+ *	written out in order.
+ */
+BOOL GeneratePuzzleFile(char *corpusFilename, long count, unsigned int seed, int workers) {
+	BOOL			error = NO;
+	char			**sentences = NULL;
+	int				sentenceCount = 0;
+	char			**lines = NULL;
+	puzzleGenerator	*pool = NULL;
+	long			done = 0;
+	int				i;
+
+	// first, get the sentences to make the puzzles from
 	if (!error) {
-		if (map == NULL) {
-			error = YES;
-			printf("*** Error in IncorporateCypherToPlainMapInLegend() ***\n"
-				   "    The passed-in legend was NULL which means that\n"
-				   "    there's really nothing to do. Please make sure the\n"
-				   "	arguments are non-NULL before calling this routine.\n");
+		if (corpusFilename != NULL) {
+			sentences = LoadSentences(corpusFilename, &sentenceCount);
+			if (sentences == NULL) {
+				error = YES;
+			}
+		} else {
+			sentences = benchCorpus;
+			while (sentences[sentenceCount] != NULL) {
+				sentenceCount++;
+			}
 		}
 	}
 
-	// make sure that the lengths are the same
+	// ...and room for a chunk of lines and the threads making them
 	if (!error) {
-		if (strlen(cyphertext) != strlen(plaintext)) {
+		if (workers < 1) {
+			workers = 1;
+		}
+		lines = (char **) calloc(GENERATE_CHUNK_SIZE, sizeof(char *));
+		pool = (puzzleGenerator *) calloc(workers, sizeof(puzzleGenerator));
+		if ((lines == NULL) || (pool == NULL)) {
 			error = YES;
-			printf("*** Error in IncorporateCypherToPlainMapInLegend() ***\n"
-				   "    The length of the cyphertext was %lu and the length of\n"
-				   "    the plaintext was %lu. This means we can't match up the\n"
-				   "    characters because they are of different lengths.\n",
-				   strlen(cyphertext), strlen(plaintext));
+			fprintf(stderr, "*** Error in GeneratePuzzleFile() ***\n"
+							"    The room for a chunk of %d puzzles and %d threads\n"
+							"    could not be created. This is a serious allocation\n"
+							"    error.\n", GENERATE_CHUNK_SIZE, workers);
 		}
 	}
 
-	/*
-	 *	OK... now we need to process each character in the cyphertext
-	 *	to see if it's already assigned in the legend, etc.
-	 */
+	// the header says how to make them again
 	if (!error) {
-		int		i, j;
-		int		len = strlen(cyphertext);
-		char	cc, pc;
-
-		for (i = 0; (i < len) && !error; i++) {
-			// first, get the plaintext and cyphertext characters
-			cc = tolower(cyphertext[i]);
-			pc = tolower(plaintext[i]);
-
-			/*
-			 *	Next, check for punctuation - if there's a mismatch
-			 *	it's no-go... if it's a match, then just skip it.
-			 */
-			// check for misplaced punctuation
-			if ((ispunct(cc) && !ispunct(pc)) || (!ispunct(cc) && ispunct(pc))) {
-				// one is punctuation, the other isn't - so no good
+		printf("# quip %d.%d.%d puzzles: seed %u, %ld puzzles from %d sentences\n",
+			   QUIP_VERSION_MAJOR, QUIP_VERSION_MINOR, QUIP_VERSION_RELEASE,
+			   seed, count, sentenceCount);
+	}
+
+	// now make them a chunk at a time
+	while (!error && (done < count)) {
+		int		chunk = (count - done < GENERATE_CHUNK_SIZE ? (int) (count - done) : GENERATE_CHUNK_SIZE);
+		int		share = (chunk + workers - 1) / workers;
+		int		started = 0;
+
+		for (i = 0; (i < workers) && (i * share < chunk); i++) {
+			pool[i].sentences = sentences;
+			pool[i].sentenceCount = sentenceCount;
+			pool[i].seed = seed;
+			pool[i].first = done + i * share;
+			pool[i].count = ((i + 1) * share <= chunk ? share : chunk - i * share);
+			pool[i].lines = &lines[i * share];
+			pool[i].error = NO;
+			if (pthread_create(&pool[i].thread, NULL, GeneratePuzzles, &pool[i]) != 0) {
 				error = YES;
+				fprintf(stderr, "*** Error in GeneratePuzzleFile() ***\n"
+								"    The thread for making puzzles %ld on could not be\n"
+								"    started. This is a serious problem.\n", pool[i].first);
 				break;
 			}
-			// check to see if these are both punctuation
-			if (ispunct(cc) && ispunct(pc)) {
-				continue;
+			started++;
+		}
+		for (i = 0; i < started; i++) {
+			pthread_join(pool[i].thread, NULL);
+			if (pool[i].error) {
+				error = YES;
 			}
+		}
 
-			// next, see if either side of the mapping already exists
-			if (map->map[cc - 'a'] != 0) {
-				// OK... is it a match to the existing plaintext?
-				if (map->map[cc - 'a'] != pc) {
-					// nope... sorry, this is bad news...
-					error = YES;
-				}
-			} else {
-				// OK, see if the plaintext char is already mapped
-				for (j = 0; (j < 26) && !error; j++) {
-					if (map->map[j] == pc) {
-						// plaintext is already assigned to another cypherchar
-						error = YES;
-					}
-				}
+		// ...and write them out, in order
+		for (i = 0; i < chunk; i++) {
+			if (!error && (lines[i] != NULL)) {
+				puts(lines[i]);
 			}
-
-			// OK... new, valid, mapping data. Let's save it.
-			if (!error) {
-				map->map[cc - 'a'] = pc;
+			if (lines[i] != NULL) {
+				free(lines[i]);
+				lines[i] = NULL;
 			}
 		}
+		if (!error && ferror(stdout)) {
+			error = YES;
+			fprintf(stderr, "*** Error in GeneratePuzzleFile() ***\n"
+					"    The puzzles could not be written out: %s\n", strerror(errno));
+		}
+		done += chunk;
+	}
+	fflush(stdout);
+
+	// clean up what we've used
+	if (lines != NULL) {
+		free(lines);
+	}
+	if (pool != NULL) {
+		free(pool);
+	}
+	if ((sentences != NULL) && (sentences != benchCorpus)) {
+		for (i = 0; i < sentenceCount; i++) {
+			free(sentences[i]);
+		}
+		free(sentences);
 	}
 
 	return !error;
@@ -2310,6 +2088,19 @@ BOOL IncorporateCypherToPlainMapInLegend(char *cyphertext, char *plaintext, lege
  *	General User interface routines
  *
  ************************************************************************/
+/*
+ *	This routine loads the words file 'wordsFilename' for solving -
+ *	or, with '--image', maps in the dictionary image of it, making
+ *	the image first if it's not there or is out of date.
+ */
+dictionary *LoadWords(char *wordsFilename) {
+	if (imageFilename != NULL) {
+		return AttachDictionaryImage(imageFilename, wordsFilename, threadCount);
+	}
+	return LoadDictionary(wordsFilename, threadCount);
+}
+
+
 /*
  *	This routine simply let's the user know what this program
  *	takes and what it returns. Nothing special here.
@@ -2319,91 +2110,455 @@ void showUsage() {
 	puts("  by Robert E. Beaty and James H. Alred");
 	puts("");
 	puts("Usage: (to create a quip)");
-	puts("      quip -e plaintext [-c] [-h]");
+	puts("      quip -e plaintext [-c] [--seed n] [-h]");
 	puts("where:");
 	puts("      -e - indicates to encode the plaintext");
 	puts("      plaintext - is the (quoted) plain text to encode");
 	puts("      -c - indicates to create a command line for quip decoding");
 	puts("      -l - will show the encrypted legend before cyphertext");
+	puts("      --seed n - use (n) to make the legend and hint");
 	puts("      -h - print this message");
 	puts("");
+	puts("Usage: (to create a file of quips)");
+	puts("      quip --generate n [--corpus file] [--seed n] [-jn]");
+	puts("where:");
+	puts("      n - is the number of quips to create");
+	puts("      --corpus file - make them from the sentences in 'file', one to a");
+	puts("            line ('-' is stdin), instead of the benchmark corpus");
+	puts("      --seed n - use (n) to pick the sentences, legends and hints, so");
+	puts("            the same (n) makes the same quips (default: the time)");
+	puts("      -jn - use (n) threads to create them (default: 1 per cpu)");
+	puts("      Each quip is written as a request for '--batch', and its comment");
+	puts("      has its number, the plaintext and the legend for 'a' to 'z'.");
+	puts("");
 	puts("Usage: (to decode a quip)");
-	puts("      quip cyphertext -ka=b [-ka=b] [-p] [-ffilename] [-F|-W] [-h]");
+	puts("      quip cyphertext -ka=b [-ka=b] [-p] [-ffilename] [-jn] [-x] [-F[n]|-W|-Aauto|-Aportfolio]");
+	puts("           [-Ox] [-S] [-E[r|f]] [-P]");
+	puts("           [--image file] [--cache file [--cache-size n]] [--log file]");
+	puts("           [--trace file] [-h]");
 	puts("where:");
 	puts("      cyphertext - is the (quoted) cyphertext to use");
 	puts("      -ka=b - indicates known substitution 'b' for 'a'");
 	puts("      -Tn - limit the solution search time to (n) sec.");
 	puts("      -H - on output, format it as HTML");
 	puts("      -ffilename - use the file 'filename' for words");
-	puts("      -F - try the 'Frequency Attack' for a solution");
+	puts("      -jn - use up to (n) threads to load the words, as many as the size");
+	puts("            of the words file warrants (default: 1 per cpu)");
+	puts("      -x - no letter stands for itself (as with '-e' and the papers)");
+	puts("      -F[n] - try the 'Frequency Attack' for a solution, for up to (n)");
+	puts("           sec. (default: -Tn) - the 'Word Block Attack' after it still");
+	puts("           gets its own -Tn");
 	puts("      -W - try the 'Word Block Attack' for a solution");
+	puts("      -Aauto - try whichever attack is predicted to take the least time,");
+	puts("           from random probes of each - and with '--log', log how it did");
+	puts("      -Aportfolio - race the 'Word Block Attack', with each of the -O");
+	puts("           orderings, and the 'Frequency Attack' on threads of their own,");
+	puts("           and take the solutions of the first to finish");
+	puts("      -P - show the time spent in each phase, from loading the words to");
+	puts("           printing the solutions, the arena allocations and peak RSS");
+	puts("      -S - show the statistics of the search: the nodes, tested and rejected");
+	puts("           possibles by cypherword, and the conflicts with the legend by cause");
+	puts("      -Ox - order the possibles of each word for the 'Word Block Attack'");
+	puts("            by: l = the words file (default), c = cross-match counts,");
+	puts("            n = least constraining on the neighboring words");
+	puts("      -E - estimate the size of the 'Word Block Attack' search, and the");
+	puts("           time it will take, before starting it - and with: r = refuse");
+	puts("           to start it if it will take more than -Tn, f = try the");
+	puts("           'Frequency Attack' instead");
+	puts("      --image file - map in the words from the dictionary image 'file',");
+	puts("            making it from the words file if it's missing or out of date");
+	puts("      --cache file - keep the solutions in 'file', and use them for any");
+	puts("            quip solved before - even with a different key");
+	printf("      --cache-size n - keep no more than (n) MB of them (default: %d)\n",
+		   (int) (CACHE_DEFAULT_SIZE / (1024 * 1024)));
+	puts("      --log file - add a line of JSON to 'file' for every solve, with");
+	puts("            the hash of the quip, the hints, the outcome, search nodes");
+	puts("            and the time in each phase - and with '-Aauto', the attack");
+	puts("            picked, what each was predicted to take, and if it was off");
+	puts("      --trace file - write every possible the 'Word Block Attack' tries,");
+	puts("            and what became of it, to 'file' for 'quiptrace' to look at");
 	puts("      -h - print this message");
+	puts("");
+	puts("Usage: (to serve quips on a Unix socket)");
+	puts("      quip --serve path [-ffilename] [-jn] [-Tn] [--image file]");
+	puts("           [--cache file [--cache-size n]] [--log file]");
+	puts("where:");
+	puts("      path - is the socket to listen on for requests");
+	puts("      -ffilename - use the file 'filename' for words");
+	puts("      -jn - answer (n) requests at once (default: 1 per cpu)");
+	puts("      -Tn - the time limit for requests without their own");
+	puts("      Each request is a line with a cyphertext and its -k, -T, -x,");
+	puts("      -F, -W, -A, -O, -S and -E options, and each answer is a line of JSON");
+	puts("      with the status, solutions, search nodes and timings - and the");
+	puts("      search statistics, with '-S', and estimate, with '-E'.");
+	puts("");
+	puts("Usage: (to solve a file of quips)");
+	puts("      quip --batch file [-ffilename] [-jn] [-Tn] [--image file]");
+	puts("           [--cache file [--cache-size n]] [--log file]");
+	puts("where:");
+	puts("      file - has a request, as for '--serve', on each line ('-' is stdin)");
+	puts("      -jn - solve (n) quips at once (default: 1 per cpu)");
+	puts("      -Tn - the time limit for quips without their own, and the");
+	printf("            deadline for every quip is that plus %d sec.\n", BATCH_DEADLINE_GRACE);
+	puts("");
+	puts("Usage: (to benchmark the solver)");
+	puts("      quip --bench [n] [-ffilename] [-jn] [-Tn] [--image file]");
+	puts("where:");
+	printf("      n - solve each puzzle (n) times (default: %d)\n", BENCH_DEFAULT_RUNS);
+	puts("      -Tn - limit each solve to (n) sec.");
+	puts("      The puzzles are made from a fixed list with a fixed seed, so they");
+	puts("      are the same every time, and the report has the min, median and");
+	puts("      99th percentile times, search nodes and solutions for each one.");
 }
 
 
 /*
- *	This routine logs the message to the appropriate file in the
- *	system with the date and time conveniently displayed at the
- *	beginning of each line for sorting/identification issues.
+ *	This is the solution callback for the command line - it prints
+ *	each solution as soon as it's found, with how long it took to
+ *	get there.
  */
-void logIt(char *msg) {
-	BOOL	error = NO;
-	char	*dateFmt = NULL;
-	FILE	*fp = NULL;
+BOOL PrintSolution(char *plaintext, void *userData) {
+	solutionPrinter	*printer = (solutionPrinter *) userData;
+	struct timespec	now;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+	printer->count++;
+	// see what kind of output the user wants
+	if (htmlOutput) {
+		printf("%s<BR>\n", plaintext);
+	} else {
+		printf("[%ld us] Solution: %s\n",
+			   (long) ((now.tv_sec - printer->start.tv_sec) * 1000000
+					   + (now.tv_nsec - printer->start.tv_nsec) / 1000),
+			   plaintext);
+	}
+	fflush(stdout);
 
-	/*
-	 *	First, let's get the date and time into a nice string...
-	 */
+	return YES;
+}
+
+
+/************************************************************************
+ *
+ *	Solve log routines
+ *
+ *	These keep the log of the solves for '--log' - see solveLog_t
+ *	for how it's kept off the solve path.
+ *
+ ************************************************************************/
+/*
+ *	This routine opens the log file 'filename' for adding to, and
+ *	starts the thread that writes the records to it. The 'source' is
+ *	put in every record, to tell the command line from the server and
+ *	the batch. The log is written with O_APPEND, and a bunch of whole
+ *	lines at a time, so any number of them can share the one file.
+ */
+solveLog *OpenSolveLog(char *filename, char *source) {
+	BOOL		error = NO;
+	solveLog	*retval = NULL;
+
+	// first, make the log itself, and its ring of records
 	if (!error) {
-		time_t	now = time(NULL);
-		dateFmt = ctime( &now );
-		if (dateFmt == NULL) {
+		retval = (solveLog *) calloc(1, sizeof(solveLog));
+		if (retval != NULL) {
+			retval->fd = -1;
+			retval->ring = (logRecord *) malloc(LOG_RING_SIZE * sizeof(logRecord));
+		}
+		if ((retval == NULL) || (retval->ring == NULL)) {
 			error = YES;
-			printf("*** Error in logIt() ***\n"
-				   "    The date/time stamp could not be generated for the\n"
-				   "    log. This is a serious problem! The message was:\n"
-				   "    %s\n", msg);
-		} else {
-			// drop the '\n' that's in the date/time string
-			dateFmt[24] = '\0';
+			fprintf(stderr, "*** Error in OpenSolveLog() ***\n"
+							"    The solve log, and its ring of %d records, could not\n"
+							"    be created. This is a serious allocation error.\n", LOG_RING_SIZE);
 		}
 	}
 
-	/*
-	 *	Now let's set up the log file for the addition of this message
-	 */
+	// next, open up the file to add to it
 	if (!error) {
-		fp = fopen(DEFAULT_LOG_FILE, "a");
-		if (fp == NULL) {
+		retval->fd = open(filename, O_WRONLY | O_CREAT | O_APPEND, 0644);
+		if (retval->fd < 0) {
 			error = YES;
-			printf("*** Error in logIt() ***\n"
-				   "    The log file could not be opened for adding this\n"
-				   "    message. This is a serious problem! The message was:\n"
-				   "    %s\n", msg);
-		} else {
-			if (fseek(fp, 0, SEEK_END) == -1) {
-				error = YES;
-				printf("*** Error in logIt() ***\n"
-					   "    The log file could not be positioned for adding this\n"
-					   "    message. This is a serious problem! The message was:\n"
-					   "    %s\n", msg);
-			}
+			fprintf(stderr, "*** Error in OpenSolveLog() ***\n"
+							"    The log file '%s' could not be opened for adding\n"
+							"    to: %s\n", filename, strerror(errno));
 		}
 	}
 
-	/*
-	 *	Now we can write this message out to the log file
-	 */
+	// ...and start the thread to write it
 	if (!error) {
-		fprintf(fp, "%s (%s) %s\n", dateFmt, getlogin(), msg);
+		char	*user = getlogin();
+
+		retval->source = source;
+		retval->pid = getpid();
+		snprintf(retval->user, sizeof(retval->user), "%s", (user != NULL ? user : ""));
+		pthread_mutex_init(&retval->lock, NULL);
+		pthread_cond_init(&retval->ready, NULL);
+		if (pthread_create(&retval->drainer, NULL, DrainSolveLog, retval) != 0) {
+			error = YES;
+			fprintf(stderr, "*** Error in OpenSolveLog() ***\n"
+							"    The thread to write the log '%s' could not be\n"
+							"    started.\n", filename);
+			pthread_cond_destroy(&retval->ready);
+			pthread_mutex_destroy(&retval->lock);
+		}
 	}
 
-	/*
-	 *	Now clean everything up so that it's all nice and tidy.
-	 */
-	if (fp != NULL) {
-		fclose(fp);
+	// if it didn't all work, don't leave any of it around
+	if (error && (retval != NULL)) {
+		if (retval->fd >= 0) {
+			close(retval->fd);
+		}
+		if (retval->ring != NULL) {
+			free(retval->ring);
+		}
+		free(retval);
+		retval = NULL;
+	}
+
+	return retval;
+}
+
+
+/*
+ *	This routine stops the thread writing the log - after it's
+ *	written out all the records in the ring - and closes the file.
+ *	Anything logged after this is just dropped, so a server worker
+ *	that's still finishing an answer can't get in trouble with it,
+ *	and the memory is left for DestroySolveLog(), or the exit.
+ */
+void CloseSolveLog(solveLog *log) {
+	if ((log != NULL) && !log->closed) {
+		pthread_mutex_lock(&log->lock);
+		log->stopping = YES;
+		pthread_cond_signal(&log->ready);
+		pthread_mutex_unlock(&log->lock);
+		pthread_join(log->drainer, NULL);
+		close(log->fd);
+		log->fd = -1;
+		log->closed = YES;
+	}
+}
+
+
+/*
+ *	This routine closes the log, if it's not already closed, and
+ *	releases all of it. It always returns NULL.
+ */
+solveLog *DestroySolveLog(solveLog *log) {
+	if (log != NULL) {
+		CloseSolveLog(log);
+		pthread_cond_destroy(&log->ready);
+		pthread_mutex_destroy(&log->lock);
+		free(log->ring);
+		free(log);
+	}
+
+	return NULL;
+}
+
+
+/*
+ *	This routine adds the record of the solve in the context to the
+ *	log - with the 'status' of it, a constant string, the number of
+ *	'solutions' - the context doesn't keep them when they go to a
+ *	callback - and the 'total_us' it took, as the caller saw it.
+ *	The record is made up before the lock is taken, and then it's
+ *	just copied into the ring, so it's a small fraction of a
+ *	microsecond. It's fine to call this with a NULL log - there's
+ *	just nothing to do.
+ */
+void LogSolve(solveLog *log, quipContext *ctx, char *status, int solutions, long total_us) {
+	logRecord	rec;
+	int			i, h = 0;
+
+	if ((log == NULL) || (ctx == NULL)) {
+		return;
+	}
+
+	// make up the record from the context
+	clock_gettime(CLOCK_REALTIME, &rec.when);
+	rec.status = status;
+	rec.length = (ctx->initialCyphertext != NULL ? strlen(ctx->initialCyphertext) : 0);
+	rec.quipHash = HashString(CACHE_HASH_SEED, (ctx->initialCyphertext != NULL ? ctx->initialCyphertext : ""), rec.length);
+	for (i = 0; (ctx->userLegend != NULL) && (i < 26); i++) {
+		if (ctx->userLegend->map[i] != 0) {
+			rec.hints[h++] = 'a' + i;
+			rec.hints[h++] = ctx->userLegend->map[i];
+		}
+	}
+	rec.hints[h] = '\0';
+	rec.solutions = solutions;
+	rec.cached = ctx->cached;
+	rec.nodes = ctx->searchNodes;
+	memcpy(rec.phaseTime_us, ctx->phaseTime_us, sizeof(rec.phaseTime_us));
+	rec.total_us = total_us;
+	rec.choice = ctx->choice;
+	rec.strategy = ((ctx->portfolio != NULL) && (ctx->portfolio->taken >= 0) ?
+					GetPortfolioStrategyName(ctx->portfolio->taken) : NULL);
+	rec.raced = (ctx->portfolio != NULL);
+	rec.winner = ((ctx->portfolio != NULL) && (ctx->portfolio->winner >= 0) ?
+				  GetPortfolioStrategyName(ctx->portfolio->winner) : NULL);
+	for (i = 0; rec.raced && (i < PORTFOLIO_STRATEGIES); i++) {
+		rec.strategies[i].finished = ctx->portfolio->strategies[i].finished;
+		rec.strategies[i].error = ctx->portfolio->strategies[i].error;
+		rec.strategies[i].elapsed_us = ctx->portfolio->strategies[i].elapsed_us;
+		rec.strategies[i].nodes = ctx->portfolio->strategies[i].nodes;
+		rec.strategies[i].solutions = ctx->portfolio->strategies[i].solutions;
+	}
+
+	// ...and put it in the ring - if there's room
+	pthread_mutex_lock(&log->lock);
+	if (log->stopping || ((log->head - log->tail) >= LOG_RING_SIZE)) {
+		log->dropped++;
+	} else {
+		log->ring[log->head % LOG_RING_SIZE] = rec;
+		log->head++;
+		if ((log->head - log->tail) == (LOG_RING_SIZE / 2)) {
+			pthread_cond_signal(&log->ready);
+		}
+	}
+	pthread_mutex_unlock(&log->lock);
+}
+
+
+/*
+ *	This is the thread routine that writes the log. It waits for
+ *	records to show up in the ring, takes out up to LOG_DRAIN_BATCH
+ *	of them at once, and writes them with a single write() - all
+ *	without the lock, so the solves can keep adding records. When
+ *	the log is stopping, it keeps on until the ring is empty.
+ */
+void *DrainSolveLog(void *arg) {
+	solveLog		*log = (solveLog *) arg;
+	logRecord		*batch = NULL;
+	char			*buf = NULL;
+	int				count, len, i;
+	unsigned long	dropped;
+	struct timespec	deadline;
+
+	batch = (logRecord *) malloc(LOG_DRAIN_BATCH * sizeof(logRecord));
+	buf = (char *) malloc(LOG_DRAIN_BATCH * LOG_RECORD_SIZE);
+	if ((batch == NULL) || (buf == NULL)) {
+		fprintf(stderr, "*** Error in DrainSolveLog() ***\n"
+						"    The space for writing the log could not be had, so\n"
+						"    nothing will be written to it.\n");
+	}
+
+	pthread_mutex_lock(&log->lock);
+	while (YES) {
+		// wait for something to write, or to be told to stop
+		while ((log->head == log->tail) && !log->stopping) {
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			deadline.tv_nsec += (LOG_DRAIN_INTERVAL % 1000) * 1000000L;
+			deadline.tv_sec += (LOG_DRAIN_INTERVAL / 1000) + (deadline.tv_nsec / 1000000000L);
+			deadline.tv_nsec %= 1000000000L;
+			pthread_cond_timedwait(&log->ready, &log->lock, &deadline);
+		}
+		if (log->head == log->tail) {
+			break;
+		}
+
+		// take out what we can, and write it without the lock
+		count = 0;
+		while ((count < LOG_DRAIN_BATCH) && (log->tail != log->head)) {
+			if (batch != NULL) {
+				batch[count] = log->ring[log->tail % LOG_RING_SIZE];
+			}
+			count++;
+			log->tail++;
+		}
+		dropped = log->dropped;
+		log->dropped = 0;
+		pthread_mutex_unlock(&log->lock);
+
+		if ((batch != NULL) && (buf != NULL)) {
+			len = 0;
+			for (i = 0; i < count; i++) {
+				len += FormatLogRecord(log, &batch[i], (i == 0 ? dropped : 0), &buf[len], LOG_RECORD_SIZE);
+			}
+			if (write(log->fd, buf, len) != len) {
+				// there's nobody to tell - the next write may do better
+			}
+		}
+
+		pthread_mutex_lock(&log->lock);
+	}
+	pthread_mutex_unlock(&log->lock);
+
+	if (batch != NULL) {
+		free(batch);
 	}
+	if (buf != NULL) {
+		free(buf);
+	}
+
+	return NULL;
+}
+
+
+/*
+ *	This routine writes the record into 'buf' - no more than 'size'
+ *	characters of it - as a line of JSON:
+ *
+ *	  {"time":"...","source":"...","pid":n,"user":"...","quip":"...",
+ *	   "length":n,"hints":"ab...","status":"...","solutions":n,
+ *	   "cached":b,"nodes":n,"total_us":n,"phases_us":{"load":n,...}}
+ *
+ *	where "quip" is the hash of the cyphertext, the "hints" are the
+ *	known substitutions as cypherchar/plainchar pairs, and the status
+ *	is one of the statuses of AnswerRequest(). If records had to be
+ *	'dropped' before this one, there's a "dropped" count, too - and
+ *	with '-Aportfolio', there's the "strategy" that was taken, and a
+ *	"portfolio" with the winner and how each strategy did. The
+ *	length of the line is returned.
+ */
+int FormatLogRecord(solveLog *log, logRecord *rec, unsigned long dropped, char *buf, int size) {
+	struct tm	utc;
+	int			len;
+	int			i;
+
+	gmtime_r(&rec->when.tv_sec, &utc);
+	len = snprintf(buf, size, "{\"time\":\"%04d-%02d-%02dT%02d:%02d:%02d.%06ldZ\",\"source\":\"%s\",\"pid\":%d,"
+				   "\"user\":\"%s\",\"quip\":\"%08x\",\"length\":%d,\"hints\":\"%s\",\"status\":\"%s\","
+				   "\"solutions\":%d,\"cached\":%s,\"nodes\":%ld,\"total_us\":%ld",
+				   utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec,
+				   rec->when.tv_nsec / 1000, log->source, (int) log->pid, log->user, rec->quipHash,
+				   rec->length, rec->hints, rec->status, rec->solutions, (rec->cached ? "true" : "false"),
+				   rec->nodes, rec->total_us);
+	if (dropped > 0) {
+		len += snprintf(&buf[len], size - len, ",\"dropped\":%lu", dropped);
+	}
+	if (rec->strategy != NULL) {
+		len += snprintf(&buf[len], size - len, ",\"strategy\":\"%s\"", rec->strategy);
+	}
+	if (rec->raced) {
+		len += snprintf(&buf[len], size - len, ",\"portfolio\":{\"winner\":%s%s%s,\"strategies\":[",
+						(rec->winner != NULL ? "\"" : ""), (rec->winner != NULL ? rec->winner : "null"),
+						(rec->winner != NULL ? "\"" : ""));
+		for (i = 0; i < PORTFOLIO_STRATEGIES; i++) {
+			len += snprintf(&buf[len], size - len, "%s{\"strategy\":\"%s\",\"finished\":%s,\"error\":%s,"
+							"\"elapsed_us\":%ld,\"nodes\":%ld,\"solutions\":%d}", (i > 0 ? "," : ""),
+							GetPortfolioStrategyName(i), (rec->strategies[i].finished ? "true" : "false"),
+							(rec->strategies[i].error ? "true" : "false"), rec->strategies[i].elapsed_us,
+							rec->strategies[i].nodes, rec->strategies[i].solutions);
+		}
+		len += snprintf(&buf[len], size - len, "]}");
+	}
+	if (rec->choice.done) {
+		len += snprintf(&buf[len], size - len, ",\"attack\":{\"picked\":\"%s\",\"hints\":%d,\"coverage\":%.3f,"
+						"\"word_block_us\":%.6g,\"frequency_us\":%.6g,\"frequency_error\":%.3f,"
+						"\"unreliable\":%s,\"actual_us\":%ld,\"mispredicted\":%s}",
+						GetAttackName(rec->choice.chosen), rec->choice.hints, rec->choice.coverage,
+						rec->choice.wordBlock_us, rec->choice.frequency_us, rec->choice.frequencyError,
+						(rec->choice.unreliable ? "true" : "false"), rec->choice.actual_us,
+						(rec->choice.mispredicted ? "true" : "false"));
+	}
+	for (i = 0; i < PHASE_COUNT; i++) {
+		len += snprintf(&buf[len], size - len, "%s\"%s\":%ld", (i == 0 ? ",\"phases_us\":{" : ","),
+						GetPhaseName(i), rec->phaseTime_us[i]);
+	}
+	len += snprintf(&buf[len], size - len, "}}\n");
+
+	return (len < size ? len : size - 1);
 }
 
 
@@ -2416,36 +2571,54 @@ int main(int argc, char *argv[]) {
 	BOOL	error = NO;
 	BOOL	keepGoing = YES;
 	BOOL	solutionAttempted = NO;
+	solutionPrinter	printer;
 	BOOL	decrypting = YES;
 	BOOL	showLegend = NO;
 	// default to a reasonable time limit
-	int		timeLimit = 20;
+	int		timeLimit = DEFAULT_TIME_LIMIT;
 	BOOL	creatingCommandLine = NO;
+	BOOL	showingPhases = NO;
+	struct timespec	runStart;
 	BOOL	tryingFrequencyAttack = NO;
 	BOOL	tryingWordBlockAttack = YES;
 	char	*wordsFilename = NULL;
-	// this is for logging purposes
-	char	logMsg[2408];
-	int		runtime_us = 0;
+	char	*serveSocketPath = NULL;
+	char	*batchFilename = NULL;
+	char	*cacheFilename = NULL;
+	size_t	cacheSize = CACHE_DEFAULT_SIZE;
+	int		benchRuns = 0;
+	long	generateCount = 0;
+	char	*corpusFilename = NULL;
+	char	*traceFilename = NULL;
+	searchTrace		*trace = NULL;
+	BOOL	handled;
+	quipContext		*ctx = NULL;
+	dictionary		*dict = NULL;
+	quipCache		*cache = NULL;
+	unsigned int	randSeed;
 
 	/*
 	 *	First, set up the defaults for this program
 	 */
-	// reset all the global variables
+	clock_gettime(CLOCK_MONOTONIC_RAW, &runStart);
+	// make an empty solve context for the options to go into
 	if (!error && keepGoing) {
-		wordCount = 0;
-		words = NULL;
-		legendCount = 0;
-		legends = NULL;
-		userLegend = NULL;
-		initialCyphertext = NULL;
-		plainText = NULL;
-		plainTextCnt = 0;
-		plainTextMaxCnt = 0;
+		ctx = CreateQuipContext(NULL);
+		if (ctx == NULL) {
+			error = YES;
+		}
 
 		// ...and start the random number generator
 		randSeed = time(NULL) % 23487637;
 		rand_r(&randSeed);
+
+		// ...and default to a thread per processor
+		threadCount = (int) sysconf(_SC_NPROCESSORS_ONLN);
+		if (threadCount < 1) {
+			threadCount = 1;
+		} else if (threadCount > MAX_THREADS) {
+			threadCount = MAX_THREADS;
+		}
 	}
 
 	/*
@@ -2470,52 +2643,31 @@ int main(int argc, char *argv[]) {
 						wordsFilename = strdup(&(argv[i][2]));
 						if (wordsFilename == NULL) {
 							error = YES;
-							printf("*** Error ***\n"
-								   "    The file containing the words to use in the\n"
-								   "    decryption, '%s', could not be copied for\n"
-								   "    later use by the program. This is a serious\n"
-								   "    problem and needs to be addressed.\n", &(argv[i][2]));
-						}
-						break;
-					case 'k' :
-						// check to see that it's the right format
-						if ((!isalpha(argv[i][2])) || (argv[i][3] != '=') || (!isalpha(argv[i][4]))) {
-							error = YES;
-							printf("*** Error ***\n"
-								   "    The format of the '-k' option is bad.\n");
-							showUsage();
-						}
-
-						// now, add the known info to the user legend
-						if (!error) {
-							if (userLegend == NULL) {
-								// we need to create a new user legend
-								userLegend = CreateLegend(argv[i][2], argv[i][4]);
-								if (userLegend == NULL) {
-									error = YES;
-									printf("*** Error ***\n"
-										   "    The user-supplied known substitution could not\n"
-										   "    be used to create a new user legend structure.\n"
-										   "    This is a serious problem because there will be\n"
-										   "    no way to know where to start in the solution.\n");
-								}
-							} else {
-								// we can simply add to the existing legend
-								userLegend->map[argv[i][2] - 'a'] = argv[i][4];
-							}
+							fprintf(stderr, "*** Error ***\n"
+											"    The file containing the words to use in the\n"
+											"    decryption, '%s', could not be copied for\n"
+											"    later use by the program. This is a serious\n"
+											"    problem and needs to be addressed.\n", &(argv[i][2]));
 						}
 						break;
 					case 'H' :
 						htmlOutput = YES;
 						break;
-					case 'T' :
-						if (strlen(argv[i]) > 2) {
-							timeLimit = atoi( &(argv[i][2]) );
-							if (timeLimit < 0) {
-								timeLimit = -1;
-							} else if (timeLimit > 300) {
-								timeLimit = 300;
-							}
+					case 'P' :
+						showingPhases = YES;
+						break;
+					case 'j' :
+						// the count can be attached, or the next argument
+						if ((strlen(argv[i]) == 2) && ((i + 1) < argc)) {
+							i++;
+							threadCount = atoi(argv[i]);
+						} else {
+							threadCount = atoi( &(argv[i][2]) );
+						}
+						if (threadCount < 1) {
+							threadCount = 1;
+						} else if (threadCount > MAX_THREADS) {
+							threadCount = MAX_THREADS;
 						}
 						break;
 					case 'l' :
@@ -2526,40 +2678,142 @@ int main(int argc, char *argv[]) {
 						showUsage();
 						keepGoing = NO;
 						break;
-					case 'F' :
-						tryingFrequencyAttack = YES;
+					case '-' :
+						// the long options are for the server and batches
+						if ((strcmp(argv[i], "--serve") == 0) && ((i + 1) < argc)) {
+							i++;
+							serveSocketPath = argv[i];
+						} else if ((strcmp(argv[i], "--batch") == 0) && ((i + 1) < argc)) {
+							i++;
+							batchFilename = argv[i];
+						} else if ((strcmp(argv[i], "--image") == 0) && ((i + 1) < argc)) {
+							i++;
+							imageFilename = argv[i];
+						} else if ((strcmp(argv[i], "--cache") == 0) && ((i + 1) < argc)) {
+							i++;
+							cacheFilename = argv[i];
+						} else if ((strcmp(argv[i], "--log") == 0) && ((i + 1) < argc)) {
+							i++;
+							logFilename = argv[i];
+						} else if ((strcmp(argv[i], "--trace") == 0) && ((i + 1) < argc)) {
+							i++;
+							traceFilename = argv[i];
+						} else if (strcmp(argv[i], "--bench") == 0) {
+							benchRuns = BENCH_DEFAULT_RUNS;
+							// ...the number of runs is optional
+							if (((i + 1) < argc) && isdigit(argv[i + 1][0])) {
+								i++;
+								benchRuns = atoi(argv[i]);
+								if (benchRuns < 1) {
+									benchRuns = 1;
+								} else if (benchRuns > BENCH_MAX_RUNS) {
+									benchRuns = BENCH_MAX_RUNS;
+								}
+							}
+						} else if ((strcmp(argv[i], "--generate") == 0) && ((i + 1) < argc) &&
+								   (atol(argv[i + 1]) > 0)) {
+							i++;
+							generateCount = atol(argv[i]);
+						} else if ((strcmp(argv[i], "--corpus") == 0) && ((i + 1) < argc)) {
+							i++;
+							corpusFilename = argv[i];
+						} else if ((strcmp(argv[i], "--seed") == 0) && ((i + 1) < argc) &&
+								   isdigit(argv[i + 1][0])) {
+							i++;
+							randSeed = (unsigned int) strtoul(argv[i], NULL, 10);
+						} else if ((strcmp(argv[i], "--cache-size") == 0) && ((i + 1) < argc) &&
+								   (atoi(argv[i + 1]) > 0)) {
+							i++;
+							cacheSize = (size_t) atoi(argv[i]) * 1024 * 1024;
+						} else {
+							error = YES;
+							fprintf(stderr, "*** Error ***\n"
+											"    The option '%s' isn't known.\n", argv[i]);
+							showUsage();
+						}
 						break;
-					case 'W' :
-						tryingWordBlockAttack = YES;
+					default :
+						if (!ParseSolveOption(ctx, argv[i], &timeLimit, &tryingFrequencyAttack, &tryingWordBlockAttack, &handled)) {
+							error = YES;
+							showUsage();
+						}
 						break;
 				}
 			} else {
 				// not an option, so it must be the text
-				initialCyphertext = strdup(argv[i]);
-				if (initialCyphertext == NULL) {
+				if (!SetCyphertextInContext(ctx, argv[i])) {
 					error = YES;
-					printf("*** Error ***\n"
-						   "    The text on the command line: '%s'\n"
-						   "    could not be copied for use by this program. This is a\n"
-						   "    serious problem in memory allocation.\n", argv[i]);
+					fprintf(stderr, "*** Error ***\n"
+									"    The text on the command line: '%s'\n"
+									"    could not be copied for use by this program. This is a\n"
+									"    serious problem in memory allocation.\n", argv[i]);
 				}
 			}
 		}
 	}
 
 	/*
-	 *	Log what we've got so far - if needed
+	 *	If we're to be a server, then that's all we do - until
+	 *	we're told to stop.
+	 */
+	if (!error && keepGoing && (serveSocketPath != NULL)) {
+		if (logFilename != NULL) {
+			logger = OpenSolveLog(logFilename, "server");
+			if (logger == NULL) {
+				error = YES;
+			}
+		}
+		if (!error && !ServeQuips(serveSocketPath, wordsFilename, cacheFilename, cacheSize, threadCount, timeLimit)) {
+			error = YES;
+		}
+		// ...the workers could still be logging, so it's left for the exit
+		CloseSolveLog(logger);
+		logger = NULL;
+		keepGoing = NO;
+	}
+
+	/*
+	 *	...or if we're to solve a batch of puzzles, then do that.
+	 */
+	if (!error && keepGoing && (batchFilename != NULL)) {
+		if (logFilename != NULL) {
+			logger = OpenSolveLog(logFilename, "batch");
+			if (logger == NULL) {
+				error = YES;
+			}
+		}
+		if (!error && !SolveBatch(batchFilename, wordsFilename, cacheFilename, cacheSize, threadCount, timeLimit)) {
+			error = YES;
+		}
+		logger = DestroySolveLog(logger);
+		keepGoing = NO;
+	}
+
+	/*
+	 *	...or if we're to run the benchmark, then do that.
+	 */
+	if (!error && keepGoing && (benchRuns > 0)) {
+		if (!RunBenchmark(wordsFilename, benchRuns, timeLimit)) {
+			error = YES;
+		}
+		keepGoing = NO;
+	}
+
+	/*
+	 *	...or if we're to make a file of puzzles, then do that.
 	 */
-	if (!error && keepGoing && LOG) {
-		snprintf(logMsg, 2048, "starting: quip='%s' time=%d", initialCyphertext, timeLimit);
-		logIt(logMsg);
+	if (!error && keepGoing && (generateCount > 0)) {
+		if (!GeneratePuzzleFile(corpusFilename, generateCount, randSeed, threadCount)) {
+			error = YES;
+		}
+		keepGoing = NO;
 	}
 
 	/*
 	 *	Check to see if we have any cyphertext to process.
 	 *	If not, then we need to show the usage and quit.
 	 */
-	if (!error && keepGoing && (initialCyphertext == NULL)) {
+	if (!error && keepGoing && (ctx->initialCyphertext == NULL)) {
 		showUsage();
 		keepGoing = NO;
 	}
@@ -2571,174 +2825,160 @@ int main(int argc, char *argv[]) {
 	 *	cyphertext, then let's do that and no more.
 	 */
 	if (!error && keepGoing && !decrypting) {
-		EncryptPlaintext(initialCyphertext, showLegend, creatingCommandLine);
+		EncryptPlaintext(ctx->initialCyphertext, showLegend, creatingCommandLine, &randSeed);
 
 		// now we need to say 'No more' to this program
 		keepGoing = NO;
 	}
 
 	/*
-	 *	If we're here, then we need to split up the rawText
-	 *	into a bunch of cypherwords and prepare the system
-	 *	for a solution.
+	 *	If we're here, then we need to solve the cyphertext - so load
+	 *	up the words file for the context...
 	 */
 	if (!error && keepGoing) {
-		if (!CreateCypherwordsFromCyphertext(initialCyphertext)) {
+		struct timespec	loadStart;
+
+		clock_gettime(CLOCK_MONOTONIC_RAW, &loadStart);
+		dict = LoadWords((wordsFilename != NULL ? wordsFilename : DEFAULT_WORDS_FILE));
+		AddPhaseTime(ctx, PHASE_LOAD, &loadStart);
+		if (dict == NULL) {
 			error = YES;
-			if (htmlOutput) {
-				printf("*** Error ***<BR>\n"
-					   "    The passsed in cyphertext could not be parsed into<BR>\n"
-					   "    cyberwords properly. Please check for messages<BR>\n"
-					   "    indicating what might have gone wrong.<BR>\n");
-			} else {
-				printf("*** Error ***\n"
-					   "    The passsed in cyphertext could not be parsed into\n"
-					   "    cyberwords properly. Please check for messages\n"
-					   "    indicating what might have gone wrong.\n");
-			}
+			fprintf(stderr, "*** Error ***\n"
+							"    The file '%s' could not be loaded as a dictionary,\n"
+							"    and there's no way to solve the quip without it.\n",
+							(wordsFilename != NULL ? wordsFilename : DEFAULT_WORDS_FILE));
+		} else {
+			ctx->dict = dict;
+			ctx->htmlOutput = htmlOutput;
+			ctx->threadCount = threadCount;
 		}
 	}
 
 	/*
-	 *	Next, we need to read in the file of words and
-	 *	process each word to see if it's a possible match to
-	 *	each cypherword.
+	 *	...and the cache of the quips that have been solved before,
+	 *	if we're to use one.
 	 */
-	if (!error && keepGoing) {
-		if (!ReadAndProcessPlaintextFile((wordsFilename == NULL ? DEFAULT_WORDS_FILE : wordsFilename))) {
+	if (!error && keepGoing && (cacheFilename != NULL)) {
+		cache = OpenQuipCache(cacheFilename, cacheSize, dict);
+		if (cache == NULL) {
 			error = YES;
-			printf("*** Error ***\n"
-				   "    The file of words could not be processed properly.\n"
-				   "    This is a serious problem, but there should be\n"
-				   "    some indication as to the cause in the log.\n");
+		} else {
+			ctx->cache = cache;
 		}
 	}
 
 	/*
-	 *	Let's try a frequency-based attack on the problem.
-	 *	it isn't as 'smart' as others, but it's a complete
-	 *	search through all possible legends, and with a
-	 *	reduced search space, it should be reasonably fast.
+	 *	...and the trace of the search, if we're to write one.
 	 */
-	if (!error && keepGoing && tryingFrequencyAttack) {
-		if (!DoFrequencyAttack(userLegend, timeLimit)) {
-			keepGoing = NO;
+	if (!error && keepGoing && (traceFilename != NULL)) {
+		trace = OpenSearchTrace(traceFilename);
+		if (trace == NULL) {
+			error = YES;
+		} else {
+			ctx->trace = trace;
 		}
-		// ...well... we certainly tried
-		solutionAttempted = YES;
 	}
 
 	/*
-	 *	Let's try a word-by-word attack on the solution.
-	 *	Start with the first plaintext word of the first
-	 *	cypherword and put all missing keys into the legend.
-	 *	Then, move to the next cypherword and repeat. If
-	 *	we do it right, blocks of the legend will be tried
-	 *	at once and therefore make it a little more speedy.
+	 *	...and the log of the solve, if we're to keep one.
 	 */
-	if (!error && keepGoing && tryingWordBlockAttack) {
-		struct timespec	start, end;
-		clock_gettime(CLOCK_MONOTONIC_RAW, &start);
-		if (!DoWordBlockAttack(0, userLegend, timeLimit)) {
-			keepGoing = NO;
+	if (!error && keepGoing && (logFilename != NULL)) {
+		logger = OpenSolveLog(logFilename, "cli");
+		if (logger == NULL) {
+			error = YES;
 		}
-		clock_gettime(CLOCK_MONOTONIC_RAW, &end);
-		runtime_us = (end.tv_sec - start.tv_sec) * 1000000
-		             + (end.tv_nsec - start.tv_nsec) / 1000;
-		// ...well... we certainly tried
-		solutionAttempted = YES;
 	}
 
 	/*
-	 *	Now that I think I'm done, let's print out the
-	 *	answers that my code has generated for me. Make
-	 *	sure to print out a message if none were found.
-	 *	It can happen... and we need to be clear about
-	 *	what we've done for the user.
+	 *	...and split it up into cypherwords, match them against the
+	 *	dictionary, and run the attacks on it - printing out the
+	 *	answers as they're found.
 	 */
-	if (!error && solutionAttempted) {
-		if (plainTextCnt == 0) {
-			if (htmlOutput) {
-				printf("*** No solutions to this could be found! ***<BR>\n");
-			} else {
-				printf("*** No solutions to this could be found! ***\n");
-			}
+	if (!error && keepGoing) {
+		printer.count = 0;
+		clock_gettime(CLOCK_MONOTONIC_RAW, &printer.start);
+		SetSolutionCallbackInContext(ctx, PrintSolution, &printer);
+		if (!SolveCyphertext(ctx, timeLimit, tryingFrequencyAttack, tryingWordBlockAttack, &keepGoing, NULL, NULL)) {
+			error = YES;
 		} else {
-			int		i;
-
-			for(i = 0; i < plainTextCnt; i++) {
-				// see what kind of output the user wants
-				if (htmlOutput) {
-					printf("%s<BR>\n", plainText[i]);
-				} else {
-					printf("[%d us] Solution: %s\n", runtime_us, plainText[i]);
-				}
-			}
+			// ...well... we certainly tried
+			solutionAttempted = YES;
 		}
 	}
 
 	/*
-	 *	Log the end of what we've done
+	 *	...and if asked for, say how the search went.
 	 */
-	if (!error && keepGoing && LOG) {
-		snprintf(logMsg, 2048, "terminating: quip='%s'", initialCyphertext);
-		logIt(logMsg);
+	if (!error && solutionAttempted) {
+		PrintSearchStats(ctx);
+		PrintSearchEstimate(ctx);
+		PrintAttackChoice(ctx);
+		PrintPortfolio(ctx);
 	}
 
 	/*
-	 *	When all is said and done, we need to release those
-	 *	resources that we've used at some point in the code
+	 *	Now that I think I'm done, make sure to print out a
+	 *	message if no answers were found. It can happen... and
+	 *	we need to be clear about what we've done for the user.
 	 */
-	if (initialCyphertext != NULL) {
-		free(initialCyphertext);
-		initialCyphertext = NULL;
+	if (!error && solutionAttempted && (printer.count == 0)) {
+		if (htmlOutput) {
+			printf("*** No solutions to this could be found! ***<BR>\n");
+		} else {
+			printf("*** No solutions to this could be found! ***\n");
+		}
 	}
 
-	if (wordsFilename != NULL) {
-		free(wordsFilename);
-		wordsFilename = NULL;
-	}
+	/*
+	 *	...and if asked for, where the time went - all the way
+	 *	from the start to here.
+	 */
+	if (!error && solutionAttempted && showingPhases) {
+		struct timespec	now;
 
-	if (userLegend != NULL) {
-		userLegend = DestroyLegend(userLegend);
+		clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+		PrintPhaseTimes(ctx, (now.tv_sec - runStart.tv_sec) * 1000000
+							 + (now.tv_nsec - runStart.tv_nsec) / 1000);
 	}
 
-	if (words != NULL) {
-		int		i;
-
-		for (i = 0; i < wordCount; i++) {
-			words[i] = DestroyCypherword(words[i]);
-		}
-		free(words);
+	/*
+	 *	Log what we've done - if we're keeping a log
+	 */
+	if ((logger != NULL) && (solutionAttempted || error)) {
+		struct timespec	now;
 
-		words = NULL;
-		wordCount = 0;
+		clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+		LogSolve(logger, ctx, (error ? "error" :
+							   (!keepGoing ? (ctx->estimate.refused && (ctx->estimateMode == ESTIMATE_REFUSE) ? "refused" : "timeout") :
+								(printer.count > 0 ? "solved" : "unsolved"))),
+				 printer.count, (now.tv_sec - runStart.tv_sec) * 1000000 + (now.tv_nsec - runStart.tv_nsec) / 1000);
 	}
+	logger = DestroySolveLog(logger);
 
-	if (legends != NULL) {
-		int		i;
-
-		for (i = 0; i < legendCount; i++) {
-			legends[i] = DestroyLegend(legends[i]);
-		}
-		free(legends);
+	/*
+	 *	When all is said and done, we need to release those
+	 *	resources that we've used at some point in the code
+	 */
+	ctx = DestroyQuipContext(ctx);
 
-		legends = NULL;
-		legendCount = 0;
+	// ...the context ends the search in the trace, so it goes first
+	if (trace != NULL) {
+		trace = CloseSearchTrace(trace);
 	}
 
-	if (plainText != NULL) {
-		int		i;
+	if (cache != NULL) {
+		cache = CloseQuipCache(cache);
+	}
 
-		for (i = 0; i < plainTextCnt; i++) {
-			free(plainText[i]);
-		}
-		free(plainText);
+	if (wordsFilename != NULL) {
+		free(wordsFilename);
+		wordsFilename = NULL;
+	}
 
-		plainText = NULL;
-		plainTextCnt = 0;
-		plainTextMaxCnt = 0;
+	if (dict != NULL) {
+		dict = DestroyDictionary(dict);
 	}
 
 	return 0;
 }
+
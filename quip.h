@@ -0,0 +1,966 @@
+
+/*
+ *	quip.h - the interface to libquip, the cryptoquip solving engine
+ *			 behind quip. A dictionary is loaded once from the words
+ *			 file, and then any number of solve contexts can use it -
+ *			 each holding everything about solving one cyphertext. The
+ *			 dictionary is never changed by the solving, so contexts on
+ *			 different threads can share it and solve at the same time.
+ *
+ *			 The usual sequence is: LoadDictionary(), CreateQuipContext(),
+ *			 SetCyphertextInContext(), AddKnownSubstitutionToContext(),
+ *			 SolveCyphertext(), and then the solutions are in the
+ *			 context's 'plainText'. ResetQuipContext() gets it ready for
+ *			 the next cyphertext.
+ *
+ *			 To get the solutions as they're found instead, give the
+ *			 context a callback with SetSolutionCallbackInContext(), or
+ *			 call StartSolve() and then SolveNext() for each solution -
+ *			 the search picks up where it left off each time, and can
+ *			 just be dropped when the caller has seen enough.
+ *
+ *			 Everything a context builds up for a solve - solutions
+ *			 included - lives in its arena, and is all let go at once
+ *			 by ResetQuipContext(), so none of it is the caller's to
+ *			 free.
+ *
+ *	Copyright 2000 Robert E. Beaty, Ph.D. All Rights Reserved
+ */
+#ifndef __QUIP_H
+#define __QUIP_H
+
+/*
+ *	Standard system-level includes
+ */
+#include <stdio.h>
+#include <sys/types.h>
+#include <time.h>
+#include <pthread.h>
+
+/*
+ *	System-level & Data type definitions
+ */
+// nobody but NeXT ever seems to do Boolean data right
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef YES
+#define YES 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+#ifndef NO
+#define NO 0
+#endif
+#ifndef BOOL
+typedef int BOOL;
+#endif
+
+/*
+ *	Public Constants
+ */
+// define the version for this program
+#ifndef QUIP_VERSION_MAJOR
+#define QUIP_VERSION_MAJOR		0
+#endif
+#ifndef QUIP_VERSION_MINOR
+#define QUIP_VERSION_MINOR		1
+#endif
+#ifndef QUIP_VERSION_RELEASE
+#define QUIP_VERSION_RELEASE	0
+#endif
+#define QUIP_VERSION	QUIP_VERSION_MAJOR.QUIP_VERSION_MINOR.QUIP_VERSION_RELEASE
+
+/*
+ *	When creating a new cypherword, the array of possibles starts
+ *	this large, and then doubles each time it fills up. This is to
+ *	keep the number of reallocations to a minimum - and since the
+ *	arrays are in an arena, where the old one is left behind, to
+ *	keep what's left behind no bigger than what's in use.
+ */
+#define STARTING_POSSIBLES_SIZE		50
+
+// this is the 26-bit letter set with every letter 'a' to 'z' in it
+#define ALL_LETTERS_MASK			0x03ffffff
+
+/*
+ *	We need to have some structures for dealing with the data.
+ *	Let's put them all here to make it easy.
+ */
+/*
+ *	This is the 'solution' to the quip - the substitution pattern
+ *	that, when applied to the cyphertext yields the plaintext. The
+ *	mapping is read: the legend element in the cyphertext and the
+ *	value of the legend element is the plaintext.
+ */
+typedef union {
+	char a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p, q, r, s, t, u, v, w, x, y, z;
+	char map[26];
+} legend_t;
+typedef legend_t legend;
+typedef legend *legend_ptr;
+
+/*
+ *	All the memory for solving one cyphertext - the cypherwords, their
+ *	possibles, the legends, the search and the solutions - comes out
+ *	of the solve context's arena. It's a list of big chunks that are
+ *	handed out a piece at a time, and nothing is given back until the
+ *	whole arena is reset for the next cyphertext - and that's just a
+ *	matter of starting over at the first chunk. The chunks are kept
+ *	for the next solve, unless there are more than ARENA_RETAIN_SIZE
+ *	bytes of them. An arena is only for one thread at a time.
+ *
+ *	All the arena routines take a NULL arena to mean the heap - with
+ *	malloc(), realloc() and free() - so the same code can work with
+ *	either one.
+ */
+#define ARENA_CHUNK_SIZE		(64 * 1024)
+#define ARENA_RETAIN_SIZE		(16 * 1024 * 1024)
+#define ARENA_ALIGNMENT			16
+
+typedef struct arenaChunk_t {
+	struct arenaChunk_t	*next;
+	size_t				size;
+	size_t				used;
+	// ...and the chunk's memory is right after this
+} arenaChunk_t;
+typedef arenaChunk_t arenaChunk;
+typedef arenaChunk *arenaChunk_ptr;
+// ...the chunk's memory starts this far in, to keep it aligned
+#define ARENA_CHUNK_HEADER		((sizeof(arenaChunk) + (ARENA_ALIGNMENT - 1)) & ~((size_t) (ARENA_ALIGNMENT - 1)))
+
+typedef struct {
+	arenaChunk		*head;
+	arenaChunk		*current;
+	size_t			chunkSize;
+	size_t			retained;
+	// ...the last piece handed out, as it can be given right back
+	void			*last;
+	// ...and what's been asked of it since it was last reset
+	long			allocations;
+	size_t			allocatedBytes;
+	long			chunkAllocations;
+} quipArena_t;
+typedef quipArena_t quipArena;
+typedef quipArena *quipArena_ptr;
+
+/*
+ *	This is the 'meat' of the problem - a single cypherword. This
+ *	word contains it's size (for convenience) and a list of all
+ *	possible matching words based on the structure of the cypherword.
+ *	When a legend is applied to a cypherword, some of the possible
+ *	words will be generated for that legend, and they can be used
+ *	with other 'solutions' from the other cypherwords in the system
+ *	to achieve a total cyphertext 'solution'.
+ *
+ *	Along with each possible plaintext is the set of letters it uses
+ *	as a bit mask - bit 0 is 'a', bit 25 is 'z'. The cypherword also
+ *	has the set of cyphertext letters it uses. With these, a possible
+ *	can often be rejected for a legend without looking at a single
+ *	character - see CanLetterMasksMakePlain().
+ *
+ *	A cyphertext word that appears more than once in the quip is
+ *	only one cypherword - with the number of times it appears. And
+ *	since the possibles only depend on the pattern of the word, all
+ *	the cypherwords with the same pattern share one array of them.
+ *	The shared arrays have a count of the cypherwords using them in
+ *	'possiblesShareCount' - which is NULL when the arrays are not
+ *	shared at all. The possible plaintexts themselves are not
+ *	copies - they point into the dictionary. A cypherword made in an
+ *	arena has everything of its own in that arena, too.
+ */
+typedef struct {
+	quipArena	*arena;
+	int		length;
+	char	*cyphertext;
+	int		occurrences;
+	int		numberOfPossibles;
+	char	**possiblePlaintext;
+	int		possiblePlaintextSize;
+	int		*possiblesShareCount;
+	// these are the 26-bit letter sets used to prefilter possibles
+	unsigned int	cypherLetterMask;
+	unsigned int	*possibleLetterMask;
+} cypherword_t;
+typedef cypherword_t cypherword;
+typedef cypherword *cypherword_ptr;
+
+/*
+ *	The dictionary is the in-memory copy of the words file, and it's
+ *	grouped into buckets by word length. Since every word in a bucket
+ *	is the same length, the words are kept back-to-back in fixed-width
+ *	slots of (length+1) characters - NUL-terminated and in the same
+ *	order as they appeared in the file. Each bucket also has a
+ *	'transposed' copy of the words in blocks of DICTIONARY_LANES
+ *	words where character 'i' of every word in the block are next
+ *	to one another. This is what lets the pattern matcher test an
+ *	entire block of words against a cypherword at once.
+ */
+#define DICTIONARY_LANES			16
+#define STARTING_DICTIONARY_SIZE	64
+
+typedef struct {
+	int				length;
+	int				count;
+	int				size;
+	char			*text;
+	unsigned char	*columns;
+} dictionaryBucket_t;
+typedef dictionaryBucket_t dictionaryBucket;
+typedef dictionaryBucket *dictionaryBucket_ptr;
+
+typedef struct {
+	int					wordCount;
+	int					maxLength;
+	dictionaryBucket	*buckets;
+	// when the buckets are in a mapped image, this is it
+	void				*image;
+	size_t				imageSize;
+} dictionary_t;
+typedef dictionary_t dictionary;
+typedef dictionary *dictionary_ptr;
+
+/*
+ *	A loaded dictionary can be saved as an image - the words and the
+ *	transposed blocks of each bucket, just as they are in memory -
+ *	that any number of processes can map in, read-only, instead of
+ *	loading the words file for themselves. Then they all share the
+ *	one copy in the page cache, and mapping it in takes next to no
+ *	time. The image has the size and modification time of the words
+ *	file it was made from, so it can be made again when that file
+ *	changes. Everything in it is at an offset from the start of the
+ *	image, in the byte order of the machine that made it - so it's
+ *	only good for that machine.
+ */
+#define DICTIONARY_IMAGE_MAGIC		"QUIPDICT"
+#define DICTIONARY_IMAGE_VERSION	1
+#define DICTIONARY_IMAGE_ALIGNMENT	64
+
+typedef struct {
+	char			magic[8];
+	int				version;
+	int				lanes;
+	int				wordCount;
+	int				maxLength;
+	long			sourceSize;
+	long			sourceTime;
+	size_t			imageSize;
+} dictionaryImageHeader_t;
+typedef dictionaryImageHeader_t dictionaryImageHeader;
+typedef dictionaryImageHeader *dictionaryImageHeader_ptr;
+
+typedef struct {
+	int				count;
+	size_t			textOffset;
+	size_t			columnsOffset;
+} dictionaryImageBucket_t;
+typedef dictionaryImageBucket_t dictionaryImageBucket;
+typedef dictionaryImageBucket *dictionaryImageBucket_ptr;
+
+/*
+ *	When matching the dictionary against a cypherword, the pattern of
+ *	the cypherword is boiled down to a list of these checks - pairs
+ *	of character positions that either must, or must not, hold the
+ *	same character. Every position is checked against the first
+ *	occurrence of its cypherchar, and the first occurrences of all
+ *	the distinct cypherchars are checked against each other.
+ */
+typedef struct {
+	int		a;
+	int		b;
+	BOOL	mustBeEqual;
+} patternCheck_t;
+typedef patternCheck_t patternCheck;
+typedef patternCheck *patternCheck_ptr;
+
+/*
+ *	The words file is loaded, and matched against the cypherwords,
+ *	by several threads at once. The file is mapped into memory and
+ *	split into line-aligned chunks - one per thread - and each thread
+ *	loads its chunk into its own dictionary. The chunk dictionaries
+ *	are then appended, in file order, into one. Then each thread
+ *	matches its slice of each bucket against its own copies of the
+ *	cypherwords, and those are appended, in slice order, to the real
+ *	cypherwords. This way the possibles end up in exactly the same
+ *	order as if it were all done on one thread.
+ *
+ *	Each thread gets one of these to say what it's to do, and where
+ *	it's to leave the results. Chunks are never made smaller than
+ *	MIN_INGEST_CHUNK_SIZE bytes, slices never cover fewer than
+ *	MIN_MATCH_SLICE_SIZE words, and no more than MAX_THREADS are used.
+ *	Starting a thread costs more than it saves on anything smaller,
+ *	so a words file the size of the usual one is done on just one.
+ */
+#define MIN_INGEST_CHUNK_SIZE		(1024 * 1024)
+#define MIN_MATCH_SLICE_SIZE		65536
+#define MAX_THREADS					64
+
+typedef struct {
+	char			*data;
+	long			start;
+	long			end;
+	dictionary		*dict;
+	cypherword		**words;
+	int				wordCount;
+	int				slice;
+	int				slices;
+	BOOL			error;
+} ingestTask_t;
+typedef ingestTask_t ingestTask;
+typedef ingestTask *ingestTask_ptr;
+
+/*
+ *	One of the utilities we have at our disposal is a character
+ *	frequency counter. This is useful for looking at the relative
+ *	frequency of both plaintext characters as well as cyphertext
+ *	characters. The routine that calculates these numbers is called
+ *	GenerateCharacterHistogramWithLegend(legend *map, BOOL showHisto)
+ *	and takes a legend to use as the 'givens'. There's also a routine
+ *	that prints out the table of relative hits, etc.
+ */
+typedef struct {
+	int		crossMatch[26][26];
+	int		plaintext[26];
+	int		cyphertext[26];
+} characterFrequencyData_t;
+typedef characterFrequencyData_t characterFrequencyData;
+typedef characterFrequencyData *characterFrequencyData_ptr;
+
+/*
+ *	The word block attack tries the possibles of each cypherword in
+ *	the order they are in the list. By default, that's the order of
+ *	the words file, but they can be re-ordered so that the possibles
+ *	most likely to be part of the solution are tried first. This is
+ *	how each possible is scored for that re-ordering.
+ */
+#define ORDER_BY_LIST					0
+#define ORDER_BY_CROSS_MATCH			1
+#define ORDER_BY_LEAST_CONSTRAINING		2
+
+typedef struct {
+	double	score;
+	int		index;
+} possibleScore_t;
+typedef possibleScore_t possibleScore;
+typedef possibleScore *possibleScore_ptr;
+
+/*
+ *	The word block attack is a depth-first search over the list of
+ *	cypherwords, and this is its stack - the legend each cypherword
+ *	started with, and the next of its possibles to try. It's kept in
+ *	the context so that the search can stop at each solution, and
+ *	pick up again right where it left off.
+ */
+typedef struct {
+	// the cypherword being tried, or -1 when the search is over
+	int				depth;
+	int				*next;
+	legend			*legends;
+	unsigned int	*used;
+	unsigned int	*assigned;
+	time_t			deadline;
+	BOOL			timedOut;
+} wordBlockSearch_t;
+typedef wordBlockSearch_t wordBlockSearch;
+typedef wordBlockSearch *wordBlockSearch_ptr;
+
+/*
+ *	When they're asked for, these are the statistics on how the
+ *	attacks searched for the solutions - for finding out why a quip
+ *	is slow. The word block attack's are by depth, which is the
+ *	cypherword being tried: how many of its possibles were tested,
+ *	how many of those didn't fit the legend, and how many did - the
+ *	nodes. The frequency attack's are the same, by cypherchar, along
+ *	with how many of the legends it made decoded the quip. Every
+ *	possible or letter that didn't fit is counted by why it didn't.
+ */
+#define CONFLICT_CYPHER_MAPPED		0
+#define CONFLICT_PLAIN_TAKEN		1
+#define CONFLICT_SELF_MAPPING		2
+#define CONFLICT_OTHER				3
+#define CONFLICT_CAUSES				4
+
+typedef struct {
+	// the word block attack, by cypherword
+	int				levels;
+	long			*tested;
+	long			*rejected;
+	long			*nodes;
+	int				maxDepth;
+	// the frequency attack, by cypherchar
+	long			freqTested[26];
+	long			freqRejected[26];
+	long			freqNodes[26];
+	int				freqMaxDepth;
+	long			freqLegends;
+	long			freqMisses;
+	// why the possibles and letters didn't fit
+	long			conflicts[CONFLICT_CAUSES];
+	long			duplicates;
+} searchStats_t;
+typedef searchStats_t searchStats;
+typedef searchStats *searchStats_ptr;
+
+/*
+ *	The word block attack can write a trace of its search to a file:
+ *	every possible it tries, in the order it tries them, as a single
+ *	32-bit event - the depth, the index of the possible at that depth,
+ *	and the TRACE_* outcome. The depth of each event says where it
+ *	is in the search tree, as every event after a TRACE_DESCEND that's
+ *	deeper than it is under it. Each search in the file starts with
+ *	a header, then the cyphertext, then each cypherword - a word
+ *	entry, its cyphertext and its possibles, all without NULs, in the
+ *	order they're searched - and then the events, up to a TRACE_END
+ *	event with the TRACE_END_* reason as its index. It's all in the
+ *	byte order of the machine that wrote it, like the dictionary
+ *	image. The events are kept in a buffer of SEARCH_TRACE_BUFFER
+ *	of them, and written when it fills.
+ */
+#define SEARCH_TRACE_MAGIC			"QUIPTRAC"
+#define SEARCH_TRACE_VERSION		1
+#define SEARCH_TRACE_BUFFER			65536
+
+#define TRACE_REJECT_MASKS			0
+#define TRACE_REJECT_LEGEND			1
+#define TRACE_REJECT_FOLD			2
+#define TRACE_DESCEND				3
+#define TRACE_SOLUTION				4
+#define TRACE_END					7
+#define TRACE_OUTCOMES				8
+
+#define TRACE_END_FINISHED			0
+#define TRACE_END_TIMED_OUT			1
+#define TRACE_END_ABANDONED			2
+
+// ...the event packs these into 3, 8 and 21 bits
+#define TRACE_MAX_DEPTH				256
+#define TRACE_MAX_INDEX				((1 << 21) - 1)
+#define TRACE_EVENT(depth, index, outcome)	((((unsigned int) (index)) << 11) | (((unsigned int) (depth)) << 3) | (unsigned int) (outcome))
+#define TRACE_EVENT_OUTCOME(event)	((event) & 0x07)
+#define TRACE_EVENT_DEPTH(event)	(((event) >> 3) & 0xff)
+#define TRACE_EVENT_INDEX(event)	((event) >> 11)
+
+typedef struct {
+	char			magic[8];
+	int				version;
+	int				wordCount;
+	int				cyphertextLength;
+	int				noSelfMapping;
+	int				possibleOrdering;
+} searchTraceHeader_t;
+typedef searchTraceHeader_t searchTraceHeader;
+typedef searchTraceHeader *searchTraceHeader_ptr;
+
+typedef struct {
+	int				length;
+	int				numberOfPossibles;
+} searchTraceWord_t;
+typedef searchTraceWord_t searchTraceWord;
+typedef searchTraceWord *searchTraceWord_ptr;
+
+typedef struct {
+	FILE			*fp;
+	unsigned int	*events;
+	int				count;
+	long			recorded;
+	int				searches;
+	BOOL			inSearch;
+	BOOL			error;
+} searchTrace_t;
+typedef searchTrace_t searchTrace;
+typedef searchTrace *searchTrace_ptr;
+
+/*
+ *	Before the word block attack starts searching, it can estimate
+ *	how big the search is going to be. The product of the number of
+ *	possibles of each cypherword is the most it could be, and it's
+ *	usually way off. A better one is Knuth's: a few random dives from
+ *	the top of the search tree, each taking one of the possibles that
+ *	fit at each level at random, until there are none. The product of
+ *	the number that fit at each level on the way down is what that
+ *	dive says the number of nodes at the next level is, and averaged
+ *	over the dives it's an unbiased estimate of the size of the tree.
+ *	The time for each possible tested is taken from the dives, too, so
+ *	the predicted time is in terms of the machine doing the search.
+ *
+ *	The dives mustn't cost more than what they're predicting, so after
+ *	ESTIMATE_MIN_PROBES of them, they stop once they've tested more
+ *	than ESTIMATE_BUDGET_FRACTION of the possibles they predict the
+ *	search will, or taken more than ESTIMATE_LIMIT_FRACTION of its
+ *	time limit. And when the product of the possibles is no more than
+ *	10^ESTIMATE_BOUND_LOG10, the search is so small that the number
+ *	it can test at most is used, and just one dive is made, for the
+ *	time.
+ *
+ *	With ESTIMATE_REPORT, it's only computed for the caller to look at.
+ *	With ESTIMATE_REFUSE, a search predicted to take longer than its
+ *	time limit isn't started at all - and with ESTIMATE_REROUTE, the
+ *	frequency attack is tried instead, if it wasn't already.
+ */
+#define ESTIMATE_OFF				0
+#define ESTIMATE_REPORT				1
+#define ESTIMATE_REFUSE				2
+#define ESTIMATE_REROUTE			3
+#define ESTIMATE_PROBES				64
+#define ESTIMATE_MIN_PROBES			4
+#define ESTIMATE_BUDGET_FRACTION	0.1
+#define ESTIMATE_LIMIT_FRACTION		0.01
+#define ESTIMATE_BOUND_LOG10		4.0
+#define ESTIMATE_SEED				20021213U
+
+typedef struct {
+	BOOL			done;
+	int				levels;
+	// log10 of the product of the possibles of the cypherwords
+	double			productLog10;
+	// ...and if it's small enough that the bound on the search was used
+	BOOL			bounded;
+	// ...these are the averages over the random dives
+	int				probes;
+	double			tested;
+	double			nodes;
+	double			solutions;
+	// ...and this is what the dives cost, and what the search should
+	long			probeTested;
+	long			probe_ns;
+	double			predicted_us;
+	long			limit_us;
+	BOOL			overBudget;
+	BOOL			refused;
+} searchEstimate_t;
+typedef searchEstimate_t searchEstimate;
+typedef searchEstimate *searchEstimate_ptr;
+
+/*
+ *	With '-Aauto', the attack isn't picked by the caller, but by what
+ *	each is predicted to cost. The word block attack's is the estimate
+ *	of its search, above. The frequency attack's is made the same way:
+ *	random dives through its tree of letters for each cypherchar, with
+ *	the time to test a legend and to try a letter taken from the dives.
+ *	The candidate counts are what the dives go through, and the hints
+ *	are in the legend they start from - the number of them, and the
+ *	share of the cyphertext's letters they cover, are kept along with
+ *	the predictions, so that when the attack that was picked takes more
+ *	than ATTACK_MISPREDICT_FACTOR times what it was predicted to - or
+ *	less than that fraction of it - the misprediction can be looked
+ *	into. Neither is a misprediction under ATTACK_MISPREDICT_FLOOR_US.
+ *	The ATTACK_*_WEIGHT factors are there to tune the model with.
+ *
+ *	A few dives down a lopsided tree can be way off, so the relative
+ *	standard error of the frequency attack's is kept, too - and if
+ *	it's more than ATTACK_MAX_RELATIVE_ERROR, the prediction isn't
+ *	to be trusted, and the word block attack is picked, as it would
+ *	have been without '-Aauto'.
+ */
+#define ATTACK_NONE					0
+#define ATTACK_WORD_BLOCK			1
+#define ATTACK_FREQUENCY			2
+#define ATTACK_WORD_BLOCK_WEIGHT	1.0
+#define ATTACK_FREQUENCY_WEIGHT		1.0
+#define ATTACK_MISPREDICT_FACTOR	4.0
+#define ATTACK_MISPREDICT_FLOOR_US	1000
+#define ATTACK_MAX_RELATIVE_ERROR	0.25
+
+typedef struct {
+	BOOL			done;
+	int				hints;
+	double			coverage;
+	// ...these are what the frequency attack's dives came up with
+	double			frequencyTested;
+	double			frequencyLegends;
+	double			frequencyError;
+	BOOL			unreliable;
+	// ...and this is what each attack was predicted to take
+	double			wordBlock_us;
+	double			frequency_us;
+	int				chosen;
+	long			actual_us;
+	BOOL			mispredicted;
+} attackChoice_t;
+typedef attackChoice_t attackChoice;
+typedef attackChoice *attackChoice_ptr;
+
+/*
+ *	The same quips get solved over and over - often re-enciphered
+ *	with a different key - so the results can be kept in a cache on
+ *	disk. The key for a result is the cyphertext with its letters
+ *	relabeled 'a', 'b', 'c'... in the order they first appear (each
+ *	keeping its case), the known substitutions relabeled the same
+ *	way, and the options that change the answer. Relabeling the
+ *	cyphertext doesn't change its plaintext, so the solutions are
+ *	kept just as they are. With '-x' or the frequency attack, the
+ *	letters themselves matter, and the key isn't relabeled at all.
+ *
+ *	The file is a log of one-line records - a result being added,
+ *	or the ones that were used - each written with a single append,
+ *	so any number of processes can share it. Each one reads what the
+ *	others have added before it looks for a result. The entries in
+ *	memory are a hash table with a list from the most to the least
+ *	recently used, and when they hold more than 'maxBytes' of keys
+ *	and solutions, the least recently used are dropped. The uses are
+ *	just kept in memory until the log gets to be more than
+ *	CACHE_COMPACT_FACTOR times that, and it's rewritten in the order
+ *	they were used with just what's still in the cache - or until
+ *	the cache is closed, and then they're all added at once.
+ */
+#define CACHE_FILE_MAGIC			"quip-cache"
+#define CACHE_FILE_VERSION			2
+#define CACHE_DEFAULT_SIZE			(16 * 1024 * 1024)
+#define CACHE_COMPACT_FACTOR		2
+#define CACHE_STARTING_HASH_SIZE	256
+// this is where the FNV-1a hash of the keys and the dictionary starts
+#define CACHE_HASH_SEED				2166136261U
+#define CACHE_HASH_PRIME			16777619U
+
+typedef struct cacheEntry_t {
+	char				*key;
+	int					solutionCount;
+	char				**solutions;
+	size_t				bytes;
+	// ...and if it's been used since that was in the file
+	BOOL				touched;
+	struct cacheEntry_t	*hashNext;
+	struct cacheEntry_t	*newer;
+	struct cacheEntry_t	*older;
+} cacheEntry_t;
+typedef cacheEntry_t cacheEntry;
+typedef cacheEntry *cacheEntry_ptr;
+
+typedef struct {
+	char			*filename;
+	unsigned int	signature;
+	size_t			maxBytes;
+	size_t			bytes;
+	// this is the file as it was last seen, and how much of it was read
+	size_t			fileBytes;
+	off_t			readOffset;
+	dev_t			fileDevice;
+	ino_t			fileInode;
+	int				entryCount;
+	int				hashSize;
+	cacheEntry		**table;
+	cacheEntry		*newest;
+	cacheEntry		*oldest;
+	int				touchCount;
+	long			hits;
+	long			misses;
+	pthread_mutex_t	lock;
+} quipCache_t;
+typedef quipCache_t quipCache;
+typedef quipCache *quipCache_ptr;
+
+/*
+ *	Solving a quip is done in phases, and the context keeps the time
+ *	spent in each - in microseconds - so that it's easy to see where
+ *	the time goes on the easy quips as well as the hard ones. Loading
+ *	the words isn't done by the context, so that's up to the caller to
+ *	fill in, if it wants it in the report. The output phase is the
+ *	time spent in the solution callback, and it's not counted in the
+ *	attack that found the solution.
+ */
+#define PHASE_LOAD					0
+#define PHASE_PARSE					1
+#define PHASE_MATCH					2
+#define PHASE_CACHE					3
+#define PHASE_HISTOGRAM				4
+#define PHASE_FREQUENCY				5
+#define PHASE_PREPARE				6
+#define PHASE_SEARCH				7
+#define PHASE_OUTPUT				8
+#define PHASE_COUNT					9
+
+/*
+ *	This is what's called with each new solution, if the context has
+ *	one - one that's found again isn't new, and isn't passed on again.
+ *	It returns NO to stop the search.
+ */
+typedef BOOL (*solutionCallback)(char *plaintext, void *userData);
+
+/*
+ *	This is everything about solving one cyphertext - the cypherwords,
+ *	the known substitutions, the legends and solutions found, and the
+ *	options for the attacks. The dictionary it points to is only read
+ *	while solving, so any number of contexts can share one.
+ */
+typedef struct {
+	dictionary		*dict;
+	// ...and the results it can use, and add to, if there are any
+	quipCache		*cache;
+	BOOL			cached;
+	// ...everything else for solving comes out of this
+	quipArena		*arena;
+	char			*initialCyphertext;
+	int				wordCount;
+	cypherword		**words;
+	legend			*userLegend;
+	int				legendCount;
+	legend			**legends;
+	char			**plainText;
+	int				plainTextMaxCnt;
+	int				plainTextCnt;
+	// these are the options on how to solve it
+	BOOL			htmlOutput;
+	// ...and if this is set, the attacks don't print what they're up to
+	BOOL			quiet;
+	int				threadCount;
+	int				possibleOrdering;
+	BOOL			noSelfMapping;
+	// ...and the seconds the frequency attack gets on its own - 0 for the time limit
+	int				frequencyTimeLimit;
+	// this counts the legends tried by the attacks - the search 'nodes'
+	long			searchNodes;
+	// ...and if asked for, this has the details of the search
+	BOOL			collectingStats;
+	searchStats		*stats;
+	// ...and if it's not NULL, the word block attack is traced to this
+	searchTrace		*trace;
+	// ...and if asked for, how big the search was expected to be
+	int				estimateMode;
+	searchEstimate	estimate;
+	// ...and if we're to pick the attack, this is how it was picked
+	BOOL			choosingAttack;
+	attackChoice	choice;
+	// ...or if all of them are to be raced, this is how the race went
+	BOOL			runningPortfolio;
+	struct portfolio_t	*portfolio;
+	// ...and if this is one of the strategies in the race, it's that
+	BOOL			inPortfolio;
+	// ...and if it's not NULL, the attacks stop when this is set
+	volatile int	*cancel;
+	// ...and this is where the time went, by phase
+	long			phaseTime_us[PHASE_COUNT];
+	// these are the letters the frequency attack tries for each cypherchar
+	char			possibleChar[26][26];
+	int				possibleCharHitCnt[26][26];
+	int				possibleCharCount[26];
+	// ...and when it has to give up, and if it did - or was cancelled
+	time_t			frequencyDeadline;
+	BOOL			frequencyTimedOut;
+	// this is the word block attack's search, for resuming it
+	wordBlockSearch	search;
+	// ...and this is who gets the solutions as they're found
+	solutionCallback	onSolution;
+	void			*onSolutionData;
+	BOOL			stopRequested;
+} quipContext_t;
+typedef quipContext_t quipContext;
+typedef quipContext *quipContext_ptr;
+
+/*
+ *	With '-Aportfolio', the attacks are raced against one another -
+ *	the word block attack with each of the orderings of the possibles,
+ *	and the frequency attack - each on a thread with a solve context
+ *	of its own. The cyphertext is split up, matched against the
+ *	dictionary and weeded out just once, and the strategies' contexts
+ *	share those possibles. The first strategy to get through its whole
+ *	search wins - having found all the solutions there are, or proven
+ *	that there aren't any - and the rest are cancelled. The orderings
+ *	all find the same solutions, and in the race the frequency attack
+ *	only reports the legends that decode every cypherword, so it finds
+ *	them, too - and the answer doesn't depend on which one won. If
+ *	none of them does in time, they're all cancelled, and what the
+ *	word block attack in list order found is taken - just what '-W'
+ *	would have found in that time - as what the others found depends
+ *	on how the threads were run. Either way, the solutions are then
+ *	reported by the context that ran the race. The strategies don't
+ *	print anything along the way - how each of them did is in the
+ *	race, for the report and the solve log.
+ */
+#define PORTFOLIO_WORD_BLOCK_LIST					0
+#define PORTFOLIO_WORD_BLOCK_CROSS_MATCH			1
+#define PORTFOLIO_WORD_BLOCK_LEAST_CONSTRAINING		2
+#define PORTFOLIO_FREQUENCY							3
+#define PORTFOLIO_STRATEGIES						4
+
+typedef struct {
+	int					strategy;
+	struct portfolio_t	*portfolio;
+	quipContext			*ctx;
+	pthread_t			thread;
+	BOOL				started;
+	BOOL				finished;
+	BOOL				error;
+	long				nodes;
+	int					solutions;
+	long				elapsed_us;
+} portfolioStrategy_t;
+typedef portfolioStrategy_t portfolioStrategy;
+typedef portfolioStrategy *portfolioStrategy_ptr;
+
+typedef struct portfolio_t {
+	quipContext			*owner;
+	int					timeLimit;
+	struct timespec		start;
+	volatile int		cancel;
+	int					running;
+	// ...the winner is claimed with a compare-and-swap, not the lock
+	volatile int		winner;
+	int					taken;
+	pthread_mutex_t		lock;
+	pthread_cond_t		done;
+	portfolioStrategy	strategies[PORTFOLIO_STRATEGIES];
+} portfolio_t;
+typedef portfolio_t portfolio;
+typedef portfolio *portfolio_ptr;
+
+
+/************************************************************************
+ *
+ *	Library Function Definitions
+ *
+ ************************************************************************/
+// ...these are the arena functions
+quipArena	*CreateArena(size_t chunkSize);
+quipArena	*DestroyArena(quipArena *arena);
+void		ResetArena(quipArena *arena);
+void		*ArenaAlloc(quipArena *arena, size_t size);
+void		*ArenaRealloc(quipArena *arena, void *ptr, size_t oldSize, size_t newSize);
+void		ArenaFree(quipArena *arena, void *ptr);
+char		*ArenaStrdup(quipArena *arena, char *str);
+
+// ...these are the cypherword functions
+BOOL 		DoPatternsMatch(char *cyphertext, char *plaintext);
+BOOL		CanCypherAndLegendMakePlain(char *cyphertext, legend *map, char *plaintext, BOOL mustBeComplete, BOOL noSelfMapping);
+unsigned int	GetLetterMaskOfString(char *str);
+BOOL		CanLetterMasksMakePlain(unsigned int possible, unsigned int assigned, unsigned int used);
+char 		*GetPossibleOfCypherwordForLegend(cypherword *word, legend *map, BOOL mustBeComplete);
+BOOL 		IsCypherwordDecryptedByLegend(cypherword *word, legend *map);
+cypherword 	*CreateCypherword(char *str);
+cypherword	*CreateCypherwordInArena(quipArena *arena, char *str);
+cypherword 	*DestroyCypherword(cypherword *word);
+BOOL 		CheckCypherwordForPossiblePlaintext(cypherword *word, char *str);
+BOOL		AddPossiblePlaintextToCypherword(cypherword *word, char *str);
+BOOL		ShareCypherwordPossibles(cypherword *word, cypherword *owner);
+BOOL		MakeCypherwordPossiblesPrivate(cypherword *word);
+
+// ...these are the dictionary functions
+dictionary	*CreateDictionary();
+dictionary	*DestroyDictionary(dictionary *dict);
+BOOL		AddWordToDictionary(dictionary *dict, char *str);
+BOOL		AppendDictionary(dictionary *dest, dictionary *src);
+int			CompareDictionaryWords(const void *a, const void *b);
+BOOL		RemoveDuplicateWordsFromDictionary(dictionary *dict);
+BOOL		IndexDictionary(dictionary *dict);
+void		*LoadDictionaryChunk(void *arg);
+dictionary	*LoadDictionary(char *filename, int threads);
+BOOL		SaveDictionaryImage(dictionary *dict, char *filename, char *wordsFilename);
+dictionary	*MapDictionaryImage(char *filename, char *wordsFilename);
+dictionary	*AttachDictionaryImage(char *filename, char *wordsFilename, int threads);
+int			CreatePatternChecks(char *cyphertext, patternCheck *checks);
+unsigned int	MatchPatternBlockScalar(unsigned char *block, int count, patternCheck *checks, int checkCount);
+unsigned int	MatchPatternBlockVector(unsigned char *block, int count, patternCheck *checks, int checkCount);
+BOOL		MatchCypherwordToDictionary(cypherword *word, dictionary *dict);
+BOOL		MatchCypherwordToDictionarySlice(cypherword *word, dictionary *dict, int slice, int slices);
+void		*MatchDictionarySlice(void *arg);
+BOOL		MatchCypherwordsToDictionary(cypherword **list, int count, dictionary *dict, int threads);
+
+// ...these are the legend functions
+legend 		*CreateLegend(char cryptChar, char plainChar);
+legend 		*DestroyLegend(legend *map);
+legend 		*DuplicateLegend(legend *map);
+legend 		*CreateDerangedLegend(unsigned int *seed);
+void 		SetLegendToLegend(legend *dest, legend *src);
+BOOL		DoesLegendEqualLegend(legend *a, legend *b);
+void		PrintLegend(legend *map);
+char 		CypherToPlainChar(legend *map, char c);
+char 		PlainToCypherChar(legend *map, char c);
+unsigned int	GetPlainLetterMaskOfLegend(legend *map, unsigned int cypherLetters);
+char 		*CypherToPlainString(legend *map, char *cyphertext);
+char		*CypherToPlainStringInArena(quipArena *arena, legend *map, char *cyphertext);
+char 		*PlainToCypherString(legend *map, char *plaintext);
+
+// ...these are the high-level cypherword and encrypting functions
+BOOL 		ProcessCypherwordsWithDictionary(quipContext *ctx);
+char 		*EncipherPlaintext(char *text, unsigned int *seed, legend **usedLegend, char *hintCypher, char *hintPlain);
+void 		EncryptPlaintext(char *text, BOOL showLegend, BOOL genCmdLine, unsigned int *seed);
+BOOL 		CreateCypherwordsFromCyphertext(quipContext *ctx, char *text);
+
+// ...these are the character frequency counting routines
+characterFrequencyData 	*GenerateCharacterCountsWithLegend(quipContext *ctx, legend *map);
+void 		PrintCrossMatchData(characterFrequencyData *data);
+
+// ...these are the frequency attack functions
+BOOL 		DoFrequencyAttack(quipContext *ctx, legend *map, int maxSec);
+BOOL		BuildFreqAttackCandidates(quipContext *ctx, legend *map);
+void 		BuildFreqAttackLegend(quipContext *ctx, int cyphercharIndex, legend *map);
+void 		TestFreqAttackLegend(quipContext *ctx, legend *map);
+
+// ...these are the word block attack functions
+BOOL		StartWordBlockAttack(quipContext *ctx, legend *map, int maxSec);
+BOOL		NextWordBlockSolution(quipContext *ctx, char **plaintext);
+void		EndWordBlockAttack(quipContext *ctx);
+BOOL 		IncorporateCypherToPlainMapInLegend(char *cyphertext, char *plaintext, legend *map, BOOL noSelfMapping);
+BOOL		ReduceCypherwordDomains(quipContext *ctx, legend *map, BOOL *solvable);
+int			ComparePossibleScores(const void *a, const void *b);
+BOOL		OrderCypherwordPossibles(quipContext *ctx, int ordering, legend *map);
+BOOL		EstimateSearchSize(quipContext *ctx, legend *map, int probes, unsigned int seed, long limit_us, searchEstimate *estimate);
+
+// ...these are the solve context functions
+quipContext	*CreateQuipContext(dictionary *dict);
+quipContext	*DestroyQuipContext(quipContext *ctx);
+void		ResetQuipContext(quipContext *ctx);
+BOOL		SetCyphertextInContext(quipContext *ctx, char *text);
+BOOL		AddKnownSubstitutionToContext(quipContext *ctx, char cypherChar, char plainChar);
+void		SetSolutionCallbackInContext(quipContext *ctx, solutionCallback callback, void *userData);
+BOOL		ReportSolution(quipContext *ctx, char *plaintext);
+BOOL		PrepareCyphertext(quipContext *ctx, int *matchTime_us);
+BOOL		StartSolve(quipContext *ctx, int timeLimit, int *matchTime_us);
+BOOL		SolveNext(quipContext *ctx, char **plaintext, BOOL *finished);
+BOOL		SolveCyphertext(quipContext *ctx, int timeLimit, BOOL tryingFrequencyAttack, BOOL tryingWordBlockAttack, BOOL *finished, int *matchTime_us, int *searchTime_us);
+
+// ...these are the attack choosing functions
+BOOL		EstimateFrequencyAttack(quipContext *ctx, legend *map, int probes, unsigned int seed, attackChoice *choice);
+BOOL		ChooseAttack(quipContext *ctx, legend *map, int maxSec, attackChoice *choice);
+void		CheckAttackChoice(quipContext *ctx, attackChoice *choice, BOOL finished);
+char		*GetAttackName(int attack);
+void		PrintAttackChoice(quipContext *ctx);
+
+// ...these are the portfolio functions
+BOOL		IsSolveCancelled(quipContext *ctx);
+char		*GetPortfolioStrategyName(int strategy);
+quipContext	*CreatePortfolioContext(quipContext *owner, int strategy);
+void		*RunPortfolioStrategy(void *arg);
+BOOL		RunPortfolio(quipContext *ctx, int timeLimit, BOOL *finished);
+void		PrintPortfolio(quipContext *ctx);
+
+// ...these are the search statistics functions
+searchStats	*CreateSearchStats(quipContext *ctx);
+int			GetLegendConflict(char *cyphertext, legend *map, char *plaintext, BOOL noSelfMapping);
+char		*GetConflictName(int cause);
+void		PrintSearchStats(quipContext *ctx);
+void		PrintSearchEstimate(quipContext *ctx);
+
+// ...these are the phase timing functions
+void		AddPhaseTime(quipContext *ctx, int phase, struct timespec *start);
+char		*GetPhaseName(int phase);
+void		PrintPhaseTimes(quipContext *ctx, long total_us);
+
+// ...these are the search trace functions
+searchTrace	*OpenSearchTrace(char *filename);
+searchTrace	*CloseSearchTrace(searchTrace *trace);
+void		FlushSearchTrace(searchTrace *trace);
+BOOL		StartSearchTrace(quipContext *ctx);
+void		AddSearchTraceEvent(searchTrace *trace, int depth, int index, int outcome);
+void		EndSearchTrace(quipContext *ctx);
+
+// ...these are the result cache functions
+unsigned int	HashString(unsigned int hash, char *str, size_t len);
+unsigned int	GetDictionarySignature(dictionary *dict);
+char		*CreateCacheKey(quipContext *ctx, BOOL tryingFrequencyAttack, BOOL tryingWordBlockAttack);
+quipCache	*OpenQuipCache(char *filename, size_t maxBytes, dictionary *dict);
+quipCache	*CloseQuipCache(quipCache *cache);
+cacheEntry	*FindCacheEntry(quipCache *cache, char *key);
+void		UnlinkCacheEntry(quipCache *cache, cacheEntry *entry);
+void		DestroyCacheEntry(cacheEntry *entry);
+BOOL		PutCacheEntry(quipCache *cache, char *key, char **solutions, int solutionCount);
+void		UseCacheEntry(quipCache *cache, cacheEntry *entry);
+BOOL		ReadQuipCacheFile(quipCache *cache, BOOL fromStart);
+BOOL		RefreshQuipCache(quipCache *cache);
+BOOL		AppendQuipCacheRecord(quipCache *cache, char type, cacheEntry *entry);
+BOOL		AppendQuipCacheTouches(quipCache *cache);
+BOOL		CompactQuipCache(quipCache *cache);
+BOOL		LookupQuipCache(quipCache *cache, quipContext *ctx, char *key, BOOL *found);
+BOOL		AddToQuipCache(quipCache *cache, char *key, char **solutions, int solutionCount);
+
+#endif
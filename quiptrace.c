@@ -0,0 +1,669 @@
+/*
+ *	quiptrace.c - reads back a trace of the word block attack, as
+ *				  written by 'quip --trace file', and says what the
+ *				  search did: how the possibles fared at each depth,
+ *				  where the time went - the biggest subtrees, and
+ *				  the ones that never came to anything - and how
+ *				  soon the first solution would have been found if
+ *				  the possibles had been tried in another order.
+ *
+ *				  The search tree is rebuilt from the events alone,
+ *				  so none of this needs the words file, or the
+ *				  solver, to be run again.
+ *
+ *	Copyright 2000 Robert E. Beaty, Ph.D. All Rights Reserved
+ */
+
+/*
+ *	Standard system-level includes
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+/*
+ *	The solving engine - for the format of the trace
+ */
+#include "quip.h"
+
+/*
+ *	Constants
+ */
+// this is how many of the biggest subtrees are shown, by default
+#define DEFAULT_HOT_SUBTREES		10
+
+// these are the orderings of the possibles that are tried out
+#define ORDER_RECORDED				0
+#define ORDER_REVERSED				1
+#define ORDER_SMALLEST_FIRST		2
+#define ORDER_SOLUTIONS_FIRST		3
+#define ORDER_COUNT					4
+
+/*
+ *	This is one search out of the trace file. The cypherwords have
+ *	their possibles back-to-back, 'length' characters each, with no
+ *	NULs. For each event, 'end' is one past the last event under it
+ *	- which is just the next one for all but TRACE_DESCEND - and
+ *	'parent' is the TRACE_DESCEND it's under, or -1 at the top. The
+ *	'solutions' are a running count of the TRACE_SOLUTION events,
+ *	so the number under an event is solutions[end] - solutions[i].
+ */
+typedef struct {
+	int				length;
+	int				numberOfPossibles;
+	char			*cyphertext;
+	char			*possibles;
+} traceWord_t;
+typedef traceWord_t traceWord;
+typedef traceWord *traceWord_ptr;
+
+typedef struct {
+	searchTraceHeader	header;
+	char			*cyphertext;
+	traceWord		*words;
+	unsigned int	*events;
+	long			eventCount;
+	long			eventSize;
+	int				endReason;
+	long			*end;
+	long			*parent;
+	long			*solutions;
+} traceSearch_t;
+typedef traceSearch_t traceSearch;
+typedef traceSearch *traceSearch_ptr;
+
+/*
+ *	Forward references
+ */
+// Reading routines
+BOOL ReadTraceSearch(FILE *fp, traceSearch *search, BOOL *found);
+BOOL BuildTraceTree(traceSearch *search);
+void ClearTraceSearch(traceSearch *search);
+// Summary routines
+char *GetOutcomeName(int outcome);
+char *GetEndReasonName(int reason);
+char *GetOrderName(int order);
+void PrintPossible(traceSearch *search, unsigned int event);
+void PrintDepthTable(traceSearch *search);
+void PrintHotSubtrees(traceSearch *search, int count);
+void PrintDeadWork(traceSearch *search);
+long GetFirstSolutionCost(traceSearch *search, long first, long last, int order, BOOL *found);
+void PrintOrderings(traceSearch *search);
+void SummarizeTraceSearch(traceSearch *search, int number, int hotCount);
+
+
+/************************************************************************
+ *
+ *	Main entry point
+ *
+ ************************************************************************/
+int main(int argc, char *argv[]) {
+	BOOL			error = NO;
+	BOOL			found = YES;
+	char			*traceFilename = NULL;
+	int				hotCount = DEFAULT_HOT_SUBTREES;
+	int				searches = 0;
+	FILE			*fp = NULL;
+	traceSearch		search;
+	int				i;
+
+	memset(&search, 0, sizeof(search));
+
+	// first, see what we've been asked to do
+	for (i = 1; (i < argc) && !error; i++) {
+		if (strncmp(argv[i], "-n", 2) == 0) {
+			hotCount = atoi(&(argv[i][2]));
+		} else if ((argv[i][0] == '-') || (traceFilename != NULL)) {
+			error = YES;
+		} else {
+			traceFilename = argv[i];
+		}
+	}
+	if (error || (traceFilename == NULL)) {
+		error = YES;
+		printf("usage: quiptrace [-n<count>] tracefile\n"
+			   "  -n<count>    show the (count) biggest subtrees [%d]\n"
+			   "  tracefile    is the trace written by 'quip --trace tracefile'\n",
+			   DEFAULT_HOT_SUBTREES);
+	}
+
+	// next, open up the trace
+	if (!error) {
+		fp = fopen(traceFilename, "r");
+		if (fp == NULL) {
+			error = YES;
+			printf("*** Error in main() ***\n"
+				   "    The trace '%s' could not be opened: %s\n",
+				   traceFilename, strerror(errno));
+		}
+	}
+
+	// now read, and sum up, each search in it
+	while (!error && found) {
+		if (!ReadTraceSearch(fp, &search, &found) || (found && !BuildTraceTree(&search))) {
+			error = YES;
+		} else if (found) {
+			searches++;
+			SummarizeTraceSearch(&search, searches, hotCount);
+		}
+		ClearTraceSearch(&search);
+	}
+	if (!error && (searches == 0)) {
+		printf("# there are no searches in the trace '%s'\n", traceFilename);
+	}
+
+	if (fp != NULL) {
+		fclose(fp);
+	}
+
+	return error ? 1 : 0;
+}
+
+
+/************************************************************************
+ *
+ *	Reading routines
+ *
+ ************************************************************************/
+/*
+ *	This routine reads the next search in the trace - its header,
+ *	cyphertext, cypherwords and all its events up to the TRACE_END.
+ *	If there are no more searches, 'found' is NO. A search that was
+ *	cut off - if the solver was killed, say - is read up to where
+ *	it stops, and it's said to have been abandoned.
+ */
+BOOL ReadTraceSearch(FILE *fp, traceSearch *search, BOOL *found) {
+	BOOL			error = NO;
+	BOOL			done = NO;
+	size_t			got;
+	int				i;
+
+	*found = NO;
+
+	// first, the header - if there is one
+	if (!error) {
+		got = fread(&search->header, sizeof(search->header), 1, fp);
+		if (got != 1) {
+			done = YES;
+		} else if ((memcmp(search->header.magic, SEARCH_TRACE_MAGIC, sizeof(search->header.magic)) != 0) ||
+				   (search->header.version != SEARCH_TRACE_VERSION) ||
+				   (search->header.wordCount < 1) || (search->header.wordCount > TRACE_MAX_DEPTH) ||
+				   (search->header.cyphertextLength < 0)) {
+			error = YES;
+			printf("*** Error in ReadTraceSearch() ***\n"
+				   "    This isn't a version %d search trace, or it's been\n"
+				   "    damaged. There's nothing that can be done with it.\n",
+				   SEARCH_TRACE_VERSION);
+		} else {
+			*found = YES;
+		}
+	}
+
+	// ...then the cyphertext and the cypherwords, with their possibles
+	if (!error && !done) {
+		search->cyphertext = (char *) calloc(search->header.cyphertextLength + 1, sizeof(char));
+		search->words = (traceWord *) calloc(search->header.wordCount, sizeof(traceWord));
+		if ((search->cyphertext == NULL) || (search->words == NULL) ||
+			(fread(search->cyphertext, 1, search->header.cyphertextLength, fp) != (size_t) search->header.cyphertextLength)) {
+			error = YES;
+		}
+		for (i = 0; !error && (i < search->header.wordCount); i++) {
+			searchTraceWord		entry;
+
+			if ((fread(&entry, sizeof(entry), 1, fp) != 1) || (entry.length < 1) || (entry.numberOfPossibles < 0)) {
+				error = YES;
+				break;
+			}
+			search->words[i].length = entry.length;
+			search->words[i].numberOfPossibles = entry.numberOfPossibles;
+			search->words[i].cyphertext = (char *) calloc(entry.length + 1, sizeof(char));
+			search->words[i].possibles = (char *) malloc((size_t) entry.length * entry.numberOfPossibles + 1);
+			if ((search->words[i].cyphertext == NULL) || (search->words[i].possibles == NULL) ||
+				(fread(search->words[i].cyphertext, 1, entry.length, fp) != (size_t) entry.length) ||
+				(fread(search->words[i].possibles, entry.length, entry.numberOfPossibles, fp) != (size_t) entry.numberOfPossibles)) {
+				error = YES;
+			}
+		}
+		if (error) {
+			printf("*** Error in ReadTraceSearch() ***\n"
+				   "    The cypherwords of search at the start of the trace\n"
+				   "    could not be read. The trace is cut off or damaged.\n");
+		}
+	}
+
+	// ...and then the events, up to the end of the search
+	if (!error && !done) {
+		unsigned int	event;
+
+		search->endReason = TRACE_END_ABANDONED;
+		while (!error && (fread(&event, sizeof(event), 1, fp) == 1)) {
+			if (TRACE_EVENT_OUTCOME(event) == TRACE_END) {
+				search->endReason = TRACE_EVENT_INDEX(event);
+				break;
+			}
+			if (search->eventCount == search->eventSize) {
+				unsigned int	*more;
+
+				search->eventSize = (search->eventSize > 0 ? 2 * search->eventSize : SEARCH_TRACE_BUFFER);
+				more = (unsigned int *) realloc(search->events, search->eventSize * sizeof(unsigned int));
+				if (more == NULL) {
+					error = YES;
+					printf("*** Error in ReadTraceSearch() ***\n"
+						   "    There isn't the memory for %ld events of the search.\n",
+						   search->eventSize);
+					break;
+				}
+				search->events = more;
+			}
+			search->events[search->eventCount++] = event;
+		}
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine rebuilds the search tree from the events - the end
+ *	of the subtree under each, its parent, and the running count of
+ *	the solutions. The events are in the order they were tried, so a
+ *	subtree ends at the first event that's no deeper than it is.
+ */
+BOOL BuildTraceTree(traceSearch *search) {
+	BOOL			error = NO;
+	long			n = search->eventCount;
+	long			*stack = NULL;
+	int				top = 0;
+	long			i;
+
+	// first, get the room for it all
+	if (!error) {
+		search->end = (long *) malloc((n + 1) * sizeof(long));
+		search->parent = (long *) malloc((n + 1) * sizeof(long));
+		search->solutions = (long *) malloc((n + 1) * sizeof(long));
+		stack = (long *) malloc((TRACE_MAX_DEPTH + 1) * sizeof(long));
+		if ((search->end == NULL) || (search->parent == NULL) ||
+			(search->solutions == NULL) || (stack == NULL)) {
+			error = YES;
+			printf("*** Error in BuildTraceTree() ***\n"
+				   "    There isn't the memory to rebuild the tree of %ld\n"
+				   "    events of the search.\n", n);
+		}
+	}
+
+	// now run through them, keeping the stack of open subtrees
+	if (!error) {
+		search->solutions[0] = 0;
+		for (i = 0; i < n; i++) {
+			int		depth = TRACE_EVENT_DEPTH(search->events[i]);
+
+			while ((top > 0) && (TRACE_EVENT_DEPTH(search->events[stack[top - 1]]) >= depth)) {
+				search->end[stack[--top]] = i;
+			}
+			search->parent[i] = (top > 0 ? stack[top - 1] : -1);
+			search->end[i] = i + 1;
+			if ((TRACE_EVENT_OUTCOME(search->events[i]) == TRACE_DESCEND) && (top < TRACE_MAX_DEPTH)) {
+				stack[top++] = i;
+			}
+			search->solutions[i + 1] = search->solutions[i] +
+				(TRACE_EVENT_OUTCOME(search->events[i]) == TRACE_SOLUTION ? 1 : 0);
+		}
+		while (top > 0) {
+			search->end[stack[--top]] = n;
+		}
+	}
+
+	if (stack != NULL) {
+		free(stack);
+	}
+
+	return !error;
+}
+
+
+/*
+ *	This routine releases everything read for a search, and leaves
+ *	it ready for the next.
+ */
+void ClearTraceSearch(traceSearch *search) {
+	int		i;
+
+	if (search->words != NULL) {
+		for (i = 0; i < search->header.wordCount; i++) {
+			free(search->words[i].cyphertext);
+			free(search->words[i].possibles);
+		}
+		free(search->words);
+	}
+	free(search->cyphertext);
+	free(search->events);
+	free(search->end);
+	free(search->parent);
+	free(search->solutions);
+	memset(search, 0, sizeof(traceSearch));
+}
+
+
+/************************************************************************
+ *
+ *	Summary routines
+ *
+ ************************************************************************/
+/*
+ *	These routines return the names of the TRACE_* outcomes, the
+ *	TRACE_END_* reasons and the ORDER_* orderings, for the reports.
+ */
+char *GetOutcomeName(int outcome) {
+	switch (outcome) {
+		case TRACE_REJECT_MASKS :
+			return "masks";
+		case TRACE_REJECT_LEGEND :
+			return "legend";
+		case TRACE_REJECT_FOLD :
+			return "fold";
+		case TRACE_DESCEND :
+			return "descend";
+		case TRACE_SOLUTION :
+			return "solution";
+		default :
+			return "other";
+	}
+}
+
+
+char *GetEndReasonName(int reason) {
+	switch (reason) {
+		case TRACE_END_FINISHED :
+			return "finished";
+		case TRACE_END_TIMED_OUT :
+			return "timed out";
+		case TRACE_END_ABANDONED :
+			return "abandoned";
+		default :
+			return "unknown";
+	}
+}
+
+
+char *GetOrderName(int order) {
+	switch (order) {
+		case ORDER_RECORDED :
+			return "as recorded";
+		case ORDER_REVERSED :
+			return "reversed";
+		case ORDER_SMALLEST_FIRST :
+			return "smallest subtree first";
+		case ORDER_SOLUTIONS_FIRST :
+			return "solutions first (best case)";
+		default :
+			return "unknown";
+	}
+}
+
+
+/*
+ *	This routine prints the possible that the event tried.
+ */
+void PrintPossible(traceSearch *search, unsigned int event) {
+	traceWord		*word = &(search->words[TRACE_EVENT_DEPTH(event)]);
+	int				index = TRACE_EVENT_INDEX(event);
+
+	if (index < word->numberOfPossibles) {
+		printf("%.*s", word->length, &(word->possibles[(size_t) index * word->length]));
+	} else {
+		printf("#%d", index);
+	}
+}
+
+
+/*
+ *	This routine prints how the possibles fared at each depth - how
+ *	many were tried, what became of them, and the average size of
+ *	the subtrees under the ones that were descended into.
+ */
+void PrintDepthTable(traceSearch *search) {
+	long			counts[TRACE_MAX_DEPTH][TRACE_OUTCOMES];
+	long			below[TRACE_MAX_DEPTH];
+	unsigned int	event;
+	int				d, k;
+	long			i;
+
+	memset(counts, 0, sizeof(counts));
+	memset(below, 0, sizeof(below));
+	for (i = 0; i < search->eventCount; i++) {
+		event = search->events[i];
+		counts[TRACE_EVENT_DEPTH(event)][TRACE_EVENT_OUTCOME(event)]++;
+		if (TRACE_EVENT_OUTCOME(event) == TRACE_DESCEND) {
+			below[TRACE_EVENT_DEPTH(event)] += search->end[i] - i - 1;
+		}
+	}
+
+	printf("# %5s %-16s %9s %12s %10s %10s %10s %10s %9s %12s\n", "depth", "cypherword",
+		   "possibles", "tried", GetOutcomeName(TRACE_REJECT_MASKS), GetOutcomeName(TRACE_REJECT_LEGEND),
+		   GetOutcomeName(TRACE_REJECT_FOLD), GetOutcomeName(TRACE_DESCEND),
+		   GetOutcomeName(TRACE_SOLUTION), "avg_subtree");
+	for (d = 0; d < search->header.wordCount; d++) {
+		long	tried = 0;
+
+		for (k = 0; k < TRACE_OUTCOMES; k++) {
+			tried += counts[d][k];
+		}
+		printf("  %5d %-16s %9d %12ld %10ld %10ld %10ld %10ld %9ld %12.1f\n", d,
+			   search->words[d].cyphertext, search->words[d].numberOfPossibles, tried,
+			   counts[d][TRACE_REJECT_MASKS], counts[d][TRACE_REJECT_LEGEND],
+			   counts[d][TRACE_REJECT_FOLD], counts[d][TRACE_DESCEND], counts[d][TRACE_SOLUTION],
+			   (counts[d][TRACE_DESCEND] > 0 ? (double) below[d] / counts[d][TRACE_DESCEND] : 0.0));
+	}
+}
+
+
+/*
+ *	This routine prints the 'count' biggest subtrees of the search -
+ *	by the number of events in them - with the possibles on the way
+ *	down to each one, which are the words of the partial decoding
+ *	that took all that time to rule in, or out.
+ */
+void PrintHotSubtrees(traceSearch *search, int count) {
+	long		*hot = NULL;
+	int			hotCount = 0;
+	long		i, p;
+	int			j, k;
+
+	hot = (long *) malloc((count > 0 ? count : 1) * sizeof(long));
+	if ((hot == NULL) || (count < 1)) {
+		free(hot);
+		return;
+	}
+
+	// keep the biggest, in order, as we go
+	for (i = 0; i < search->eventCount; i++) {
+		if (TRACE_EVENT_OUTCOME(search->events[i]) != TRACE_DESCEND) {
+			continue;
+		}
+		for (j = hotCount; (j > 0) && ((search->end[hot[j - 1]] - hot[j - 1]) < (search->end[i] - i)); j--) {
+			// looking for where it goes
+		}
+		if (j < count) {
+			for (k = (hotCount < count ? hotCount : count - 1); k > j; k--) {
+				hot[k] = hot[k - 1];
+			}
+			hot[j] = i;
+			if (hotCount < count) {
+				hotCount++;
+			}
+		}
+	}
+
+	printf("# hot subtrees: %12s %9s %5s  %s\n", "events", "solutions", "depth", "possibles from the top");
+	for (j = 0; j < hotCount; j++) {
+		long	path[TRACE_MAX_DEPTH];
+		int		len = 0;
+
+		i = hot[j];
+		printf("  %26ld %9ld %5d  ", search->end[i] - i,
+			   search->solutions[search->end[i]] - search->solutions[i],
+			   TRACE_EVENT_DEPTH(search->events[i]));
+		for (p = i; (p >= 0) && (len < TRACE_MAX_DEPTH); p = search->parent[p]) {
+			path[len++] = p;
+		}
+		while (len > 0) {
+			PrintPossible(search, search->events[path[--len]]);
+			printf("%s", (len > 0 ? " " : "\n"));
+		}
+	}
+
+	free(hot);
+}
+
+
+/*
+ *	This routine prints how much of the search was wasted - the
+ *	events in the subtrees that didn't have a single solution in
+ *	them, counted at the top of each, and the possibles that were
+ *	turned down along the way to the solutions. With no solutions
+ *	at all, it was all wasted, of course.
+ */
+void PrintDeadWork(traceSearch *search) {
+	long		dead = 0;
+	long		deadSubtrees = 0;
+	long		rejects = 0;
+	long		i = 0;
+	int			outcome;
+
+	while (i < search->eventCount) {
+		outcome = TRACE_EVENT_OUTCOME(search->events[i]);
+		if ((outcome == TRACE_DESCEND) && (search->solutions[search->end[i]] == search->solutions[i])) {
+			dead += search->end[i] - i;
+			deadSubtrees++;
+			i = search->end[i];
+		} else {
+			if (outcome != TRACE_DESCEND && outcome != TRACE_SOLUTION) {
+				rejects++;
+			}
+			i++;
+		}
+	}
+
+	printf("# dead work: %ld of %ld events (%.1f%%) in %ld subtrees with no solution, and %ld\n"
+		   "#   possibles turned down on the way to the solutions\n",
+		   dead, search->eventCount, (search->eventCount > 0 ? 100.0 * dead / search->eventCount : 0.0),
+		   deadSubtrees, rejects);
+}
+
+
+/*
+ *	This routine works out how many events it would take to get to
+ *	the first solution among the siblings from 'first' up to 'last'
+ *	if they were tried in the ORDER_* 'order'. A sibling that doesn't
+ *	lead to the solution costs all the events under it - the subtree
+ *	under a possible only depends on the legend it starts with, not
+ *	on when it's tried - and the one that does costs what it takes to
+ *	get down to the solution in it. 'found' says if there's one at
+ *	all; if not, the cost is that of the whole lot.
+ */
+long GetFirstSolutionCost(traceSearch *search, long first, long last, int order, BOOL *found) {
+	long		retval = 0;
+	long		*siblings = NULL;
+	long		count = 0;
+	long		i, j, k, pick;
+	BOOL		below;
+
+	*found = NO;
+
+	// gather up the siblings, in the order they were tried
+	for (i = first; i < last; i = search->end[i]) {
+		count++;
+	}
+	siblings = (long *) malloc((count > 0 ? count : 1) * sizeof(long));
+	if (siblings == NULL) {
+		return last - first;
+	}
+	for (i = first, k = 0; i < last; i = search->end[i]) {
+		siblings[k++] = i;
+	}
+
+	// now try them in the order asked for
+	for (k = 0; (k < count) && !*found; k++) {
+		pick = k;
+		if (order == ORDER_REVERSED) {
+			pick = count - 1 - k;
+		} else if ((order == ORDER_SMALLEST_FIRST) || (order == ORDER_SOLUTIONS_FIRST)) {
+			// ...picking the best of the ones that are left
+			for (j = k + 1; j < count; j++) {
+				if ((order == ORDER_SMALLEST_FIRST) ?
+						((search->end[siblings[j]] - siblings[j]) < (search->end[siblings[pick]] - siblings[pick])) :
+						((search->solutions[search->end[siblings[j]]] > search->solutions[siblings[j]]) &&
+						 (search->solutions[search->end[siblings[pick]]] == search->solutions[siblings[pick]]))) {
+					pick = j;
+				}
+			}
+			i = siblings[k];
+			siblings[k] = siblings[pick];
+			siblings[pick] = i;
+			pick = k;
+		}
+		i = siblings[pick];
+
+		retval++;
+		if (TRACE_EVENT_OUTCOME(search->events[i]) == TRACE_SOLUTION) {
+			*found = YES;
+		} else if (TRACE_EVENT_OUTCOME(search->events[i]) == TRACE_DESCEND) {
+			if (search->solutions[search->end[i]] > search->solutions[i]) {
+				retval += GetFirstSolutionCost(search, i + 1, search->end[i], order, &below);
+				*found = below;
+			} else {
+				retval += search->end[i] - i - 1;
+			}
+		}
+	}
+
+	free(siblings);
+
+	return retval;
+}
+
+
+/*
+ *	This routine prints how many events it would have taken to get
+ *	to the first solution with each of the orderings of the possibles
+ *	at every level. They all take the same events to finish the whole
+ *	search - it's only how soon the first solution shows up that the
+ *	order changes. The order of the cypherwords themselves can't be
+ *	tried this way, as the subtrees would all be different.
+ */
+void PrintOrderings(traceSearch *search) {
+	long		cost;
+	BOOL		found;
+	int			order;
+
+	printf("# events to the first solution, by the order of the possibles:\n");
+	for (order = 0; order < ORDER_COUNT; order++) {
+		cost = (search->eventCount > 0 ? GetFirstSolutionCost(search, 0, search->eventCount, order, &found) : 0);
+		if (search->solutions[search->eventCount] == 0) {
+			printf("  %-28s %12s\n", GetOrderName(order), "-");
+		} else {
+			printf("  %-28s %12ld %6.1f%%\n", GetOrderName(order), cost,
+				   (search->eventCount > 0 ? 100.0 * cost / search->eventCount : 0.0));
+		}
+	}
+}
+
+
+/*
+ *	This routine prints everything there is to say about one search
+ *	out of the trace - the 'number'-th one in it.
+ */
+void SummarizeTraceSearch(traceSearch *search, int number, int hotCount) {
+	printf("# search %d: %d cypherwords, %ld events, %ld solutions, %s%s\n", number,
+		   search->header.wordCount, search->eventCount, search->solutions[search->eventCount],
+		   GetEndReasonName(search->endReason),
+		   (search->endReason == TRACE_END_FINISHED ? "" : " - the tree is cut off"));
+	printf("# cyphertext: %s\n", search->cyphertext);
+	printf("# ordering: %d, no self mapping: %s\n", search->header.possibleOrdering,
+		   (search->header.noSelfMapping ? "yes" : "no"));
+	PrintDepthTable(search);
+	PrintHotSubtrees(search, hotCount);
+	PrintDeadWork(search);
+	PrintOrderings(search);
+}